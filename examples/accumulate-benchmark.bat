@@ -0,0 +1,3 @@
+(load examples/accumulate-benchmark.clp)
+(run-benchmark)
+(exit)
@@ -0,0 +1,3 @@
+(load examples/beta-hash-benchmark.clp)
+(run-benchmark)
+(exit)
@@ -0,0 +1,3 @@
+(load examples/fact-hash-benchmark.clp)
+(run-benchmark)
+(exit)
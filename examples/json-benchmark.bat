@@ -0,0 +1,3 @@
+(load examples/json-benchmark.clp)
+(run-benchmark)
+(exit)
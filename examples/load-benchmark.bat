@@ -0,0 +1,3 @@
+(load examples/load-benchmark.clp)
+(run-benchmark)
+(exit)
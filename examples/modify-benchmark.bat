@@ -0,0 +1,3 @@
+(load examples/modify-benchmark.clp)
+(run-benchmark)
+(exit)
@@ -0,0 +1,3 @@
+(load examples/msgpack-benchmark.clp)
+(run-benchmark)
+(exit)
@@ -0,0 +1,3 @@
+(load examples/range-benchmark.clp)
+(run-benchmark)
+(exit)
@@ -0,0 +1,5 @@
+(set-strategy breadth)
+(load examples/resp-server.clp)
+(reset)
+(run)
+(exit)
@@ -0,0 +1,3 @@
+(load examples/route-benchmark.clp)
+(run-benchmark)
+(exit)
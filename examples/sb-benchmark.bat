@@ -0,0 +1,3 @@
+(load examples/sb-benchmark.clp)
+(run-benchmark)
+(exit)
@@ -0,0 +1,4 @@
+(load examples/server-gzip.clp)
+(reset)
+(run)
+(exit)
@@ -0,0 +1,4 @@
+(load examples/server-tls.clp)
+(reset)
+(run)
+(exit)
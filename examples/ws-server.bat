@@ -0,0 +1,5 @@
+(set-strategy breadth)
+(load examples/ws-server.clp)
+(reset)
+(run)
+(exit)
@@ -0,0 +1,1019 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  10/18/26             */
+   /*                                                     */
+   /*                   AGGREGATE MODULE                  */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: Maintains the aggregate values computed by the   */
+/*   joins of accumulate conditional elements. Each partial  */
+/*   match in the left memory of an aggregate join has a     */
+/*   group recording the matches of the pattern that satisfy */
+/*   the join. The value of the aggregate is updated as      */
+/*   matches are added and removed and sent to the joins     */
+/*   below as a pattern entity holding the value.            */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Gary D. Riley                                        */
+/*                                                           */
+/* Contributing Programmer(s):                               */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
+/*************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "setup.h"
+
+#if DEFRULE_CONSTRUCT
+
+#include "drive.h"
+#include "engine.h"
+#include "envrnmnt.h"
+#include "evaluatn.h"
+#include "exprnops.h"
+#include "extnfunc.h"
+#include "memalloc.h"
+#include "prntutil.h"
+#include "proflfun.h"
+#include "reteutil.h"
+#include "retract.h"
+#include "router.h"
+#include "ruledef.h"
+#include "symbol.h"
+
+#include "aggregat.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+   static void                    AggregateValueFunction(Environment *,UDFContext *,UDFValue *);
+   static void                    PrintAggregateResult(Environment *,const char *,void *);
+   static void                    IncrementAggregateBasisCount(Environment *,void *);
+   static void                    DecrementAggregateBasisCount(Environment *,void *);
+   static bool                    AggregateResultIsDeleted(Environment *,void *);
+   static void                    InitializeAggregateMatch(struct partialMatch *,struct joinNode *);
+   static struct aggregateGroup  *CreateAggregateGroup(Environment *,struct partialMatch *);
+   static void                    AddAggregateLink(Environment *,struct aggregateGroup *,
+                                                   struct partialMatch *,struct joinNode *);
+   static void                    EvaluateAggregateExpression(Environment *,struct joinNode *,CLIPSValue *);
+   static void                    AddAggregateValue(Environment *,struct aggregateGroup *,unsigned int,CLIPSValue *);
+   static void                    RemoveAggregateValue(Environment *,struct aggregateGroup *,unsigned int,CLIPSValue *);
+   static int                     CompareNumbers(CLIPSValue *,CLIPSValue *);
+   static bool                    ReplacesExtreme(unsigned int,CLIPSValue *,CLIPSValue *);
+   static bool                    ComputeAggregateValue(Environment *,unsigned int,struct aggregateGroup *,CLIPSValue *);
+   static void                    UpdateAggregateResult(Environment *,struct aggregateGroup *,struct joinNode *,int);
+   static struct aggregateResult *CreateAggregateResult(Environment *,struct joinNode *,CLIPSValue *);
+   static void                    SupersedeAggregateResult(Environment *,struct aggregateResult *);
+   static void                    ReturnAggregateResult(Environment *,struct aggregateResult *);
+   static void                    AggregateErrorMessage(Environment *,struct joinNode *);
+
+/*********************************************************/
+/* InitializeAggregates: Initializes the pattern entity  */
+/*   used to hold aggregate values and the function used */
+/*   to retrieve them from the join network.             */
+/*********************************************************/
+void InitializeAggregates(
+  Environment *theEnv)
+  {
+   struct patternEntityRecord aggregateInfo =
+      { { "AGGREGATE_VALUE", EXTERNAL_ADDRESS_TYPE,0,0,0,
+          PrintAggregateResult,
+          PrintAggregateResult,
+          NULL,NULL,NULL,NULL,NULL,
+          NULL,NULL,NULL,NULL,NULL
+        },
+        DecrementAggregateBasisCount,
+        IncrementAggregateBasisCount,
+        NULL,
+        NULL,
+        AggregateResultIsDeleted,
+        NULL
+      };
+
+   AllocateEnvironmentData(theEnv,AGGREGATE_DATA,sizeof(struct aggregateData),NULL);
+
+   memcpy(&AggregateData(theEnv)->AggregateInfo,&aggregateInfo,sizeof(struct patternEntityRecord));
+
+   AddUDF(theEnv,"(aggregate-value)","*",0,UNBOUNDED,NULL,AggregateValueFunction,"AggregateValueFunction",NULL);
+  }
+
+/*********************************************************/
+/* AggregateName: Returns the name used for an aggregate */
+/*   in the syntax of the accumulate CE.                 */
+/*********************************************************/
+const char *AggregateName(
+  unsigned int aggregate)
+  {
+   switch (aggregate)
+     {
+      case COUNT_AGGREGATE:
+        return "count";
+
+      case SUM_AGGREGATE:
+        return "sum";
+
+      case MIN_AGGREGATE:
+        return "min";
+
+      case MAX_AGGREGATE:
+        return "max";
+     }
+
+   return "none";
+  }
+
+#if (! RUN_TIME) && (! BLOAD_ONLY)
+
+/**********************************************************/
+/* AggregateGenGetJNValue: Generates the function call    */
+/*   that retrieves the value of the variable bound by an */
+/*   accumulate CE from a partial match.                  */
+/**********************************************************/
+struct expr *AggregateGenGetJNValue(
+  Environment *theEnv,
+  struct lhsParseNode *theNode,
+  int side)
+  {
+   struct expr *theExpression;
+
+   theExpression = GenConstant(theEnv,FCALL,FindFunction(theEnv,"(aggregate-value)"));
+   theExpression->argList = GenConstant(theEnv,INTEGER_TYPE,CreateInteger(theEnv,theNode->joinDepth));
+   theExpression->argList->nextArg = GenConstant(theEnv,INTEGER_TYPE,CreateInteger(theEnv,side));
+
+   return theExpression;
+  }
+
+/************************************************************/
+/* AggregateReplaceGetJNValue: Replaces a reference to the  */
+/*   variable bound by an accumulate CE with the function   */
+/*   call that retrieves its value from a partial match.    */
+/************************************************************/
+void AggregateReplaceGetJNValue(
+  Environment *theEnv,
+  struct expr *theItem,
+  struct lhsParseNode *theNode,
+  int side)
+  {
+   struct expr *theExpression;
+
+   theExpression = AggregateGenGetJNValue(theEnv,theNode,side);
+
+   theItem->type = theExpression->type;
+   theItem->value = theExpression->value;
+   theItem->argList = theExpression->argList;
+
+   theExpression->argList = NULL;
+   ReturnExpression(theEnv,theExpression);
+  }
+
+#endif /* (! RUN_TIME) && (! BLOAD_ONLY) */
+
+/****************************************************************/
+/* AggregateValueFunction: Retrieves the value of an aggregate  */
+/*   from the partial match being evaluated. The arguments are  */
+/*   the join depth of the accumulate CE and the side of the    */
+/*   join from which the partial match is retrieved.            */
+/****************************************************************/
+static void AggregateValueFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   struct expr *theArgument;
+   unsigned short whichPattern;
+   int side;
+   struct partialMatch *theBinds;
+   PatternEntity *theEntity;
+   struct aggregateResult *theResult;
+#if MAC_XCD
+#pragma unused(context)
+#endif
+
+   theArgument = GetFirstArgument();
+   whichPattern = (unsigned short) theArgument->integerValue->contents;
+   side = (int) GetNextArgument(theArgument)->integerValue->contents;
+
+   /*===================================================*/
+   /* Find the partial match containing the aggregate.  */
+   /* The same rules used for retrieving the variables  */
+   /* of fact and instance patterns are followed. A     */
+   /* test CE following an accumulate CE is evaluated   */
+   /* by its own join, so the aggregate referenced from */
+   /* the right is found in the left partial match.     */
+   /*===================================================*/
+
+   if (side == LHS)
+     { theBinds = EngineData(theEnv)->GlobalLHSBinds; }
+   else if ((side == RHS) && (EngineData(theEnv)->GlobalRHSBinds == NULL))
+     { theBinds = EngineData(theEnv)->GlobalLHSBinds; }
+   else if (side == RHS)
+     {
+      theBinds = EngineData(theEnv)->GlobalRHSBinds;
+      whichPattern = 0;
+     }
+   else if (side == NESTED_RHS)
+     { theBinds = EngineData(theEnv)->GlobalRHSBinds; }
+   else if (EngineData(theEnv)->GlobalRHSBinds == NULL)
+     { theBinds = EngineData(theEnv)->GlobalLHSBinds; }
+   else if ((EngineData(theEnv)->GlobalJoin->depth - 1) == whichPattern)
+     {
+      theBinds = EngineData(theEnv)->GlobalRHSBinds;
+      whichPattern = 0;
+     }
+   else
+     { theBinds = EngineData(theEnv)->GlobalLHSBinds; }
+
+   if (get_nth_pm_match(theBinds,whichPattern) == NULL)
+     { theEntity = NULL; }
+   else
+     { theEntity = get_nth_pm_match(theBinds,whichPattern)->matchingItem; }
+
+   if ((theEntity == NULL) ||
+       (theEntity->theInfo != &AggregateData(theEnv)->AggregateInfo))
+     {
+      returnValue->lexemeValue = FalseSymbol(theEnv);
+      return;
+     }
+
+   theResult = (struct aggregateResult *) theEntity;
+   returnValue->value = theResult->value.value;
+  }
+
+/**********************************************************/
+/* PrintAggregateResult: Prints the value of an aggregate */
+/*   when a partial match containing it is displayed.     */
+/**********************************************************/
+static void PrintAggregateResult(
+  Environment *theEnv,
+  const char *logicalName,
+  void *theValue)
+  {
+   struct aggregateResult *theResult = (struct aggregateResult *) theValue;
+
+   WriteString(theEnv,logicalName,"<aggregate ");
+   WriteCLIPSValue(theEnv,logicalName,&theResult->value);
+   WriteString(theEnv,logicalName,">");
+  }
+
+/***************************************************************/
+/* IncrementAggregateBasisCount: Prevents an aggregate result  */
+/*   from being deleted while a rule using it is executing.    */
+/***************************************************************/
+static void IncrementAggregateBasisCount(
+  Environment *theEnv,
+  void *theValue)
+  {
+#if MAC_XCD
+#pragma unused(theEnv)
+#endif
+   struct aggregateResult *theResult = (struct aggregateResult *) theValue;
+
+   theResult->header.busyCount++;
+  }
+
+/*****************************************************************/
+/* DecrementAggregateBasisCount: Deletes an aggregate result     */
+/*   that was superseded while a rule using it was executing.    */
+/*****************************************************************/
+static void DecrementAggregateBasisCount(
+  Environment *theEnv,
+  void *theValue)
+  {
+   struct aggregateResult *theResult = (struct aggregateResult *) theValue;
+
+   theResult->header.busyCount--;
+
+   if ((theResult->header.busyCount == 0) && theResult->superseded)
+     { ReturnAggregateResult(theEnv,theResult); }
+  }
+
+/**************************************************************/
+/* AggregateResultIsDeleted: Indicates whether an aggregate   */
+/*   result has been superseded by a new value. The partial   */
+/*   matches containing a superseded result are about to be   */
+/*   retracted.                                               */
+/**************************************************************/
+static bool AggregateResultIsDeleted(
+  Environment *theEnv,
+  void *theValue)
+  {
+#if MAC_XCD
+#pragma unused(theEnv)
+#endif
+   return ((struct aggregateResult *) theValue)->superseded;
+  }
+
+/*****************************************************************/
+/* AggregateAssertLeft: Handles a partial match entering the     */
+/*   left side of an aggregate join. The matches in the alpha    */
+/*   memory which satisfy the join are recorded in a new group   */
+/*   and the value of the aggregate is sent to the joins below.  */
+/*****************************************************************/
+void AggregateAssertLeft(
+  Environment *theEnv,
+  struct partialMatch *lhsBinds,
+  struct joinNode *join,
+  int operation)
+  {
+   struct aggregateGroup *theGroup;
+   struct partialMatch *rhsBinds;
+   struct partialMatch *oldLHSBinds, *oldRHSBinds;
+   struct joinNode *oldJoin;
+   struct rangeIndexCursor rangeCursor;
+   bool exprResult, checkDeletions = true;
+
+   theGroup = CreateAggregateGroup(theEnv,lhsBinds);
+
+   oldLHSBinds = EngineData(theEnv)->GlobalLHSBinds;
+   oldRHSBinds = EngineData(theEnv)->GlobalRHSBinds;
+   oldJoin = EngineData(theEnv)->GlobalJoin;
+
+   rangeCursor.indexed = false;
+   rhsBinds = GetJoinAlphaMemory(theEnv,join,lhsBinds,lhsBinds->hashValue,&rangeCursor);
+   if ((rhsBinds != NULL) &&
+       (rhsBinds->binds[0].gm.theMatch->matchingItem->theInfo->checkDeletions != NULL))
+     {
+      checkDeletions = (*rhsBinds->binds[0].gm.theMatch->matchingItem->theInfo->checkDeletions)
+                          (theEnv,join->rightSideEntryStructure);
+     }
+
+   while (rhsBinds != NULL)
+     {
+      if ((operation == NETWORK_RETRACT) && checkDeletions && PartialMatchWillBeDeleted(theEnv,rhsBinds))
+        {
+         rhsBinds = rangeCursor.indexed ? NextRangeMatch(&rangeCursor) : rhsBinds->nextInMemory;
+         continue;
+        }
+
+#if DEBUGGING_FUNCTIONS
+      join->memoryCompares++;
+#endif
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { join->hashProbes++; }
+#endif
+
+      EngineData(theEnv)->GlobalLHSBinds = lhsBinds;
+      EngineData(theEnv)->GlobalRHSBinds = rhsBinds;
+      EngineData(theEnv)->GlobalJoin = join;
+
+      exprResult = EvaluateJoinExpression(theEnv,join->networkTest,join);
+      if (EvaluationData(theEnv)->EvaluationError)
+        {
+         exprResult = false;
+         SetEvaluationError(theEnv,false);
+        }
+
+      if (exprResult)
+        { AddAggregateLink(theEnv,theGroup,rhsBinds,join); }
+
+      rhsBinds = rangeCursor.indexed ? NextRangeMatch(&rangeCursor) : rhsBinds->nextInMemory;
+     }
+
+   EngineData(theEnv)->GlobalLHSBinds = oldLHSBinds;
+   EngineData(theEnv)->GlobalRHSBinds = oldRHSBinds;
+   EngineData(theEnv)->GlobalJoin = oldJoin;
+
+   UpdateAggregateResult(theEnv,theGroup,join,operation);
+  }
+
+/*****************************************************************/
+/* AggregateAssertRight: Handles a match of the pattern of an    */
+/*   accumulate CE entering the right side of an aggregate join. */
+/*   The match is added to the group of each partial match in    */
+/*   the left memory it satisfies and any aggregate values that  */
+/*   change are sent to the joins below.                         */
+/*****************************************************************/
+void AggregateAssertRight(
+  Environment *theEnv,
+  struct partialMatch *rhsBinds,
+  struct joinNode *join,
+  int operation)
+  {
+   struct partialMatch *lhsBinds, *nextBind;
+   struct partialMatch *oldLHSBinds, *oldRHSBinds;
+   struct joinNode *oldJoin;
+   bool exprResult;
+
+   oldLHSBinds = EngineData(theEnv)->GlobalLHSBinds;
+   oldRHSBinds = EngineData(theEnv)->GlobalRHSBinds;
+   oldJoin = EngineData(theEnv)->GlobalJoin;
+
+   for (lhsBinds = GetLeftBetaMemory(join,rhsBinds->hashValue);
+        lhsBinds != NULL;
+        lhsBinds = nextBind)
+     {
+      nextBind = lhsBinds->nextInMemory;
+
+      /*=================================================*/
+      /* Partial matches that entered the join while     */
+      /* being deleted don't have a group to update.     */
+      /*=================================================*/
+
+      if ((lhsBinds->hashValue != rhsBinds->hashValue) ||
+          (! lhsBinds->aggregateMarker))
+        { continue; }
+
+#if DEBUGGING_FUNCTIONS
+      join->memoryCompares++;
+#endif
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { join->hashProbes++; }
+#endif
+
+      EngineData(theEnv)->GlobalLHSBinds = lhsBinds;
+      EngineData(theEnv)->GlobalRHSBinds = rhsBinds;
+      EngineData(theEnv)->GlobalJoin = join;
+
+      exprResult = EvaluateJoinExpression(theEnv,join->networkTest,join);
+      if (EvaluationData(theEnv)->EvaluationError)
+        {
+         exprResult = false;
+         SetEvaluationError(theEnv,false);
+        }
+
+      if (exprResult)
+        {
+         AddAggregateLink(theEnv,(struct aggregateGroup *) lhsBinds->marker,rhsBinds,join);
+         UpdateAggregateResult(theEnv,(struct aggregateGroup *) lhsBinds->marker,join,operation);
+        }
+     }
+
+   EngineData(theEnv)->GlobalLHSBinds = oldLHSBinds;
+   EngineData(theEnv)->GlobalRHSBinds = oldRHSBinds;
+   EngineData(theEnv)->GlobalJoin = oldJoin;
+  }
+
+/******************************************************************/
+/* AggregateRetractLink: Removes a match of the pattern of an     */
+/*   accumulate CE from the group it contributes to. Called when  */
+/*   the alpha memory match is retracted. If the value of the     */
+/*   aggregate changes, the partial matches containing the old    */
+/*   value are retracted and the new value is sent to the joins   */
+/*   below.                                                       */
+/******************************************************************/
+void AggregateRetractLink(
+  Environment *theEnv,
+  struct partialMatch *linkMatch,
+  int operation)
+  {
+   struct aggregateLink *theLink = (struct aggregateLink *) linkMatch;
+   struct aggregateGroup *theGroup = theLink->group;
+   struct joinNode *join = (struct joinNode *) linkMatch->owner;
+
+   if (linkMatch->prevRightChild == NULL)
+     { linkMatch->rightParent->children = linkMatch->nextRightChild; }
+   else
+     { linkMatch->prevRightChild->nextRightChild = linkMatch->nextRightChild; }
+
+   if (linkMatch->nextRightChild != NULL)
+     { linkMatch->nextRightChild->prevRightChild = linkMatch->prevRightChild; }
+
+   if (theLink->prev == NULL)
+     { theGroup->links = theLink->next; }
+   else
+     { theLink->prev->next = theLink->next; }
+
+   if (theLink->next != NULL)
+     { theLink->next->prev = theLink->prev; }
+
+   RemoveAggregateValue(theEnv,theGroup,join->aggregate,&theLink->value);
+   if (theLink->value.value != NULL)
+     { ReleaseCV(theEnv,&theLink->value); }
+   rtn_struct(theEnv,aggregateLink,theLink);
+
+   UpdateAggregateResult(theEnv,theGroup,join,operation);
+  }
+
+/*****************************************************************/
+/* ReleaseAggregateGroup: Removes the group of a partial match   */
+/*   being removed from the left memory of an aggregate join.    */
+/*   The partial matches below the join containing the value of  */
+/*   the aggregate have already been removed.                    */
+/*****************************************************************/
+void ReleaseAggregateGroup(
+  Environment *theEnv,
+  struct partialMatch *thePM)
+  {
+   struct aggregateGroup *theGroup = (struct aggregateGroup *) thePM->marker;
+   struct aggregateLink *theLink, *nextLink;
+   struct partialMatch *linkMatch;
+
+   for (theLink = theGroup->links; theLink != NULL; theLink = nextLink)
+     {
+      nextLink = theLink->next;
+      linkMatch = &theLink->theMatch;
+
+      if (linkMatch->prevRightChild == NULL)
+        { linkMatch->rightParent->children = linkMatch->nextRightChild; }
+      else
+        { linkMatch->prevRightChild->nextRightChild = linkMatch->nextRightChild; }
+
+      if (linkMatch->nextRightChild != NULL)
+        { linkMatch->nextRightChild->prevRightChild = linkMatch->prevRightChild; }
+
+      if (theLink->value.value != NULL)
+        { ReleaseCV(theEnv,&theLink->value); }
+      rtn_struct(theEnv,aggregateLink,theLink);
+     }
+
+   if (theGroup->result != NULL)
+     {
+      theGroup->result->superseded = true;
+      if (theGroup->result->header.busyCount == 0)
+        { ReturnAggregateResult(theEnv,theGroup->result); }
+     }
+
+   if (theGroup->extreme.value != NULL)
+     { ReleaseCV(theEnv,&theGroup->extreme); }
+   rtn_struct(theEnv,aggregateGroup,theGroup);
+
+   thePM->marker = NULL;
+   thePM->aggregateMarker = false;
+  }
+
+/****************************************************************/
+/* DestroyAggregateGroup: Returns the group of a partial match  */
+/*   to free memory when the environment is being destroyed.    */
+/****************************************************************/
+void DestroyAggregateGroup(
+  Environment *theEnv,
+  struct partialMatch *thePM)
+  {
+   struct aggregateGroup *theGroup = (struct aggregateGroup *) thePM->marker;
+   struct aggregateLink *theLink, *nextLink;
+
+   for (theLink = theGroup->links; theLink != NULL; theLink = nextLink)
+     {
+      nextLink = theLink->next;
+      rtn_struct(theEnv,aggregateLink,theLink);
+     }
+
+   if (theGroup->result != NULL)
+     { rtn_struct(theEnv,aggregateResult,theGroup->result); }
+
+   rtn_struct(theEnv,aggregateGroup,theGroup);
+
+   thePM->marker = NULL;
+   thePM->aggregateMarker = false;
+  }
+
+/***********************************************************/
+/* InitializeAggregateMatch: Initializes a partial match   */
+/*   embedded in an aggregate link or result. The partial  */
+/*   match is treated as a match from the right memory of  */
+/*   the aggregate join.                                   */
+/***********************************************************/
+static void InitializeAggregateMatch(
+  struct partialMatch *theMatch,
+  struct joinNode *join)
+  {
+   theMatch->betaMemory = true;
+   theMatch->busy = false;
+   theMatch->rhsMemory = true;
+   theMatch->deleting = false;
+   theMatch->goalMarker = false;
+   theMatch->aggregateMarker = false;
+   theMatch->bcount = 1;
+   theMatch->hashValue = 0;
+   theMatch->owner = join;
+   theMatch->marker = NULL;
+   theMatch->dependents = NULL;
+   theMatch->nextInMemory = NULL;
+   theMatch->prevInMemory = NULL;
+   theMatch->children = NULL;
+   theMatch->rightParent = NULL;
+   theMatch->nextRightChild = NULL;
+   theMatch->prevRightChild = NULL;
+   theMatch->leftParent = NULL;
+   theMatch->nextLeftChild = NULL;
+   theMatch->prevLeftChild = NULL;
+   theMatch->blockList = NULL;
+   theMatch->nextBlocked = NULL;
+   theMatch->prevBlocked = NULL;
+   theMatch->binds[0].gm.theValue = NULL;
+  }
+
+/***********************************************************/
+/* CreateAggregateGroup: Creates an empty group for a      */
+/*   partial match in the left memory of an aggregate      */
+/*   join. The group is stored in the marker of the        */
+/*   partial match, which is otherwise unused by the join. */
+/***********************************************************/
+static struct aggregateGroup *CreateAggregateGroup(
+  Environment *theEnv,
+  struct partialMatch *lhsBinds)
+  {
+   struct aggregateGroup *theGroup;
+
+   theGroup = get_struct(theEnv,aggregateGroup);
+   theGroup->lhsBinds = lhsBinds;
+   theGroup->links = NULL;
+   theGroup->result = NULL;
+   theGroup->count = 0;
+   theGroup->numbers = 0;
+   theGroup->floats = 0;
+   theGroup->integerSum = 0;
+   theGroup->floatSum = 0.0;
+   theGroup->extreme.value = NULL;
+
+   lhsBinds->marker = theGroup;
+   lhsBinds->aggregateMarker = true;
+
+   return theGroup;
+  }
+
+/***************************************************************/
+/* AddAggregateLink: Adds a match of the pattern to a group.   */
+/*   The link is made a child of the alpha memory match so it  */
+/*   can be found when the match is retracted. The evaluation  */
+/*   environment must be set for the partial match and match.  */
+/***************************************************************/
+static void AddAggregateLink(
+  Environment *theEnv,
+  struct aggregateGroup *theGroup,
+  struct partialMatch *rhsBinds,
+  struct joinNode *join)
+  {
+   struct aggregateLink *theLink;
+
+   theLink = get_struct(theEnv,aggregateLink);
+   InitializeAggregateMatch(&theLink->theMatch,join);
+   EvaluateAggregateExpression(theEnv,join,&theLink->value);
+   if (theLink->value.value != NULL)
+     { RetainCV(theEnv,&theLink->value); }
+
+   theLink->theMatch.rightParent = rhsBinds;
+   theLink->theMatch.nextRightChild = rhsBinds->children;
+   if (rhsBinds->children != NULL)
+     { rhsBinds->children->prevRightChild = &theLink->theMatch; }
+   rhsBinds->children = &theLink->theMatch;
+
+   theLink->group = theGroup;
+   theLink->prev = NULL;
+   theLink->next = theGroup->links;
+   if (theGroup->links != NULL)
+     { theGroup->links->prev = theLink; }
+   theGroup->links = theLink;
+
+   AddAggregateValue(theEnv,theGroup,join->aggregate,&theLink->value);
+  }
+
+/***************************************************************/
+/* EvaluateAggregateExpression: Evaluates the expression of an */
+/*   sum, min, or max aggregate for a match. Values which are  */
+/*   not numbers are ignored by the aggregate, so NULL is      */
+/*   stored for them (and for the matches of a count).         */
+/***************************************************************/
+static void EvaluateAggregateExpression(
+  Environment *theEnv,
+  struct joinNode *join,
+  CLIPSValue *theValue)
+  {
+   UDFValue theResult;
+
+   theValue->value = NULL;
+
+   if (join->aggregateExpression == NULL)
+     { return; }
+
+   EvaluateExpression(theEnv,join->aggregateExpression,&theResult);
+
+   if (EvaluationData(theEnv)->EvaluationError)
+     {
+      AggregateErrorMessage(theEnv,join);
+      SetEvaluationError(theEnv,false);
+      return;
+     }
+
+   if ((theResult.header->type == INTEGER_TYPE) ||
+       (theResult.header->type == FLOAT_TYPE))
+     { theValue->value = theResult.value; }
+  }
+
+/************************************************************/
+/* AddAggregateValue: Updates the totals of a group for a   */
+/*   match added to the group.                              */
+/************************************************************/
+static void AddAggregateValue(
+  Environment *theEnv,
+  struct aggregateGroup *theGroup,
+  unsigned int aggregate,
+  CLIPSValue *theValue)
+  {
+   theGroup->count++;
+
+   if (theValue->value == NULL)
+     { return; }
+
+   theGroup->numbers++;
+
+   if (theValue->header->type == INTEGER_TYPE)
+     { theGroup->integerSum += theValue->integerValue->contents; }
+   else
+     {
+      theGroup->floats++;
+      theGroup->floatSum += theValue->floatValue->contents;
+     }
+
+   if ((aggregate != MIN_AGGREGATE) && (aggregate != MAX_AGGREGATE))
+     { return; }
+
+   if ((theGroup->extreme.value == NULL) ||
+       ReplacesExtreme(aggregate,theValue,&theGroup->extreme))
+     {
+      if (theGroup->extreme.value != NULL)
+        { ReleaseCV(theEnv,&theGroup->extreme); }
+      theGroup->extreme.value = theValue->value;
+      RetainCV(theEnv,&theGroup->extreme);
+     }
+  }
+
+/***************************************************************/
+/* RemoveAggregateValue: Updates the totals of a group for a   */
+/*   match removed from the group. The remaining matches only  */
+/*   have to be searched for a min or max when the value being */
+/*   removed is the current min or max.                        */
+/***************************************************************/
+static void RemoveAggregateValue(
+  Environment *theEnv,
+  struct aggregateGroup *theGroup,
+  unsigned int aggregate,
+  CLIPSValue *theValue)
+  {
+   struct aggregateLink *theLink;
+
+   theGroup->count--;
+
+   if (theValue->value == NULL)
+     { return; }
+
+   theGroup->numbers--;
+
+   if (theValue->header->type == INTEGER_TYPE)
+     { theGroup->integerSum -= theValue->integerValue->contents; }
+   else
+     {
+      theGroup->floats--;
+      if (theGroup->floats == 0)
+        { theGroup->floatSum = 0.0; }
+      else
+        { theGroup->floatSum -= theValue->floatValue->contents; }
+     }
+
+   if ((aggregate != MIN_AGGREGATE) && (aggregate != MAX_AGGREGATE))
+     { return; }
+
+   if (CompareNumbers(theValue,&theGroup->extreme) != 0)
+     { return; }
+
+   ReleaseCV(theEnv,&theGroup->extreme);
+   theGroup->extreme.value = NULL;
+
+   for (theLink = theGroup->links; theLink != NULL; theLink = theLink->next)
+     {
+      if (theLink->value.value == NULL)
+        { continue; }
+
+      if ((theGroup->extreme.value == NULL) ||
+          ReplacesExtreme(aggregate,&theLink->value,&theGroup->extreme))
+        { theGroup->extreme.value = theLink->value.value; }
+     }
+
+   if (theGroup->extreme.value != NULL)
+     { RetainCV(theEnv,&theGroup->extreme); }
+  }
+
+/********************************************************/
+/* CompareNumbers: Compares two integer or float values */
+/*   returning -1, 0, or 1.                             */
+/********************************************************/
+static int CompareNumbers(
+  CLIPSValue *value1,
+  CLIPSValue *value2)
+  {
+   double d1, d2;
+
+   if ((value1->header->type == INTEGER_TYPE) &&
+       (value2->header->type == INTEGER_TYPE))
+     {
+      if (value1->integerValue->contents < value2->integerValue->contents)
+        { return -1; }
+      else if (value1->integerValue->contents > value2->integerValue->contents)
+        { return 1; }
+
+      return 0;
+     }
+
+   if (value1->header->type == INTEGER_TYPE)
+     { d1 = (double) value1->integerValue->contents; }
+   else
+     { d1 = value1->floatValue->contents; }
+
+   if (value2->header->type == INTEGER_TYPE)
+     { d2 = (double) value2->integerValue->contents; }
+   else
+     { d2 = value2->floatValue->contents; }
+
+   if (d1 < d2)
+     { return -1; }
+   else if (d1 > d2)
+     { return 1; }
+
+   return 0;
+  }
+
+/***********************************************************/
+/* ReplacesExtreme: Determines if a value should replace   */
+/*   the current value of a min or max aggregate.          */
+/***********************************************************/
+static bool ReplacesExtreme(
+  unsigned int aggregate,
+  CLIPSValue *theValue,
+  CLIPSValue *theExtreme)
+  {
+   if (aggregate == MIN_AGGREGATE)
+     { return (CompareNumbers(theValue,theExtreme) < 0); }
+
+   return (CompareNumbers(theValue,theExtreme) > 0);
+  }
+
+/**************************************************************/
+/* ComputeAggregateValue: Computes the value of the aggregate */
+/*   for a group. Returns false if the accumulate CE isn't    */
+/*   satisfied, which happens for a min or max aggregate when */
+/*   none of the matches has a numeric value.                 */
+/**************************************************************/
+static bool ComputeAggregateValue(
+  Environment *theEnv,
+  unsigned int aggregate,
+  struct aggregateGroup *theGroup,
+  CLIPSValue *theValue)
+  {
+   switch (aggregate)
+     {
+      case COUNT_AGGREGATE:
+        theValue->integerValue = CreateInteger(theEnv,(long long) theGroup->count);
+        return true;
+
+      case SUM_AGGREGATE:
+        if (theGroup->floats > 0)
+          { theValue->floatValue = CreateFloat(theEnv,(double) theGroup->integerSum + theGroup->floatSum); }
+        else
+          { theValue->integerValue = CreateInteger(theEnv,theGroup->integerSum); }
+        return true;
+
+      case MIN_AGGREGATE:
+      case MAX_AGGREGATE:
+        if (theGroup->extreme.value == NULL)
+          { return false; }
+        theValue->value = theGroup->extreme.value;
+        return true;
+     }
+
+   return false;
+  }
+
+/****************************************************************/
+/* UpdateAggregateResult: Sends the current value of a group's  */
+/*   aggregate to the joins below the aggregate join. If the    */
+/*   value hasn't changed, nothing needs to be done. Otherwise  */
+/*   the partial matches containing the old value are retracted */
+/*   before those containing the new value are created.         */
+/****************************************************************/
+static void UpdateAggregateResult(
+  Environment *theEnv,
+  struct aggregateGroup *theGroup,
+  struct joinNode *join,
+  int operation)
+  {
+   CLIPSValue theValue;
+   bool satisfied;
+   struct aggregateResult *oldResult;
+
+   satisfied = ComputeAggregateValue(theEnv,join->aggregate,theGroup,&theValue);
+   oldResult = theGroup->result;
+
+   if (oldResult == NULL)
+     { if (! satisfied) return; }
+   else if (satisfied && (oldResult->value.value == theValue.value))
+     { return; }
+
+   if (oldResult != NULL)
+     {
+      theGroup->result = NULL;
+      SupersedeAggregateResult(theEnv,oldResult);
+     }
+
+   if (! satisfied)
+     { return; }
+
+   /*====================================================*/
+   /* Don't send the new value if the partial match from */
+   /* the left memory is about to be removed.            */
+   /*====================================================*/
+
+   if ((operation == NETWORK_RETRACT) &&
+       PartialMatchWillBeDeleted(theEnv,theGroup->lhsBinds))
+     { return; }
+
+   theGroup->result = CreateAggregateResult(theEnv,join,&theValue);
+   PPDrive(theEnv,theGroup->lhsBinds,&theGroup->result->theMatch,join,operation);
+  }
+
+/*************************************************************/
+/* CreateAggregateResult: Creates the pattern entity holding */
+/*   a value of an aggregate along with the partial match    */
+/*   used to merge it with the partial match from the left   */
+/*   memory of the join.                                     */
+/*************************************************************/
+static struct aggregateResult *CreateAggregateResult(
+  Environment *theEnv,
+  struct joinNode *join,
+  CLIPSValue *theValue)
+  {
+   struct aggregateResult *theResult;
+
+   theResult = get_struct(theEnv,aggregateResult);
+
+   theResult->header.header.type = EXTERNAL_ADDRESS_TYPE;
+   theResult->header.theInfo = &AggregateData(theEnv)->AggregateInfo;
+   theResult->header.dependents = NULL;
+   theResult->header.busyCount = 0;
+   theResult->header.timeTag = DefruleData(theEnv)->CurrentEntityTimeTag++;
+
+   theResult->theAlphaMatch.matchingItem = &theResult->header;
+   theResult->theAlphaMatch.markers = NULL;
+   theResult->theAlphaMatch.next = NULL;
+   theResult->theAlphaMatch.bucket = 0;
+   theResult->theAlphaMatch.rangeNode = NULL;
+
+   theResult->value.value = theValue->value;
+   RetainCV(theEnv,&theResult->value);
+   theResult->superseded = false;
+
+   InitializeAggregateMatch(&theResult->theMatch,join);
+   theResult->theMatch.binds[0].gm.theMatch = &theResult->theAlphaMatch;
+
+   return theResult;
+  }
+
+/***************************************************************/
+/* SupersedeAggregateResult: Retracts the partial matches that */
+/*   contain an aggregate value which is no longer current. If */
+/*   a rule using the value is executing, the result is        */
+/*   deleted once the rule has finished.                       */
+/***************************************************************/
+static void SupersedeAggregateResult(
+  Environment *theEnv,
+  struct aggregateResult *theResult)
+  {
+   theResult->superseded = true;
+
+   if (theResult->theMatch.children != NULL)
+     { PosEntryRetractAlpha(theEnv,&theResult->theMatch,NETWORK_RETRACT); }
+
+   if (theResult->header.busyCount == 0)
+     { ReturnAggregateResult(theEnv,theResult); }
+  }
+
+/************************************************************/
+/* ReturnAggregateResult: Returns an aggregate result to    */
+/*   free memory.                                           */
+/************************************************************/
+static void ReturnAggregateResult(
+  Environment *theEnv,
+  struct aggregateResult *theResult)
+  {
+   ReleaseCV(theEnv,&theResult->value);
+   rtn_struct(theEnv,aggregateResult,theResult);
+  }
+
+/***************************************************************/
+/* AggregateErrorMessage: Prints an informational message      */
+/*   indicating which join of a rule generated an error when   */
+/*   the expression of an aggregate was being evaluated.       */
+/***************************************************************/
+static void AggregateErrorMessage(
+  Environment *theEnv,
+  struct joinNode *join)
+  {
+   PrintErrorID(theEnv,"AGGREGAT",1,true);
+   WriteString(theEnv,STDERR,"This error occurred while computing the value of an accumulate CE.\n");
+   WriteString(theEnv,STDERR,"   Problem resides in associated join\n");
+   TraceErrorToRule(theEnv,join,"      ");
+   WriteString(theEnv,STDERR,"\n");
+  }
+
+#endif /* DEFRULE_CONSTRUCT */
@@ -0,0 +1,105 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  10/18/26             */
+   /*                                                     */
+   /*                AGGREGATE HEADER FILE                */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: Maintains the aggregate values computed by the   */
+/*   joins of accumulate conditional elements.               */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Gary D. Riley                                        */
+/*                                                           */
+/* Contributing Programmer(s):                               */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_aggregat
+
+#pragma once
+
+#define _H_aggregat
+
+#include "entities.h"
+#include "match.h"
+#include "network.h"
+#include "reorder.h"
+
+#define AGGREGATE_DATA 68
+
+/********************************************************/
+/* aggregateLink: Records one match of the pattern of   */
+/*   an accumulate CE that contributes to the aggregate */
+/*   of a partial match in the left memory of the join. */
+/*   The link is a child of the alpha memory match, so  */
+/*   it's found when the alpha memory match is removed. */
+/********************************************************/
+struct aggregateLink
+  {
+   struct partialMatch theMatch;
+   CLIPSValue value;
+   struct aggregateGroup *group;
+   struct aggregateLink *prev;
+   struct aggregateLink *next;
+  };
+
+/*******************************************************/
+/* aggregateResult: The pattern entity holding the     */
+/*   value of an aggregate. A new result is created    */
+/*   each time the value changes so that the partial   */
+/*   matches holding the old value can be retracted.   */
+/*******************************************************/
+struct aggregateResult
+  {
+   PatternEntity header;
+   struct alphaMatch theAlphaMatch;
+   CLIPSValue value;
+   bool superseded;
+   struct partialMatch theMatch;
+  };
+
+/*******************************************************/
+/* aggregateGroup: The matches and running totals for  */
+/*   the aggregate of a partial match in the left      */
+/*   memory of an aggregate join.                      */
+/*******************************************************/
+struct aggregateGroup
+  {
+   struct partialMatch *lhsBinds;
+   struct aggregateLink *links;
+   struct aggregateResult *result;
+   unsigned long count;
+   unsigned long numbers;
+   unsigned long floats;
+   long long integerSum;
+   double floatSum;
+   CLIPSValue extreme;
+  };
+
+struct aggregateData
+  {
+   struct patternEntityRecord AggregateInfo;
+  };
+
+#define AggregateData(theEnv) ((struct aggregateData *) GetEnvironmentData(theEnv,AGGREGATE_DATA))
+
+   void                           InitializeAggregates(Environment *);
+   const char                    *AggregateName(unsigned int);
+   void                           AggregateAssertLeft(Environment *,struct partialMatch *,struct joinNode *,int);
+   void                           AggregateAssertRight(Environment *,struct partialMatch *,struct joinNode *,int);
+   void                           AggregateRetractLink(Environment *,struct partialMatch *,int);
+   void                           ReleaseAggregateGroup(Environment *,struct partialMatch *);
+   void                           DestroyAggregateGroup(Environment *,struct partialMatch *);
+#if (! RUN_TIME) && (! BLOAD_ONLY)
+   struct expr                   *AggregateGenGetJNValue(Environment *,struct lhsParseNode *,int);
+   void                           AggregateReplaceGetJNValue(Environment *,struct expr *,struct lhsParseNode *,int);
+#endif
+
+#endif /* _H_aggregat */
@@ -35,6 +35,11 @@
 /*                                                           */
 /*            Static constraint checking is always enabled.  */
 /*                                                           */
+/*      ?.??: Binding occurrences of variables referenced by */
+/*            other constraints or CEs are flagged.          */
+/*                                                           */
+/*            Added variable analysis for the accumulate CE. */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -208,6 +213,19 @@ bool VariableAnalysis(
             ReleaseNandFrames(theEnv,theNandFrames);
             return true;
            }
+
+         /*========================================================*/
+         /* Create the expression evaluated for each match of the  */
+         /* pattern of an accumulate CE to compute the aggregate.  */
+         /*========================================================*/
+
+         if (patternPtr->aggregateExpression != NULL)
+           {
+            if (CheckExpression(theEnv,patternPtr->aggregateExpression,NULL,patternPtr->whichCE,NULL,0) != NULL)
+              { errorFlag = true; }
+            else
+              { patternPtr->aggregateValue = GetvarReplace(theEnv,patternPtr->aggregateExpression,false,false,theNandFrames); }
+           }
         }
 
       /*==============================================================*/
@@ -461,8 +479,18 @@ static bool ProcessVariable(
       theConstraints = GetConstraintRecord(theEnv);
       thePattern->constraints = theConstraints;
       thePattern->constraints->anyAllowed = false;
-      thePattern->constraints->instanceAddressesAllowed = true;
-      thePattern->constraints->factAddressesAllowed = true;
+      if (thePattern->aggregate == COUNT_AGGREGATE)
+        { thePattern->constraints->integersAllowed = true; }
+      else if (thePattern->aggregate != NO_AGGREGATE)
+        {
+         thePattern->constraints->integersAllowed = true;
+         thePattern->constraints->floatsAllowed = true;
+        }
+      else
+        {
+         thePattern->constraints->instanceAddressesAllowed = true;
+         thePattern->constraints->factAddressesAllowed = true;
+        }
       thePattern->derivedConstraints = true;
      }
 
@@ -514,6 +542,23 @@ static bool PropagateVariableDriver(
   bool assignReference,
   ParseNodeType patternHeadType)
   {
+   /*=======================================================*/
+   /* The variable bound to the value of an accumulate CE   */
+   /* is only visible to the CEs following the accumulate.  */
+   /*=======================================================*/
+
+   if ((theNode == patternHead) && (patternHead->aggregate != NO_AGGREGATE))
+     {
+      if (PropagateVariableToNodes(theEnv,patternHead->bottom,theType,variableName,theReference,
+                                   patternHead->beginNandDepth,assignReference,false))
+        {
+         VariableMixingErrorMessage(theEnv,variableName);
+         return true;
+        }
+
+      return false;
+     }
+
    /*===================================================*/
    /* Propagate the variable location to any additional */
    /* constraints associated with the binding variable. */
@@ -554,15 +599,20 @@ static bool PropagateVariableDriver(
                                 patternHead->beginNandDepth,assignReference,true))
      { return true; }
 
+   if (PropagateVariableToNodes(theEnv,patternHead->aggregateExpression,theType,variableName,theReference,
+                                patternHead->beginNandDepth,assignReference,true))
+     { return true; }
+
    /*======================================================*/
    /* Propagate values to other patterns if the pattern in */
-   /* which the variable is found is not a "not" CE or the */
-   /* last pattern within a nand CE.                       */
+   /* which the variable is found is not a "not" CE, an    */
+   /* accumulate CE, or the last pattern within a nand CE. */
    /*======================================================*/
 
    if (((patternHead->pnType == PATTERN_CE_NODE) || (patternHead->pnType == TEST_CE_NODE)) &&
        (patternHead->negated == false) &&
        (patternHead->exists == false) &&
+       (patternHead->aggregate == NO_AGGREGATE) &&
        (patternHead->beginNandDepth <= patternHead->endNandDepth))
      {
       bool ignoreVariableMixing;
@@ -710,6 +760,12 @@ static bool PropagateVariableToNodes(
                                   theReference,startDepth,assignReference,true);
         }
 
+      if (theNode->aggregateExpression != NULL)
+        {
+         PropagateVariableToNodes(theEnv,theNode->aggregateExpression,theType,variableName,
+                                  theReference,startDepth,assignReference,true);
+        }
+
       if (theNode->secondaryExpression != NULL)
         {
          PropagateVariableToNodes(theEnv,theNode->secondaryExpression,theType,variableName,
@@ -760,6 +816,8 @@ static bool PropagateVariableToNodes(
 
          if (assignReference)
            {
+            theReference->referenced = true;
+
             if (theNode->referringNode == NULL)
               { theNode->referringNode = theReference; }
             else if (theReference->pattern == theNode->pattern)
@@ -782,6 +840,7 @@ static bool PropagateVariableToNodes(
         {
          if (theType == MF_VARIABLE) return true;
 
+         theReference->referenced = true;
          theNode->referringNode = theReference;
         }
 
@@ -65,6 +65,9 @@
 /*                                                           */
 /*            Support for named facts.                       */
 /*                                                           */
+/*      ?.??: GetLogicalName accepts external addresses      */
+/*            whose type supplies a logical name.            */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -99,6 +102,7 @@ const char *GetLogicalName(
    Environment *theEnv = context->environment;
    const char *logicalName;
    UDFValue theArg;
+   struct externalAddressType *theType;
 
    if (! UDFNextArgument(context,ANY_TYPE_BITS,&theArg))
      { return NULL; }
@@ -118,6 +122,14 @@ const char *GetLogicalName(
      {
       logicalName = CreateSymbol(theEnv,LongIntegerToString(theEnv,theArg.integerValue->contents))->contents;
      }
+   else if (CVIsType(&theArg,EXTERNAL_ADDRESS_BIT))
+     {
+      theType = EvaluationData(theEnv)->ExternalAddressTypes[theArg.externalAddressValue->type];
+      if ((theType != NULL) && (theType->logicalNameFunction != NULL))
+        { logicalName = (*theType->logicalNameFunction)(theEnv,theArg.externalAddressValue->contents); }
+      else
+        { logicalName = NULL; }
+     }
    else
      { logicalName = NULL; }
 
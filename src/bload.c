@@ -100,7 +100,7 @@ void InitializeBloadData(
    AddClearFunction(theEnv,"bload",ClearBloadCallback,10000,NULL);
 
    BloadData(theEnv)->BinaryPrefixID = "\1\2\3\4CLIPS";
-   BloadData(theEnv)->BinaryVersionID = "V7.00";
+   BloadData(theEnv)->BinaryVersionID = "V7.03";
    BloadData(theEnv)->BinarySizes = (char *) genalloc(theEnv,strlen(sizeBuffer) + 1);
    genstrcpy(BloadData(theEnv)->BinarySizes,sizeBuffer);
   }
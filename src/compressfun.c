@@ -0,0 +1,515 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*            COMPRESSION FUNCTIONS MODULE             */
+/*******************************************************/
+
+/***********************************************************************/
+/* Purpose: Compresses what is printed to a socket connection with a   */
+/*   zlib deflate stream (gzip or zlib framing), and serves static     */
+/*   files with their precompressed .gz sidecars when the client       */
+/*   accepts gzip. Building with NO_ZLIB defined leaves compression    */
+/*   out; static-file and send-file still work without it.             */
+/*                                                                     */
+/* Principal Programmer(s):                                            */
+/*      Ryan P. Johnston                                               */
+/*                                                                     */
+/* Revision History:                                                   */
+/*                                                                     */
+/*      ?.??: Added this file.                                         */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "clips.h"
+
+#include "compressfun.h"
+#include "socketrtr.h"
+#include "tlsfun.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+#ifndef NO_ZLIB
+	static bool                    RunDeflate(struct socketRouter *,int);
+#endif
+	static bool                    AcceptsGzip(const char *);
+
+/*************************************************************/
+/* CompressionFunctionDefinitions: Registers the compression */
+/*   functions.                                              */
+/*************************************************************/
+void CompressionFunctionDefinitions(
+		Environment *theEnv)
+{
+	AddUDF(theEnv,"set-compression","b",2,3,";lsy;y;l",SetCompressionFunction,"SetCompressionFunction",NULL);
+	AddUDF(theEnv,"compression-statistics","bm",1,1,"lsy",CompressionStatisticsFunction,"CompressionStatisticsFunction",NULL);
+	AddUDF(theEnv,"static-file","bm",1,2,"sy",StaticFileFunction,"StaticFileFunction",NULL);
+	AddUDF(theEnv,"send-file","bl",2,2,";lsy;sy",SendFileFunction,"SendFileFunction",NULL);
+}
+
+#ifndef NO_ZLIB
+
+/*************************************************************/
+/* RunDeflate: Feeds the stream's pending input through      */
+/*   deflate with the given flush mode, writing compressed   */
+/*   output to the connection's stream each time the output  */
+/*   buffer fills, and whatever is left at the end.          */
+/*************************************************************/
+static bool RunDeflate(
+		struct socketRouter *sptr,
+		int flush)
+{
+	struct socketCompression *theCompression = sptr->compression;
+	z_stream *stream = &theCompression->stream;
+	size_t produced;
+	int rv;
+
+	do
+	{
+		stream->next_out = theCompression->output;
+		stream->avail_out = COMPRESSION_BUFFER_SIZE;
+
+		rv = deflate(stream,flush);
+		if (rv == Z_STREAM_ERROR)
+		{ return false; }
+
+		produced = COMPRESSION_BUFFER_SIZE - stream->avail_out;
+		if (produced > 0)
+		{
+			if (fwrite(theCompression->output,1,produced,sptr->stream) != produced)
+			{ return false; }
+			theCompression->bytesOut += produced;
+		}
+	}
+	while ((stream->avail_out == 0) ||
+	       ((flush == Z_FINISH) && (rv != Z_STREAM_END)));
+
+	return true;
+}
+
+/*************************************************************/
+/* WriteCompressed: Compresses bytes written to a connection */
+/*   that has compression enabled. Deflate buffers input     */
+/*   internally, so small writes cost little until a flush.  */
+/*************************************************************/
+bool WriteCompressed(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		const void *data,
+		size_t length)
+{
+	z_stream *stream;
+
+	if (sptr->compression == NULL)
+	{ return false; }
+
+	stream = &sptr->compression->stream;
+	stream->next_in = (Bytef *) data;
+	stream->avail_in = (uInt) length;
+	sptr->compression->bytesIn += length;
+
+	return RunDeflate(sptr,Z_NO_FLUSH);
+}
+
+/*************************************************************/
+/* FlushCompressed: Pushes everything compressed so far into */
+/*   the connection's stream with a sync flush, so the peer  */
+/*   can decompress it without waiting for the stream's end. */
+/*************************************************************/
+bool FlushCompressed(
+		Environment *theEnv,
+		struct socketRouter *sptr)
+{
+	if (sptr->compression == NULL)
+	{ return false; }
+
+	sptr->compression->stream.next_in = NULL;
+	sptr->compression->stream.avail_in = 0;
+
+	return RunDeflate(sptr,Z_SYNC_FLUSH);
+}
+
+/*************************************************************/
+/* EndCompression: Finishes the deflate stream, writing the  */
+/*   gzip or zlib trailer, and turns compression off. The    */
+/*   connection's stream is not flushed.                     */
+/*************************************************************/
+bool EndCompression(
+		Environment *theEnv,
+		struct socketRouter *sptr)
+{
+	bool rv;
+
+	if (sptr->compression == NULL)
+	{ return false; }
+
+	sptr->compression->stream.next_in = NULL;
+	sptr->compression->stream.avail_in = 0;
+
+	rv = RunDeflate(sptr,Z_FINISH);
+
+	deflateEnd(&sptr->compression->stream);
+	rm(theEnv,sptr->compression,sizeof(struct socketCompression));
+	sptr->compression = NULL;
+
+	return rv;
+}
+
+#else
+
+bool WriteCompressed(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		const void *data,
+		size_t length)
+{
+	return false;
+}
+
+bool FlushCompressed(
+		Environment *theEnv,
+		struct socketRouter *sptr)
+{
+	return false;
+}
+
+bool EndCompression(
+		Environment *theEnv,
+		struct socketRouter *sptr)
+{
+	return false;
+}
+
+#endif
+
+/*************************************************************/
+/* SetCompressionFunction: H/L access function for           */
+/*   set-compression. Everything printed to the connection   */
+/*   after gzip or deflate is chosen goes through a deflate  */
+/*   stream at the given level (6 by default); none finishes */
+/*   the stream, writing its trailer. Choosing a format      */
+/*   while one is active finishes the old stream first, so   */
+/*   each response body can be its own stream.               */
+/*   (set-compression ?socket gzip|deflate|none <?level>)    */
+/*************************************************************/
+void SetCompressionFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	const char *format;
+#ifndef NO_ZLIB
+	struct socketCompression *theCompression;
+	long long level = Z_DEFAULT_COMPRESSION;
+	int windowBits;
+#endif
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"set-compression: could not find connection\n");
+		return;
+	}
+
+	UDFNextArgument(context,SYMBOL_BIT,&theArg);
+	format = theArg.lexemeValue->contents;
+
+	if ((strcmp(format,"gzip") != 0) &&
+	    (strcmp(format,"deflate") != 0) &&
+	    (strcmp(format,"none") != 0))
+	{
+		WriteString(theEnv,STDERR,"set-compression: format must be gzip, deflate or none\n");
+		return;
+	}
+
+#ifdef NO_ZLIB
+	if (strcmp(format,"none") == 0)
+	{ returnValue->lexemeValue = TrueSymbol(theEnv); }
+	else
+	{ WriteString(theEnv,STDERR,"set-compression: built without zlib\n"); }
+#else
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,INTEGER_BIT,&theArg);
+		level = theArg.integerValue->contents;
+		if ((level < 0) || (level > 9))
+		{
+			WriteString(theEnv,STDERR,"set-compression: level must be from 0 to 9\n");
+			return;
+		}
+	}
+
+	if ((sptr->compression != NULL) && ! EndCompression(theEnv,sptr))
+	{
+		WriteString(theEnv,STDERR,"set-compression: could not finish compressed stream\n");
+		return;
+	}
+
+	if (strcmp(format,"none") == 0)
+	{
+		returnValue->lexemeValue = TrueSymbol(theEnv);
+		return;
+	}
+
+	/*==============================================*/
+	/* Adding 16 to the window bits asks zlib for a */
+	/* gzip header and trailer instead of zlib's.   */
+	/*==============================================*/
+	theCompression = (struct socketCompression *) gm2(theEnv,sizeof(struct socketCompression));
+	memset(&theCompression->stream,0,sizeof(z_stream));
+	theCompression->format = (strcmp(format,"gzip") == 0) ? COMPRESSION_GZIP : COMPRESSION_DEFLATE;
+	theCompression->level = (int) level;
+	theCompression->bytesIn = 0;
+	theCompression->bytesOut = 0;
+
+	windowBits = (theCompression->format == COMPRESSION_GZIP) ? (MAX_WBITS + 16) : MAX_WBITS;
+	if (deflateInit2(&theCompression->stream,(int) level,Z_DEFLATED,windowBits,8,Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		WriteString(theEnv,STDERR,"set-compression: could not start compressed stream\n");
+		rm(theEnv,theCompression,sizeof(struct socketCompression));
+		return;
+	}
+
+	sptr->compression = theCompression;
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+#endif
+}
+
+/*************************************************************/
+/* CompressionStatisticsFunction: H/L access function for    */
+/*   compression-statistics. Returns the format, level, and  */
+/*   bytes in and out of a connection's current compressed   */
+/*   stream, or FALSE if compression is off.                 */
+/*   (compression-statistics ?socket)                        */
+/*************************************************************/
+void CompressionStatisticsFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+#ifndef NO_ZLIB
+	MultifieldBuilder *theMB;
+#endif
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"compression-statistics: could not find connection\n");
+		return;
+	}
+
+#ifndef NO_ZLIB
+	if (sptr->compression == NULL)
+	{ return; }
+
+	theMB = CreateMultifieldBuilder(theEnv,4);
+	MBAppendSymbol(theMB,(sptr->compression->format == COMPRESSION_GZIP) ? "gzip" : "deflate");
+	MBAppendInteger(theMB,(sptr->compression->level < 0) ? 6 : sptr->compression->level);
+	MBAppendInteger(theMB,(long long) sptr->compression->bytesIn);
+	MBAppendInteger(theMB,(long long) sptr->compression->bytesOut);
+	returnValue->multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+#endif
+}
+
+/*************************************************************/
+/* AcceptsGzip: Whether an Accept-Encoding header value      */
+/*   lists gzip (or *) without refusing it with q=0.         */
+/*************************************************************/
+static bool AcceptsGzip(
+		const char *acceptEncoding)
+{
+	const char *token, *end, *nameEnd, *q;
+	size_t nameLength;
+
+	for (token = acceptEncoding; *token != '\0'; token = (*end == ',') ? end + 1 : end)
+	{
+		while ((*token == ' ') || (*token == '\t'))
+		{ token++; }
+
+		end = strchr(token,',');
+		if (end == NULL)
+		{ end = token + strlen(token); }
+
+		nameEnd = token;
+		while ((nameEnd < end) && (*nameEnd != ';') && (*nameEnd != ' ') && (*nameEnd != '\t'))
+		{ nameEnd++; }
+		nameLength = (size_t) (nameEnd - token);
+
+		if (! (((nameLength == 4) && (strncasecmp(token,"gzip",4) == 0)) ||
+		       ((nameLength == 1) && (*token == '*'))))
+		{ continue; }
+
+		q = (const char *) memmem(nameEnd,(size_t) (end - nameEnd),"q=",2);
+		if (q == NULL)
+		{ return true; }
+
+		for (q += 2; q < end; q++)
+		{
+			if (isdigit((unsigned char) *q) && (*q != '0'))
+			{ return true; }
+			if ((*q != '0') && (*q != '.'))
+			{ break; }
+		}
+		return false;
+	}
+
+	return false;
+}
+
+/*************************************************************/
+/* StaticFileFunction: H/L access function for static-file.  */
+/*   Decides which file to serve for a path: its .gz sidecar */
+/*   if the client's Accept-Encoding allows gzip and the     */
+/*   sidecar is at least as new as the file, otherwise the   */
+/*   file itself. Returns a multifield of the path to send,  */
+/*   its content encoding (gzip or identity) and its size,   */
+/*   for the Content-Encoding and Content-Length headers, or */
+/*   FALSE if the path is not a regular file.                */
+/*   (static-file ?path <?acceptEncoding>)                   */
+/*************************************************************/
+void StaticFileFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	const char *path;
+	char *sidecar;
+	size_t sidecarLength;
+	struct stat fileInfo, sidecarInfo;
+	MultifieldBuilder *theMB;
+	bool useSidecar = false;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	UDFNextArgument(context,LEXEME_BITS,&theArg);
+	path = theArg.lexemeValue->contents;
+
+	if ((stat(path,&fileInfo) != 0) || ! S_ISREG(fileInfo.st_mode))
+	{ return; }
+
+	sidecarLength = strlen(path) + strlen(STATIC_FILE_SIDECAR_SUFFIX) + 1;
+	sidecar = (char *) gm2(theEnv,sidecarLength);
+	snprintf(sidecar,sidecarLength,"%s%s",path,STATIC_FILE_SIDECAR_SUFFIX);
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,LEXEME_BITS,&theArg);
+		useSidecar = AcceptsGzip(theArg.lexemeValue->contents) &&
+		             (stat(sidecar,&sidecarInfo) == 0) &&
+		             S_ISREG(sidecarInfo.st_mode) &&
+		             (sidecarInfo.st_mtime >= fileInfo.st_mtime);
+	}
+
+	theMB = CreateMultifieldBuilder(theEnv,3);
+	if (useSidecar)
+	{
+		MBAppendString(theMB,sidecar);
+		MBAppendSymbol(theMB,"gzip");
+		MBAppendInteger(theMB,(long long) sidecarInfo.st_size);
+	}
+	else
+	{
+		MBAppendString(theMB,path);
+		MBAppendSymbol(theMB,"identity");
+		MBAppendInteger(theMB,(long long) fileInfo.st_size);
+	}
+	returnValue->multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+
+	rm(theEnv,sidecar,sidecarLength);
+}
+
+/*************************************************************/
+/* SendFileFunction: H/L access function for send-file.      */
+/*   Copies a file's bytes to a connection's output, through */
+/*   its deflate stream if compression is on. Unlike reading */
+/*   and printing the file a line at a time, binary files    */
+/*   (such as .gz sidecars) arrive intact. Returns the       */
+/*   number of bytes read from the file, or FALSE.           */
+/*   (send-file ?socket ?path)                               */
+/*************************************************************/
+void SendFileFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	FILE *theFile;
+	char *buffer;
+	size_t nread;
+	long long total = 0;
+	bool ok = true;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"send-file: could not find connection\n");
+		return;
+	}
+
+	UDFNextArgument(context,LEXEME_BITS,&theArg);
+
+	if ((theFile = GenOpen(theEnv,theArg.lexemeValue->contents,"rb")) == NULL)
+	{
+		WriteString(theEnv,STDERR,"send-file: could not open ");
+		WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
+		WriteString(theEnv,STDERR,"\n");
+		return;
+	}
+
+	/*============================================*/
+	/* When the kernel encrypts the connection    */
+	/* the file goes out without being read here. */
+	/*============================================*/
+	if ((sptr->compression == NULL) && TlsCanSendFile(sptr))
+	{
+		total = TlsSendFile(theEnv,sptr,fileno(theFile));
+		ok = (total >= 0);
+		GenClose(theEnv,theFile);
+	}
+	else
+	{
+		buffer = (char *) gm2(theEnv,SEND_FILE_BUFFER_SIZE);
+
+		while (ok && ((nread = fread(buffer,1,SEND_FILE_BUFFER_SIZE,theFile)) > 0))
+		{
+			ok = WriteSocketBytes(theEnv,sptr,buffer,nread);
+			total += (long long) nread;
+		}
+
+		if (ferror(theFile))
+		{ ok = false; }
+
+		rm(theEnv,buffer,SEND_FILE_BUFFER_SIZE);
+		GenClose(theEnv,theFile);
+	}
+
+	if (ok)
+	{ returnValue->integerValue = CreateInteger(theEnv,total); }
+	else
+	{ WriteString(theEnv,STDERR,"send-file: could not send file\n"); }
+}
@@ -0,0 +1,67 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*            COMPRESSION FUNCTIONS HEADER             */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: Streaming gzip/deflate compression of socket     */
+/*   connection output and precompressed static files.       */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_compressfun
+
+#pragma once
+
+#define _H_compressfun
+
+#include <stddef.h>
+
+#ifndef NO_ZLIB
+#include <zlib.h>
+#endif
+
+#define COMPRESSION_BUFFER_SIZE 16384
+#define SEND_FILE_BUFFER_SIZE 65536
+#define STATIC_FILE_SIDECAR_SUFFIX ".gz"
+
+struct socketRouter;
+
+enum compressionFormat
+  {
+   COMPRESSION_GZIP,
+   COMPRESSION_DEFLATE
+  };
+
+#ifndef NO_ZLIB
+struct socketCompression
+  {
+   z_stream stream;
+   enum compressionFormat format;
+   int level;
+   unsigned long long bytesIn;
+   unsigned long long bytesOut;
+   unsigned char output[COMPRESSION_BUFFER_SIZE];
+  };
+#endif
+
+   bool                           WriteCompressed(Environment *,struct socketRouter *,const void *,size_t);
+   bool                           FlushCompressed(Environment *,struct socketRouter *);
+   bool                           EndCompression(Environment *,struct socketRouter *);
+   void                           CompressionFunctionDefinitions(Environment *);
+   void                           SetCompressionFunction(Environment *,UDFContext *,UDFValue *);
+   void                           CompressionStatisticsFunction(Environment *,UDFContext *,UDFValue *);
+   void                           StaticFileFunction(Environment *,UDFContext *,UDFValue *);
+   void                           SendFileFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_compressfun */
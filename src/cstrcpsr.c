@@ -64,6 +64,9 @@
 /*            File name/line count displayed for errors      */
 /*            and warnings during load command.              */
 /*                                                           */
+/*      ?.??: Regular files are mapped into memory by load   */
+/*            and parsed directly from the mapped buffer.    */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -112,6 +115,10 @@ LoadError Load(
    FILE *theFile;
    char *oldParsingFileName;
    int noErrorsDetected;
+   char *fileBuffer;
+   size_t fileLength;
+   const char *oldRouter, *oldString;
+   long oldIndex;
 
    /*=======================================*/
    /* Open the file specified by file name. */
@@ -121,12 +128,43 @@ LoadError Load(
      { return LE_OPEN_FILE_ERROR; }
 
    /*===================================================*/
-   /* Read in the constructs. Enabling fast load allows */
-   /* the router system to be bypassed for quicker load */
-   /* times.                                            */
+   /* If the file can be mapped into memory (and has no */
+   /* embedded NUL characters), the constructs are read */
+   /* directly from the mapped buffer using the fast    */
+   /* string get option. The file pointer is used as    */
+   /* the logical name in either case.                  */
    /*===================================================*/
 
-   SetFastLoad(theEnv,theFile);
+   fileBuffer = GenMapFile(theEnv,theFile,&fileLength);
+   if ((fileBuffer != NULL) &&
+       (memchr(fileBuffer,'\0',fileLength) != NULL))
+     {
+      GenUnmapFile(theEnv,fileBuffer,fileLength);
+      fileBuffer = NULL;
+     }
+
+   if (fileBuffer != NULL)
+     {
+      oldRouter = RouterData(theEnv)->FastCharGetRouter;
+      oldString = RouterData(theEnv)->FastCharGetString;
+      oldIndex = RouterData(theEnv)->FastCharGetIndex;
+
+      RouterData(theEnv)->FastCharGetRouter = (char *) theFile;
+      RouterData(theEnv)->FastCharGetString = fileBuffer;
+      RouterData(theEnv)->FastCharGetIndex = (long) GenTell(theEnv,theFile);
+     }
+
+   /*===================================================*/
+   /* Otherwise, enabling fast load allows the router   */
+   /* system to be bypassed for quicker load times.     */
+   /*===================================================*/
+
+   else
+     { SetFastLoad(theEnv,theFile); }
+
+   /*=========================*/
+   /* Read in the constructs. */
+   /*=========================*/
 
    oldParsingFileName = CopyString(theEnv,GetParsingFileName(theEnv));
    SetParsingFileName(theEnv,fileName);
@@ -141,7 +179,16 @@ LoadError Load(
    SetWarningFileName(theEnv,NULL);
    SetErrorFileName(theEnv,NULL);
 
-   SetFastLoad(theEnv,NULL);
+   if (fileBuffer != NULL)
+     {
+      RouterData(theEnv)->FastCharGetRouter = oldRouter;
+      RouterData(theEnv)->FastCharGetString = oldString;
+      RouterData(theEnv)->FastCharGetIndex = oldIndex;
+
+      GenUnmapFile(theEnv,fileBuffer,fileLength);
+     }
+   else
+     { SetFastLoad(theEnv,NULL); }
 
    /*=================*/
    /* Close the file. */
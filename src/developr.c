@@ -50,6 +50,9 @@
 /*                                                           */
 /*            Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: Pattern network display includes the range     */
+/*            index expression.                              */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -454,9 +457,19 @@ static void ShowFactPatternNetworkDriver(
       if (patternPtr->header.rightHash == NULL) WriteString(theEnv,STDOUT,"None");
       else PrintExpression(theEnv,STDOUT,patternPtr->header.rightHash);
 
+      if (patternPtr->header.rightRange != NULL)
+        {
+         WriteString(theEnv,STDOUT," RightRange: ");
+         PrintExpression(theEnv,STDOUT,patternPtr->header.rightRange);
+        }
+
       WriteString(theEnv,STDOUT," Filter: ");
       if (patternPtr->modifySlots == NULL) WriteString(theEnv,STDOUT,"None");
       else PrintAtom(theEnv,STDOUT,BITMAP_TYPE,patternPtr->modifySlots);
+
+      WriteString(theEnv,STDOUT," Tested: ");
+      if (patternPtr->testedSlots == NULL) WriteString(theEnv,STDOUT,"None");
+      else PrintAtom(theEnv,STDOUT,BITMAP_TYPE,patternPtr->testedSlots);
       
       WriteString(theEnv,STDOUT,"\n");
 
@@ -606,6 +619,11 @@ static void PrintOPNLevel(
             WriteString(theEnv,STDOUT," RH: ");
             PrintExpression(theEnv,STDOUT,alphaPtr->header.rightHash);
            }
+         if (alphaPtr->header.rightRange != NULL)
+           {
+            WriteString(theEnv,STDOUT," RR: ");
+            PrintExpression(theEnv,STDOUT,alphaPtr->header.rightRange);
+           }
 
          WriteString(theEnv,STDOUT,"\n");
          alphaPtr = alphaPtr->nxtInGroup;
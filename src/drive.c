@@ -51,6 +51,18 @@
 /*                                                           */
 /*            Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: Not and exists CEs entered from the left use   */
+/*            the range index of the alpha memory.           */
+/*                                                           */
+/*            Added support for the accumulate CE.           */
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
+/*            Join keys are hashed by value and mixed.       */
+/*                                                           */
+/*            Added NetworkReattachMatch for the matches     */
+/*            kept by the modify command.                    */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -61,6 +73,7 @@
 #if DEFRULE_CONSTRUCT
 
 #include "agenda.h"
+#include "aggregat.h"
 #include "constant.h"
 #include "engine.h"
 #include "envrnmnt.h"
@@ -69,6 +82,7 @@
 #include "lgcldpnd.h"
 #include "memalloc.h"
 #include "prntutil.h"
+#include "proflfun.h"
 #include "reteutil.h"
 #include "retract.h"
 #include "router.h"
@@ -85,6 +99,12 @@
 
    static void                    EmptyDrive(Environment *,struct joinNode *,struct partialMatch *,int);
    static void                    JoinNetErrorMessage(Environment *,struct joinNode *);
+   static void                    ReattachBetaMatch(Environment *,struct partialMatch *,struct joinNode *);
+   static void                    ReattachLinkedMatches(Environment *,struct partialMatch *,struct joinNode *,bool);
+   static void                    ReattachJoinedMatches(Environment *,struct partialMatch *,struct joinNode *,bool);
+   static void                    AppendReattachGroup(struct partialMatch *,struct partialMatch **,struct partialMatch **);
+   static void                    ReattachBlockedMatches(Environment *,struct partialMatch *,struct joinNode *,
+                                                         struct partialMatch **);
 
 /************************************************/
 /* NetworkAssert: Primary routine for filtering */
@@ -110,6 +130,10 @@ void NetworkAssert(
 
    if (join->firstJoin)
      {
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { join->rightActivations++; }
+#endif
       EmptyDrive(theEnv,join,binds,NETWORK_ASSERT);
       return;
      }
@@ -149,12 +173,28 @@ void NetworkAssertRight(
    if (EngineData(theEnv)->IncrementalResetInProgress && (join->initialize == false)) return;
 #endif
 
+#if PROFILING_FUNCTIONS
+   if (ProfileFunctionData(theEnv)->ProfileJoins)
+     { join->rightActivations++; }
+#endif
+
    if (join->firstJoin)
      {
       EmptyDrive(theEnv,join,rhsBinds,operation);
       return;
      }
 
+   /*=============================================*/
+   /* The match of the pattern of an accumulate   */
+   /* CE updates the aggregates it's a part of.   */
+   /*=============================================*/
+
+   if (join->aggregate != NO_AGGREGATE)
+     {
+      AggregateAssertRight(theEnv,rhsBinds,join,operation);
+      return;
+     }
+
    /*=====================================================*/
    /* The partial matches entering from the LHS of a join */
    /* are stored in the left beta memory of the join.     */
@@ -194,6 +234,10 @@ void NetworkAssertRight(
 #if DEBUGGING_FUNCTIONS
       join->memoryCompares++;
 #endif
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { join->hashProbes++; }
+#endif
 
       /*===========================================================*/
       /* Initialize some variables pointing to the partial matches */
@@ -348,6 +392,7 @@ void NetworkAssertLeft(
    struct partialMatch *oldRHSBinds = NULL;
    struct joinNode *oldJoin = NULL;
    bool checkDeletions = true;
+   struct rangeIndexCursor rangeCursor;
 
    if ((operation == NETWORK_RETRACT) && PartialMatchWillBeDeleted(theEnv,lhsBinds))
      { return; }
@@ -361,6 +406,11 @@ void NetworkAssertLeft(
    if (EngineData(theEnv)->IncrementalResetInProgress && (join->initialize == false)) return;
 #endif
 
+#if PROFILING_FUNCTIONS
+   if (ProfileFunctionData(theEnv)->ProfileJoins)
+     { join->leftActivations++; }
+#endif
+
    /*===================================*/
    /* The only action for the last join */
    /* of a rule is to activate it.      */
@@ -372,6 +422,17 @@ void NetworkAssertLeft(
       return;
      }
 
+   /*================================================*/
+   /* The partial match entering an aggregate join   */
+   /* computes the aggregate of the pattern matches. */
+   /*================================================*/
+
+   if (join->aggregate != NO_AGGREGATE)
+     {
+      AggregateAssertLeft(theEnv,lhsBinds,join,operation);
+      return;
+     }
+
    /*=====================================*/
    /* Handle a join handling a test CE at */
    /* the beginning of a not/and group.   */
@@ -412,12 +473,13 @@ void NetworkAssertLeft(
    /*==================================================*/
 
    entryHashValue = lhsBinds->hashValue;
+   rangeCursor.indexed = false;
    if (join->joinFromTheRight)
      { rhsBinds = GetRightBetaMemory(join,entryHashValue); }
    else
      {
       struct patternNodeHeader *theHeader = (struct patternNodeHeader *) join->rightSideEntryStructure;
-      rhsBinds = GetAlphaMemory(theEnv,theHeader,entryHashValue);
+      rhsBinds = GetJoinAlphaMemory(theEnv,join,lhsBinds,entryHashValue,&rangeCursor);
       if (rhsBinds != NULL)
         {
          PatternEntity *theEntity;
@@ -457,13 +519,17 @@ void NetworkAssertLeft(
      {
       if ((operation == NETWORK_RETRACT) && checkDeletions && PartialMatchWillBeDeleted(theEnv,rhsBinds))
         {
-         rhsBinds = rhsBinds->nextInMemory;
+         rhsBinds = rangeCursor.indexed ? NextRangeMatch(&rangeCursor) : rhsBinds->nextInMemory;
          continue;
         }
         
 #if DEBUGGING_FUNCTIONS
       join->memoryCompares++;
 #endif
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { join->hashProbes++; }
+#endif
 
       /*===================================================*/
       /* If the join has no expression associated with it, */
@@ -569,7 +635,7 @@ void NetworkAssertLeft(
       /* Move on to the next partial match. */
       /*====================================*/
 
-      rhsBinds = rhsBinds->nextInMemory;
+      rhsBinds = rangeCursor.indexed ? NextRangeMatch(&rangeCursor) : rhsBinds->nextInMemory;
      }
 
    /*==================================================================*/
@@ -647,6 +713,13 @@ bool EvaluateJoinExpression(
 
    if (joinExpr == NULL) return true;
 
+#if PROFILING_FUNCTIONS
+   if ((joinPtr != NULL) &&
+       ProfileFunctionData(theEnv)->ProfileJoins &&
+       ((joinExpr == joinPtr->networkTest) || (joinExpr == joinPtr->secondaryNetworkTest)))
+     { joinPtr->testEvaluations++; }
+#endif
+
    /*====================================================*/
    /* Initialize some variables which allow this routine */
    /* to avoid calling the "and" and "or" functions if   */
@@ -822,11 +895,6 @@ unsigned long BetaMemoryHashValue(
    struct joinNode *oldJoin;
    unsigned long hashValue = 0;
    unsigned long multiplier = 1;
-   union
-     {
-      void *vv;
-      unsigned long liv;
-     } fis;
 
    /*======================================*/
    /* A NULL expression evaluates to zero. */
@@ -877,37 +945,7 @@ unsigned long BetaMemoryHashValue(
       else
         { EvaluateExpression(theEnv,hashExpr,&theResult); }
 
-      switch (theResult.header->type)
-        {
-         case STRING_TYPE:
-         case SYMBOL_TYPE:
-         case INSTANCE_NAME_TYPE:
-           hashValue += theResult.lexemeValue->bucket * multiplier;
-           break;
-
-         case INTEGER_TYPE:
-            hashValue += (theResult.integerValue->bucket * multiplier);
-            break;
-
-         case FLOAT_TYPE:
-           hashValue += (theResult.floatValue->bucket * multiplier);
-           break;
-
-          case FACT_ADDRESS_TYPE:
-#if OBJECT_SYSTEM
-          case INSTANCE_ADDRESS_TYPE:
-#endif
-            fis.liv = 0;
-            fis.vv = theResult.value;
-            hashValue += fis.liv * multiplier;
-            break;
-
-          case EXTERNAL_ADDRESS_TYPE:
-            fis.liv = 0;
-            fis.vv = theResult.externalAddressValue->contents;
-            hashValue += fis.liv * multiplier;
-            break;
-        }
+      hashValue += JoinKeyHashValue(&theResult) * multiplier;
 
       /*==============================================*/
       /* Move to the next expression to be evaluated. */
@@ -929,7 +967,7 @@ unsigned long BetaMemoryHashValue(
    /* Return the result of evaluating the expression. */
    /*=================================================*/
 
-   return hashValue;
+   return MixJoinHashValue(hashValue);
   }
 
 /*******************************************************************/
@@ -1040,6 +1078,392 @@ void EPMDrive(
      }
   }
 
+/**************************************************************/
+/* NetworkReattachMatch: Restores a match which was detached  */
+/*   from the network by NetworkDetachMatch when the fact     */
+/*   kept by the modify command reaches the match's pattern   */
+/*   again.                                                   */
+/*   The partial matches derived from the match are put back  */
+/*   in the memories of the joins and given activations in    */
+/*   the order NetworkAssert would have created them, so the  */
+/*   agenda is the same as after a retract and assert.        */
+/**************************************************************/
+void NetworkReattachMatch(
+  Environment *theEnv,
+  struct partialMatch *alphaMatch,
+  struct patternNodeHeader *theHeader)
+  {
+   struct joinNode *theJoin;
+   struct partialMatch *unblocked, *nextMatch;
+
+   LinkAlphaMatch(theEnv,theHeader,alphaMatch);
+
+   unblocked = alphaMatch->blockList;
+   alphaMatch->blockList = NULL;
+
+   for (theJoin = theHeader->entryJoin;
+        theJoin != NULL;
+        theJoin = theJoin->rightMatchNode)
+     {
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { theJoin->rightActivations++; }
+#endif
+
+      if (theJoin->patternIsNegated)
+        { ReattachBlockedMatches(theEnv,alphaMatch,theJoin,&unblocked); }
+      else if (theJoin->firstJoin)
+        { ReattachLinkedMatches(theEnv,alphaMatch,theJoin,true); }
+      else
+        { ReattachJoinedMatches(theEnv,alphaMatch,theJoin,true); }
+     }
+
+   /*==================================================*/
+   /* Partial matches unblocked by the detached match  */
+   /* that it doesn't block again remain unblocked, as */
+   /* they would after a retract and assert.           */
+   /*==================================================*/
+
+   for (;
+        unblocked != NULL;
+        unblocked = nextMatch)
+     {
+      nextMatch = unblocked->nextBlocked;
+      unblocked->nextBlocked = NULL;
+      unblocked->prevBlocked = NULL;
+     }
+  }
+
+/*************************************************************/
+/* ReattachBetaMatch: Puts a detached partial match back in  */
+/*   the left memory of a join, then restores its activation */
+/*   or its own children in the order the join creates them. */
+/*************************************************************/
+static void ReattachBetaMatch(
+  Environment *theEnv,
+  struct partialMatch *theMatch,
+  struct joinNode *theJoin)
+  {
+   theMatch->nextInMemory = NULL;
+   theMatch->prevInMemory = NULL;
+
+   LinkBetaPMToNode(theEnv,theMatch,theJoin,LHS);
+   MoveBetaPMToFrontOfLineage(theMatch);
+
+#if PROFILING_FUNCTIONS
+   if (ProfileFunctionData(theEnv)->ProfileJoins)
+     { theJoin->leftActivations++; }
+#endif
+
+   if (theJoin->ruleToActivate != NULL)
+     {
+      AddActivation(theEnv,theJoin->ruleToActivate,theMatch);
+      return;
+     }
+
+   if (theMatch->children == NULL)
+     { return; }
+
+   if (theJoin->rightSideEntryStructure == NULL)
+     { ReattachLinkedMatches(theEnv,theMatch,theJoin,false); }
+   else
+     { ReattachJoinedMatches(theEnv,theMatch,theJoin,false); }
+  }
+
+/*************************************************************/
+/* ReattachLinkedMatches: Reattaches the children created by */
+/*   a join from a partial match alone (the first join of a  */
+/*   rule or the join of a test CE). There's one child for   */
+/*   each of the join's links, reattached in link order.     */
+/*************************************************************/
+static void ReattachLinkedMatches(
+  Environment *theEnv,
+  struct partialMatch *theParent,
+  struct joinNode *theJoin,
+  bool rightParent)
+  {
+   struct joinLink *theLink;
+   struct partialMatch *theChild;
+
+   for (theLink = theJoin->nextLinks;
+        theLink != NULL;
+        theLink = theLink->next)
+     {
+      for (theChild = theParent->children;
+           theChild != NULL;
+           theChild = (rightParent ? theChild->nextRightChild : theChild->nextLeftChild))
+        {
+         if (theChild->owner == theLink->join)
+           { break; }
+        }
+
+      if (theChild != NULL)
+        { ReattachBetaMatch(theEnv,theChild,theLink->join); }
+     }
+  }
+
+/**************************************************************/
+/* ReattachJoinedMatches: Reattaches the children created by  */
+/*   a join from a partial match and the matches in the other */
+/*   memory of the join. The children are grouped by the      */
+/*   match they were merged with and the groups are restored  */
+/*   in the order the join compares those matches to the      */
+/*   parent. Each group is restored in the order of the       */
+/*   links.                                                   */
+/**************************************************************/
+static void ReattachJoinedMatches(
+  Environment *theEnv,
+  struct partialMatch *theParent,
+  struct joinNode *theJoin,
+  bool rightParent)
+  {
+   struct partialMatch *theChild, *theMatch, **childPtr;
+   struct partialMatch *groups = NULL, *lastGroup = NULL, *nextGroup;
+   struct joinLink *theLink;
+   struct rangeIndexCursor rangeCursor;
+   unsigned long groupCount = 0;
+
+   /*=====================================================*/
+   /* Chain the children created at the join from the     */
+   /* marker of the match in the other memory. Detached   */
+   /* children aren't in a memory, so their nextInMemory  */
+   /* links are free to use for the chain.                */
+   /*=====================================================*/
+
+   for (theChild = theParent->children;
+        theChild != NULL;
+        theChild = (rightParent ? theChild->nextRightChild : theChild->nextLeftChild))
+     {
+      if (((struct joinNode *) theChild->owner)->lastLevel != theJoin)
+        { continue; }
+
+      theMatch = (rightParent ? theChild->leftParent : theChild->rightParent);
+      if (theMatch->marker == NULL)
+        { groupCount++; }
+
+      theChild->nextInMemory = (struct partialMatch *) theMatch->marker;
+      theMatch->marker = theChild;
+     }
+
+   if (groupCount == 0)
+     { return; }
+
+   /*====================================================*/
+   /* Order the groups by the position of their match in */
+   /* the other memory. The prevInMemory link of the     */
+   /* first child of a group points to the next group.   */
+   /*====================================================*/
+
+   rangeCursor.indexed = false;
+   if (rightParent)
+     { theMatch = GetLeftBetaMemory(theJoin,theParent->hashValue); }
+   else
+     { theMatch = GetJoinAlphaMemory(theEnv,theJoin,theParent,theParent->hashValue,&rangeCursor); }
+
+   for (;
+        (theMatch != NULL) && (groupCount > 0);
+        theMatch = (rangeCursor.indexed ? NextRangeMatch(&rangeCursor) : theMatch->nextInMemory))
+     {
+      if (theMatch->marker != NULL)
+        {
+         AppendReattachGroup(theMatch,&groups,&lastGroup);
+         groupCount--;
+        }
+     }
+
+   /*===============================================*/
+   /* A group whose match wasn't found is restored  */
+   /* last so that no marker is left behind.        */
+   /*===============================================*/
+
+   for (theChild = theParent->children;
+        (theChild != NULL) && (groupCount > 0);
+        theChild = (rightParent ? theChild->nextRightChild : theChild->nextLeftChild))
+     {
+      theMatch = (rightParent ? theChild->leftParent : theChild->rightParent);
+      if ((theMatch != NULL) && (theMatch->marker == theChild))
+        {
+         AppendReattachGroup(theMatch,&groups,&lastGroup);
+         groupCount--;
+        }
+     }
+
+   /*==========================================*/
+   /* Reattach the children of each group. The */
+   /* children are moved to the front of the   */
+   /* parent's list of children as they are    */
+   /* reattached, but the groups are unchanged. */
+   /*==========================================*/
+
+   for (;
+        groups != NULL;
+        groups = nextGroup)
+     {
+      nextGroup = groups->prevInMemory;
+      groups->prevInMemory = NULL;
+
+      for (theLink = theJoin->nextLinks;
+           theLink != NULL;
+           theLink = theLink->next)
+        {
+         for (childPtr = &groups;
+              *childPtr != NULL;
+              childPtr = &(*childPtr)->nextInMemory)
+           {
+            if ((*childPtr)->owner == theLink->join)
+              { break; }
+           }
+
+         if (*childPtr == NULL)
+           { continue; }
+
+         theChild = *childPtr;
+         *childPtr = theChild->nextInMemory;
+         ReattachBetaMatch(theEnv,theChild,theLink->join);
+        }
+     }
+  }
+
+/**************************************************************/
+/* AppendReattachGroup: Moves the chain of children from the  */
+/*   marker of a match to the end of the list of groups being */
+/*   reattached by ReattachJoinedMatches.                     */
+/**************************************************************/
+static void AppendReattachGroup(
+  struct partialMatch *theMatch,
+  struct partialMatch **groups,
+  struct partialMatch **lastGroup)
+  {
+   struct partialMatch *theGroup;
+
+   theGroup = (struct partialMatch *) theMatch->marker;
+   theMatch->marker = NULL;
+   theGroup->prevInMemory = NULL;
+
+   if (*lastGroup == NULL)
+     { *groups = theGroup; }
+   else
+     { (*lastGroup)->prevInMemory = theGroup; }
+
+   *lastGroup = theGroup;
+  }
+
+/**************************************************************/
+/* ReattachBlockedMatches: Blocks the partial matches in the  */
+/*   left memory of a not CE's join that a reattached match   */
+/*   would block if it was asserted. These are the partial    */
+/*   matches it unblocked when it was detached and those that */
+/*   have since been created from the fact's other patterns.  */
+/*   Any other unblocked partial match was already compared   */
+/*   to the match and isn't blocked by it.                    */
+/**************************************************************/
+static void ReattachBlockedMatches(
+  Environment *theEnv,
+  struct partialMatch *alphaMatch,
+  struct joinNode *theJoin,
+  struct partialMatch **unblocked)
+  {
+   struct partialMatch *lhsBinds, *nextBind;
+   struct partialMatch *oldLHSBinds, *oldRHSBinds;
+   struct joinNode *oldJoin;
+   struct patternEntity *theEntity;
+   bool exprResult;
+
+   theEntity = alphaMatch->binds[0].gm.theMatch->matchingItem;
+
+   if (theJoin->firstJoin)
+     { lhsBinds = theJoin->leftMemory->beta[0]; }
+   else
+     { lhsBinds = GetLeftBetaMemory(theJoin,alphaMatch->hashValue); }
+
+   oldLHSBinds = EngineData(theEnv)->GlobalLHSBinds;
+   oldRHSBinds = EngineData(theEnv)->GlobalRHSBinds;
+   oldJoin = EngineData(theEnv)->GlobalJoin;
+   EngineData(theEnv)->GlobalRHSBinds = alphaMatch;
+   EngineData(theEnv)->GlobalJoin = theJoin;
+
+   for (;
+        lhsBinds != NULL;
+        lhsBinds = nextBind)
+     {
+      nextBind = (theJoin->firstJoin ? NULL : lhsBinds->nextInMemory);
+
+      if ((! theJoin->firstJoin) &&
+          (lhsBinds->hashValue != alphaMatch->hashValue))
+        { continue; }
+
+      if ((lhsBinds->marker != NULL) && (! lhsBinds->goalMarker))
+        { continue; }
+
+      /*===============================================*/
+      /* Remove a partial match that was unblocked by  */
+      /* the detached match from the list of unblocked */
+      /* partial matches before comparing it.          */
+      /*===============================================*/
+
+      if ((lhsBinds == *unblocked) || (lhsBinds->prevBlocked != NULL))
+        {
+         if (lhsBinds->prevBlocked == NULL)
+           { *unblocked = lhsBinds->nextBlocked; }
+         else
+           { lhsBinds->prevBlocked->nextBlocked = lhsBinds->nextBlocked; }
+
+         if (lhsBinds->nextBlocked != NULL)
+           { lhsBinds->nextBlocked->prevBlocked = lhsBinds->prevBlocked; }
+
+         lhsBinds->nextBlocked = NULL;
+         lhsBinds->prevBlocked = NULL;
+        }
+      else if (theJoin->firstJoin ||
+               (! FindEntityInPartialMatch(theEntity,lhsBinds)))
+        { continue; }
+
+#if DEBUGGING_FUNCTIONS
+      theJoin->memoryCompares++;
+#endif
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { theJoin->hashProbes++; }
+#endif
+
+      /*==================================================*/
+      /* Evaluate the join's expressions as EmptyDrive or */
+      /* NetworkAssertRight does for an asserted match.   */
+      /*==================================================*/
+
+      EngineData(theEnv)->GlobalLHSBinds = (theJoin->firstJoin ? NULL : lhsBinds);
+      exprResult = true;
+
+      if (theJoin->networkTest != NULL)
+        {
+         exprResult = EvaluateJoinExpression(theEnv,theJoin->networkTest,theJoin);
+         if (EvaluationData(theEnv)->EvaluationError)
+           {
+            if (! theJoin->firstJoin) exprResult = true;
+            SetEvaluationError(theEnv,false);
+           }
+        }
+
+      if ((theJoin->secondaryNetworkTest != NULL) && exprResult)
+        {
+         exprResult = EvaluateJoinExpression(theEnv,theJoin->secondaryNetworkTest,theJoin);
+         if (EvaluationData(theEnv)->EvaluationError)
+           { SetEvaluationError(theEnv,false); }
+        }
+
+      if (exprResult)
+        {
+         AddBlockedLink(lhsBinds,alphaMatch);
+         if (lhsBinds->children != NULL)
+           { PosEntryRetractBeta(theEnv,lhsBinds,lhsBinds->children,NETWORK_ASSERT); }
+        }
+     }
+
+   EngineData(theEnv)->GlobalLHSBinds = oldLHSBinds;
+   EngineData(theEnv)->GlobalRHSBinds = oldRHSBinds;
+   EngineData(theEnv)->GlobalJoin = oldJoin;
+  }
+
 /***************************************************************/
 /* EmptyDrive: Handles the entry of a alpha memory partial     */
 /*   match from the RHS of a join that is the first join of    */
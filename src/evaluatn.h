@@ -64,6 +64,10 @@
 /*                                                           */
 /*      6.41: Added FCBPopArgument function.                 */
 /*                                                           */
+/*      ?.??: External address types can supply a logical    */
+/*            name so their values can be used as output     */
+/*            destinations.                                  */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_evaluatn
@@ -109,6 +113,7 @@ struct externalAddressType
    bool (*discardFunction)(Environment *,void *);
    void (*newFunction)(UDFContext *,UDFValue *);
    bool (*callFunction)(UDFContext *,UDFValue *,UDFValue *);
+   const char *(*logicalNameFunction)(Environment *,void *);
   };
 
 #define CoerceToLongInteger(t,v) ((t == INTEGER_TYPE) ? ValueToLong(v) : (long) ValueToDouble(v))
@@ -33,6 +33,8 @@
 /*                                                           */
 /*            Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: Added tested slots to fact pattern nodes.      */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -70,6 +72,7 @@ struct bsaveFactPatternNode
    unsigned long leftNode;
    unsigned long rightNode;
    unsigned long modifySlots;
+   unsigned long testedSlots;
   };
 
 #define BSAVE_FIND         0
@@ -209,6 +212,8 @@ static void BsaveDriver(
            thePattern->bsaveID = FactBinaryData(theEnv)->NumberOfPatterns++;
            if (thePattern->modifySlots != NULL)
              { thePattern->modifySlots->neededBitMap = true; }
+           if (thePattern->testedSlots != NULL)
+             { thePattern->testedSlots->neededBitMap = true; }
            break;
 
          case BSAVE_PATTERNS:
@@ -327,6 +332,10 @@ static void BsavePatternNode(
      { tempNode.modifySlots = ULONG_MAX; }
    else
      { tempNode.modifySlots = thePattern->modifySlots->bucket; }
+   if (thePattern->testedSlots == NULL)
+     { tempNode.testedSlots = ULONG_MAX; }
+   else
+     { tempNode.testedSlots = thePattern->testedSlots->bucket; }
 
    GenWrite(&tempNode,sizeof(struct bsaveFactPatternNode),fp);
   }
@@ -436,6 +445,13 @@ static void UpdateFactPatterns(
      }
    else
      { FactBinaryData(theEnv)->FactPatternArray[obji].modifySlots = NULL; }
+   if (bp->testedSlots != ULONG_MAX)
+     {
+      FactBinaryData(theEnv)->FactPatternArray[obji].testedSlots = BitMapPointer(bp->testedSlots);
+      IncrementBitMapCount(FactBinaryData(theEnv)->FactPatternArray[obji].testedSlots);
+     }
+   else
+     { FactBinaryData(theEnv)->FactPatternArray[obji].testedSlots = NULL; }
   }
 
 /***************************************************/
@@ -461,6 +477,8 @@ static void ClearBload(
         
       if (FactBinaryData(theEnv)->FactPatternArray[i].modifySlots != NULL)
         { DecrementBitMapReferenceCount(theEnv,FactBinaryData(theEnv)->FactPatternArray[i].modifySlots); }
+      if (FactBinaryData(theEnv)->FactPatternArray[i].testedSlots != NULL)
+        { DecrementBitMapReferenceCount(theEnv,FactBinaryData(theEnv)->FactPatternArray[i].testedSlots); }
      }
 
 
@@ -41,6 +41,15 @@
 /*                                                           */
 /*            Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: Stop nodes record the slots tested by the      */
+/*            pattern so that modify can retain matches      */
+/*            unaffected by the changed slots.               */
+/*                                                           */
+/*            The range index expression is part of the      */
+/*            identity of a stop node.                       */
+/*                                                           */
+/*            Beta memories count their resizes.             */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -91,10 +100,13 @@
    static void                       IncrementalResetGoalsDriver(Environment *,Deftemplate *);
    static void                       RemoveChildGoalExpressions(Environment *,Deftemplate *);
    static CLIPSBitMap               *CreatePatternSlotMap(Environment *,Deftemplate *,struct lhsParseNode *);
-   static struct factPatternNode    *FindStopPatternNode(struct factPatternNode *,struct factPatternNode **,CLIPSBitMap *,Expression *);
+   static CLIPSBitMap               *CreateTestedSlotMap(Environment *,Deftemplate *,struct lhsParseNode *);
+   static bool                       SlotIsTested(struct lhsParseNode *);
+   static struct factPatternNode    *FindStopPatternNode(struct factPatternNode *,struct factPatternNode **,CLIPSBitMap *,
+                                                         CLIPSBitMap *,Expression *,Expression *);
    static struct factPatternNode    *CreateNewStopPatternNode(Environment *,struct lhsParseNode *,struct factPatternNode *,
                                                               struct factPatternNode *,bool,Deftemplate *,CLIPSBitMap *,
-                                                              Expression *);
+                                                              CLIPSBitMap *,Expression *,Expression *);
 #endif
 
 /*********************************************************/
@@ -188,8 +200,8 @@ static struct patternNodeHeader *PlaceFactPattern(
    bool goalNetworkWasEmpty = false;
    Deftemplate *theDeftemplate;
    Deftemplate *currentDeftemplate;
-   CLIPSBitMap *theSlotMap;
-   Expression *theRightHash;
+   CLIPSBitMap *theSlotMap, *theTestedMap;
+   Expression *theRightHash, *theRightRange;
 
    /*======================================================================*/
    /* Get the name of the deftemplate associated with the pattern being    */
@@ -222,6 +234,7 @@ static struct patternNodeHeader *PlaceFactPattern(
    /*======================================================*/
 
    theSlotMap = CreatePatternSlotMap(theEnv,currentDeftemplate,thePattern);
+   theTestedMap = CreateTestedSlotMap(theEnv,currentDeftemplate,thePattern);
    
    /*=====================================================*/
    /* Remove any slot tests that test only for existance. */
@@ -262,6 +275,7 @@ static struct patternNodeHeader *PlaceFactPattern(
    /*=====================================================*/
 
    theRightHash = thePattern->rightHash;
+   theRightRange = thePattern->rightRange;
 
    /*================================================*/
    /* Initialize some pointers to indicate where the */
@@ -404,15 +418,20 @@ static struct patternNodeHeader *PlaceFactPattern(
    /* Add the end node. */
    /*===================*/
    
-   newNode = FindStopPatternNode(currentLevel,&nodeBeforeMatch,theSlotMap,theRightHash);
+   newNode = FindStopPatternNode(currentLevel,&nodeBeforeMatch,theSlotMap,theTestedMap,theRightHash,theRightRange);
    
    if (newNode != NULL)
      {
       if (theSlotMap != NULL)
         { DecrementBitMapReferenceCount(theEnv,theSlotMap); }
+      if (theTestedMap != NULL)
+        { DecrementBitMapReferenceCount(theEnv,theTestedMap); }
      }
    else
-     { newNode = CreateNewStopPatternNode(theEnv,thePattern,nodeBeforeMatch,lastLevel,addToGoalNetwork,currentDeftemplate,theSlotMap,theRightHash); }
+     {
+      newNode = CreateNewStopPatternNode(theEnv,thePattern,nodeBeforeMatch,lastLevel,addToGoalNetwork,
+                                         currentDeftemplate,theSlotMap,theTestedMap,theRightHash,theRightRange);
+     }
    
    /*=====================================================*/
    /* If the goal network for this deftemplate was empty, */
@@ -504,6 +523,7 @@ static void UpdateGoalExpressions(
             theJoin->leftMemory->beta[0] = CreateEmptyPartialMatch(theEnv);
             theJoin->leftMemory->beta[0]->owner = theJoin;
             theJoin->leftMemory->size = 1;
+            theJoin->leftMemory->resizes = 0;
             theJoin->leftMemory->count = 1;
 
             theLink = get_struct(theEnv,joinLink);
@@ -792,7 +812,9 @@ static struct factPatternNode *FindStopPatternNode(
   struct factPatternNode *listOfNodes,
   struct factPatternNode **nodeBeforeMatch,
   CLIPSBitMap *modifySlots,
-  Expression *theRightHash)
+  CLIPSBitMap *testedSlots,
+  Expression *theRightHash,
+  Expression *theRightRange)
   {
    *nodeBeforeMatch = NULL;
 
@@ -809,7 +831,9 @@ static struct factPatternNode *FindStopPatternNode(
       
       if (listOfNodes->header.stopNode &&
           IdenticalExpression(listOfNodes->header.rightHash,theRightHash) &&
-          (listOfNodes->modifySlots == modifySlots))
+          IdenticalExpression(listOfNodes->header.rightRange,theRightRange) &&
+          (listOfNodes->modifySlots == modifySlots) &&
+          (listOfNodes->testedSlots == testedSlots))
         { return listOfNodes; }
 
       /*==================================*/
@@ -867,6 +891,77 @@ static CLIPSBitMap *CreatePatternSlotMap(
    return theBitMap;
   }
 
+/*************************************************************/
+/* CreateTestedSlotMap: Determines the slots whose values    */
+/*   can affect whether a fact matches the pattern or which  */
+/*   partial matches it joins with. A slot whose constraint  */
+/*   is an unreferenced single field wildcard or variable    */
+/*   (such as ?x bound only for use on the RHS of the rule)  */
+/*   is excluded. Unlike the slot map used by the update     */
+/*   command, the pattern-match reactivity of the slot is    */
+/*   ignored. A NULL map indicates any slot can affect the   */
+/*   pattern (e.g. its fact address is used in the LHS).     */
+/*************************************************************/
+static CLIPSBitMap *CreateTestedSlotMap(
+  Environment *theEnv,
+  Deftemplate *theDeftemplate,
+  struct lhsParseNode *thePattern)
+  {
+   unsigned short slotMapSize;
+   char *slotMap;
+   CLIPSBitMap *theBitMap;
+
+   if ((theDeftemplate->numberOfSlots == 0) ||
+       (thePattern->referenced))
+     { return NULL; }
+
+   slotMapSize = CountToBitMapSize(theDeftemplate->numberOfSlots);
+   slotMap = (char *) gm2(theEnv,slotMapSize);
+   ClearBitString((void *) slotMap,slotMapSize);
+
+   for (thePattern = thePattern->right;
+        thePattern != NULL;
+        thePattern = thePattern->right)
+     {
+      if ((thePattern->slot != NULL) && SlotIsTested(thePattern))
+        { SetBitMap(slotMap,thePattern->slotNumber-1); }
+     }
+
+   theBitMap = AddBitMap(theEnv,slotMap,slotMapSize);
+   rm(theEnv,slotMap,slotMapSize);
+   IncrementBitMapReferenceCount(theEnv,theBitMap);
+
+   return theBitMap;
+  }
+
+/*************************************************************/
+/* SlotIsTested: Returns true if the value of a slot is used */
+/*   by the pattern network, the join network, or another    */
+/*   constraint. Multifield slots are always considered      */
+/*   tested since the alpha match stores the field markers   */
+/*   for the slot's contents.                                */
+/*************************************************************/
+static bool SlotIsTested(
+  struct lhsParseNode *theSlot)
+  {
+   if (theSlot->multifieldSlot)
+     { return true; }
+
+   if ((theSlot->pnType != SF_WILDCARD_NODE) &&
+       (theSlot->pnType != SF_VARIABLE_NODE))
+     { return true; }
+
+   if ((theSlot->networkTest != NULL) ||
+       (theSlot->constantSelector != NULL) ||
+       (theSlot->referringNode != NULL) ||
+       (theSlot->referenced) ||
+       (theSlot->bottom != NULL) ||
+       (theSlot->expression != NULL))
+     { return true; }
+
+   return false;
+  }
+
 /*************************************************************/
 /* RemoveUnneededSlots: Removes fact pattern nodes that have */
 /*   no effect on pattern matching. For example, given the   */
@@ -1073,6 +1168,7 @@ static struct factPatternNode *CreateNewPatternNode(
    newNode->leftNode = NULL;
    newNode->leaveFields = thePattern->singleFieldsAfter;
    newNode->modifySlots = modifySlots;
+   newNode->testedSlots = NULL;
    InitializePatternHeader(theEnv,(struct patternNodeHeader *) &newNode->header);
 
    if (thePattern->index > 0)
@@ -1193,7 +1289,9 @@ static struct factPatternNode *CreateNewStopPatternNode(
   bool goal,
   Deftemplate *currentDeftemplate,
   CLIPSBitMap *modifySlots,
-  Expression *theRightHash)
+  CLIPSBitMap *testedSlots,
+  Expression *theRightHash,
+  Expression *theRightRange)
   {
    struct factPatternNode *newNode;
 
@@ -1209,6 +1307,7 @@ static struct factPatternNode *CreateNewStopPatternNode(
    newNode->leftNode = NULL;
    newNode->leaveFields = 0;
    newNode->modifySlots = modifySlots;
+   newNode->testedSlots = testedSlots;
    newNode->whichField = 0;
    newNode->whichSlot = 0;
    
@@ -1217,6 +1316,7 @@ static struct factPatternNode *CreateNewStopPatternNode(
    newNode->header.stopNode = true;
 
    newNode->header.rightHash = AddHashedExpression(theEnv,theRightHash);
+   newNode->header.rightRange = AddHashedExpression(theEnv,theRightRange);
 
    /*===============================================*/
    /* Set the upper level pointer for the new node. */
@@ -1369,8 +1469,11 @@ static void DetachFactPattern(
 
          RemoveHashedExpression(theEnv,patternPtr->networkTest);
          RemoveHashedExpression(theEnv,patternPtr->header.rightHash);
+         RemoveHashedExpression(theEnv,patternPtr->header.rightRange);
          if (patternPtr->modifySlots != NULL)
            { DecrementBitMapReferenceCount(theEnv,patternPtr->modifySlots); }
+         if (patternPtr->testedSlots != NULL)
+           { DecrementBitMapReferenceCount(theEnv,patternPtr->testedSlots); }
          rtn_struct(theEnv,factPatternNode,patternPtr);
         }
       else if (upperLevel->leftNode != NULL)
@@ -1393,8 +1496,11 @@ static void DetachFactPattern(
 
          RemoveHashedExpression(theEnv,patternPtr->networkTest);
          RemoveHashedExpression(theEnv,patternPtr->header.rightHash);
+         RemoveHashedExpression(theEnv,patternPtr->header.rightRange);
          if (patternPtr->modifySlots != NULL)
            { DecrementBitMapReferenceCount(theEnv,patternPtr->modifySlots); }
+         if (patternPtr->testedSlots != NULL)
+           { DecrementBitMapReferenceCount(theEnv,patternPtr->testedSlots); }
          rtn_struct(theEnv,factPatternNode,patternPtr);
          upperLevel = NULL;
         }
@@ -1421,8 +1527,11 @@ static void DetachFactPattern(
 
          RemoveHashedExpression(theEnv,patternPtr->networkTest);
          RemoveHashedExpression(theEnv,patternPtr->header.rightHash);
+         RemoveHashedExpression(theEnv,patternPtr->header.rightRange);
          if (patternPtr->modifySlots != NULL)
            { DecrementBitMapReferenceCount(theEnv,patternPtr->modifySlots); }
+         if (patternPtr->testedSlots != NULL)
+           { DecrementBitMapReferenceCount(theEnv,patternPtr->testedSlots); }
          rtn_struct(theEnv,factPatternNode,patternPtr);
          upperLevel = NULL;
         }
@@ -1458,6 +1567,8 @@ void DestroyFactPatternNetwork(
 #if (! BLOAD_ONLY) && (! RUN_TIME)
       if (thePattern->modifySlots != NULL)
         { DecrementBitMapReferenceCount(theEnv,thePattern->modifySlots); }
+      if (thePattern->testedSlots != NULL)
+        { DecrementBitMapReferenceCount(theEnv,thePattern->testedSlots); }
       rtn_struct(theEnv,factPatternNode,thePattern);
 #endif
 
@@ -32,6 +32,8 @@
 /*                                                           */
 /*      7.00: Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: Added testedSlots to fact pattern nodes.       */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_factbld
@@ -58,6 +60,7 @@ struct factPatternNode
    struct factPatternNode *leftNode;
    struct factPatternNode *rightNode;
    CLIPSBitMap *modifySlots;
+   CLIPSBitMap *testedSlots;
   };
 
    void                           InitializeFactPatterns(Environment *);
@@ -35,6 +35,8 @@
 /*                                                           */
 /*            Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: Added tested slots to fact pattern nodes.      */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -397,6 +399,13 @@ static void PatternNodeToCode(
    /*==============*/
 
    PrintBitMapReference(theEnv,theFile,thePatternNode->modifySlots);
+
+   /*==============*/
+   /* Tested Slots */
+   /*==============*/
+
+   fprintf(theFile,",");
+   PrintBitMapReference(theEnv,theFile,thePatternNode->testedSlots);
    fprintf(theFile,"}");
   }
 
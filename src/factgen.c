@@ -42,6 +42,8 @@
 /*            Support for ?var:slot references to facts in   */
 /*            methods and rule actions.                      */
 /*                                                           */
+/*      ?.??: Added support for the accumulate CE.           */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -1633,6 +1635,13 @@ CLIPSLexeme *FindTemplateForFactAddress(
 
    if (thePattern == NULL) return NULL;
 
+   /*==============================================*/
+   /* The variable of an accumulate CE is bound to */
+   /* the aggregate value rather than the fact.    */
+   /*==============================================*/
+
+   if (thePattern->aggregate != NO_AGGREGATE) return NULL;
+
    /*=====================================*/
    /* Verify that just a symbol is stored */
    /* as the first field of the pattern.  */
@@ -57,6 +57,9 @@
 /*                                                           */
 /*            Support for certainty factors.                 */
 /*                                                           */
+/*      ?.??: Matches kept by the modify command are         */
+/*            reattached when the fact is reasserted.        */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -570,6 +573,28 @@ static void ProcessFactAlphaMatch(
    struct patternMatch *listOfMatches;
    struct joinNode *listOfJoins;
    unsigned long hashValue;
+   struct patternMatch **retainedPtr;
+
+  /*===================================================*/
+  /* If the modify command kept the fact's match for   */
+  /* the pattern, then reattach it instead of creating */
+  /* a new one.                                        */
+  /*===================================================*/
+
+  for (retainedPtr = &FactData(theEnv)->RetainedMatches;
+       *retainedPtr != NULL;
+       retainedPtr = &(*retainedPtr)->next)
+    {
+     if ((*retainedPtr)->matchingPattern == &thePattern->header)
+       {
+        listOfMatches = *retainedPtr;
+        *retainedPtr = listOfMatches->next;
+        listOfMatches->next = theFact->list;
+        theFact->list = listOfMatches;
+        NetworkReattachMatch(theEnv,listOfMatches->theMatch,&thePattern->header);
+        return;
+       }
+    }
 
   /*============================================*/
   /* Create the hash value for the alpha match. */
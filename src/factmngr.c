@@ -188,6 +188,7 @@
    static bool                    RetractCallback(Fact *,Environment *);
    static Fact                   *FMModifyDriver(FactModifier *theFM,bool);
    static void                    AddFactToLists(Environment *,Fact *,size_t,long long,Fact *,Fact *);
+   static PutSlotError            PutFactBuilderSlot(FactBuilder *,struct templateSlot *,unsigned short,CLIPSValue *);
   
 /**************************************************************/
 /* InitializeFacts: Initializes the fact data representation. */
@@ -802,8 +803,10 @@ RetractError RetractDriver(
    /*===========================================*/
 
    EngineData(theEnv)->JoinOperationInProgress = true;
-   if (modifyOperation)
+   if (modifyOperation && applyReactivity)
      { theFact->list = NetworkRetractReplaceFact(theEnv,theFact->list,changeMap,applyReactivity); }
+   else if (modifyOperation)
+     { theFact->list = NetworkRetractModifiedFact(theEnv,theFact,changeMap); }
    else
      {
       NetworkRetract(theEnv,theFact->list);
@@ -2879,12 +2882,8 @@ PutSlotError FBPutSlot(
   const char *slotName,
   CLIPSValue *slotValue)
   {
-   Environment *theEnv;
    struct templateSlot *theSlot;
    unsigned short whichSlot;
-   CLIPSValue oldValue;
-   int i;
-   ConstraintViolationType cvType;
      
    /*==========================*/
    /* Check for NULL pointers. */
@@ -2896,8 +2895,6 @@ PutSlotError FBPutSlot(
    if ((theFB->fbDeftemplate == NULL) || (slotValue->value == NULL))
      { return PSE_NULL_POINTER_ERROR; }
    
-   theEnv = theFB->fbEnv;
-     
    /*===================================*/
    /* Make sure the slot name requested */
    /* corresponds to a valid slot name. */
@@ -2906,6 +2903,56 @@ PutSlotError FBPutSlot(
    if ((theSlot = FindSlot(theFB->fbDeftemplate,CreateSymbol(theFB->fbEnv,slotName),&whichSlot)) == NULL)
      { return PSE_SLOT_NOT_FOUND_ERROR; }
      
+   return PutFactBuilderSlot(theFB,theSlot,whichSlot,slotValue);
+  }
+
+/***********************************************************/
+/* FBPutSlotByPosition: Sets a slot by its zero-based      */
+/*   position in the deftemplate rather than by name, so   */
+/*   callers storing many facts of the same deftemplate    */
+/*   only need to look up each slot name once.             */
+/***********************************************************/
+PutSlotError FBPutSlotByPosition(
+  FactBuilder *theFB,
+  unsigned short whichSlot,
+  CLIPSValue *slotValue)
+  {
+   struct templateSlot *theSlot;
+   unsigned short i;
+
+   if ((theFB == NULL) || (slotValue == NULL))
+     { return PSE_NULL_POINTER_ERROR; }
+
+   if ((theFB->fbDeftemplate == NULL) || (slotValue->value == NULL))
+     { return PSE_NULL_POINTER_ERROR; }
+
+   if (whichSlot >= theFB->fbDeftemplate->numberOfSlots)
+     { return PSE_SLOT_NOT_FOUND_ERROR; }
+
+   for (theSlot = theFB->fbDeftemplate->slotList, i = 0;
+        i < whichSlot;
+        theSlot = theSlot->next, i++)
+     { /* Do Nothing */ }
+
+   return PutFactBuilderSlot(theFB,theSlot,whichSlot,slotValue);
+  }
+
+/*****************************************************/
+/* PutFactBuilderSlot: Checks a value against a slot */
+/*   that has already been located and stores it in  */
+/*   the fact builder.                               */
+/*****************************************************/
+static PutSlotError PutFactBuilderSlot(
+  FactBuilder *theFB,
+  struct templateSlot *theSlot,
+  unsigned short whichSlot,
+  CLIPSValue *slotValue)
+  {
+   Environment *theEnv = theFB->fbEnv;
+   CLIPSValue oldValue;
+   int i;
+   ConstraintViolationType cvType;
+
    /*=============================================*/
    /* Make sure a single field value is not being */
    /* stored in a multifield slot or vice versa.  */
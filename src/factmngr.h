@@ -85,6 +85,8 @@
 /*                                                           */
 /*            Support for named facts.                       */
 /*                                                           */
+/*      ?.??: Added retained match data for modify.          */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_factmngr
@@ -244,6 +246,7 @@ struct factsData
    Fact                    *CurrentPatternFact;
    struct multifieldMarker *CurrentPatternMarks;
    CLIPSBitMap             *CurrentChangeMap;
+   struct patternMatch     *RetainedMatches;
 #endif
    long LastModuleIndex;
    RetractError retractError;
@@ -315,6 +318,7 @@ struct factsData
    bool                           RemoveRetractFunction(Environment *,const char *);
    FactBuilder                   *CreateFactBuilder(Environment *,const char *);
    PutSlotError                   FBPutSlot(FactBuilder *,const char *,CLIPSValue *);
+   PutSlotError                   FBPutSlotByPosition(FactBuilder *,unsigned short,CLIPSValue *);
    Fact                          *FBAssert(FactBuilder *);
    void                           FBDispose(FactBuilder *);
    void                           FBAbort(FactBuilder *);
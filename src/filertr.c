@@ -77,6 +77,8 @@
    static void                    WriteFileCallback(Environment *,const char *,const char *,void *);
    static int                     ReadFileCallback(Environment *,const char *,void *);
    static int                     UnreadFileCallback(Environment *,const char *,int,void *);
+   static size_t                  ReadBlockFileCallback(Environment *,const char *,char *,size_t,const char *,void *);
+   static void                    WriteBlockFileCallback(Environment *,const char *,const char *,size_t,void *);
    static void                    DeallocateFileRouterData(Environment *);
 
 /***************************************************************/
@@ -90,6 +92,7 @@ void InitializeFileRouter(
    AddRouter(theEnv,"fileio",0,FindFile,
              WriteFileCallback,ReadFileCallback,
              UnreadFileCallback,ExitFileCallback,NULL);
+   SetRouterBlockCallbacks(theEnv,"fileio",ReadBlockFileCallback,WriteBlockFileCallback);
   }
 
 /*****************************************/
@@ -248,6 +251,65 @@ static int UnreadFileCallback(
      { return ungetc(ch,fptr); }
   }
 
+/**************************************************/
+/* ReadBlockFileCallback: Block read callback for */
+/*   file router. Stops after a delimiter so that */
+/*   nothing past it is taken from the stream.    */
+/**************************************************/
+static size_t ReadBlockFileCallback(
+  Environment *theEnv,
+  const char *logicalName,
+  char *buffer,
+  size_t size,
+  const char *delimiters,
+  void *context)
+  {
+   FILE *fptr;
+   int theChar;
+   size_t count = 0;
+
+   fptr = FindFptr(theEnv,logicalName);
+
+   while (count < size)
+     {
+      if (fptr == stdin)
+        { theChar = gengetchar(theEnv); }
+      else
+        { theChar = getc(fptr); }
+
+      if (theChar == EOF)
+        {
+         if (fptr == stdin) clearerr(stdin);
+         break;
+        }
+
+      buffer[count++] = (char) theChar;
+
+      if (strchr(delimiters,theChar) != NULL)
+        { break; }
+     }
+
+   return count;
+  }
+
+/****************************************************/
+/* WriteBlockFileCallback: Block write callback for */
+/*   file router.                                   */
+/****************************************************/
+static void WriteBlockFileCallback(
+  Environment *theEnv,
+  const char *logicalName,
+  const char *str,
+  size_t length,
+  void *context)
+  {
+   FILE *fptr;
+
+   fptr = FindFptr(theEnv,logicalName);
+
+   fwrite(str,1,length,fptr);
+  }
+
 /*********************************************************/
 /* OpenFile: Opens a file with the specified access mode */
 /*   and stores the opened stream on the list of files   */
@@ -289,6 +351,7 @@ bool OpenAFile(
 
    newRouter->next = FileRouterData(theEnv)->ListOfFileRouters;
    FileRouterData(theEnv)->ListOfFileRouters = newRouter;
+   RouterNameChanged(theEnv,logicalName);
 
    /*==================================*/
    /* Return true to indicate the file */
@@ -315,6 +378,7 @@ bool CloseFile(
      {
       if (strcmp(fptr->logicalName,fid) == 0)
         {
+         RouterNameChanged(theEnv,fptr->logicalName);
          GenClose(theEnv,fptr->stream);
          rm(theEnv,(void *) fptr->logicalName,strlen(fptr->logicalName) + 1);
          if (prev == NULL)
@@ -356,6 +420,7 @@ bool CloseAllFiles(
      }
 
    FileRouterData(theEnv)->ListOfFileRouters = NULL;
+   InvalidateRouterCache(theEnv);
 
    return true;
   }
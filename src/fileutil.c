@@ -35,6 +35,9 @@
 /*      6.41: Fixed compiler warning when compiling with     */
 /*            RUN_TIME set to 1.                             */
 /*                                                           */
+/*      ?.??: The batch* command only checks for a complete  */
+/*            command at the end of a line.                  */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -954,7 +957,14 @@ bool BatchStar(
       theString = ExpandStringWithChar(theEnv,inchar,theString,&position,
                                        &maxChars,maxChars+80);
 
-      if (CompleteCommand(theString) != 0)
+      /*=============================================*/
+      /* A command can only be completed by the end  */
+      /* of a line, so there's no need to rescan the */
+      /* command after every character.              */
+      /*=============================================*/
+
+      if (((inchar == '\n') || (inchar == '\r')) &&
+          (CompleteCommand(theString) != 0))
         {
          FlushPPBuffer(theEnv);
          SetPPBufferStatus(theEnv,false);
@@ -47,15 +47,22 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added range index expressions for not and      */
+/*            exists CEs.                                    */
+/*                                                           */
+/*            Added variable getters for the accumulate CE.  */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "setup.h"
 
 #if (! RUN_TIME) && (! BLOAD_ONLY) && DEFRULE_CONSTRUCT
 
+#include "aggregat.h"
 #include "argacces.h"
 #include "constant.h"
 #include "envrnmnt.h"
@@ -99,6 +106,8 @@
                                                         int);
    static bool                    AllVariablesInExpression(struct lhsParseNode *,
                                                            int);
+   static void                    GenRangeIndex(Environment *,struct lhsParseNode *,
+                                                struct lhsParseNode *);
 
 /*******************************************************/
 /* FieldConversion: Generates join and pattern network */
@@ -298,12 +307,27 @@ void FieldConversion(
              (! theField->referringNode->goalCE) &&
              (theField->referringNode->patternType->genGetJNValueFunction))
            {
-            tempExpression = (*theField->referringNode->patternType->genGetJNValueFunction)(theEnv,theField->referringNode,LHS);
+            tempExpression = GenJNGetvar(theEnv,theField->referringNode,LHS);
             thePattern->leftHash = AppendExpressions(tempExpression,thePattern->leftHash);
            }
         }
      }
 
+   /*==============================================================*/
+   /* If a field of a not or exists CE uses <, <=, >, or >= to     */
+   /* compare a variable from the pattern to a variable from a     */
+   /* prior pattern, then generate the range index expressions.    */
+   /* The comparison must be and'ed with the other constraints of  */
+   /* the field, so fields with an or'ed constraint can't be used. */
+   /*==============================================================*/
+
+   if ((thePattern->negated || thePattern->exists) &&
+       (thePattern->leftRange == NULL) &&
+       (theNandFrames == NULL) &&
+       (theField->bottom != NULL) &&
+       (theField->bottom->bottom == NULL))
+     { GenRangeIndex(theEnv,theField->bottom,thePattern); }
+
    /*======================================================*/
    /* Attach the pattern network expressions to the field. */
    /*======================================================*/
@@ -773,10 +797,10 @@ void AddNandUnification(
 
          theFrame->nandCE->externalNetworkTest = CombineExpressions(theEnv,theFrame->nandCE->externalNetworkTest,tempExpression);
 
-         tempExpression = (*nodeList->referringNode->patternType->genGetJNValueFunction)(theEnv,nodeList->referringNode,LHS);
+         tempExpression = GenJNGetvar(theEnv,nodeList->referringNode,LHS);
          theFrame->nandCE->externalRightHash = AppendExpressions(theFrame->nandCE->externalRightHash,tempExpression);
 
-         tempExpression = (*nodeList->referringNode->patternType->genGetJNValueFunction)(theEnv,nodeList->referringNode,LHS);
+         tempExpression = GenJNGetvar(theEnv,nodeList->referringNode,LHS);
          theFrame->nandCE->externalLeftHash = AppendExpressions(theFrame->nandCE->externalLeftHash,tempExpression);
         }
      }
@@ -836,21 +860,18 @@ struct expr *GetvarReplace(
         {
          if (nodeList->beginNandDepth > nodeList->referringNode->beginNandDepth)
            {
-            (*nodeList->referringNode->patternType->replaceGetJNValueFunction)
-               (theEnv,newList,nodeList->referringNode,LHS);
+            ReplaceJNGetvar(theEnv,newList,nodeList->referringNode,LHS);
            }
          else
            {
-            (*nodeList->referringNode->patternType->replaceGetJNValueFunction)
-               (theEnv,newList,nodeList->referringNode,NESTED_RHS);
+            ReplaceJNGetvar(theEnv,newList,nodeList->referringNode,NESTED_RHS);
            }
         }
       else
         {
          if (nodeList->joinDepth != nodeList->referringNode->joinDepth)
            {
-            (*nodeList->referringNode->patternType->replaceGetJNValueFunction)
-               (theEnv,newList,nodeList->referringNode,LHS);
+            ReplaceJNGetvar(theEnv,newList,nodeList->referringNode,LHS);
            }
          else
            {
@@ -871,8 +892,7 @@ struct expr *GetvarReplace(
                  { side = LHS; }
               }
 
-            (*nodeList->referringNode->patternType->replaceGetJNValueFunction)
-               (theEnv,newList,useNode,side);
+            ReplaceJNGetvar(theEnv,newList,useNode,side);
            }
         }
      }
@@ -888,6 +908,43 @@ struct expr *GetvarReplace(
    return(newList);
   }
 
+/****************************************************************/
+/* GenJNGetvar: Generates the function call that retrieves the  */
+/*   value of a variable from the join network. The value of    */
+/*   the variable of an accumulate CE is retrieved from the     */
+/*   aggregate rather than from the pattern's fact or instance. */
+/****************************************************************/
+struct expr *GenJNGetvar(
+  Environment *theEnv,
+  struct lhsParseNode *theNode,
+  int side)
+  {
+   if (theNode->aggregate != NO_AGGREGATE)
+     { return AggregateGenGetJNValue(theEnv,theNode,side); }
+
+   return (*theNode->patternType->genGetJNValueFunction)(theEnv,theNode,side);
+  }
+
+/****************************************************************/
+/* ReplaceJNGetvar: Replaces a variable reference in place with */
+/*   the function call that retrieves the variable's value from */
+/*   the join network.                                          */
+/****************************************************************/
+void ReplaceJNGetvar(
+  Environment *theEnv,
+  struct expr *theItem,
+  struct lhsParseNode *theNode,
+  int side)
+  {
+   if (theNode->aggregate != NO_AGGREGATE)
+     {
+      AggregateReplaceGetJNValue(theEnv,theItem,theNode,side);
+      return;
+     }
+
+   (*theNode->patternType->replaceGetJNValueFunction)(theEnv,theItem,theNode,side);
+  }
+
 /**********************************************************************/
 /* GetfieldReplace: Replaces occurences of variables in expressions   */
 /*   with function calls that will extract the variable's value       */
@@ -963,13 +1020,17 @@ static struct expr *GenJNVariableComparison(
        (referringNode->patternType->genCompareJNValuesFunction == NULL))
      { return NULL; }
 
-   /*=====================================================*/
-   /* If both patterns are of the same type, then use the */
-   /* special function for generating the join test.      */
-   /*=====================================================*/
+   /*======================================================*/
+   /* If both patterns are of the same type, then use the  */
+   /* special function for generating the join test. The   */
+   /* value of an accumulate CE is not stored in a fact or */
+   /* instance, so it is always compared using eq/neq.     */
+   /*======================================================*/
 
-   if (selfNode->patternType->genCompareJNValuesFunction ==
-       referringNode->patternType->genCompareJNValuesFunction)
+   if ((selfNode->patternType->genCompareJNValuesFunction ==
+        referringNode->patternType->genCompareJNValuesFunction) &&
+       (selfNode->aggregate == NO_AGGREGATE) &&
+       (referringNode->aggregate == NO_AGGREGATE))
 
      {
       return (*selfNode->patternType->genCompareJNValuesFunction)(theEnv,selfNode,
@@ -986,8 +1047,11 @@ static struct expr *GenJNVariableComparison(
    if (selfNode->negated) top = GenConstant(theEnv,FCALL,ExpressionData(theEnv)->PTR_NEQ);
    else top = GenConstant(theEnv,FCALL,ExpressionData(theEnv)->PTR_EQ);
 
-   top->argList = (*selfNode->patternType->genGetJNValueFunction)(theEnv,selfNode,RHS);
-   top->argList->nextArg = (*referringNode->patternType->genGetJNValueFunction)(theEnv,referringNode,LHS);
+   if (isNand)
+     { top->argList = GenJNGetvar(theEnv,selfNode,NESTED_RHS); }
+   else
+     { top->argList = GenJNGetvar(theEnv,selfNode,RHS); }
+   top->argList->nextArg = GenJNGetvar(theEnv,referringNode,LHS);
 
    return(top);
   }
@@ -1110,6 +1174,104 @@ static bool AllVariablesInExpression(
    return true;
   }
 
-#endif /* (! RUN_TIME) && (! BLOAD_ONLY) && DEFRULE_CONSTRUCT */
+/***************************************************************/
+/* GenRangeIndex: Looks for a predicate constraint comparing a */
+/*   variable bound in the pattern to a variable bound in a    */
+/*   prior pattern with <, <=, >, or >=. If one is found, the  */
+/*   expression for retrieving the value from the pattern is   */
+/*   stored in the rightRange field of the pattern and the     */
+/*   expression for retrieving the value from the prior        */
+/*   pattern is stored in the leftRange field. The alpha       */
+/*   memory of the pattern is then kept ordered by the value   */
+/*   so that only the matches which can satisfy the comparison */
+/*   need to be checked when a partial match enters the join.  */
+/***************************************************************/
+static void GenRangeIndex(
+  Environment *theEnv,
+  struct lhsParseNode *andField,
+  struct lhsParseNode *thePattern)
+  {
+   struct lhsParseNode *theCall, *firstArg, *secondArg;
+   struct lhsParseNode *leftVariable, *rightVariable;
+   const char *functionName;
+   bool greaterThan, leftFirst;
 
+   for (;
+        andField != NULL;
+        andField = andField->right)
+     {
+      if ((andField->pnType != PREDICATE_CONSTRAINT_NODE) || andField->negated)
+        { continue; }
+
+      /*================================================*/
+      /* The predicate must be a call to one of the     */
+      /* numeric comparison functions with exactly two  */
+      /* arguments, both of which are single field      */
+      /* variables.                                     */
+      /*================================================*/
+
+      theCall = andField->expression;
+      if ((theCall == NULL) || (theCall->pnType != FCALL_NODE))
+        { continue; }
+
+      functionName = theCall->functionValue->callFunctionName->contents;
+      if ((strcmp(functionName,">") == 0) || (strcmp(functionName,">=") == 0))
+        { greaterThan = true; }
+      else if ((strcmp(functionName,"<") == 0) || (strcmp(functionName,"<=") == 0))
+        { greaterThan = false; }
+      else
+        { continue; }
+
+      firstArg = theCall->bottom;
+      if ((firstArg == NULL) || (firstArg->right == NULL) || (firstArg->right->right != NULL))
+        { continue; }
+      secondArg = firstArg->right;
+
+      if ((firstArg->pnType != SF_VARIABLE_NODE) || (firstArg->referringNode == NULL) ||
+          (firstArg->referringNode->pnType != SF_VARIABLE_NODE) ||
+          (secondArg->pnType != SF_VARIABLE_NODE) || (secondArg->referringNode == NULL) ||
+          (secondArg->referringNode->pnType != SF_VARIABLE_NODE))
+        { continue; }
+
+      /*================================================*/
+      /* One variable must come from the pattern (the   */
+      /* right side of the join) and the other from a   */
+      /* prior pattern (the left side of the join).     */
+      /*================================================*/
+
+      if ((firstArg->joinDepth != firstArg->referringNode->joinDepth) &&
+          (secondArg->joinDepth == secondArg->referringNode->joinDepth))
+        {
+         leftVariable = firstArg->referringNode;
+         rightVariable = secondArg->referringNode;
+         leftFirst = true;
+        }
+      else if ((firstArg->joinDepth == firstArg->referringNode->joinDepth) &&
+               (secondArg->joinDepth != secondArg->referringNode->joinDepth))
+        {
+         leftVariable = secondArg->referringNode;
+         rightVariable = firstArg->referringNode;
+         leftFirst = false;
+        }
+      else
+        { continue; }
+
+      if (leftVariable->goalCE || rightVariable->goalCE ||
+          (leftVariable->patternType->genGetJNValueFunction == NULL) ||
+          (rightVariable->patternType->genGetPNValueFunction == NULL))
+        { continue; }
+
+      /*================================================*/
+      /* For (> ?left ?right) the right value must be   */
+      /* at most the left value. Swapping the arguments */
+      /* or using < reverses the direction.             */
+      /*================================================*/
+
+      thePattern->leftRange = GenJNGetvar(theEnv,leftVariable,LHS);
+      thePattern->rightRange = (*rightVariable->patternType->genGetPNValueFunction)(theEnv,rightVariable);
+      thePattern->rangeAtMost = (greaterThan == leftFirst);
+      return;
+     }
+  }
 
+#endif /* (! RUN_TIME) && (! BLOAD_ONLY) && DEFRULE_CONSTRUCT */
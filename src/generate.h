@@ -50,6 +50,8 @@
    void                           FieldConversion(Environment *,struct lhsParseNode *,struct lhsParseNode *,struct nandFrame *);
    struct expr                   *GetvarReplace(Environment *,struct lhsParseNode *,bool,bool,struct nandFrame *);
    void                           AddNandUnification(Environment *,struct lhsParseNode *,struct nandFrame *);
+   struct expr                   *GenJNGetvar(Environment *,struct lhsParseNode *,int);
+   void                           ReplaceJNGetvar(Environment *,struct expr *,struct lhsParseNode *,int);
 
 #endif /* _H_generate */
 
@@ -114,6 +114,9 @@
 /*                                                           */
 /*            Added with-open-file function.                 */
 /*                                                           */
+/*      ?.??: The readline function reads blocks of          */
+/*            characters from routers that support it.       */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -171,6 +174,8 @@ struct conversionInfo
 /***************/
 
 #define FORMAT_MAX 512
+
+#define READLINE_DELIMITERS "\n\r\b"
 #define FLAG_MAX    80
 
 /********************/
@@ -200,7 +205,6 @@ struct IOFunctionData
    static void             ReadNumber(Environment *,const char *,struct token *,bool);
    static void             PrintDriver(UDFContext *,const char *,bool);
    static void             CreateConversionString(StringBuilder *,struct conversionInfo *,UDFValue *);
-   static int              GetCharForReadline(Environment *,const char *);
 #if (! BLOAD_ONLY)
    static struct expr     *WithOpenFileParser(Environment *,struct expr *,const char *);
 #endif
@@ -1990,27 +1994,6 @@ void ReadlineFunction(
    return;
   }
 
-/***********************/
-/* GetCharForReadline: */
-/***********************/
-static int GetCharForReadline(
-  Environment *theEnv,
-  const char *logicalName)
-  {
-   int c;
-   
-   c = ReadRouter(theEnv,logicalName);
-   if (c != '\r')
-     { return c; }
-
-   c = ReadRouter(theEnv,logicalName);
-   if (c == '\n')
-     { return c; }
-      
-   UnreadRouter(theEnv,logicalName,c);
-   return '\r';
-  }
-  
 /*************************************************************/
 /* FillBuffer: Read characters from a specified logical name */
 /*   and places them into a buffer until a carriage return   */
@@ -2022,6 +2005,9 @@ static char *FillBuffer(
   size_t *currentPosition,
   size_t *maximumSize)
   {
+   char block[ROUTER_BLOCK_SIZE];
+   size_t count, length;
+   bool delimited;
    int c;
    char *buf = NULL;
 
@@ -2029,19 +2015,45 @@ static char *FillBuffer(
    /* Read until end of line or eof. */
    /*================================*/
 
-   c = GetCharForReadline(theEnv,logicalName);
-   if (c == EOF)
+   count = ReadBlockRouter(theEnv,logicalName,block,ROUTER_BLOCK_SIZE,READLINE_DELIMITERS);
+   if (count == 0)
      { return NULL; }
 
-   /*==================================*/
-   /* Grab characters until cr or eof. */
-   /*==================================*/
+   /*==============================================*/
+   /* Grab blocks of characters until cr or eof. A */
+   /* backspace (or a NUL) also ends a block so it */
+   /* can be added a character at a time.          */
+   /*==============================================*/
 
-   while ((c != '\n') && (c != '\r') && (c != EOF) &&
-          (! GetHaltExecution(theEnv)))
+   while (! GetHaltExecution(theEnv))
      {
-      buf = ExpandStringWithChar(theEnv,c,buf,currentPosition,maximumSize,*maximumSize+80);
-      c = GetCharForReadline(theEnv,logicalName);
+      c = (unsigned char) block[count-1];
+      delimited = (strchr(READLINE_DELIMITERS,c) != NULL);
+      length = delimited ? (count - 1) : count;
+
+      if (length > 0)
+        { buf = AppendNToString(theEnv,block,buf,length,currentPosition,maximumSize); }
+
+      if (! delimited)
+        {
+         if (count < ROUTER_BLOCK_SIZE)
+           { break; }
+        }
+      else if (c == '\n')
+        { break; }
+      else if (c == '\r')
+        {
+         c = ReadRouter(theEnv,logicalName);
+         if (c != '\n')
+           { UnreadRouter(theEnv,logicalName,c); }
+         break;
+        }
+      else
+        { buf = ExpandStringWithChar(theEnv,c,buf,currentPosition,maximumSize,*maximumSize+80); }
+
+      count = ReadBlockRouter(theEnv,logicalName,block,ROUTER_BLOCK_SIZE,READLINE_DELIMITERS);
+      if (count == 0)
+        { break; }
      }
 
    /*==================*/
@@ -0,0 +1,1932 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*                 JSON FUNCTIONS MODULE               */
+/*******************************************************/
+
+/***********************************************************************/
+/* Purpose: Decodes JSON text from a string, a file or a socket        */
+/*   connection and asserts one deftemplate fact per object without    */
+/*   creating intermediate CLIPS values. Encodes facts, instances and  */
+/*   multifields as JSON into a string or a connection's output.       */
+/*                                                                     */
+/* Principal Programmer(s):                                            */
+/*      Ryan P. Johnston                                               */
+/*                                                                     */
+/* Revision History:                                                   */
+/*                                                                     */
+/*      ?.??: Added this file.                                         */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "clips.h"
+
+#include "jsonfun.h"
+#include "socketrtr.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+	static void                    InitializeJsonParser(Environment *,struct jsonParser *,const char *,Deftemplate *);
+	static void                    ReleaseJsonParser(struct jsonParser *);
+	static bool                    ApplyJsonMapping(struct jsonParser *,UDFContext *);
+	static Deftemplate            *GetJsonDeftemplate(Environment *,UDFContext *,const char *);
+	static long long               AssertJsonRecords(struct jsonParser *,const char *,size_t,bool,size_t *);
+	static bool                    ParseJsonObject(struct jsonParser *);
+	static bool                    ParseJsonString(struct jsonParser *);
+	static bool                    ParseJsonValue(struct jsonParser *,bool,CLIPSValue *);
+	static bool                    ParseJsonNumber(struct jsonParser *,CLIPSValue *);
+	static bool                    ParseJsonArray(struct jsonParser *,CLIPSValue *);
+	static bool                    SkipJsonValue(struct jsonParser *);
+	static bool                    MatchJsonLiteral(struct jsonParser *,const char *,size_t);
+	static struct jsonKey         *FindJsonKey(struct jsonParser *,const char *,size_t);
+	static struct jsonKey         *AddJsonKey(struct jsonParser *,const char *,size_t,unsigned long);
+	static unsigned long           HashJsonKey(const char *,size_t);
+	static long                    ParseHexQuad(const char *);
+	static void                    ScratchAppend(struct jsonParser *,const char *,size_t);
+	static void                    ScratchAppendCodepoint(struct jsonParser *,unsigned long);
+	static const char             *SkipJsonWhitespace(const char *,const char *);
+	static const char             *ScanJsonStringRun(const char *,const char *);
+	static void                    JsonSyntaxError(struct jsonParser *,const char *);
+	static void                    InitializeJsonWriter(Environment *,struct jsonWriter *,struct socketRouter *);
+	static void                    FinishJsonWriter(struct jsonWriter *);
+	static void                    JsonWriterCheckFlush(struct jsonWriter *);
+	static void                    JsonWriteString(struct jsonWriter *,const char *,size_t);
+	static void                    JsonWriteValue(struct jsonWriter *,CLIPSValue *,int);
+	static void                    JsonWriteMultifield(struct jsonWriter *,Multifield *,size_t,size_t,int);
+	static void                    JsonWriteFact(struct jsonWriter *,Fact *,int);
+	static void                    JsonWriteInstance(struct jsonWriter *,Instance *,int);
+	static void                    JsonWriteUDFValue(struct jsonWriter *,UDFValue *);
+	static struct socketRouter    *GetJsonArrayConnection(Environment *,UDFContext *,const char *);
+
+/**********************************************************/
+/* JsonFunctionDefinitions: Registers the JSON functions. */
+/**********************************************************/
+void JsonFunctionDefinitions(
+		Environment *theEnv)
+{
+	AddUDF(theEnv,"json-assert","bl",2,3,";y;s;m",JsonAssertFunction,"JsonAssertFunction",NULL);
+	AddUDF(theEnv,"json-assert-file","bl",2,3,";y;sy;m",JsonAssertFileFunction,"JsonAssertFileFunction",NULL);
+	AddUDF(theEnv,"json-assert-connection","bl",2,3,";y;lsy;m",JsonAssertConnectionFunction,"JsonAssertConnectionFunction",NULL);
+	AddUDF(theEnv,"to-json","bs",1,2,"*;*;lsy",ToJsonFunction,"ToJsonFunction",NULL);
+	AddUDF(theEnv,"to-json-array-start","b",1,1,"lsy",ToJsonArrayStartFunction,"ToJsonArrayStartFunction",NULL);
+	AddUDF(theEnv,"to-json-array-append","b",2,2,"*;lsy;*",ToJsonArrayAppendFunction,"ToJsonArrayAppendFunction",NULL);
+	AddUDF(theEnv,"to-json-array-end","bl",1,1,"lsy",ToJsonArrayEndFunction,"ToJsonArrayEndFunction",NULL);
+}
+
+/**********************************************************/
+/* SkipJsonWhitespace: Returns the first byte at or after */
+/*   p that is not JSON whitespace. Pretty printed input  */
+/*   has long runs of indentation, so those are skipped a */
+/*   vector at a time when the compiler targets SSE2 or   */
+/*   AVX2.                                                */
+/**********************************************************/
+static const char *SkipJsonWhitespace(
+		const char *p,
+		const char *end)
+{
+	if (p < end && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+	{ return p; }
+
+#if defined(__AVX2__)
+	{
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i newline = _mm256_set1_epi8('\n');
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		__m256i chunk, ws;
+		unsigned int mask;
+
+		while ((end - p) >= 32)
+		{
+			chunk = _mm256_loadu_si256((const __m256i *) p);
+			ws = _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(chunk,space),_mm256_cmpeq_epi8(chunk,newline)),
+					_mm256_or_si256(_mm256_cmpeq_epi8(chunk,cr),_mm256_cmpeq_epi8(chunk,tab)));
+			mask = ~ (unsigned int) _mm256_movemask_epi8(ws);
+			if (mask != 0)
+			{ return p + __builtin_ctz(mask); }
+			p += 32;
+		}
+	}
+#endif
+
+#if defined(__SSE2__)
+	{
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i newline = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i tab = _mm_set1_epi8('\t');
+		__m128i chunk, ws;
+		unsigned int mask;
+
+		while ((end - p) >= 16)
+		{
+			chunk = _mm_loadu_si128((const __m128i *) p);
+			ws = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(chunk,space),_mm_cmpeq_epi8(chunk,newline)),
+					_mm_or_si128(_mm_cmpeq_epi8(chunk,cr),_mm_cmpeq_epi8(chunk,tab)));
+			mask = (~ (unsigned int) _mm_movemask_epi8(ws)) & 0xFFFF;
+			if (mask != 0)
+			{ return p + __builtin_ctz(mask); }
+			p += 16;
+		}
+	}
+#endif
+
+	while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+	{ p++; }
+
+	return p;
+}
+
+/***********************************************************/
+/* ScanJsonStringRun: Returns the first byte at or after p */
+/*   that ends a run of plain string characters: a quote,  */
+/*   a backslash or a control character. Uses SSE2 or AVX2 */
+/*   compares when the compiler targets them.              */
+/***********************************************************/
+static const char *ScanJsonStringRun(
+		const char *p,
+		const char *end)
+{
+#if defined(__AVX2__)
+	{
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i backslash = _mm256_set1_epi8('\\');
+		const __m256i control = _mm256_set1_epi8(0x1F);
+		__m256i chunk, special;
+		unsigned int mask;
+
+		while ((end - p) >= 32)
+		{
+			chunk = _mm256_loadu_si256((const __m256i *) p);
+			special = _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(chunk,quote),_mm256_cmpeq_epi8(chunk,backslash)),
+					_mm256_cmpeq_epi8(_mm256_min_epu8(chunk,control),chunk));
+			mask = (unsigned int) _mm256_movemask_epi8(special);
+			if (mask != 0)
+			{ return p + __builtin_ctz(mask); }
+			p += 32;
+		}
+	}
+#endif
+
+#if defined(__SSE2__)
+	{
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i control = _mm_set1_epi8(0x1F);
+		__m128i chunk, special;
+		unsigned int mask;
+
+		while ((end - p) >= 16)
+		{
+			chunk = _mm_loadu_si128((const __m128i *) p);
+			special = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(chunk,quote),_mm_cmpeq_epi8(chunk,backslash)),
+					_mm_cmpeq_epi8(_mm_min_epu8(chunk,control),chunk));
+			mask = (unsigned int) _mm_movemask_epi8(special);
+			if (mask != 0)
+			{ return p + __builtin_ctz(mask); }
+			p += 16;
+		}
+	}
+#endif
+
+	while (p < end && *p != '"' && *p != '\\' && ((unsigned char) *p) >= 0x20)
+	{ p++; }
+
+	return p;
+}
+
+/*****************************************************/
+/* InitializeJsonParser: Sets up a parser for one    */
+/*   call of a json-assert function. The key table   */
+/*   and scratch buffer live as long as the call so  */
+/*   each distinct key is only resolved once.        */
+/*****************************************************/
+static void InitializeJsonParser(
+		Environment *theEnv,
+		struct jsonParser *parser,
+		const char *functionName,
+		Deftemplate *theDeftemplate)
+{
+	int i;
+
+	parser->theEnv = theEnv;
+	parser->functionName = functionName;
+	parser->start = NULL;
+	parser->current = NULL;
+	parser->end = NULL;
+	parser->theDeftemplate = theDeftemplate;
+	parser->theFB = CreateFactBuilder(theEnv,theDeftemplate->header.name->contents);
+	for (i = 0; i < JSON_KEY_TABLE_SIZE; i++)
+	{ parser->keyTable[i] = NULL; }
+	parser->scratchSize = BUFSIZ;
+	parser->scratch = (char *) gm2(theEnv,parser->scratchSize);
+	parser->scratchLength = 0;
+	parser->incomplete = false;
+	parser->error = false;
+}
+
+/*************************************************/
+/* ReleaseJsonParser: Returns the memory held by */
+/*   a parser's key table and scratch buffer.    */
+/*************************************************/
+static void ReleaseJsonParser(
+		struct jsonParser *parser)
+{
+	Environment *theEnv = parser->theEnv;
+	struct jsonKey *theKey, *nextKey;
+	int i;
+
+	for (i = 0; i < JSON_KEY_TABLE_SIZE; i++)
+	{
+		for (theKey = parser->keyTable[i]; theKey != NULL; theKey = nextKey)
+		{
+			nextKey = theKey->next;
+			rm(theEnv,theKey->name,theKey->length + 1);
+			rtn_struct(theEnv,jsonKey,theKey);
+		}
+	}
+
+	FBDispose(parser->theFB);
+	rm(theEnv,parser->scratch,parser->scratchSize);
+}
+
+/*********************************************/
+/* HashJsonKey: FNV-1a hash of a decoded key. */
+/*********************************************/
+static unsigned long HashJsonKey(
+		const char *name,
+		size_t length)
+{
+	unsigned long hashValue = 2166136261UL;
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		hashValue ^= (unsigned char) name[i];
+		hashValue *= 16777619UL;
+	}
+
+	return hashValue;
+}
+
+/*************************************************************/
+/* AddJsonKey: Interns a key the first time it is seen,      */
+/*   resolving it to a slot of the deftemplate by name. Keys */
+/*   that match no slot are remembered as unmapped so their  */
+/*   values can be skipped without another lookup.           */
+/*************************************************************/
+static struct jsonKey *AddJsonKey(
+		struct jsonParser *parser,
+		const char *name,
+		size_t length,
+		unsigned long hashValue)
+{
+	Environment *theEnv = parser->theEnv;
+	struct jsonKey *theKey;
+	struct templateSlot *theSlot;
+	unsigned short whichSlot;
+
+	theKey = get_struct(theEnv,jsonKey);
+	theKey->name = (char *) gm2(theEnv,length + 1);
+	memcpy(theKey->name,name,length);
+	theKey->name[length] = '\0';
+	theKey->length = length;
+	theKey->hashValue = hashValue;
+	theKey->whichSlot = 0;
+	theKey->mapped = false;
+	theKey->multislot = false;
+
+	for (theSlot = parser->theDeftemplate->slotList, whichSlot = 0;
+	     theSlot != NULL;
+	     theSlot = theSlot->next, whichSlot++)
+	{
+		if (strcmp(theSlot->slotName->contents,theKey->name) == 0)
+		{
+			theKey->whichSlot = whichSlot;
+			theKey->mapped = true;
+			theKey->multislot = theSlot->multislot;
+			break;
+		}
+	}
+
+	theKey->next = parser->keyTable[hashValue % JSON_KEY_TABLE_SIZE];
+	parser->keyTable[hashValue % JSON_KEY_TABLE_SIZE] = theKey;
+
+	return theKey;
+}
+
+/***************************************************/
+/* FindJsonKey: Returns the interned entry for a   */
+/*   key, adding it if this is its first occurence. */
+/***************************************************/
+static struct jsonKey *FindJsonKey(
+		struct jsonParser *parser,
+		const char *name,
+		size_t length)
+{
+	unsigned long hashValue = HashJsonKey(name,length);
+	struct jsonKey *theKey;
+
+	for (theKey = parser->keyTable[hashValue % JSON_KEY_TABLE_SIZE];
+	     theKey != NULL;
+	     theKey = theKey->next)
+	{
+		if ((theKey->hashValue == hashValue) &&
+		    (theKey->length == length) &&
+		    (memcmp(theKey->name,name,length) == 0))
+		{ return theKey; }
+	}
+
+	return AddJsonKey(parser,name,length,hashValue);
+}
+
+/*************************************************************/
+/* ApplyJsonMapping: Reads the optional mapping arguments,   */
+/*   pairs of slot name and JSON key, and seeds the key      */
+/*   table with them so those keys fill the named slots      */
+/*   instead of the slot with the same name as the key.      */
+/*************************************************************/
+static bool ApplyJsonMapping(
+		struct jsonParser *parser,
+		UDFContext *context)
+{
+	Environment *theEnv = parser->theEnv;
+	UDFValue theArg;
+	CLIPSValue *fields;
+	size_t i, count = 0;
+	struct jsonKey *theKey;
+	struct templateSlot *theSlot;
+	unsigned short whichSlot;
+	const char *slotName, *keyName;
+	size_t keyLength;
+
+	if (! UDFHasNextArgument(context))
+	{ return true; }
+
+	UDFNextArgument(context,MULTIFIELD_BIT,&theArg);
+	fields = &theArg.multifieldValue->contents[theArg.begin];
+	count = theArg.range;
+
+	if ((count % 2) != 0)
+	{
+		WriteString(theEnv,STDERR,parser->functionName);
+		WriteString(theEnv,STDERR,": mapping must be a multifield of slot and key pairs\n");
+		return false;
+	}
+
+	for (i = 0; i < count; i += 2)
+	{
+		if (((fields[i].header->type != SYMBOL_TYPE) && (fields[i].header->type != STRING_TYPE)) ||
+		    ((fields[i+1].header->type != SYMBOL_TYPE) && (fields[i+1].header->type != STRING_TYPE)))
+		{
+			WriteString(theEnv,STDERR,parser->functionName);
+			WriteString(theEnv,STDERR,": mapping must be a multifield of slot and key pairs\n");
+			return false;
+		}
+
+		slotName = fields[i].lexemeValue->contents;
+		keyName = fields[i+1].lexemeValue->contents;
+		keyLength = strlen(keyName);
+
+		for (theSlot = parser->theDeftemplate->slotList, whichSlot = 0;
+		     theSlot != NULL;
+		     theSlot = theSlot->next, whichSlot++)
+		{
+			if (strcmp(theSlot->slotName->contents,slotName) == 0)
+			{ break; }
+		}
+
+		if (theSlot == NULL)
+		{
+			WriteString(theEnv,STDERR,parser->functionName);
+			WriteString(theEnv,STDERR,": deftemplate has no slot named ");
+			WriteString(theEnv,STDERR,slotName);
+			WriteString(theEnv,STDERR,"\n");
+			return false;
+		}
+
+		theKey = FindJsonKey(parser,keyName,keyLength);
+		theKey->whichSlot = whichSlot;
+		theKey->mapped = true;
+		theKey->multislot = theSlot->multislot;
+	}
+
+	return true;
+}
+
+/*******************************************************/
+/* GetJsonDeftemplate: Looks up the deftemplate named  */
+/*   by the next argument, which must have slots.      */
+/*******************************************************/
+static Deftemplate *GetJsonDeftemplate(
+		Environment *theEnv,
+		UDFContext *context,
+		const char *functionName)
+{
+	UDFValue theArg;
+	Deftemplate *theDeftemplate;
+
+	UDFNextArgument(context,LEXEME_BITS,&theArg);
+
+	theDeftemplate = FindDeftemplate(theEnv,theArg.lexemeValue->contents);
+	if ((theDeftemplate == NULL) || theDeftemplate->implied)
+	{
+		WriteString(theEnv,STDERR,functionName);
+		WriteString(theEnv,STDERR,": ");
+		WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
+		WriteString(theEnv,STDERR," is not a deftemplate with slots\n");
+		return NULL;
+	}
+
+	return theDeftemplate;
+}
+
+/**************************************************/
+/* JsonSyntaxError: Reports where decoding failed. */
+/**************************************************/
+static void JsonSyntaxError(
+		struct jsonParser *parser,
+		const char *message)
+{
+	Environment *theEnv = parser->theEnv;
+
+	parser->error = true;
+
+	WriteString(theEnv,STDERR,parser->functionName);
+	WriteString(theEnv,STDERR,": ");
+	WriteString(theEnv,STDERR,message);
+	WriteString(theEnv,STDERR," at byte ");
+	WriteInteger(theEnv,STDERR,(long long) (parser->current - parser->start));
+	WriteString(theEnv,STDERR,"\n");
+}
+
+/*******************************************************/
+/* ScratchAppend: Appends bytes to the scratch buffer, */
+/*   growing it as needed. The buffer is always kept   */
+/*   NUL terminated.                                   */
+/*******************************************************/
+static void ScratchAppend(
+		struct jsonParser *parser,
+		const char *bytes,
+		size_t length)
+{
+	size_t newSize;
+	char *newScratch;
+
+	if ((parser->scratchLength + length + 1) > parser->scratchSize)
+	{
+		newSize = parser->scratchSize * 2;
+		while ((parser->scratchLength + length + 1) > newSize)
+		{ newSize *= 2; }
+
+		newScratch = (char *) gm2(parser->theEnv,newSize);
+		memcpy(newScratch,parser->scratch,parser->scratchLength);
+		rm(parser->theEnv,parser->scratch,parser->scratchSize);
+		parser->scratch = newScratch;
+		parser->scratchSize = newSize;
+	}
+
+	memcpy(parser->scratch + parser->scratchLength,bytes,length);
+	parser->scratchLength += length;
+	parser->scratch[parser->scratchLength] = '\0';
+}
+
+/*************************************************/
+/* ScratchAppendCodepoint: Appends a code point  */
+/*   to the scratch buffer encoded as UTF-8.     */
+/*************************************************/
+static void ScratchAppendCodepoint(
+		struct jsonParser *parser,
+		unsigned long codepoint)
+{
+	char utf8[4];
+	size_t length;
+
+	if (codepoint < 0x80)
+	{
+		utf8[0] = (char) codepoint;
+		length = 1;
+	}
+	else if (codepoint < 0x800)
+	{
+		utf8[0] = (char) (0xC0 | (codepoint >> 6));
+		utf8[1] = (char) (0x80 | (codepoint & 0x3F));
+		length = 2;
+	}
+	else if (codepoint < 0x10000)
+	{
+		utf8[0] = (char) (0xE0 | (codepoint >> 12));
+		utf8[1] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+		utf8[2] = (char) (0x80 | (codepoint & 0x3F));
+		length = 3;
+	}
+	else
+	{
+		utf8[0] = (char) (0xF0 | (codepoint >> 18));
+		utf8[1] = (char) (0x80 | ((codepoint >> 12) & 0x3F));
+		utf8[2] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+		utf8[3] = (char) (0x80 | (codepoint & 0x3F));
+		length = 4;
+	}
+
+	ScratchAppend(parser,utf8,length);
+}
+
+/******************************************************/
+/* ParseHexQuad: Reads the four hex digits of a \u    */
+/*   escape. Returns -1 if they are not valid.        */
+/******************************************************/
+static long ParseHexQuad(
+		const char *p)
+{
+	long value = 0;
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		value <<= 4;
+		if (p[i] >= '0' && p[i] <= '9') value |= p[i] - '0';
+		else if (p[i] >= 'a' && p[i] <= 'f') value |= p[i] - 'a' + 10;
+		else if (p[i] >= 'A' && p[i] <= 'F') value |= p[i] - 'A' + 10;
+		else return -1;
+	}
+
+	return value;
+}
+
+/*************************************************************/
+/* ParseJsonString: Decodes the string starting at the       */
+/*   opening quote into the scratch buffer. Plain runs are   */
+/*   copied in one piece; only escapes are handled bytewise. */
+/*************************************************************/
+static bool ParseJsonString(
+		struct jsonParser *parser)
+{
+	const char *p = parser->current + 1;
+	const char *end = parser->end;
+	const char *run;
+	long codepoint, low;
+
+	parser->scratchLength = 0;
+	parser->scratch[0] = '\0';
+
+	while (true)
+	{
+		run = ScanJsonStringRun(p,end);
+		if (run > p)
+		{ ScratchAppend(parser,p,(size_t) (run - p)); }
+		p = run;
+
+		if (p >= end)
+		{
+			parser->incomplete = true;
+			return false;
+		}
+
+		if (*p == '"')
+		{
+			parser->current = p + 1;
+			return true;
+		}
+
+		if (*p != '\\')
+		{
+			parser->current = p;
+			JsonSyntaxError(parser,"control character in string");
+			return false;
+		}
+
+		if ((end - p) < 2)
+		{
+			parser->incomplete = true;
+			return false;
+		}
+
+		switch (p[1])
+		{
+			case '"':  ScratchAppend(parser,"\"",1); p += 2; break;
+			case '\\': ScratchAppend(parser,"\\",1); p += 2; break;
+			case '/':  ScratchAppend(parser,"/",1); p += 2; break;
+			case 'b':  ScratchAppend(parser,"\b",1); p += 2; break;
+			case 'f':  ScratchAppend(parser,"\f",1); p += 2; break;
+			case 'n':  ScratchAppend(parser,"\n",1); p += 2; break;
+			case 'r':  ScratchAppend(parser,"\r",1); p += 2; break;
+			case 't':  ScratchAppend(parser,"\t",1); p += 2; break;
+			case 'u':
+				if ((end - p) < 6)
+				{
+					parser->incomplete = true;
+					return false;
+				}
+				if ((codepoint = ParseHexQuad(p + 2)) < 0)
+				{
+					parser->current = p;
+					JsonSyntaxError(parser,"invalid \\u escape");
+					return false;
+				}
+
+				/*=========================================*/
+				/* CLIPS strings end at a NUL, so \u0000   */
+				/* would silently truncate the value.      */
+				/*=========================================*/
+				if (codepoint == 0)
+				{
+					parser->current = p;
+					JsonSyntaxError(parser,"\\u0000 in string");
+					return false;
+				}
+				if ((codepoint >= 0xDC00) && (codepoint <= 0xDFFF))
+				{
+					parser->current = p;
+					JsonSyntaxError(parser,"unpaired surrogate in \\u escape");
+					return false;
+				}
+				p += 6;
+
+				/*=========================================*/
+				/* A high surrogate must be followed by a  */
+				/* low surrogate to form one code point.   */
+				/* Only the part of the pair that has      */
+				/* arrived is checked before asking for    */
+				/* more input.                             */
+				/*=========================================*/
+				if ((codepoint >= 0xD800) && (codepoint <= 0xDBFF))
+				{
+					if (((p < end) && (p[0] != '\\')) ||
+					    (((end - p) >= 2) && (p[1] != 'u')))
+					{
+						parser->current = p;
+						JsonSyntaxError(parser,"unpaired surrogate in \\u escape");
+						return false;
+					}
+					if ((end - p) < 6)
+					{
+						parser->incomplete = true;
+						return false;
+					}
+					if (((low = ParseHexQuad(p + 2)) < 0xDC00) || (low > 0xDFFF))
+					{
+						parser->current = p;
+						JsonSyntaxError(parser,"unpaired surrogate in \\u escape");
+						return false;
+					}
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+					p += 6;
+				}
+				ScratchAppendCodepoint(parser,(unsigned long) codepoint);
+				break;
+			default:
+				parser->current = p;
+				JsonSyntaxError(parser,"invalid escape in string");
+				return false;
+		}
+	}
+}
+
+/************************************************************/
+/* MatchJsonLiteral: Consumes true, false or null. Running  */
+/*   off the end of a partial buffer is not an error.       */
+/************************************************************/
+static bool MatchJsonLiteral(
+		struct jsonParser *parser,
+		const char *literal,
+		size_t length)
+{
+	size_t available = (size_t) (parser->end - parser->current);
+
+	if (available < length)
+	{
+		if (memcmp(parser->current,literal,available) == 0)
+		{ parser->incomplete = true; }
+		else
+		{ JsonSyntaxError(parser,"invalid literal"); }
+		return false;
+	}
+
+	if (memcmp(parser->current,literal,length) != 0)
+	{
+		JsonSyntaxError(parser,"invalid literal");
+		return false;
+	}
+
+	parser->current += length;
+	return true;
+}
+
+/*************************************************************/
+/* ParseJsonNumber: Converts a number to an integer, or to a */
+/*   float when it has a fraction or exponent or does not    */
+/*   fit in a long long.                                     */
+/*************************************************************/
+static bool ParseJsonNumber(
+		struct jsonParser *parser,
+		CLIPSValue *theValue)
+{
+	Environment *theEnv = parser->theEnv;
+	char buffer[JSON_MAX_NUMBER_LENGTH];
+	const char *p = parser->current;
+	bool isFloat = false;
+	size_t length;
+	long long integerValue;
+	char *numberEnd;
+
+	while ((p < parser->end) &&
+	       (((*p >= '0') && (*p <= '9')) || (*p == '-') || (*p == '+') ||
+	        (*p == '.') || (*p == 'e') || (*p == 'E')))
+	{
+		if ((*p == '.') || (*p == 'e') || (*p == 'E'))
+		{ isFloat = true; }
+		p++;
+	}
+
+	if (p >= parser->end)
+	{
+		parser->incomplete = true;
+		return false;
+	}
+
+	length = (size_t) (p - parser->current);
+	if ((length == 0) || (length >= JSON_MAX_NUMBER_LENGTH))
+	{
+		JsonSyntaxError(parser,"invalid number");
+		return false;
+	}
+
+	memcpy(buffer,parser->current,length);
+	buffer[length] = '\0';
+
+	if (! isFloat)
+	{
+		errno = 0;
+		integerValue = strtoll(buffer,&numberEnd,10);
+		if ((*numberEnd == '\0') && (errno != ERANGE))
+		{
+			theValue->integerValue = CreateInteger(theEnv,integerValue);
+			parser->current = p;
+			return true;
+		}
+	}
+
+	theValue->floatValue = CreateFloat(theEnv,strtod(buffer,&numberEnd));
+	if (*numberEnd != '\0')
+	{
+		JsonSyntaxError(parser,"invalid number");
+		return false;
+	}
+
+	parser->current = p;
+	return true;
+}
+
+/*************************************************************/
+/* SkipJsonValue: Steps over a value without converting it.  */
+/*   Used for keys that map to no slot and for nested values */
+/*   that are stored as their JSON text.                     */
+/*************************************************************/
+static bool SkipJsonValue(
+		struct jsonParser *parser)
+{
+	const char *p;
+	long depth = 0;
+
+	p = parser->current = SkipJsonWhitespace(parser->current,parser->end);
+	if (p >= parser->end)
+	{
+		parser->incomplete = true;
+		return false;
+	}
+
+	switch (*p)
+	{
+		case '"':
+			p++;
+			while (true)
+			{
+				p = ScanJsonStringRun(p,parser->end);
+				if (p >= parser->end)
+				{
+					parser->incomplete = true;
+					return false;
+				}
+				if (*p == '"')
+				{ break; }
+				if (*p == '\\')
+				{ p += 2; }
+				else
+				{ p++; }
+			}
+			parser->current = p + 1;
+			return true;
+
+		case 't': return MatchJsonLiteral(parser,"true",4);
+		case 'f': return MatchJsonLiteral(parser,"false",5);
+		case 'n': return MatchJsonLiteral(parser,"null",4);
+
+		case '{':
+		case '[':
+			break;
+
+		default:
+			while ((p < parser->end) &&
+			       (((*p >= '0') && (*p <= '9')) || (*p == '-') || (*p == '+') ||
+			        (*p == '.') || (*p == 'e') || (*p == 'E')))
+			{ p++; }
+			if (p >= parser->end)
+			{
+				parser->incomplete = true;
+				return false;
+			}
+			if (p == parser->current)
+			{
+				JsonSyntaxError(parser,"unexpected character");
+				return false;
+			}
+			parser->current = p;
+			return true;
+	}
+
+	/*=============================================*/
+	/* Containers are skipped by tracking nesting. */
+	/* Strings inside them are scanned so brackets */
+	/* within string values are not counted.       */
+	/*=============================================*/
+	while (p < parser->end)
+	{
+		switch (*p)
+		{
+			case '{':
+			case '[':
+				depth++;
+				p++;
+				break;
+
+			case '}':
+			case ']':
+				depth--;
+				p++;
+				if (depth == 0)
+				{
+					parser->current = p;
+					return true;
+				}
+				break;
+
+			case '"':
+				p++;
+				while (true)
+				{
+					p = ScanJsonStringRun(p,parser->end);
+					if (p >= parser->end)
+					{
+						parser->incomplete = true;
+						return false;
+					}
+					if (*p == '"')
+					{ break; }
+					if (*p == '\\')
+					{ p += 2; }
+					else
+					{ p++; }
+				}
+				p++;
+				break;
+
+			default:
+				p++;
+				break;
+		}
+	}
+
+	parser->incomplete = true;
+	return false;
+}
+
+/*************************************************************/
+/* ParseJsonArray: Builds a multifield from an array for a   */
+/*   multislot. Nested containers become their JSON text.    */
+/*************************************************************/
+static bool ParseJsonArray(
+		struct jsonParser *parser,
+		CLIPSValue *theValue)
+{
+	Environment *theEnv = parser->theEnv;
+	MultifieldBuilder *theMB;
+	CLIPSValue element;
+
+	theMB = CreateMultifieldBuilder(theEnv,0);
+	parser->current++;
+
+	parser->current = SkipJsonWhitespace(parser->current,parser->end);
+	if ((parser->current < parser->end) && (*parser->current == ']'))
+	{
+		parser->current++;
+		theValue->multifieldValue = MBCreate(theMB);
+		MBDispose(theMB);
+		return true;
+	}
+
+	while (true)
+	{
+		if (! ParseJsonValue(parser,false,&element))
+		{
+			MBDispose(theMB);
+			return false;
+		}
+
+		if (element.value != NULL)
+		{ MBAppend(theMB,&element); }
+		else
+		{ MBAppendSymbol(theMB,"nil"); }
+
+		parser->current = SkipJsonWhitespace(parser->current,parser->end);
+		if (parser->current >= parser->end)
+		{
+			parser->incomplete = true;
+			MBDispose(theMB);
+			return false;
+		}
+
+		if (*parser->current == ']')
+		{
+			parser->current++;
+			break;
+		}
+
+		if (*parser->current != ',')
+		{
+			JsonSyntaxError(parser,"expected , or ] in array");
+			MBDispose(theMB);
+			return false;
+		}
+		parser->current++;
+	}
+
+	theValue->multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+	return true;
+}
+
+/*************************************************************/
+/* ParseJsonValue: Converts one value to a CLIPS value.      */
+/*   Strings become STRINGs, numbers INTEGERs or FLOATs, and */
+/*   true and false the symbols TRUE and FALSE. null leaves  */
+/*   value set to NULL so the slot keeps its default. Arrays */
+/*   become multifields when stored in a multislot; any      */
+/*   other container is stored as its JSON text.             */
+/*************************************************************/
+static bool ParseJsonValue(
+		struct jsonParser *parser,
+		bool multislot,
+		CLIPSValue *theValue)
+{
+	Environment *theEnv = parser->theEnv;
+	const char *valueStart;
+
+	theValue->value = NULL;
+
+	parser->current = SkipJsonWhitespace(parser->current,parser->end);
+	if (parser->current >= parser->end)
+	{
+		parser->incomplete = true;
+		return false;
+	}
+
+	switch (*parser->current)
+	{
+		case '"':
+			if (! ParseJsonString(parser))
+			{ return false; }
+			theValue->lexemeValue = CreateString(theEnv,parser->scratch);
+			return true;
+
+		case 't':
+			if (! MatchJsonLiteral(parser,"true",4))
+			{ return false; }
+			theValue->lexemeValue = TrueSymbol(theEnv);
+			return true;
+
+		case 'f':
+			if (! MatchJsonLiteral(parser,"false",5))
+			{ return false; }
+			theValue->lexemeValue = FalseSymbol(theEnv);
+			return true;
+
+		case 'n':
+			return MatchJsonLiteral(parser,"null",4);
+
+		case '[':
+			if (multislot)
+			{ return ParseJsonArray(parser,theValue); }
+			/* Fall through */
+
+		case '{':
+			valueStart = parser->current;
+			if (! SkipJsonValue(parser))
+			{ return false; }
+			parser->scratchLength = 0;
+			ScratchAppend(parser,valueStart,(size_t) (parser->current - valueStart));
+			theValue->lexemeValue = CreateString(theEnv,parser->scratch);
+			return true;
+
+		default:
+			return ParseJsonNumber(parser,theValue);
+	}
+}
+
+/*************************************************************/
+/* ParseJsonObject: Decodes one object into the fact builder. */
+/*   Each key is resolved through the interned key table.    */
+/*************************************************************/
+static bool ParseJsonObject(
+		struct jsonParser *parser)
+{
+	Environment *theEnv = parser->theEnv;
+	struct jsonKey *theKey;
+	CLIPSValue theValue;
+	MultifieldBuilder *theMB;
+	PutSlotError rv;
+
+	parser->current++;
+
+	parser->current = SkipJsonWhitespace(parser->current,parser->end);
+	if ((parser->current < parser->end) && (*parser->current == '}'))
+	{
+		parser->current++;
+		return true;
+	}
+
+	while (true)
+	{
+		parser->current = SkipJsonWhitespace(parser->current,parser->end);
+		if (parser->current >= parser->end)
+		{
+			parser->incomplete = true;
+			return false;
+		}
+
+		if (*parser->current != '"')
+		{
+			JsonSyntaxError(parser,"expected string key in object");
+			return false;
+		}
+
+		if (! ParseJsonString(parser))
+		{ return false; }
+
+		theKey = FindJsonKey(parser,parser->scratch,parser->scratchLength);
+
+		parser->current = SkipJsonWhitespace(parser->current,parser->end);
+		if (parser->current >= parser->end)
+		{
+			parser->incomplete = true;
+			return false;
+		}
+
+		if (*parser->current != ':')
+		{
+			JsonSyntaxError(parser,"expected : after object key");
+			return false;
+		}
+		parser->current++;
+
+		if (! theKey->mapped)
+		{
+			if (! SkipJsonValue(parser))
+			{ return false; }
+		}
+		else
+		{
+			if (! ParseJsonValue(parser,theKey->multislot,&theValue))
+			{ return false; }
+
+			if (theValue.value != NULL)
+			{
+				/*====================================*/
+				/* A scalar stored in a multislot is  */
+				/* wrapped in a one field multifield. */
+				/*====================================*/
+				if (theKey->multislot && (theValue.header->type != MULTIFIELD_TYPE))
+				{
+					theMB = CreateMultifieldBuilder(theEnv,1);
+					MBAppend(theMB,&theValue);
+					theValue.multifieldValue = MBCreate(theMB);
+					MBDispose(theMB);
+				}
+
+				rv = FBPutSlotByPosition(parser->theFB,theKey->whichSlot,&theValue);
+				if (rv != PSE_NO_ERROR)
+				{
+					WriteString(theEnv,STDERR,parser->functionName);
+					WriteString(theEnv,STDERR,": value for key ");
+					WriteString(theEnv,STDERR,theKey->name);
+					WriteString(theEnv,STDERR," violates the constraints of its slot at byte ");
+					WriteInteger(theEnv,STDERR,(long long) (parser->current - parser->start));
+					WriteString(theEnv,STDERR,"\n");
+					parser->error = true;
+					return false;
+				}
+			}
+		}
+
+		parser->current = SkipJsonWhitespace(parser->current,parser->end);
+		if (parser->current >= parser->end)
+		{
+			parser->incomplete = true;
+			return false;
+		}
+
+		if (*parser->current == '}')
+		{
+			parser->current++;
+			return true;
+		}
+
+		if (*parser->current != ',')
+		{
+			JsonSyntaxError(parser,"expected , or } in object");
+			return false;
+		}
+		parser->current++;
+	}
+}
+
+/*************************************************************/
+/* AssertJsonRecords: Asserts a fact for each object in the  */
+/*   buffer. Objects may be separated by whitespace, as in   */
+/*   newline delimited JSON, or enclosed in a top level      */
+/*   array. When partial is true the buffer may end inside   */
+/*   an object; that object is left alone and consumed is    */
+/*   set to the offset where it starts. Returns the number   */
+/*   of new facts asserted. On an error, parser->error is    */
+/*   set and consumed is the offset of the offending object. */
+/*************************************************************/
+static long long AssertJsonRecords(
+		struct jsonParser *parser,
+		const char *buffer,
+		size_t length,
+		bool partial,
+		size_t *consumed)
+{
+	Environment *theEnv = parser->theEnv;
+	const char *recordStart;
+	long long count = 0, nextIndex;
+	GCBlock gcb;
+
+	parser->start = buffer;
+	parser->current = buffer;
+	parser->end = buffer + length;
+	parser->incomplete = false;
+	parser->error = false;
+
+	while (true)
+	{
+		/*=============================================*/
+		/* Separators between top level objects, the   */
+		/* brackets and commas of an enclosing array,  */
+		/* are skipped along with whitespace.          */
+		/*=============================================*/
+		while (true)
+		{
+			parser->current = SkipJsonWhitespace(parser->current,parser->end);
+			if ((parser->current < parser->end) &&
+			    ((*parser->current == '[') || (*parser->current == ']') || (*parser->current == ',')))
+			{ parser->current++; }
+			else
+			{ break; }
+		}
+
+		recordStart = parser->current;
+		if (parser->current >= parser->end)
+		{ break; }
+
+		if (*parser->current != '{')
+		{
+			JsonSyntaxError(parser,"expected an object");
+			break;
+		}
+
+		GCBlockStart(theEnv,&gcb);
+
+		if (ParseJsonObject(parser))
+		{
+			/*==========================================*/
+			/* A duplicate of an existing fact is not   */
+			/* given a new index and is not counted.    */
+			/*==========================================*/
+			nextIndex = FactData(theEnv)->NextFactIndex;
+			if ((FBAssert(parser->theFB) != NULL) &&
+			    (FactData(theEnv)->NextFactIndex != nextIndex))
+			{ count++; }
+			GCBlockEnd(theEnv,&gcb);
+			continue;
+		}
+
+		FBAbort(parser->theFB);
+		GCBlockEnd(theEnv,&gcb);
+
+		if (parser->incomplete && ! parser->error)
+		{
+			if (! partial)
+			{
+				parser->current = recordStart;
+				JsonSyntaxError(parser,"unterminated object");
+			}
+		}
+
+		parser->current = recordStart;
+		break;
+	}
+
+	if (consumed != NULL)
+	{ *consumed = (size_t) (parser->current - buffer); }
+
+	return count;
+}
+
+/*************************************************************/
+/* JsonAssertFunction: H/L access function for json-assert.  */
+/*   (json-assert ?template ?json <$?mapping>)               */
+/*   Asserts a fact of the deftemplate for every object in   */
+/*   the string and returns how many were asserted. Facts    */
+/*   before a syntax error remain asserted and are counted;  */
+/*   FALSE is returned only if there were none.              */
+/*************************************************************/
+void JsonAssertFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	Deftemplate *theDeftemplate;
+	struct jsonParser parser;
+	const char *text;
+	long long count;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((theDeftemplate = GetJsonDeftemplate(theEnv,context,"json-assert")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,LEXEME_BITS,&theArg);
+	text = theArg.lexemeValue->contents;
+
+	InitializeJsonParser(theEnv,&parser,"json-assert",theDeftemplate);
+
+	if (ApplyJsonMapping(&parser,context))
+	{
+		count = AssertJsonRecords(&parser,text,strlen(text),false,NULL);
+		if ((count > 0) || ! parser.error)
+		{ returnValue->integerValue = CreateInteger(theEnv,count); }
+	}
+
+	ReleaseJsonParser(&parser);
+}
+
+/*************************************************************/
+/* JsonAssertFileFunction: H/L access function for           */
+/*   json-assert-file. The file is mapped into memory and    */
+/*   decoded in place without being copied through stdio.    */
+/*   (json-assert-file ?template ?path <$?mapping>)          */
+/*************************************************************/
+void JsonAssertFileFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	Deftemplate *theDeftemplate;
+	struct jsonParser parser;
+	struct stat st;
+	const char *path;
+	void *mapping = NULL;
+	long long count;
+	int fd;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((theDeftemplate = GetJsonDeftemplate(theEnv,context,"json-assert-file")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,LEXEME_BITS,&theArg);
+	path = theArg.lexemeValue->contents;
+
+	if ((fd = open(path,O_RDONLY)) < 0)
+	{
+		WriteString(theEnv,STDERR,"json-assert-file: could not open ");
+		WriteString(theEnv,STDERR,path);
+		WriteString(theEnv,STDERR,"\n");
+		perror("perror");
+		return;
+	}
+
+	if (fstat(fd,&st) < 0)
+	{
+		perror("perror");
+		close(fd);
+		return;
+	}
+
+	if (st.st_size > 0)
+	{
+		mapping = mmap(NULL,(size_t) st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+		if (mapping == MAP_FAILED)
+		{
+			perror("perror");
+			close(fd);
+			return;
+		}
+		madvise(mapping,(size_t) st.st_size,MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	InitializeJsonParser(theEnv,&parser,"json-assert-file",theDeftemplate);
+
+	if (ApplyJsonMapping(&parser,context))
+	{
+		count = AssertJsonRecords(&parser,(const char *) mapping,(size_t) st.st_size,false,NULL);
+		if ((count > 0) || ! parser.error)
+		{ returnValue->integerValue = CreateInteger(theEnv,count); }
+	}
+
+	ReleaseJsonParser(&parser);
+
+	if (mapping != NULL)
+	{ munmap(mapping,(size_t) st.st_size); }
+}
+
+/*************************************************************/
+/* JsonAssertConnectionFunction: H/L access function for     */
+/*   json-assert-connection. Reads what is available on the  */
+/*   connection, waiting if it is blocking and nothing is,   */
+/*   and asserts a fact for each complete object. A trailing */
+/*   partial object is kept for the next call. A line with   */
+/*   a syntax error is skipped and decoding resumes on the   */
+/*   next one. Returns the number of new facts asserted, or  */
+/*   FALSE if none were and there was an error or the peer   */
+/*   has closed and no complete objects remain.              */
+/*   (json-assert-connection ?template ?socket <$?mapping>)  */
+/*************************************************************/
+void JsonAssertConnectionFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	Deftemplate *theDeftemplate;
+	struct socketRouter *sptr;
+	struct jsonParser parser;
+	long long count = 0;
+	size_t consumed = 0, offset = 0;
+	const char *newline;
+	bool eof, failed = false;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((theDeftemplate = GetJsonDeftemplate(theEnv,context,"json-assert-connection")) == NULL)
+	{ return; }
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"json-assert-connection: could not find connection\n");
+		return;
+	}
+
+	InitializeJsonParser(theEnv,&parser,"json-assert-connection",theDeftemplate);
+
+	if (! ApplyJsonMapping(&parser,context))
+	{
+		ReleaseJsonParser(&parser);
+		return;
+	}
+
+	if (! ReadSocketAvailable(theEnv,sptr,&eof))
+	{
+		perror("perror");
+		ReleaseJsonParser(&parser);
+		return;
+	}
+
+	/*=============================================*/
+	/* On an error the rest of the offending line  */
+	/* is thrown away and decoding carries on with */
+	/* the next, so one bad record does not cost   */
+	/* the ones that follow it.                    */
+	/*=============================================*/
+	while (true)
+	{
+		count += AssertJsonRecords(&parser,sptr->pending + offset,sptr->pendingLength - offset,! eof,&consumed);
+		offset += consumed;
+		if (! parser.error)
+		{ break; }
+
+		failed = true;
+		newline = (const char *) memchr(sptr->pending + offset,'\n',sptr->pendingLength - offset);
+		if (newline == NULL)
+		{
+			offset = sptr->pendingLength;
+			break;
+		}
+		offset = (size_t) (newline - sptr->pending) + 1;
+	}
+
+	ConsumeSocketPending(theEnv,sptr,offset);
+
+	if ((count > 0) || (! failed && ! eof))
+	{ returnValue->integerValue = CreateInteger(theEnv,count); }
+
+	ReleaseJsonParser(&parser);
+}
+
+/*******************************************************/
+/* InitializeJsonWriter: Sets up a writer that builds  */
+/*   JSON in a string builder. When router is given    */
+/*   the builder is flushed to it as it fills, so long */
+/*   output goes to the connection without being held  */
+/*   in memory as one string.                          */
+/*******************************************************/
+static void InitializeJsonWriter(
+		Environment *theEnv,
+		struct jsonWriter *writer,
+		struct socketRouter *router)
+{
+	writer->theEnv = theEnv;
+	writer->theSB = CreateStringBuilder(theEnv,BUFSIZ * 2);
+	writer->router = router;
+}
+
+/******************************************************/
+/* FinishJsonWriter: Writes anything still held by a  */
+/*   writer to its stream and disposes of its builder. */
+/******************************************************/
+static void FinishJsonWriter(
+		struct jsonWriter *writer)
+{
+	if ((writer->router != NULL) && (writer->theSB->length > 0))
+	{ WriteSocketBytes(writer->theEnv,writer->router,writer->theSB->contents,writer->theSB->length); }
+
+	SBDispose(writer->theSB);
+}
+
+/******************************************************/
+/* JsonWriterCheckFlush: Moves the builder's contents */
+/*   into the stream's buffer once it passes BUFSIZ.  */
+/******************************************************/
+static void JsonWriterCheckFlush(
+		struct jsonWriter *writer)
+{
+	if ((writer->router == NULL) || (writer->theSB->length < BUFSIZ))
+	{ return; }
+
+	WriteSocketBytes(writer->theEnv,writer->router,writer->theSB->contents,writer->theSB->length);
+	SBReset(writer->theSB);
+}
+
+/************************************************************/
+/* JsonWriteString: Writes a quoted, escaped JSON string.   */
+/*   Runs that need no escaping are found with the same     */
+/*   vector scan the decoder uses and copied in one piece.  */
+/************************************************************/
+static void JsonWriteString(
+		struct jsonWriter *writer,
+		const char *text,
+		size_t length)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+	const char *p = text;
+	const char *end = text + length;
+	const char *run;
+	char escape[6];
+
+	SBAddChar(writer->theSB,'"');
+
+	while (p < end)
+	{
+		run = ScanJsonStringRun(p,end);
+		if (run > p)
+		{ SBAppendLength(writer->theSB,p,(size_t) (run - p)); }
+		p = run;
+
+		if (p >= end)
+		{ break; }
+
+		switch (*p)
+		{
+			case '"':  SBAppendLength(writer->theSB,"\\\"",2); break;
+			case '\\': SBAppendLength(writer->theSB,"\\\\",2); break;
+			case '\n': SBAppendLength(writer->theSB,"\\n",2); break;
+			case '\r': SBAppendLength(writer->theSB,"\\r",2); break;
+			case '\t': SBAppendLength(writer->theSB,"\\t",2); break;
+			case '\b': SBAppendLength(writer->theSB,"\\b",2); break;
+			case '\f': SBAppendLength(writer->theSB,"\\f",2); break;
+			default:
+				escape[0] = '\\';
+				escape[1] = 'u';
+				escape[2] = '0';
+				escape[3] = '0';
+				escape[4] = hexDigits[(*p >> 4) & 0x0F];
+				escape[5] = hexDigits[*p & 0x0F];
+				SBAppendLength(writer->theSB,escape,6);
+				break;
+		}
+		p++;
+	}
+
+	SBAddChar(writer->theSB,'"');
+	JsonWriterCheckFlush(writer);
+}
+
+/*********************************************************/
+/* JsonWriteMultifield: Writes a range of a multifield   */
+/*   as a JSON array.                                    */
+/*********************************************************/
+static void JsonWriteMultifield(
+		struct jsonWriter *writer,
+		Multifield *theMultifield,
+		size_t begin,
+		size_t range,
+		int depth)
+{
+	size_t i;
+
+	SBAddChar(writer->theSB,'[');
+
+	for (i = 0; i < range; i++)
+	{
+		if (i > 0)
+		{ SBAddChar(writer->theSB,','); }
+		JsonWriteValue(writer,&theMultifield->contents[begin + i],depth + 1);
+	}
+
+	SBAddChar(writer->theSB,']');
+}
+
+/**********************************************************/
+/* JsonWriteFact: Writes a fact as an object keyed by its */
+/*   slot names. An ordered fact is written as the array  */
+/*   of its fields.                                       */
+/**********************************************************/
+static void JsonWriteFact(
+		struct jsonWriter *writer,
+		Fact *theFact,
+		int depth)
+{
+	struct templateSlot *theSlot;
+	CLIPSValue *contents = theFact->theProposition.contents;
+	size_t i;
+
+	if (theFact->garbage)
+	{
+		SBAppendLength(writer->theSB,"null",4);
+		return;
+	}
+
+	if (theFact->whichDeftemplate->implied)
+	{
+		JsonWriteMultifield(writer,contents[0].multifieldValue,0,contents[0].multifieldValue->length,depth);
+		return;
+	}
+
+	SBAddChar(writer->theSB,'{');
+
+	for (theSlot = theFact->whichDeftemplate->slotList, i = 0;
+	     theSlot != NULL;
+	     theSlot = theSlot->next, i++)
+	{
+		if (i > 0)
+		{ SBAddChar(writer->theSB,','); }
+		JsonWriteString(writer,theSlot->slotName->contents,strlen(theSlot->slotName->contents));
+		SBAddChar(writer->theSB,':');
+		JsonWriteValue(writer,&contents[i],depth + 1);
+	}
+
+	SBAddChar(writer->theSB,'}');
+}
+
+/**************************************************************/
+/* JsonWriteInstance: Writes an instance as an object keyed   */
+/*   by its slot names, including inherited and shared slots. */
+/**************************************************************/
+static void JsonWriteInstance(
+		struct jsonWriter *writer,
+		Instance *theInstance,
+		int depth)
+{
+	InstanceSlot *theSlot;
+	CLIPSValue theValue;
+	const char *slotName;
+	unsigned short i;
+
+	if (theInstance->garbage)
+	{
+		SBAppendLength(writer->theSB,"null",4);
+		return;
+	}
+
+	SBAddChar(writer->theSB,'{');
+
+	for (i = 0; i < theInstance->cls->instanceSlotCount; i++)
+	{
+		theSlot = theInstance->slotAddresses[i];
+		slotName = theSlot->desc->slotName->name->contents;
+
+		if (i > 0)
+		{ SBAddChar(writer->theSB,','); }
+		JsonWriteString(writer,slotName,strlen(slotName));
+		SBAddChar(writer->theSB,':');
+
+		theValue.value = theSlot->value;
+		JsonWriteValue(writer,&theValue,depth + 1);
+	}
+
+	SBAddChar(writer->theSB,'}');
+}
+
+/****************************************************************/
+/* JsonWriteValue: Writes any CLIPS value. TRUE, FALSE and nil  */
+/*   become true, false and null; other symbols, strings and    */
+/*   instance names become strings. Facts and instances nested  */
+/*   in slots are written as objects up to JSON_MAX_DEPTH,      */
+/*   which also stops instances that refer to each other.       */
+/****************************************************************/
+static void JsonWriteValue(
+		struct jsonWriter *writer,
+		CLIPSValue *theValue,
+		int depth)
+{
+	Environment *theEnv = writer->theEnv;
+	char buffer[JSON_MAX_NUMBER_LENGTH];
+	int length, i;
+
+	if (depth > JSON_MAX_DEPTH)
+	{
+		SBAppendLength(writer->theSB,"null",4);
+		return;
+	}
+
+	switch (theValue->header->type)
+	{
+		case SYMBOL_TYPE:
+			if (theValue->lexemeValue == TrueSymbol(theEnv))
+			{ SBAppendLength(writer->theSB,"true",4); }
+			else if (theValue->lexemeValue == FalseSymbol(theEnv))
+			{ SBAppendLength(writer->theSB,"false",5); }
+			else if (strcmp(theValue->lexemeValue->contents,"nil") == 0)
+			{ SBAppendLength(writer->theSB,"null",4); }
+			else
+			{ JsonWriteString(writer,theValue->lexemeValue->contents,strlen(theValue->lexemeValue->contents)); }
+			break;
+
+		case STRING_TYPE:
+		case INSTANCE_NAME_TYPE:
+			JsonWriteString(writer,theValue->lexemeValue->contents,strlen(theValue->lexemeValue->contents));
+			break;
+
+		case INTEGER_TYPE:
+			length = snprintf(buffer,sizeof(buffer),"%lld",theValue->integerValue->contents);
+			SBAppendLength(writer->theSB,buffer,(size_t) length);
+			break;
+
+		case FLOAT_TYPE:
+			if (! isfinite(theValue->floatValue->contents))
+			{
+				SBAppendLength(writer->theSB,"null",4);
+				break;
+			}
+
+			/*==========================================*/
+			/* Match the way CLIPS prints floats, so a  */
+			/* whole number still reads back as float.  */
+			/*==========================================*/
+			length = snprintf(buffer,sizeof(buffer),"%.15g",theValue->floatValue->contents);
+			SBAppendLength(writer->theSB,buffer,(size_t) length);
+			for (i = 0; i < length; i++)
+			{
+				if ((buffer[i] == '.') || (buffer[i] == 'e'))
+				{ break; }
+			}
+			if (i == length)
+			{ SBAppendLength(writer->theSB,".0",2); }
+			break;
+
+		case MULTIFIELD_TYPE:
+			JsonWriteMultifield(writer,theValue->multifieldValue,0,theValue->multifieldValue->length,depth);
+			break;
+
+		case FACT_ADDRESS_TYPE:
+			JsonWriteFact(writer,theValue->factValue,depth);
+			break;
+
+		case INSTANCE_ADDRESS_TYPE:
+			JsonWriteInstance(writer,theValue->instanceValue,depth);
+			break;
+
+		default:
+			SBAppendLength(writer->theSB,"null",4);
+			break;
+	}
+
+	JsonWriterCheckFlush(writer);
+}
+
+/*********************************************************/
+/* JsonWriteUDFValue: Writes a function argument, using  */
+/*   the range of a multifield argument.                 */
+/*********************************************************/
+static void JsonWriteUDFValue(
+		struct jsonWriter *writer,
+		UDFValue *theArg)
+{
+	CLIPSValue theValue;
+
+	if (theArg->header->type == MULTIFIELD_TYPE)
+	{
+		JsonWriteMultifield(writer,theArg->multifieldValue,theArg->begin,theArg->range,0);
+		return;
+	}
+
+	theValue.value = theArg->value;
+	JsonWriteValue(writer,&theValue,0);
+}
+
+/*************************************************************/
+/* ToJsonFunction: H/L access function for to-json.          */
+/*   (to-json ?factOrInstanceOrValue <?socket>)              */
+/*   Returns the JSON text as a string, or writes it to the  */
+/*   connection's output buffer and returns TRUE.            */
+/*************************************************************/
+void ToJsonFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg, socketArg;
+	struct socketRouter *sptr = NULL;
+	struct jsonWriter writer;
+
+	UDFNextArgument(context,ANY_TYPE_BITS,&theArg);
+
+	if (UDFHasNextArgument(context))
+	{
+		if ((sptr = GetSocketRouterFromArgument(theEnv,context,&socketArg)) == NULL)
+		{
+			WriteString(theEnv,STDERR,"to-json: could not find connection\n");
+			returnValue->lexemeValue = FalseSymbol(theEnv);
+			return;
+		}
+	}
+
+	InitializeJsonWriter(theEnv,&writer,sptr);
+	JsonWriteUDFValue(&writer,&theArg);
+
+	if (sptr == NULL)
+	{ returnValue->lexemeValue = CreateString(theEnv,writer.theSB->contents); }
+	else
+	{ returnValue->lexemeValue = TrueSymbol(theEnv); }
+
+	FinishJsonWriter(&writer);
+}
+
+/***********************************************************/
+/* GetJsonArrayConnection: Gets the connection argument of */
+/*   the to-json-array functions, reporting if it is not   */
+/*   a connection.                                         */
+/***********************************************************/
+static struct socketRouter *GetJsonArrayConnection(
+		Environment *theEnv,
+		UDFContext *context,
+		const char *functionName)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,functionName);
+		WriteString(theEnv,STDERR,": could not find connection\n");
+	}
+
+	return sptr;
+}
+
+/************************************************************/
+/* ToJsonArrayStartFunction: H/L access function for        */
+/*   to-json-array-start. Opens a JSON array on a           */
+/*   connection that to-json-array-append adds elements to, */
+/*   so a response can be streamed from do-for-all-facts.   */
+/*   (to-json-array-start ?socket)                          */
+/************************************************************/
+void ToJsonArrayStartFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *sptr;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetJsonArrayConnection(theEnv,context,"to-json-array-start")) == NULL)
+	{ return; }
+
+	if (sptr->jsonArrayCount >= 0)
+	{
+		WriteString(theEnv,STDERR,"to-json-array-start: an array is already open on this connection\n");
+		return;
+	}
+
+	WriteSocketBytes(theEnv,sptr,"[",1);
+	sptr->jsonArrayCount = 0;
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/**********************************************************/
+/* ToJsonArrayAppendFunction: H/L access function for     */
+/*   to-json-array-append. Writes a value as the next     */
+/*   element of the array open on the connection.         */
+/*   (to-json-array-append ?socket ?factOrInstanceOrValue) */
+/**********************************************************/
+void ToJsonArrayAppendFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	struct jsonWriter writer;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetJsonArrayConnection(theEnv,context,"to-json-array-append")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,ANY_TYPE_BITS,&theArg);
+
+	if (sptr->jsonArrayCount < 0)
+	{
+		WriteString(theEnv,STDERR,"to-json-array-append: no array is open on this connection\n");
+		return;
+	}
+
+	InitializeJsonWriter(theEnv,&writer,sptr);
+	if (sptr->jsonArrayCount > 0)
+	{ SBAddChar(writer.theSB,','); }
+	JsonWriteUDFValue(&writer,&theArg);
+	FinishJsonWriter(&writer);
+
+	sptr->jsonArrayCount++;
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*******************************************************/
+/* ToJsonArrayEndFunction: H/L access function for     */
+/*   to-json-array-end. Closes the array open on the   */
+/*   connection and returns how many elements it had.  */
+/*   (to-json-array-end ?socket)                       */
+/*******************************************************/
+void ToJsonArrayEndFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *sptr;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetJsonArrayConnection(theEnv,context,"to-json-array-end")) == NULL)
+	{ return; }
+
+	if (sptr->jsonArrayCount < 0)
+	{
+		WriteString(theEnv,STDERR,"to-json-array-end: no array is open on this connection\n");
+		return;
+	}
+
+	WriteSocketBytes(theEnv,sptr,"]",1);
+	returnValue->integerValue = CreateInteger(theEnv,sptr->jsonArrayCount);
+	sptr->jsonArrayCount = -1;
+}
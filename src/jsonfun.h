@@ -0,0 +1,82 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*                JSON FUNCTIONS HEADER                */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: Native JSON decoding that maps objects directly  */
+/*   onto deftemplate facts, and encoding of facts,          */
+/*   instances and multifields.                              */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_jsonfun
+
+#pragma once
+
+#define _H_jsonfun
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define JSON_KEY_TABLE_SIZE 64
+#define JSON_MAX_NUMBER_LENGTH 64
+#define JSON_MAX_DEPTH 32
+
+struct socketRouter;
+
+struct jsonKey
+  {
+   char *name;
+   size_t length;
+   unsigned long hashValue;
+   unsigned short whichSlot;
+   bool mapped;
+   bool multislot;
+   struct jsonKey *next;
+  };
+
+struct jsonParser
+  {
+   Environment *theEnv;
+   const char *functionName;
+   const char *start;
+   const char *current;
+   const char *end;
+   Deftemplate *theDeftemplate;
+   FactBuilder *theFB;
+   struct jsonKey *keyTable[JSON_KEY_TABLE_SIZE];
+   char *scratch;
+   size_t scratchLength;
+   size_t scratchSize;
+   bool incomplete;
+   bool error;
+  };
+
+struct jsonWriter
+  {
+   Environment *theEnv;
+   StringBuilder *theSB;
+   struct socketRouter *router;
+  };
+
+   void                           JsonFunctionDefinitions(Environment *);
+   void                           JsonAssertFunction(Environment *,UDFContext *,UDFValue *);
+   void                           JsonAssertFileFunction(Environment *,UDFContext *,UDFValue *);
+   void                           JsonAssertConnectionFunction(Environment *,UDFContext *,UDFValue *);
+   void                           ToJsonFunction(Environment *,UDFContext *,UDFValue *);
+   void                           ToJsonArrayStartFunction(Environment *,UDFContext *,UDFValue *);
+   void                           ToJsonArrayAppendFunction(Environment *,UDFContext *,UDFValue *);
+   void                           ToJsonArrayEndFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_jsonfun */
@@ -31,6 +31,10 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added range index node to alphaMatch.          */
+/*                                                           */
+/*            Added aggregate group marker to partialMatch.  */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_match
@@ -80,6 +84,7 @@ struct partialMatch
    unsigned int rhsMemory   :  1;
    unsigned int deleting    :  1;
    unsigned int goalMarker  :  1;
+   unsigned int aggregateMarker : 1;
    unsigned short bcount;
    unsigned long hashValue;
    void *owner;
@@ -109,6 +114,7 @@ struct alphaMatch
    MultifieldMarker *markers;
    AlphaMatch *next;
    unsigned long bucket;
+   struct rangeIndexNode *rangeNode;
   };
 
 /******************************************************/
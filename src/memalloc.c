@@ -51,6 +51,9 @@
 /*                                                           */
 /*      6.41: Fixed MEM_TABLE_SIZE=0 release-mem crash.      */
 /*                                                           */
+/*      ?.??: Added arenas for memory that is released all   */
+/*            at once, such as per-connection data.          */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -479,3 +482,108 @@ void genmemcpy(
    for (i = 0L ; i < size ; i++)
      dst[i] = src[i];
   }
+
+/*******************************************************/
+/* CreateArena: Creates an arena from which memory is  */
+/*   handed out sequentially and released all at once  */
+/*   by ReleaseArena. The arena header lives at the    */
+/*   start of its first block, so an arena that never  */
+/*   outgrows blockSize costs a single allocation.     */
+/*******************************************************/
+struct memoryArena *CreateArena(
+  Environment *theEnv,
+  size_t blockSize)
+  {
+   struct arenaBlock *theBlock;
+   struct memoryArena *theArena;
+   size_t headerSize;
+
+   headerSize = (sizeof(struct arenaBlock) + sizeof(struct memoryArena) + ARENA_ALIGN_SIZE - 1) &
+                ~((size_t) ARENA_ALIGN_SIZE - 1);
+
+   theBlock = (struct arenaBlock *) genalloc(theEnv,headerSize + blockSize);
+   theBlock->next = NULL;
+   theBlock->size = headerSize + blockSize;
+   theBlock->used = headerSize;
+
+   theArena = (struct memoryArena *) (theBlock + 1);
+   theArena->blocks = theBlock;
+   theArena->blockSize = blockSize;
+   theArena->size = 0;
+   theArena->reserved = theBlock->size;
+
+   MemoryData(theEnv)->ArenaCount++;
+   MemoryData(theEnv)->ArenaMemoryAmount += (long long) theBlock->size;
+
+   return theArena;
+  }
+
+/*****************************************************/
+/* ArenaAllocate: Allocates memory from an arena.    */
+/*   The memory is not initialized and can only be   */
+/*   returned by releasing the whole arena.          */
+/*****************************************************/
+void *ArenaAllocate(
+  Environment *theEnv,
+  struct memoryArena *theArena,
+  size_t size)
+  {
+   struct arenaBlock *theBlock;
+   size_t blockSize;
+   void *memPtr;
+
+   size = (size + ARENA_ALIGN_SIZE - 1) & ~((size_t) ARENA_ALIGN_SIZE - 1);
+
+   theBlock = theArena->blocks;
+   if ((theBlock->size - theBlock->used) < size)
+     {
+      blockSize = (sizeof(struct arenaBlock) + ARENA_ALIGN_SIZE - 1) & ~((size_t) ARENA_ALIGN_SIZE - 1);
+      if (size > theArena->blockSize)
+        { blockSize += size; }
+      else
+        { blockSize += theArena->blockSize; }
+
+      theBlock = (struct arenaBlock *) genalloc(theEnv,blockSize);
+      theBlock->size = blockSize;
+      theBlock->used = blockSize - (size > theArena->blockSize ? size : theArena->blockSize);
+      theBlock->next = theArena->blocks;
+      theArena->blocks = theBlock;
+      theArena->reserved += blockSize;
+      MemoryData(theEnv)->ArenaMemoryAmount += (long long) blockSize;
+     }
+
+   memPtr = ((char *) theBlock) + theBlock->used;
+   theBlock->used += size;
+   theArena->size += size;
+
+   if (theArena->size > MemoryData(theEnv)->ArenaPeakSize)
+     { MemoryData(theEnv)->ArenaPeakSize = theArena->size; }
+
+   return memPtr;
+  }
+
+/*****************************************************/
+/* ReleaseArena: Returns every block of an arena,    */
+/*   including the arena itself, in one pass.        */
+/*****************************************************/
+void ReleaseArena(
+  Environment *theEnv,
+  struct memoryArena *theArena)
+  {
+   struct arenaBlock *theBlock, *nextBlock;
+
+   MemoryData(theEnv)->ArenaCount--;
+   MemoryData(theEnv)->ArenaMemoryAmount -= (long long) theArena->reserved;
+
+   /*=============================================*/
+   /* The arena header lives in the oldest block, */
+   /* which is last in the list, so it is still   */
+   /* valid until the final genfree.              */
+   /*=============================================*/
+
+   for (theBlock = theArena->blocks; theBlock != NULL; theBlock = nextBlock)
+     {
+      nextBlock = theBlock->next;
+      genfree(theEnv,theBlock,theBlock->size);
+     }
+  }
@@ -155,6 +155,23 @@ struct memoryPtr
 
 #define MEMORY_DATA 59
 
+#define ARENA_ALIGN_SIZE 16
+
+struct arenaBlock
+  {
+   struct arenaBlock *next;
+   size_t size;
+   size_t used;
+  };
+
+struct memoryArena
+  {
+   struct arenaBlock *blocks;
+   size_t blockSize;
+   size_t size;
+   size_t reserved;
+  };
+
 struct memoryData
   {
    long long MemoryAmount;
@@ -164,6 +181,9 @@ struct memoryData
    struct memoryPtr *TempMemoryPtr;
    struct memoryPtr **MemoryTable;
    size_t TempSize;
+   long long ArenaCount;
+   long long ArenaMemoryAmount;
+   size_t ArenaPeakSize;
   };
 
 #define MemoryData(theEnv) ((struct memoryData *) GetEnvironmentData(theEnv,MEMORY_DATA))
@@ -187,6 +207,9 @@ struct memoryData
    bool                           SetConserveMemory(Environment *,bool);
    bool                           GetConserveMemory(Environment *);
    void                           genmemcpy(char *,char *,unsigned long);
+   struct memoryArena            *CreateArena(Environment *,size_t);
+   void                          *ArenaAllocate(Environment *,struct memoryArena *,size_t);
+   void                           ReleaseArena(Environment *,struct memoryArena *);
 
 #endif /* _H_memalloc */
 
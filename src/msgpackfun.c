@@ -0,0 +1,1332 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*              MSGPACK FUNCTIONS MODULE               */
+/*******************************************************/
+
+/***********************************************************************/
+/* Purpose: Exchanges facts between CLIPS processes as MessagePack.    */
+/*   Facts, instances and values are encoded straight into a           */
+/*   connection's output buffer, and messages read from a connection's */
+/*   pending buffer are asserted as facts without going through the    */
+/*   scanner.                                                          */
+/*                                                                     */
+/* Principal Programmer(s):                                            */
+/*      Ryan P. Johnston                                               */
+/*                                                                     */
+/* Revision History:                                                   */
+/*                                                                     */
+/*      ?.??: Added this file.                                         */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clips.h"
+#include "tmpltutl.h"
+
+#include "msgpackfun.h"
+#include "socketrtr.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+	static void                    MsgpackWriteBytes(struct msgpackWriter *,const void *,size_t);
+	static void                    MsgpackWriteTyped(struct msgpackWriter *,unsigned char,uint64_t,int);
+	static void                    MsgpackWriteInteger(struct msgpackWriter *,long long);
+	static void                    MsgpackWriteFloat(struct msgpackWriter *,double);
+	static void                    MsgpackWriteString(struct msgpackWriter *,const char *);
+	static void                    MsgpackWriteExt(struct msgpackWriter *,int,const char *);
+	static void                    MsgpackWriteArrayHeader(struct msgpackWriter *,size_t);
+	static void                    MsgpackWriteMapHeader(struct msgpackWriter *,size_t);
+	static void                    MsgpackWriteValue(struct msgpackWriter *,CLIPSValue *,bool,int);
+	static void                    MsgpackWriteFact(struct msgpackWriter *,Fact *,int);
+	static void                    MsgpackWriteInstance(struct msgpackWriter *,Instance *,int);
+	static void                    MsgpackFlushWriter(struct msgpackWriter *);
+	static enum msgpackParseResult ReadMsgpackItem(struct msgpackParser *,struct msgpackItem *);
+	static enum msgpackParseResult SkipMsgpackValue(struct msgpackParser *,int);
+	static bool                    ItemToCLIPSValue(struct msgpackParser *,struct msgpackItem *,bool,CLIPSValue *);
+	static bool                    AppendMsgpackValue(struct msgpackParser *,MultifieldBuilder *,int);
+	static bool                    ParseMsgpackSlotValue(struct msgpackParser *,bool,CLIPSValue *);
+	static bool                    AssertMsgpackMap(struct msgpackParser *,Deftemplate *,FactBuilder *,size_t);
+	static bool                    AssertMsgpackMessage(struct msgpackParser *,long long *,int);
+	static struct msgpackTemplate *GetMsgpackTemplate(struct msgpackParser *,Deftemplate *);
+	static struct msgpackTemplate *FindMsgpackTemplate(struct msgpackParser *,CLIPSLexeme *);
+	static const char             *MsgpackScratchCopy(struct msgpackParser *,const char *,size_t);
+	static void                    MsgpackError(struct msgpackParser *,const char *);
+
+/*********************************************************/
+/* MsgpackFunctionDefinitions: Registers the MessagePack */
+/*   functions.                                          */
+/*********************************************************/
+void MsgpackFunctionDefinitions(
+		Environment *theEnv)
+{
+	AddUDF(theEnv,"msgpack-encode","b",1,UNBOUNDED,"*;lsy",MsgpackEncodeFunction,"MsgpackEncodeFunction",NULL);
+	AddUDF(theEnv,"msgpack-decode","bl",1,2,";lsy;sy",MsgpackDecodeFunction,"MsgpackDecodeFunction",NULL);
+}
+
+/*********************************************************/
+/* MsgpackFlushWriter: Moves the writer's buffer to its  */
+/*   stream. The stream is not flushed; that is left to  */
+/*   flush-connection like the other socket writers.     */
+/*********************************************************/
+static void MsgpackFlushWriter(
+		struct msgpackWriter *writer)
+{
+	if (writer->length > 0)
+	{
+		fwrite(writer->buffer,1,writer->length,writer->stream);
+		writer->length = 0;
+	}
+}
+
+/**********************************************/
+/* MsgpackWriteBytes: Appends raw bytes to a  */
+/*   writer, passing long runs straight on.   */
+/**********************************************/
+static void MsgpackWriteBytes(
+		struct msgpackWriter *writer,
+		const void *bytes,
+		size_t length)
+{
+	if ((writer->length + length) > MSGPACK_WRITE_BUFFER_SIZE)
+	{
+		MsgpackFlushWriter(writer);
+		if (length > MSGPACK_WRITE_BUFFER_SIZE)
+		{
+			fwrite(bytes,1,length,writer->stream);
+			return;
+		}
+	}
+
+	memcpy(writer->buffer + writer->length,bytes,length);
+	writer->length += length;
+}
+
+/*************************************************************/
+/* MsgpackWriteTyped: Writes a type byte followed by a big   */
+/*   endian value of 0, 1, 2, 4 or 8 bytes.                  */
+/*************************************************************/
+static void MsgpackWriteTyped(
+		struct msgpackWriter *writer,
+		unsigned char type,
+		uint64_t value,
+		int size)
+{
+	unsigned char bytes[9];
+	int i;
+
+	bytes[0] = type;
+	for (i = 0; i < size; i++)
+	{ bytes[size - i] = (unsigned char) (value >> (8 * i)); }
+
+	MsgpackWriteBytes(writer,bytes,(size_t) size + 1);
+}
+
+/*******************************************************/
+/* MsgpackWriteInteger: Writes an integer in the       */
+/*   smallest format that holds it.                    */
+/*******************************************************/
+static void MsgpackWriteInteger(
+		struct msgpackWriter *writer,
+		long long value)
+{
+	if (value >= 0)
+	{
+		if (value < 128)
+		{ MsgpackWriteTyped(writer,(unsigned char) value,0,0); }
+		else if (value <= UINT8_MAX)
+		{ MsgpackWriteTyped(writer,0xcc,(uint64_t) value,1); }
+		else if (value <= UINT16_MAX)
+		{ MsgpackWriteTyped(writer,0xcd,(uint64_t) value,2); }
+		else if (value <= UINT32_MAX)
+		{ MsgpackWriteTyped(writer,0xce,(uint64_t) value,4); }
+		else
+		{ MsgpackWriteTyped(writer,0xcf,(uint64_t) value,8); }
+	}
+	else if (value >= -32)
+	{ MsgpackWriteTyped(writer,(unsigned char) (int8_t) value,0,0); }
+	else if (value >= INT8_MIN)
+	{ MsgpackWriteTyped(writer,0xd0,(uint64_t) value,1); }
+	else if (value >= INT16_MIN)
+	{ MsgpackWriteTyped(writer,0xd1,(uint64_t) value,2); }
+	else if (value >= INT32_MIN)
+	{ MsgpackWriteTyped(writer,0xd2,(uint64_t) value,4); }
+	else
+	{ MsgpackWriteTyped(writer,0xd3,(uint64_t) value,8); }
+}
+
+/*********************************************/
+/* MsgpackWriteFloat: Writes a float64.      */
+/*********************************************/
+static void MsgpackWriteFloat(
+		struct msgpackWriter *writer,
+		double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits,&value,sizeof(bits));
+	MsgpackWriteTyped(writer,0xcb,bits,8);
+}
+
+/*********************************************/
+/* MsgpackWriteString: Writes a str value.   */
+/*********************************************/
+static void MsgpackWriteString(
+		struct msgpackWriter *writer,
+		const char *text)
+{
+	size_t length = strlen(text);
+
+	if (length < 32)
+	{ MsgpackWriteTyped(writer,(unsigned char) (0xa0 | length),0,0); }
+	else if (length <= UINT8_MAX)
+	{ MsgpackWriteTyped(writer,0xd9,length,1); }
+	else if (length <= UINT16_MAX)
+	{ MsgpackWriteTyped(writer,0xda,length,2); }
+	else
+	{ MsgpackWriteTyped(writer,0xdb,length,4); }
+
+	MsgpackWriteBytes(writer,text,length);
+}
+
+/*************************************************************/
+/* MsgpackWriteExt: Writes the text of a symbol or instance  */
+/*   name as an ext value of the given type, so it reads     */
+/*   back as the same kind of value rather than a string.    */
+/*************************************************************/
+static void MsgpackWriteExt(
+		struct msgpackWriter *writer,
+		int extType,
+		const char *text)
+{
+	size_t length = strlen(text);
+	unsigned char type;
+
+	switch (length)
+	{
+		case 1: type = 0xd4; break;
+		case 2: type = 0xd5; break;
+		case 4: type = 0xd6; break;
+		case 8: type = 0xd7; break;
+		case 16: type = 0xd8; break;
+		default: type = 0; break;
+	}
+
+	if (type != 0)
+	{ MsgpackWriteTyped(writer,type,0,0); }
+	else if (length <= UINT8_MAX)
+	{ MsgpackWriteTyped(writer,0xc7,length,1); }
+	else if (length <= UINT16_MAX)
+	{ MsgpackWriteTyped(writer,0xc8,length,2); }
+	else
+	{ MsgpackWriteTyped(writer,0xc9,length,4); }
+
+	type = (unsigned char) extType;
+	MsgpackWriteBytes(writer,&type,1);
+	MsgpackWriteBytes(writer,text,length);
+}
+
+/***********************************************/
+/* MsgpackWriteArrayHeader: Starts an array.   */
+/***********************************************/
+static void MsgpackWriteArrayHeader(
+		struct msgpackWriter *writer,
+		size_t count)
+{
+	if (count < 16)
+	{ MsgpackWriteTyped(writer,(unsigned char) (0x90 | count),0,0); }
+	else if (count <= UINT16_MAX)
+	{ MsgpackWriteTyped(writer,0xdc,count,2); }
+	else
+	{ MsgpackWriteTyped(writer,0xdd,count,4); }
+}
+
+/*******************************************/
+/* MsgpackWriteMapHeader: Starts a map.    */
+/*******************************************/
+static void MsgpackWriteMapHeader(
+		struct msgpackWriter *writer,
+		size_t count)
+{
+	if (count < 16)
+	{ MsgpackWriteTyped(writer,(unsigned char) (0x80 | count),0,0); }
+	else if (count <= UINT16_MAX)
+	{ MsgpackWriteTyped(writer,0xde,count,2); }
+	else
+	{ MsgpackWriteTyped(writer,0xdf,count,4); }
+}
+
+/************************************************************/
+/* MsgpackWriteFact: Writes a fact as a message. A          */
+/*   deftemplate fact becomes [name, {slot: value ...}] and */
+/*   an ordered fact the array of its relation name and     */
+/*   fields, the same shape assert-string would be given.   */
+/************************************************************/
+static void MsgpackWriteFact(
+		struct msgpackWriter *writer,
+		Fact *theFact,
+		int depth)
+{
+	struct templateSlot *theSlot;
+	CLIPSValue *contents = theFact->theProposition.contents;
+	Multifield *theMultifield;
+	size_t i;
+
+	if (theFact->garbage)
+	{
+		MsgpackWriteTyped(writer,0xc0,0,0);
+		return;
+	}
+
+	if (theFact->whichDeftemplate->implied)
+	{
+		theMultifield = contents[0].multifieldValue;
+		MsgpackWriteArrayHeader(writer,theMultifield->length + 1);
+		MsgpackWriteExt(writer,MSGPACK_EXT_SYMBOL,theFact->whichDeftemplate->header.name->contents);
+		for (i = 0; i < theMultifield->length; i++)
+		{ MsgpackWriteValue(writer,&theMultifield->contents[i],false,depth + 1); }
+		return;
+	}
+
+	MsgpackWriteArrayHeader(writer,2);
+	MsgpackWriteExt(writer,MSGPACK_EXT_SYMBOL,theFact->whichDeftemplate->header.name->contents);
+	MsgpackWriteMapHeader(writer,theFact->whichDeftemplate->numberOfSlots);
+
+	for (theSlot = theFact->whichDeftemplate->slotList, i = 0;
+	     theSlot != NULL;
+	     theSlot = theSlot->next, i++)
+	{
+		MsgpackWriteString(writer,theSlot->slotName->contents);
+		MsgpackWriteValue(writer,&contents[i],false,depth + 1);
+	}
+}
+
+/**********************************************************/
+/* MsgpackWriteInstance: Writes an instance as a message, */
+/*   [class, {slot: value ...}], which the receiver       */
+/*   asserts as a fact of the deftemplate with the same   */
+/*   name as the class.                                   */
+/**********************************************************/
+static void MsgpackWriteInstance(
+		struct msgpackWriter *writer,
+		Instance *theInstance,
+		int depth)
+{
+	InstanceSlot *theSlot;
+	CLIPSValue theValue;
+	unsigned short i;
+
+	if (theInstance->garbage)
+	{
+		MsgpackWriteTyped(writer,0xc0,0,0);
+		return;
+	}
+
+	MsgpackWriteArrayHeader(writer,2);
+	MsgpackWriteExt(writer,MSGPACK_EXT_SYMBOL,theInstance->cls->header.name->contents);
+	MsgpackWriteMapHeader(writer,theInstance->cls->instanceSlotCount);
+
+	for (i = 0; i < theInstance->cls->instanceSlotCount; i++)
+	{
+		theSlot = theInstance->slotAddresses[i];
+		MsgpackWriteString(writer,theSlot->desc->slotName->name->contents);
+		theValue.value = theSlot->value;
+		MsgpackWriteValue(writer,&theValue,false,depth + 1);
+	}
+}
+
+/****************************************************************/
+/* MsgpackWriteValue: Writes any CLIPS value. TRUE, FALSE and   */
+/*   nil become booleans and nil, symbols and instance names    */
+/*   become ext values and multifields become arrays. Facts and */
+/*   instances are written as whole messages when they are a    */
+/*   message or an element of one (message is true); inside a   */
+/*   slot an instance is written as its name and a fact as nil. */
+/****************************************************************/
+static void MsgpackWriteValue(
+		struct msgpackWriter *writer,
+		CLIPSValue *theValue,
+		bool message,
+		int depth)
+{
+	Environment *theEnv = writer->theEnv;
+	Multifield *theMultifield;
+	size_t i;
+
+	if (depth > MSGPACK_MAX_DEPTH)
+	{
+		MsgpackWriteTyped(writer,0xc0,0,0);
+		return;
+	}
+
+	switch (theValue->header->type)
+	{
+		case SYMBOL_TYPE:
+			if (theValue->lexemeValue == TrueSymbol(theEnv))
+			{ MsgpackWriteTyped(writer,0xc3,0,0); }
+			else if (theValue->lexemeValue == FalseSymbol(theEnv))
+			{ MsgpackWriteTyped(writer,0xc2,0,0); }
+			else if (strcmp(theValue->lexemeValue->contents,"nil") == 0)
+			{ MsgpackWriteTyped(writer,0xc0,0,0); }
+			else
+			{ MsgpackWriteExt(writer,MSGPACK_EXT_SYMBOL,theValue->lexemeValue->contents); }
+			break;
+
+		case STRING_TYPE:
+			MsgpackWriteString(writer,theValue->lexemeValue->contents);
+			break;
+
+		case INSTANCE_NAME_TYPE:
+			MsgpackWriteExt(writer,MSGPACK_EXT_INSTANCE_NAME,theValue->lexemeValue->contents);
+			break;
+
+		case INTEGER_TYPE:
+			MsgpackWriteInteger(writer,theValue->integerValue->contents);
+			break;
+
+		case FLOAT_TYPE:
+			MsgpackWriteFloat(writer,theValue->floatValue->contents);
+			break;
+
+		case MULTIFIELD_TYPE:
+			theMultifield = theValue->multifieldValue;
+			MsgpackWriteArrayHeader(writer,theMultifield->length);
+			for (i = 0; i < theMultifield->length; i++)
+			{ MsgpackWriteValue(writer,&theMultifield->contents[i],message,depth + 1); }
+			break;
+
+		case FACT_ADDRESS_TYPE:
+			if (message)
+			{ MsgpackWriteFact(writer,theValue->factValue,depth); }
+			else
+			{ MsgpackWriteTyped(writer,0xc0,0,0); }
+			break;
+
+		case INSTANCE_ADDRESS_TYPE:
+			if (message)
+			{ MsgpackWriteInstance(writer,theValue->instanceValue,depth); }
+			else if (theValue->instanceValue->garbage)
+			{ MsgpackWriteTyped(writer,0xc0,0,0); }
+			else
+			{ MsgpackWriteExt(writer,MSGPACK_EXT_INSTANCE_NAME,theValue->instanceValue->name->contents); }
+			break;
+
+		default:
+			MsgpackWriteTyped(writer,0xc0,0,0);
+			break;
+	}
+}
+
+/*************************************************************/
+/* MsgpackEncodeFunction: H/L access function for            */
+/*   msgpack-encode. Writes each remaining argument to the   */
+/*   connection's output buffer as one message. A multifield */
+/*   argument is one array message; facts and instances in  */
+/*   it are written in full, so a batch of facts can be sent */
+/*   as a single message.                                    */
+/*   (msgpack-encode ?socket ?value ...)                     */
+/*************************************************************/
+void MsgpackEncodeFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	struct msgpackWriter *writer;
+	CLIPSValue theValue;
+	size_t i;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"msgpack-encode: could not find connection\n");
+		return;
+	}
+
+	writer = (struct msgpackWriter *) gm2(theEnv,sizeof(struct msgpackWriter));
+	writer->theEnv = theEnv;
+	writer->stream = sptr->stream;
+	writer->length = 0;
+
+	while (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,ANY_TYPE_BITS,&theArg);
+
+		if (theArg.header->type == MULTIFIELD_TYPE)
+		{
+			MsgpackWriteArrayHeader(writer,theArg.range);
+			for (i = theArg.begin; i < (theArg.begin + theArg.range); i++)
+			{ MsgpackWriteValue(writer,&theArg.multifieldValue->contents[i],true,1); }
+		}
+		else
+		{
+			theValue.value = theArg.value;
+			MsgpackWriteValue(writer,&theValue,true,0);
+		}
+	}
+
+	MsgpackFlushWriter(writer);
+	rm(theEnv,writer,sizeof(struct msgpackWriter));
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*******************************************************/
+/* MsgpackError: Reports where decoding failed.        */
+/*******************************************************/
+static void MsgpackError(
+		struct msgpackParser *parser,
+		const char *message)
+{
+	Environment *theEnv = parser->theEnv;
+
+	WriteString(theEnv,STDERR,"msgpack-decode: ");
+	WriteString(theEnv,STDERR,message);
+	WriteString(theEnv,STDERR," at byte ");
+	WriteInteger(theEnv,STDERR,(long long) (parser->current - parser->start));
+	WriteString(theEnv,STDERR,"\n");
+}
+
+/*****************************************************/
+/* MsgpackScratchCopy: Copies bytes into the         */
+/*   parser's scratch buffer so they can be null     */
+/*   terminated.                                     */
+/*****************************************************/
+static const char *MsgpackScratchCopy(
+		struct msgpackParser *parser,
+		const char *bytes,
+		size_t length)
+{
+	size_t newSize;
+
+	if ((length + 1) > parser->scratchSize)
+	{
+		newSize = parser->scratchSize * 2;
+		while ((length + 1) > newSize)
+		{ newSize *= 2; }
+
+		rm(parser->theEnv,parser->scratch,parser->scratchSize);
+		parser->scratch = (char *) gm2(parser->theEnv,newSize);
+		parser->scratchSize = newSize;
+	}
+
+	memcpy(parser->scratch,bytes,length);
+	parser->scratch[length] = '\0';
+
+	return parser->scratch;
+}
+
+/****************************************************/
+/* ReadMsgpackBigEndian: Reads an unsigned integer  */
+/*   of size bytes.                                 */
+/****************************************************/
+static uint64_t ReadMsgpackBigEndian(
+		const char *bytes,
+		int size)
+{
+	uint64_t value = 0;
+	int i;
+
+	for (i = 0; i < size; i++)
+	{ value = (value << 8) | (unsigned char) bytes[i]; }
+
+	return value;
+}
+
+/*************************************************************/
+/* ReadMsgpackItem: Reads the header of the next value. For  */
+/*   strings, binaries and ext values the payload is stepped */
+/*   over as well and pointed to by data; for arrays and     */
+/*   maps length is the number of elements or pairs that     */
+/*   follow.                                                 */
+/*************************************************************/
+static enum msgpackParseResult ReadMsgpackItem(
+		struct msgpackParser *parser,
+		struct msgpackItem *item)
+{
+	const char *p = parser->current;
+	unsigned char type;
+	int size = 0, lengthSize = 0;
+	uint64_t value;
+	float floatValue;
+	uint32_t floatBits;
+
+	if (p >= parser->end)
+	{ return MSGPACK_PARSE_INCOMPLETE; }
+
+	type = (unsigned char) *p++;
+	item->extType = 0;
+	item->data = NULL;
+	item->length = 0;
+
+	if (type <= 0x7f)
+	{
+		item->type = MSGPACK_INTEGER;
+		item->integer = type;
+		parser->current = p;
+		return MSGPACK_PARSE_OK;
+	}
+
+	if (type >= 0xe0)
+	{
+		item->type = MSGPACK_INTEGER;
+		item->integer = (signed char) type;
+		parser->current = p;
+		return MSGPACK_PARSE_OK;
+	}
+
+	if ((type & 0xf0) == 0x80)
+	{
+		item->type = MSGPACK_MAP;
+		item->length = type & 0x0f;
+		parser->current = p;
+		return MSGPACK_PARSE_OK;
+	}
+
+	if ((type & 0xf0) == 0x90)
+	{
+		item->type = MSGPACK_ARRAY;
+		item->length = type & 0x0f;
+		parser->current = p;
+		return MSGPACK_PARSE_OK;
+	}
+
+	if ((type & 0xe0) == 0xa0)
+	{
+		item->type = MSGPACK_STRING;
+		item->length = type & 0x1f;
+	}
+	else switch (type)
+	{
+		case 0xc0: item->type = MSGPACK_NIL; break;
+		case 0xc2: item->type = MSGPACK_BOOLEAN; item->integer = 0; break;
+		case 0xc3: item->type = MSGPACK_BOOLEAN; item->integer = 1; break;
+		case 0xc4: item->type = MSGPACK_BINARY; lengthSize = 1; break;
+		case 0xc5: item->type = MSGPACK_BINARY; lengthSize = 2; break;
+		case 0xc6: item->type = MSGPACK_BINARY; lengthSize = 4; break;
+		case 0xc7: item->type = MSGPACK_EXT; lengthSize = 1; break;
+		case 0xc8: item->type = MSGPACK_EXT; lengthSize = 2; break;
+		case 0xc9: item->type = MSGPACK_EXT; lengthSize = 4; break;
+		case 0xca: item->type = MSGPACK_FLOAT; size = 4; break;
+		case 0xcb: item->type = MSGPACK_FLOAT; size = 8; break;
+		case 0xcc: item->type = MSGPACK_INTEGER; size = 1; break;
+		case 0xcd: item->type = MSGPACK_INTEGER; size = 2; break;
+		case 0xce: item->type = MSGPACK_INTEGER; size = 4; break;
+		case 0xcf: item->type = MSGPACK_INTEGER; size = 8; break;
+		case 0xd0: item->type = MSGPACK_INTEGER; size = -1; break;
+		case 0xd1: item->type = MSGPACK_INTEGER; size = -2; break;
+		case 0xd2: item->type = MSGPACK_INTEGER; size = -4; break;
+		case 0xd3: item->type = MSGPACK_INTEGER; size = -8; break;
+		case 0xd4: item->type = MSGPACK_EXT; item->length = 1; break;
+		case 0xd5: item->type = MSGPACK_EXT; item->length = 2; break;
+		case 0xd6: item->type = MSGPACK_EXT; item->length = 4; break;
+		case 0xd7: item->type = MSGPACK_EXT; item->length = 8; break;
+		case 0xd8: item->type = MSGPACK_EXT; item->length = 16; break;
+		case 0xd9: item->type = MSGPACK_STRING; lengthSize = 1; break;
+		case 0xda: item->type = MSGPACK_STRING; lengthSize = 2; break;
+		case 0xdb: item->type = MSGPACK_STRING; lengthSize = 4; break;
+		case 0xdc: item->type = MSGPACK_ARRAY; lengthSize = 2; break;
+		case 0xdd: item->type = MSGPACK_ARRAY; lengthSize = 4; break;
+		case 0xde: item->type = MSGPACK_MAP; lengthSize = 2; break;
+		case 0xdf: item->type = MSGPACK_MAP; lengthSize = 4; break;
+		default:
+			MsgpackError(parser,"invalid type byte");
+			return MSGPACK_PARSE_ERROR;
+	}
+
+	/*=====================================*/
+	/* Fixed size numbers. A negative size */
+	/* marks a signed integer.             */
+	/*=====================================*/
+	if (size != 0)
+	{
+		int width = (size < 0) ? -size : size;
+
+		if ((parser->end - p) < width)
+		{ return MSGPACK_PARSE_INCOMPLETE; }
+
+		value = ReadMsgpackBigEndian(p,width);
+		p += width;
+
+		if (item->type == MSGPACK_FLOAT)
+		{
+			if (width == 4)
+			{
+				floatBits = (uint32_t) value;
+				memcpy(&floatValue,&floatBits,sizeof(floatValue));
+				item->floating = floatValue;
+			}
+			else
+			{ memcpy(&item->floating,&value,sizeof(item->floating)); }
+		}
+		else if (size < 0)
+		{
+			switch (width)
+			{
+				case 1: item->integer = (int8_t) value; break;
+				case 2: item->integer = (int16_t) value; break;
+				case 4: item->integer = (int32_t) value; break;
+				default: item->integer = (int64_t) value; break;
+			}
+		}
+		else
+		{
+			if (value > INT64_MAX)
+			{
+				MsgpackError(parser,"unsigned integer too large");
+				return MSGPACK_PARSE_ERROR;
+			}
+			item->integer = (long long) value;
+		}
+
+		parser->current = p;
+		return MSGPACK_PARSE_OK;
+	}
+
+	if (lengthSize != 0)
+	{
+		if ((parser->end - p) < lengthSize)
+		{ return MSGPACK_PARSE_INCOMPLETE; }
+
+		item->length = (size_t) ReadMsgpackBigEndian(p,lengthSize);
+		p += lengthSize;
+	}
+
+	if ((item->type == MSGPACK_ARRAY) || (item->type == MSGPACK_MAP))
+	{
+		if (item->length > MSGPACK_MAX_ELEMENTS)
+		{
+			MsgpackError(parser,"too many elements");
+			return MSGPACK_PARSE_ERROR;
+		}
+		parser->current = p;
+		return MSGPACK_PARSE_OK;
+	}
+
+	if (item->type == MSGPACK_EXT)
+	{
+		if (p >= parser->end)
+		{ return MSGPACK_PARSE_INCOMPLETE; }
+		item->extType = (signed char) *p++;
+	}
+
+	if ((item->type == MSGPACK_STRING) ||
+	    (item->type == MSGPACK_BINARY) ||
+	    (item->type == MSGPACK_EXT))
+	{
+		if (item->length > MSGPACK_MAX_LENGTH)
+		{
+			MsgpackError(parser,"value too long");
+			return MSGPACK_PARSE_ERROR;
+		}
+
+		if ((size_t) (parser->end - p) < item->length)
+		{ return MSGPACK_PARSE_INCOMPLETE; }
+
+		item->data = p;
+		p += item->length;
+	}
+
+	parser->current = p;
+	return MSGPACK_PARSE_OK;
+}
+
+/*************************************************************/
+/* SkipMsgpackValue: Steps over a value, checking that it is */
+/*   complete before anything in it is asserted.             */
+/*************************************************************/
+static enum msgpackParseResult SkipMsgpackValue(
+		struct msgpackParser *parser,
+		int depth)
+{
+	struct msgpackItem item;
+	enum msgpackParseResult rv;
+	size_t i, count;
+
+	if (depth > MSGPACK_MAX_DEPTH)
+	{
+		MsgpackError(parser,"nested too deeply");
+		return MSGPACK_PARSE_ERROR;
+	}
+
+	if ((rv = ReadMsgpackItem(parser,&item)) != MSGPACK_PARSE_OK)
+	{ return rv; }
+
+	if ((item.type != MSGPACK_ARRAY) && (item.type != MSGPACK_MAP))
+	{ return MSGPACK_PARSE_OK; }
+
+	count = (item.type == MSGPACK_MAP) ? item.length * 2 : item.length;
+
+	for (i = 0; i < count; i++)
+	{
+		if ((rv = SkipMsgpackValue(parser,depth + 1)) != MSGPACK_PARSE_OK)
+		{ return rv; }
+	}
+
+	return MSGPACK_PARSE_OK;
+}
+
+/*************************************************************/
+/* ItemToCLIPSValue: Converts a scalar item. Strings and     */
+/*   binaries become strings, or symbols when asSymbol is    */
+/*   true (for relation names sent as plain strings); ext    */
+/*   types 1 and 2 become symbols and instance names.        */
+/*************************************************************/
+static bool ItemToCLIPSValue(
+		struct msgpackParser *parser,
+		struct msgpackItem *item,
+		bool asSymbol,
+		CLIPSValue *theValue)
+{
+	Environment *theEnv = parser->theEnv;
+	const char *text;
+
+	switch (item->type)
+	{
+		case MSGPACK_NIL:
+			theValue->lexemeValue = CreateSymbol(theEnv,"nil");
+			return true;
+
+		case MSGPACK_BOOLEAN:
+			theValue->lexemeValue = CreateBoolean(theEnv,item->integer != 0);
+			return true;
+
+		case MSGPACK_INTEGER:
+			theValue->integerValue = CreateInteger(theEnv,item->integer);
+			return true;
+
+		case MSGPACK_FLOAT:
+			theValue->floatValue = CreateFloat(theEnv,item->floating);
+			return true;
+
+		case MSGPACK_STRING:
+		case MSGPACK_BINARY:
+		case MSGPACK_EXT:
+			if (memchr(item->data,'\0',item->length) != NULL)
+			{
+				MsgpackError(parser,"string contains a null byte");
+				return false;
+			}
+
+			text = MsgpackScratchCopy(parser,item->data,item->length);
+
+			if (item->type != MSGPACK_EXT)
+			{
+				if (asSymbol)
+				{ theValue->lexemeValue = CreateSymbol(theEnv,text); }
+				else
+				{ theValue->lexemeValue = CreateString(theEnv,text); }
+				return true;
+			}
+
+			if (item->extType == MSGPACK_EXT_SYMBOL)
+			{
+				theValue->lexemeValue = CreateSymbol(theEnv,text);
+				return true;
+			}
+
+			if (item->extType == MSGPACK_EXT_INSTANCE_NAME)
+			{
+				theValue->lexemeValue = CreateInstanceName(theEnv,text);
+				return true;
+			}
+
+			MsgpackError(parser,"unsupported ext type");
+			return false;
+
+		default:
+			MsgpackError(parser,"expected a single value");
+			return false;
+	}
+}
+
+/*************************************************************/
+/* AppendMsgpackValue: Appends the next value to a builder.  */
+/*   Multifields cannot nest, so arrays are flattened into   */
+/*   their elements and maps into their keys and values.     */
+/*************************************************************/
+static bool AppendMsgpackValue(
+		struct msgpackParser *parser,
+		MultifieldBuilder *theMB,
+		int depth)
+{
+	struct msgpackItem item;
+	CLIPSValue theValue;
+	size_t i, count;
+
+	if (ReadMsgpackItem(parser,&item) != MSGPACK_PARSE_OK)
+	{ return false; }
+
+	if ((item.type == MSGPACK_ARRAY) || (item.type == MSGPACK_MAP))
+	{
+		count = (item.type == MSGPACK_MAP) ? item.length * 2 : item.length;
+		for (i = 0; i < count; i++)
+		{
+			if (! AppendMsgpackValue(parser,theMB,depth + 1))
+			{ return false; }
+		}
+		return true;
+	}
+
+	if (! ItemToCLIPSValue(parser,&item,false,&theValue))
+	{ return false; }
+
+	MBAppend(theMB,&theValue);
+	return true;
+}
+
+/*************************************************************/
+/* ParseMsgpackSlotValue: Converts the next value for a      */
+/*   slot. An array or map becomes a multifield, and a       */
+/*   single value stored in a multislot is wrapped in a one  */
+/*   field multifield.                                       */
+/*************************************************************/
+static bool ParseMsgpackSlotValue(
+		struct msgpackParser *parser,
+		bool multislot,
+		CLIPSValue *theValue)
+{
+	const char *valueStart = parser->current;
+	struct msgpackItem item;
+	MultifieldBuilder *theMB;
+	bool rv;
+
+	if (ReadMsgpackItem(parser,&item) != MSGPACK_PARSE_OK)
+	{ return false; }
+
+	if ((item.type != MSGPACK_ARRAY) && (item.type != MSGPACK_MAP) && ! multislot)
+	{ return ItemToCLIPSValue(parser,&item,false,theValue); }
+
+	parser->current = valueStart;
+	theMB = CreateMultifieldBuilder(parser->theEnv,8);
+	rv = AppendMsgpackValue(parser,theMB,1);
+	if (rv)
+	{ theValue->multifieldValue = MBCreate(theMB); }
+	MBDispose(theMB);
+
+	return rv;
+}
+
+/***********************************************************/
+/* GetMsgpackTemplate: Returns the cache entry for a       */
+/*   deftemplate, adding it the first time the deftemplate */
+/*   is seen in this call. Deftemplates with slots get a   */
+/*   fact builder that is reused for all of their facts.   */
+/***********************************************************/
+static struct msgpackTemplate *GetMsgpackTemplate(
+		struct msgpackParser *parser,
+		Deftemplate *theDeftemplate)
+{
+	struct msgpackTemplate *theTemplate;
+	unsigned int i;
+
+	for (i = 0; i < parser->templateCount; i++)
+	{
+		if (parser->templates[i].theDeftemplate == theDeftemplate)
+		{ return &parser->templates[i]; }
+	}
+
+	/*===========================================*/
+	/* Once the cache is full the last entry is  */
+	/* reused for any deftemplate not in it.     */
+	/*===========================================*/
+	if (parser->templateCount < MSGPACK_TEMPLATE_CACHE_SIZE)
+	{ theTemplate = &parser->templates[parser->templateCount++]; }
+	else
+	{
+		theTemplate = &parser->templates[MSGPACK_TEMPLATE_CACHE_SIZE - 1];
+		if (theTemplate->theFB != NULL)
+		{ FBDispose(theTemplate->theFB); }
+	}
+
+	theTemplate->theDeftemplate = theDeftemplate;
+	if (theDeftemplate->implied)
+	{ theTemplate->theFB = NULL; }
+	else
+	{ theTemplate->theFB = CreateFactBuilder(parser->theEnv,theDeftemplate->header.name->contents); }
+
+	return theTemplate;
+}
+
+/*************************************************************/
+/* FindMsgpackTemplate: Looks up a deftemplate by name,      */
+/*   trying the deftemplates already seen in this call       */
+/*   before searching the modules. Returns NULL if there is  */
+/*   no such deftemplate.                                    */
+/*************************************************************/
+static struct msgpackTemplate *FindMsgpackTemplate(
+		struct msgpackParser *parser,
+		CLIPSLexeme *name)
+{
+	Deftemplate *theDeftemplate;
+	unsigned int i;
+
+	for (i = 0; i < parser->templateCount; i++)
+	{
+		if (parser->templates[i].theDeftemplate->header.name == name)
+		{ return &parser->templates[i]; }
+	}
+
+	theDeftemplate = FindDeftemplate(parser->theEnv,name->contents);
+	if (theDeftemplate == NULL)
+	{ return NULL; }
+
+	return GetMsgpackTemplate(parser,theDeftemplate);
+}
+
+/*************************************************************/
+/* AssertMsgpackMap: Fills a fact builder from the next      */
+/*   count key/value pairs and asserts it. Keys that name no */
+/*   slot are skipped. Keys normally arrive in slot order,   */
+/*   so the slot after the previous one is tried first.      */
+/*************************************************************/
+static bool AssertMsgpackMap(
+		struct msgpackParser *parser,
+		Deftemplate *theDeftemplate,
+		FactBuilder *theFB,
+		size_t count)
+{
+	struct msgpackItem item;
+	struct templateSlot *theSlot, *nextSlot = theDeftemplate->slotList;
+	unsigned short whichSlot, nextWhich = 0;
+	CLIPSValue theValue;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (ReadMsgpackItem(parser,&item) != MSGPACK_PARSE_OK)
+		{ return false; }
+
+		if ((item.type != MSGPACK_STRING) &&
+		    ! ((item.type == MSGPACK_EXT) && (item.extType == MSGPACK_EXT_SYMBOL)))
+		{
+			MsgpackError(parser,"expected a slot name key");
+			FBAbort(theFB);
+			return false;
+		}
+
+		theSlot = nextSlot;
+		whichSlot = nextWhich;
+		if ((theSlot == NULL) ||
+		    (strncmp(theSlot->slotName->contents,item.data,item.length) != 0) ||
+		    (theSlot->slotName->contents[item.length] != '\0'))
+		{
+			for (theSlot = theDeftemplate->slotList, whichSlot = 0;
+			     theSlot != NULL;
+			     theSlot = theSlot->next, whichSlot++)
+			{
+				if ((strncmp(theSlot->slotName->contents,item.data,item.length) == 0) &&
+				    (theSlot->slotName->contents[item.length] == '\0'))
+				{ break; }
+			}
+		}
+
+		if (theSlot == NULL)
+		{
+			if (SkipMsgpackValue(parser,1) != MSGPACK_PARSE_OK)
+			{
+				FBAbort(theFB);
+				return false;
+			}
+			continue;
+		}
+
+		nextSlot = theSlot->next;
+		nextWhich = whichSlot + 1;
+
+		if (! ParseMsgpackSlotValue(parser,theSlot->multislot,&theValue))
+		{
+			FBAbort(theFB);
+			return false;
+		}
+
+		if (FBPutSlotByPosition(theFB,whichSlot,&theValue) != PSE_NO_ERROR)
+		{
+			WriteString(parser->theEnv,STDERR,"msgpack-decode: value for slot ");
+			WriteString(parser->theEnv,STDERR,theSlot->slotName->contents);
+			WriteString(parser->theEnv,STDERR," violates the constraints of the slot at byte ");
+			WriteInteger(parser->theEnv,STDERR,(long long) (parser->current - parser->start));
+			WriteString(parser->theEnv,STDERR,"\n");
+			FBAbort(theFB);
+			return false;
+		}
+	}
+
+	return (FBAssert(theFB) != NULL);
+}
+
+/*************************************************************/
+/* AssertMsgpackMessage: Asserts the fact, or the batch of   */
+/*   facts, in the next message. The message has already     */
+/*   been checked to be complete.                            */
+/*     [name, {slot: value ...}]  a deftemplate fact         */
+/*     [name, value ...]          an ordered fact            */
+/*     {slot: value ...}          a fact of the default      */
+/*                                deftemplate                */
+/*     [[...], [...] ...]         a batch of the above       */
+/*************************************************************/
+static bool AssertMsgpackMessage(
+		struct msgpackParser *parser,
+		long long *count,
+		int depth)
+{
+	Environment *theEnv = parser->theEnv;
+	struct msgpackItem item, nameItem, mapItem;
+	struct msgpackTemplate *theTemplate;
+	Deftemplate *theDeftemplate;
+	MultifieldBuilder *theMB;
+	CLIPSValue nameValue, theValue;
+	const char *nameStart, *mapStart;
+	Fact *theFact;
+	size_t i;
+
+	if (ReadMsgpackItem(parser,&item) != MSGPACK_PARSE_OK)
+	{ return false; }
+
+	if (item.type == MSGPACK_MAP)
+	{
+		if (parser->defaultDeftemplate == NULL)
+		{
+			MsgpackError(parser,"a map message needs a deftemplate argument");
+			return false;
+		}
+
+		theTemplate = GetMsgpackTemplate(parser,parser->defaultDeftemplate);
+		if (! AssertMsgpackMap(parser,theTemplate->theDeftemplate,theTemplate->theFB,item.length))
+		{ return false; }
+
+		(*count)++;
+		return true;
+	}
+
+	if ((item.type != MSGPACK_ARRAY) || (item.length == 0))
+	{
+		MsgpackError(parser,"expected a fact message");
+		return false;
+	}
+
+	/*=================================*/
+	/* An array of arrays or maps is a */
+	/* batch of messages.              */
+	/*=================================*/
+	nameStart = parser->current;
+	if (ReadMsgpackItem(parser,&nameItem) != MSGPACK_PARSE_OK)
+	{ return false; }
+
+	if ((nameItem.type == MSGPACK_ARRAY) || (nameItem.type == MSGPACK_MAP))
+	{
+		if (depth > 0)
+		{
+			MsgpackError(parser,"batches may not nest");
+			return false;
+		}
+
+		parser->current = nameStart;
+		for (i = 0; i < item.length; i++)
+		{
+			if (! AssertMsgpackMessage(parser,count,depth + 1))
+			{ return false; }
+		}
+		return true;
+	}
+
+	if ((nameItem.type != MSGPACK_STRING) &&
+	    ! ((nameItem.type == MSGPACK_EXT) && (nameItem.extType == MSGPACK_EXT_SYMBOL)))
+	{
+		MsgpackError(parser,"expected a deftemplate or relation name");
+		return false;
+	}
+
+	if (! ItemToCLIPSValue(parser,&nameItem,true,&nameValue))
+	{ return false; }
+
+	theTemplate = FindMsgpackTemplate(parser,nameValue.lexemeValue);
+
+	/*=========================================*/
+	/* [name, {slot: value ...}] is a fact of  */
+	/* a deftemplate with slots.               */
+	/*=========================================*/
+	if (item.length == 2)
+	{
+		mapStart = parser->current;
+		if (ReadMsgpackItem(parser,&mapItem) != MSGPACK_PARSE_OK)
+		{ return false; }
+
+		if (mapItem.type == MSGPACK_MAP)
+		{
+			if ((theTemplate == NULL) || (theTemplate->theFB == NULL))
+			{
+				MsgpackError(parser,"no deftemplate with slots for a map message");
+				return false;
+			}
+
+			if (! AssertMsgpackMap(parser,theTemplate->theDeftemplate,theTemplate->theFB,mapItem.length))
+			{ return false; }
+
+			(*count)++;
+			return true;
+		}
+
+		parser->current = mapStart;
+	}
+
+	/*===================================*/
+	/* Otherwise it is an ordered fact,  */
+	/* creating its implied deftemplate  */
+	/* the first time it is seen.        */
+	/*===================================*/
+	if (theTemplate == NULL)
+	{
+		theDeftemplate = CreateImpliedDeftemplate(theEnv,nameValue.lexemeValue,true);
+		if (theDeftemplate == NULL)
+		{ return false; }
+		theTemplate = GetMsgpackTemplate(parser,theDeftemplate);
+	}
+	else if (theTemplate->theFB != NULL)
+	{
+		MsgpackError(parser,"expected a map of slots for a deftemplate fact");
+		return false;
+	}
+
+	theMB = CreateMultifieldBuilder(theEnv,item.length);
+	for (i = 1; i < item.length; i++)
+	{
+		if (! AppendMsgpackValue(parser,theMB,1))
+		{
+			MBDispose(theMB);
+			return false;
+		}
+	}
+
+	theValue.multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+
+	theFact = CreateFact(theTemplate->theDeftemplate);
+	PutFactSlot(theFact,NULL,&theValue);
+	if (Assert(theFact) == NULL)
+	{ return false; }
+
+	(*count)++;
+	return true;
+}
+
+/*************************************************************/
+/* MsgpackDecodeFunction: H/L access function for            */
+/*   msgpack-decode. Reads what is available on the          */
+/*   connection, waiting if it is blocking and nothing is,   */
+/*   and asserts the facts in each complete message. A       */
+/*   trailing partial message is kept for the next call.     */
+/*   Returns the number of facts asserted, or FALSE on an    */
+/*   error or once the peer has closed and no complete       */
+/*   messages remain.                                        */
+/*   (msgpack-decode ?socket <?deftemplate>)                 */
+/*************************************************************/
+void MsgpackDecodeFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	struct msgpackParser parser;
+	enum msgpackParseResult rv = MSGPACK_PARSE_OK;
+	const char *messageStart;
+	long long count = 0;
+	unsigned int i;
+	GCBlock gcb;
+	bool eof;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"msgpack-decode: could not find connection\n");
+		return;
+	}
+
+	parser.defaultDeftemplate = NULL;
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,LEXEME_BITS,&theArg);
+		parser.defaultDeftemplate = FindDeftemplate(theEnv,theArg.lexemeValue->contents);
+		if ((parser.defaultDeftemplate == NULL) || parser.defaultDeftemplate->implied)
+		{
+			WriteString(theEnv,STDERR,"msgpack-decode: ");
+			WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
+			WriteString(theEnv,STDERR," is not a deftemplate with slots\n");
+			return;
+		}
+	}
+
+	if (! ReadSocketAvailable(theEnv,sptr,&eof))
+	{
+		perror("perror");
+		return;
+	}
+
+	parser.theEnv = theEnv;
+	parser.start = sptr->pending;
+	parser.current = sptr->pending;
+	parser.end = sptr->pending + sptr->pendingLength;
+	parser.templateCount = 0;
+	parser.scratchSize = BUFSIZ;
+	parser.scratch = (char *) gm2(theEnv,parser.scratchSize);
+
+	while (parser.current < parser.end)
+	{
+		messageStart = parser.current;
+
+		rv = SkipMsgpackValue(&parser,0);
+		if (rv != MSGPACK_PARSE_OK)
+		{
+			parser.current = messageStart;
+			break;
+		}
+
+		parser.current = messageStart;
+
+		GCBlockStart(theEnv,&gcb);
+		if (! AssertMsgpackMessage(&parser,&count,0))
+		{ rv = MSGPACK_PARSE_ERROR; }
+		GCBlockEnd(theEnv,&gcb);
+
+		if (rv == MSGPACK_PARSE_ERROR)
+		{ break; }
+	}
+
+	for (i = 0; i < parser.templateCount; i++)
+	{
+		if (parser.templates[i].theFB != NULL)
+		{ FBDispose(parser.templates[i].theFB); }
+	}
+	rm(theEnv,parser.scratch,parser.scratchSize);
+
+	/*============================================*/
+	/* On an error the offending bytes are thrown */
+	/* away so the next call does not see them.   */
+	/*============================================*/
+	if (rv == MSGPACK_PARSE_ERROR)
+	{
+		ConsumeSocketPending(theEnv,sptr,sptr->pendingLength);
+		return;
+	}
+
+	ConsumeSocketPending(theEnv,sptr,(size_t) (parser.current - sptr->pending));
+
+	if ((count > 0) || ! eof)
+	{ returnValue->integerValue = CreateInteger(theEnv,count); }
+}
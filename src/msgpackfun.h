@@ -0,0 +1,101 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*              MSGPACK FUNCTIONS HEADER               */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: MessagePack encoding of facts and values onto    */
+/*   socket connections and decoding of framed messages      */
+/*   back into facts.                                        */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_msgpackfun
+
+#pragma once
+
+#define _H_msgpackfun
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define MSGPACK_EXT_SYMBOL 1
+#define MSGPACK_EXT_INSTANCE_NAME 2
+#define MSGPACK_MAX_LENGTH (512UL * 1024UL * 1024UL)
+#define MSGPACK_MAX_ELEMENTS (1024UL * 1024UL)
+#define MSGPACK_MAX_DEPTH 32
+#define MSGPACK_TEMPLATE_CACHE_SIZE 16
+#define MSGPACK_WRITE_BUFFER_SIZE 4096
+
+enum msgpackParseResult
+  {
+   MSGPACK_PARSE_OK,
+   MSGPACK_PARSE_INCOMPLETE,
+   MSGPACK_PARSE_ERROR
+  };
+
+enum msgpackItemType
+  {
+   MSGPACK_NIL,
+   MSGPACK_BOOLEAN,
+   MSGPACK_INTEGER,
+   MSGPACK_FLOAT,
+   MSGPACK_STRING,
+   MSGPACK_BINARY,
+   MSGPACK_EXT,
+   MSGPACK_ARRAY,
+   MSGPACK_MAP
+  };
+
+struct msgpackItem
+  {
+   enum msgpackItemType type;
+   long long integer;
+   double floating;
+   const char *data;
+   size_t length;
+   int extType;
+  };
+
+struct msgpackTemplate
+  {
+   Deftemplate *theDeftemplate;
+   FactBuilder *theFB;
+  };
+
+struct msgpackParser
+  {
+   Environment *theEnv;
+   const char *start;
+   const char *current;
+   const char *end;
+   Deftemplate *defaultDeftemplate;
+   struct msgpackTemplate templates[MSGPACK_TEMPLATE_CACHE_SIZE];
+   unsigned int templateCount;
+   char *scratch;
+   size_t scratchSize;
+  };
+
+struct msgpackWriter
+  {
+   Environment *theEnv;
+   FILE *stream;
+   size_t length;
+   unsigned char buffer[MSGPACK_WRITE_BUFFER_SIZE];
+  };
+
+   void                           MsgpackFunctionDefinitions(Environment *);
+   void                           MsgpackEncodeFunction(Environment *,UDFContext *,UDFValue *);
+   void                           MsgpackDecodeFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_msgpackfun */
@@ -66,6 +66,9 @@
 /*                                                           */
 /*            Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: HashValueArray hashes every element rather     */
+/*            than repeatedly hashing the first one.         */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -813,7 +816,7 @@ size_t HashValueArray(
    size_t i, count = 0;
    
    for (i = 0; i < length; i++)
-     { count += HashCLIPSValue(&theValue[0],i,theRange); }
+     { count += HashCLIPSValue(&theValue[i],i,theRange); }
      
    return count;
   }
@@ -25,6 +25,16 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added range indexes to alpha memories.         */
+/*                                                           */
+/*            Added aggregate joins for the accumulate       */
+/*            conditional element.                           */
+/*                                                           */
+/*            Added join profiling counters and alpha memory */
+/*            counts.                                        */
+/*                                                           */
+/*            Beta memories count their resizes.             */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_network
@@ -38,6 +48,8 @@ struct betaMemory;
 struct joinLink;
 struct joinNode;
 struct patternNodeHashEntry;
+struct rangeIndex;
+struct rangeIndexNode;
 typedef struct patternNodeHeader PatternNodeHeader;
 
 #include "entities.h"
@@ -48,6 +60,9 @@ struct patternNodeHeader
    struct alphaMemoryHash *lastHash;
    struct joinNode *entryJoin;
    Expression *rightHash;
+   Expression *rightRange;
+   unsigned long alphaCount;
+   unsigned long alphaPeak;
    unsigned int singlefieldNode : 1;
    unsigned int multifieldNode : 1;
    unsigned int stopNode : 1;
@@ -81,20 +96,82 @@ struct alphaMemoryHash
    struct alphaMemoryHash *prevHash;
    struct alphaMemoryHash *next;
    struct alphaMemoryHash *prev;
+   struct rangeIndex *rangeIndex;
   };
 
 typedef struct alphaMemoryHash ALPHA_MEMORY_HASH;
 
+/*******************************************************/
+/* rangeIndex: A skip list ordering the matches of an  */
+/*   alpha memory by the value of the rightRange       */
+/*   expression of the pattern. Matches for which the  */
+/*   value isn't a number are kept in an unordered     */
+/*   list and are always checked.                      */
+/*******************************************************/
+
+#define RANGE_INDEX_MAX_LEVEL 16
+
+struct rangeIndexNode
+  {
+   double key;
+   unsigned long long sequence;
+   PartialMatch *theMatch;
+   unsigned short level;
+   struct rangeIndexNode *prev;
+   struct rangeIndexNode *next[1];
+  };
+
+struct rangeIndex
+  {
+   unsigned short level;
+   unsigned long seed;
+   unsigned long long nextSequence;
+   struct rangeIndexNode *unordered;
+   struct rangeIndexNode *lastUnordered;
+   struct rangeIndexNode *head;
+  };
+
+struct rangeIndexCursor
+  {
+   bool indexed;
+   bool atMost;
+   struct rangeIndexNode *current;
+   struct rangeIndexNode *firstOrdered;
+  };
+
 #ifndef _H_ruledef
 #include "ruledef.h"
 #endif
 
+/*******************************************************/
+/* A hashed beta memory grows by BETA_HASH_GROWTH when */
+/*   it averages more than BETA_HASH_MAXIMUM_LOAD      */
+/*   partial matches per bucket, and shrinks by the    */
+/*   same factor when it averages less than            */
+/*   1/BETA_HASH_MINIMUM_LOAD partial matches.         */
+/*******************************************************/
+
 #define INITIAL_BETA_HASH_SIZE 17
+#define BETA_HASH_GROWTH        4
+#define BETA_HASH_MAXIMUM_LOAD  4
+#define BETA_HASH_MINIMUM_LOAD 16
+
+/*******************************************************/
+/* Aggregate types of the joins created for an         */
+/*   accumulate conditional element.                   */
+/*******************************************************/
+
+#define NO_AGGREGATE    0
+#define COUNT_AGGREGATE 1
+#define SUM_AGGREGATE   2
+#define MIN_AGGREGATE   3
+#define MAX_AGGREGATE   4
 
 struct betaMemory
   {
    unsigned long size;
    unsigned long count;
+   unsigned long resizes;
    struct partialMatch **beta;
    struct partialMatch **last;
   };
@@ -120,6 +197,8 @@ struct joinNode
    unsigned int marked : 1;
    unsigned int goalMarked : 1;
    unsigned int rhsType : 3;
+   unsigned int rangeAtMost : 1;
+   unsigned int aggregate : 3;
    unsigned int depth : 16; // TBD Decrease
    unsigned long bsaveID;
 #if DEBUGGING_FUNCTIONS
@@ -128,6 +207,14 @@ struct joinNode
    long long memoryLeftDeletes;
    long long memoryRightDeletes;
    long long memoryCompares;
+#endif
+#if PROFILING_FUNCTIONS
+   long long leftActivations;
+   long long rightActivations;
+   long long testEvaluations;
+   long long hashProbes;
+   unsigned long leftMemoryPeak;
+   unsigned long rightMemoryPeak;
 #endif
    struct betaMemory *leftMemory;
    struct betaMemory *rightMemory;
@@ -136,6 +223,8 @@ struct joinNode
    Expression *goalExpression;
    Expression *leftHash;
    Expression *rightHash;
+   Expression *leftRange;
+   Expression *aggregateExpression;
    void *rightSideEntryStructure;
    struct joinLink *nextLinks;
    struct joinNode *lastLevel;
@@ -62,6 +62,9 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: The range index expression is part of the      */
+/*            identity of an alpha node.                     */
+/*                                                           */
 /*************************************************************/
 /* =========================================
    *****************************************
@@ -667,7 +670,7 @@ static struct patternNodeHeader *PlaceObjectPattern(
    OBJECT_ALPHA_NODE *newAlphaNode;
    bool endSlot;
    CLIPSBitMap *newClassBitMap,*newSlotBitMap;
-   struct expr *rightHash;
+   struct expr *rightHash, *rightRange;
    unsigned int i;
    const CLASS_BITMAP *cbmp;
    Defclass *relevantDefclass;
@@ -688,6 +691,7 @@ static struct patternNodeHeader *PlaceObjectPattern(
    /*====================================================*/
 
    rightHash = thePattern->rightHash;
+   rightRange = thePattern->rightRange;
 
    newSlotBitMap = FormSlotBitMap(theEnv,thePattern->right);
    thePattern->right = RemoveSlotExistenceTests(theEnv,thePattern->right,&newClassBitMap);
@@ -769,7 +773,8 @@ static struct patternNodeHeader *PlaceObjectPattern(
      {
       if ((newClassBitMap == newAlphaNode->classbmp) &&
           (newSlotBitMap == newAlphaNode->slotbmp) &&
-          IdenticalExpression(newAlphaNode->header.rightHash,rightHash))
+          IdenticalExpression(newAlphaNode->header.rightHash,rightHash) &&
+          IdenticalExpression(newAlphaNode->header.rightRange,rightRange))
         return((struct patternNodeHeader *) newAlphaNode);
       newAlphaNode = newAlphaNode->nxtInGroup;
      }
@@ -777,6 +782,7 @@ static struct patternNodeHeader *PlaceObjectPattern(
    newAlphaNode = get_struct(theEnv,objectAlphaNode);
    InitializePatternHeader(theEnv,&newAlphaNode->header);
    newAlphaNode->header.rightHash = AddHashedExpression(theEnv,rightHash);
+   newAlphaNode->header.rightRange = AddHashedExpression(theEnv,rightRange);
    newAlphaNode->matchTimeTag = 0L;
    newAlphaNode->patternNode = lastLevel;
    newAlphaNode->classbmp = newClassBitMap;
@@ -1157,6 +1163,7 @@ static void DetachObjectPattern(
         {
          alphaPtr->patternNode->alphaNode = alphaPtr->nxtInGroup;
          RemoveHashedExpression(theEnv,alphaPtr->header.rightHash);
+         RemoveHashedExpression(theEnv,alphaPtr->header.rightRange);
          rtn_struct(theEnv,objectAlphaNode,alphaPtr);
          return;
         }
@@ -1165,11 +1172,13 @@ static void DetachObjectPattern(
      {
       prv->nxtInGroup = alphaPtr->nxtInGroup;
       RemoveHashedExpression(theEnv,alphaPtr->header.rightHash);
+      RemoveHashedExpression(theEnv,alphaPtr->header.rightRange);
       rtn_struct(theEnv,objectAlphaNode,alphaPtr);
       return;
      }
    alphaPtr->patternNode->alphaNode = NULL;
    RemoveHashedExpression(theEnv,alphaPtr->header.rightHash);
+   RemoveHashedExpression(theEnv,alphaPtr->header.rightRange);
    upperLevel = alphaPtr->patternNode;
    rtn_struct(theEnv,objectAlphaNode,alphaPtr);
 
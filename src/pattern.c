@@ -34,6 +34,11 @@
 /*            Removed use of void pointers for specific      */
 /*            data structures.                               */
 /*                                                           */
+/*      ?.??: Constructs-to-c support for range index        */
+/*            expressions.                                   */
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -527,8 +532,10 @@ void PatternNodeHeaderToCode(
      }
 
    PrintHashedExpressionReference(theEnv,fp,theHeader->rightHash,imageID,maxIndices);
+   fprintf(fp,",");
+   PrintHashedExpressionReference(theEnv,fp,theHeader->rightRange,imageID,maxIndices);
 
-   fprintf(fp,",%d,%d,%d,0,0,%d,%d,%d}",theHeader->singlefieldNode,
+   fprintf(fp,",0,0,%d,%d,%d,0,0,%d,%d,%d}",theHeader->singlefieldNode,
                                      theHeader->multifieldNode,
                                      theHeader->stopNode,
                                      theHeader->beginSlot,
@@ -50,6 +50,8 @@
 /*      6.41: Used gensnprintf in place of gensprintf and.   */
 /*            sprintf.                                       */
 /*                                                           */
+/*      ?.??: Added profiling of joins.                      */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -66,6 +68,7 @@
 #include "memalloc.h"
 #include "msgcom.h"
 #include "router.h"
+#include "rulecom.h"
 #include "sysdep.h"
 
 #include "proflfun.h"
@@ -75,6 +78,7 @@
 #define NO_PROFILE      0
 #define USER_FUNCTIONS  1
 #define CONSTRUCTS_CODE 2
+#define JOINS_CODE      3
 
 #define OUTPUT_STRING "%-40s %7ld %15.6f  %8.2f%%  %15.6f  %8.2f%%\n"
 
@@ -86,6 +90,7 @@
                                                         const char *,const char *,const char *,const char **);
    static void                        OutputUserFunctionsInfo(Environment *);
    static void                        OutputConstructsCodeInfo(Environment *);
+   static void                        OutputJoinsInfo(Environment *);
 #if (! RUN_TIME)
    static void                        ProfileClearFunction(Environment *,void *);
 #endif
@@ -169,7 +174,7 @@ void ProfileCommand(
 
    if (! Profile(theEnv,argument))
      {
-      UDFInvalidArgumentMessage(context,"symbol with value constructs, user-functions, or off");
+      UDFInvalidArgumentMessage(context,"symbol with value constructs, user-functions, joins, or off");
       return;
      }
 
@@ -189,7 +194,9 @@ bool Profile(
    /* user-defined functions should be profiled. If the    */
    /* argument is the symbol "constructs", then            */
    /* deffunctions, generic functions, message-handlers,   */
-   /* and rule RHS actions are profiled.                   */
+   /* and rule RHS actions are profiled. If the argument   */
+   /* is the symbol "joins", then the activity of the      */
+   /* joins of rules is counted.                           */
    /*======================================================*/
 
    if (strcmp(argument,"user-functions") == 0)
@@ -197,6 +204,7 @@ bool Profile(
       ProfileFunctionData(theEnv)->ProfileStartTime = gentime();
       ProfileFunctionData(theEnv)->ProfileUserFunctions = true;
       ProfileFunctionData(theEnv)->ProfileConstructs = false;
+      ProfileFunctionData(theEnv)->ProfileJoins = false;
       ProfileFunctionData(theEnv)->LastProfileInfo = USER_FUNCTIONS;
      }
 
@@ -205,12 +213,23 @@ bool Profile(
       ProfileFunctionData(theEnv)->ProfileStartTime = gentime();
       ProfileFunctionData(theEnv)->ProfileUserFunctions = false;
       ProfileFunctionData(theEnv)->ProfileConstructs = true;
+      ProfileFunctionData(theEnv)->ProfileJoins = false;
       ProfileFunctionData(theEnv)->LastProfileInfo = CONSTRUCTS_CODE;
      }
 
+   else if (strcmp(argument,"joins") == 0)
+     {
+      ProfileFunctionData(theEnv)->ProfileStartTime = gentime();
+      ProfileFunctionData(theEnv)->ProfileUserFunctions = false;
+      ProfileFunctionData(theEnv)->ProfileConstructs = false;
+      ProfileFunctionData(theEnv)->ProfileJoins = true;
+      ProfileFunctionData(theEnv)->LastProfileInfo = JOINS_CODE;
+     }
+
    /*======================================================*/
    /* Otherwise, if the argument is the symbol "off", then */
-   /* don't profile constructs and user-defined functions. */
+   /* don't profile constructs, user-defined functions,    */
+   /* and joins.                                           */
    /*======================================================*/
 
    else if (strcmp(argument,"off") == 0)
@@ -219,6 +238,7 @@ bool Profile(
       ProfileFunctionData(theEnv)->ProfileTotalTime += (ProfileFunctionData(theEnv)->ProfileEndTime - ProfileFunctionData(theEnv)->ProfileStartTime);
       ProfileFunctionData(theEnv)->ProfileUserFunctions = false;
       ProfileFunctionData(theEnv)->ProfileConstructs = false;
+      ProfileFunctionData(theEnv)->ProfileJoins = false;
      }
 
    /*=====================================================*/
@@ -248,7 +268,9 @@ void ProfileInfoCommand(
    /* update the profile end time.     */
    /*==================================*/
 
-   if (ProfileFunctionData(theEnv)->ProfileUserFunctions || ProfileFunctionData(theEnv)->ProfileConstructs)
+   if (ProfileFunctionData(theEnv)->ProfileUserFunctions ||
+       ProfileFunctionData(theEnv)->ProfileConstructs ||
+       ProfileFunctionData(theEnv)->ProfileJoins)
      {
       ProfileFunctionData(theEnv)->ProfileEndTime = gentime();
       ProfileFunctionData(theEnv)->ProfileTotalTime += (ProfileFunctionData(theEnv)->ProfileEndTime - ProfileFunctionData(theEnv)->ProfileStartTime);
@@ -263,6 +285,22 @@ void ProfileInfoCommand(
       snprintf(buffer,sizeof(buffer),"Profile elapsed time = %g seconds\n",
                       ProfileFunctionData(theEnv)->ProfileTotalTime);
       WriteString(theEnv,STDOUT,buffer);
+     }
+
+   if (ProfileFunctionData(theEnv)->LastProfileInfo == JOINS_CODE)
+     {
+      snprintf(buffer,sizeof(buffer),"%-30s%11s%11s%11s%11s%14s%14s\n",
+               "Rule and CE","Left","Right","Tests","Probes","Left Memory","Right Memory");
+      WriteString(theEnv,STDOUT,buffer);
+      snprintf(buffer,sizeof(buffer),"%-30s%11s%11s%11s%11s%14s%14s\n",
+               "-----------","----","-----","-----","------","-----------","------------");
+      WriteString(theEnv,STDOUT,buffer);
+      OutputJoinsInfo(theEnv);
+      return;
+     }
+
+   if (ProfileFunctionData(theEnv)->LastProfileInfo != NO_PROFILE)
+     {
 
       if (ProfileFunctionData(theEnv)->LastProfileInfo == USER_FUNCTIONS)
         { WriteString(theEnv,STDOUT,"Function Name                            "); }
@@ -491,6 +529,9 @@ void ProfileResetCommand(
      {
       ResetProfileInfo((struct constructProfileInfo *)
                        TestUserData(ProfileFunctionData(theEnv)->ProfileDataID,theDefrule->header.usrData));
+#if DEBUGGING_FUNCTIONS
+      ResetJoinProfile(theEnv,theDefrule);
+#endif
      }
 #endif
 
@@ -792,6 +833,27 @@ const char *SetProfileOutputString(
    return(oldOutputString);
   }
 
+/********************************************************/
+/* OutputJoinsInfo: Prints the activity counted for the */
+/*   joins of each rule while joins were profiled.      */
+/********************************************************/
+static void OutputJoinsInfo(
+  Environment *theEnv)
+  {
+#if DEFRULE_CONSTRUCT && DEBUGGING_FUNCTIONS
+   Defrule *theDefrule;
+
+   for (theDefrule = GetNextDefrule(theEnv,NULL);
+        theDefrule != NULL;
+        theDefrule = GetNextDefrule(theEnv,theDefrule))
+     { ListJoinProfile(theEnv,theDefrule); }
+#else
+#if MAC_XCD
+#pragma unused(theEnv)
+#endif
+#endif
+  }
+
 #if (! RUN_TIME)
 /******************************************************************/
 /* ProfileClearFunction: Profiling clear routine for use with the */
@@ -48,6 +48,8 @@
 /*                                                           */
 /*            UDF redesign.                                  */
 /*                                                           */
+/*      ?.??: Added profiling of joins.                      */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_proflfun
@@ -89,6 +91,7 @@ struct profileFunctionData
    unsigned char ProfileDataID;
    bool ProfileUserFunctions;
    bool ProfileConstructs;
+   bool ProfileJoins;
    struct constructProfileInfo *ActiveProfileFrame;
    const char *OutputString;
   };
@@ -0,0 +1,486 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*             RATE LIMIT FUNCTIONS MODULE             */
+/*******************************************************/
+
+/*************************************************************/
+/* Purpose: Named token-bucket rate limiters. Each limiter   */
+/*   keeps an open-addressing hash table of buckets keyed by */
+/*   a client's address or logical name. Buckets refill      */
+/*   lazily from a monotonic clock when they are touched,    */
+/*   and buckets that have refilled completely are dropped   */
+/*   when the table would otherwise grow.                    */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "setup.h"
+
+#include "envrnmnt.h"
+#include "extnfunc.h"
+#include "memalloc.h"
+#include "router.h"
+#include "symbol.h"
+
+#include "ratefun.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+static void                    DeallocateRateLimitData(Environment *);
+static double                  MonotonicSeconds(void);
+static size_t                  HashRateKey(CLIPSLexeme *,size_t);
+static struct rateLimiter     *FindRateLimiter(Environment *,CLIPSLexeme *);
+static struct rateBucket      *FindRateBucket(struct rateLimiter *,CLIPSLexeme *);
+static void                    RefillRateBucket(struct rateLimiter *,struct rateBucket *,double);
+static void                    ResizeRateLimiter(Environment *,struct rateLimiter *,double);
+static struct rateBucket      *AddRateBucket(Environment *,struct rateLimiter *,CLIPSLexeme *,double);
+static void                    ReturnRateLimiter(Environment *,struct rateLimiter *,bool);
+
+/*******************************************************/
+/* RateLimitFunctionDefinitions: Allocates the rate    */
+/*   limiter list and registers the rate limit         */
+/*   functions.                                        */
+/*******************************************************/
+void RateLimitFunctionDefinitions(
+		Environment *theEnv)
+{
+	AllocateEnvironmentData(
+			theEnv,
+			RATE_LIMIT_DATA,
+			sizeof(struct rateLimitData),
+			DeallocateRateLimitData);
+
+	AddUDF(theEnv,"rate-limit-create","b",3,3,";y;ld;ld",RateLimitCreateFunction,"RateLimitCreateFunction",NULL);
+	AddUDF(theEnv,"rate-limit-take","b",2,3,";y;sy;ld",RateLimitTakeFunction,"RateLimitTakeFunction",NULL);
+	AddUDF(theEnv,"rate-limit-tokens","bd",2,2,";y;sy",RateLimitTokensFunction,"RateLimitTokensFunction",NULL);
+	AddUDF(theEnv,"rate-limit-delete","b",1,1,"y",RateLimitDeleteFunction,"RateLimitDeleteFunction",NULL);
+}
+
+/****************************************************/
+/* DeallocateRateLimitData: Deallocates the rate    */
+/*   limiters when the environment is destroyed.    */
+/*   The symbol table is already gone by then, so   */
+/*   the keys are not released.                     */
+/****************************************************/
+static void DeallocateRateLimitData(
+		Environment *theEnv)
+{
+	struct rateLimiter *theLimiter, *nextLimiter;
+
+	for (theLimiter = RateLimitData(theEnv)->ListOfRateLimiters;
+	     theLimiter != NULL;
+	     theLimiter = nextLimiter)
+	{
+		nextLimiter = theLimiter->next;
+		ReturnRateLimiter(theEnv,theLimiter,false);
+	}
+}
+
+/***********************************************/
+/* MonotonicSeconds: Returns seconds on a clock */
+/*   that is not affected by changes to the     */
+/*   time of day.                               */
+/***********************************************/
+static double MonotonicSeconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	return (double) now.tv_sec + (now.tv_nsec / 1000000000.0);
+}
+
+/***************************************************/
+/* HashRateKey: Lexemes are unique, so the address */
+/*   of the key identifies it. The multiplication  */
+/*   spreads the aligned addresses over the table. */
+/***************************************************/
+static size_t HashRateKey(
+		CLIPSLexeme *theKey,
+		size_t size)
+{
+	uint64_t hash = (uint64_t) (uintptr_t) theKey;
+
+	hash = (hash >> 4) * 0x9E3779B97F4A7C15ULL;
+
+	return (size_t) (hash >> 32) & (size - 1);
+}
+
+/*****************************************************/
+/* FindRateLimiter: Returns the named rate limiter. */
+/*****************************************************/
+static struct rateLimiter *FindRateLimiter(
+		Environment *theEnv,
+		CLIPSLexeme *theName)
+{
+	struct rateLimiter *theLimiter;
+
+	for (theLimiter = RateLimitData(theEnv)->ListOfRateLimiters;
+	     theLimiter != NULL;
+	     theLimiter = theLimiter->next)
+	{
+		if (theLimiter->name == theName) return theLimiter;
+	}
+
+	return NULL;
+}
+
+/**************************************************/
+/* FindRateBucket: Probes the table for the key's */
+/*   bucket. Returns NULL if there is none.       */
+/**************************************************/
+static struct rateBucket *FindRateBucket(
+		struct rateLimiter *theLimiter,
+		CLIPSLexeme *theKey)
+{
+	size_t i;
+
+	i = HashRateKey(theKey,theLimiter->size);
+
+	while (theLimiter->buckets[i].key != NULL)
+	{
+		if (theLimiter->buckets[i].key == theKey)
+		{ return &theLimiter->buckets[i]; }
+
+		i = (i + 1) & (theLimiter->size - 1);
+	}
+
+	return NULL;
+}
+
+/***************************************************/
+/* RefillRateBucket: Adds the tokens earned since  */
+/*   the bucket was last touched, up to the burst. */
+/***************************************************/
+static void RefillRateBucket(
+		struct rateLimiter *theLimiter,
+		struct rateBucket *theBucket,
+		double now)
+{
+	if (now > theBucket->updated)
+	{
+		theBucket->tokens += (now - theBucket->updated) * theLimiter->rate;
+		if (theBucket->tokens > theLimiter->burst)
+		{ theBucket->tokens = theLimiter->burst; }
+		theBucket->updated = now;
+	}
+}
+
+/******************************************************/
+/* ResizeRateLimiter: Rebuilds the table, dropping    */
+/*   buckets that have refilled completely since a    */
+/*   missing bucket behaves the same as a full one.   */
+/*   The new table is sized to keep the load at or    */
+/*   below one quarter after the rebuild.             */
+/******************************************************/
+static void ResizeRateLimiter(
+		Environment *theEnv,
+		struct rateLimiter *theLimiter,
+		double now)
+{
+	struct rateBucket *oldBuckets = theLimiter->buckets;
+	size_t oldSize = theLimiter->size, live = 0, i, j;
+
+	for (i = 0; i < oldSize; i++)
+	{
+		if (oldBuckets[i].key == NULL) continue;
+
+		RefillRateBucket(theLimiter,&oldBuckets[i],now);
+		if (oldBuckets[i].tokens >= theLimiter->burst)
+		{
+			ReleaseLexeme(theEnv,oldBuckets[i].key);
+			oldBuckets[i].key = NULL;
+		}
+		else
+		{ live++; }
+	}
+
+	theLimiter->size = RATE_LIMIT_INITIAL_SIZE;
+	while (theLimiter->size < (live * 4))
+	{ theLimiter->size *= 2; }
+
+	theLimiter->buckets = (struct rateBucket *) gm2(theEnv,sizeof(struct rateBucket) * theLimiter->size);
+	memset(theLimiter->buckets,0,sizeof(struct rateBucket) * theLimiter->size);
+	theLimiter->count = live;
+
+	for (i = 0; i < oldSize; i++)
+	{
+		if (oldBuckets[i].key == NULL) continue;
+
+		j = HashRateKey(oldBuckets[i].key,theLimiter->size);
+		while (theLimiter->buckets[j].key != NULL)
+		{ j = (j + 1) & (theLimiter->size - 1); }
+
+		theLimiter->buckets[j] = oldBuckets[i];
+	}
+
+	if (oldBuckets != NULL)
+	{ rm(theEnv,oldBuckets,sizeof(struct rateBucket) * oldSize); }
+}
+
+/***************************************************/
+/* AddRateBucket: Adds a full bucket for the key,  */
+/*   rebuilding the table first if it is half full. */
+/***************************************************/
+static struct rateBucket *AddRateBucket(
+		Environment *theEnv,
+		struct rateLimiter *theLimiter,
+		CLIPSLexeme *theKey,
+		double now)
+{
+	size_t i;
+
+	if ((theLimiter->count + 1) * 2 > theLimiter->size)
+	{ ResizeRateLimiter(theEnv,theLimiter,now); }
+
+	i = HashRateKey(theKey,theLimiter->size);
+	while (theLimiter->buckets[i].key != NULL)
+	{ i = (i + 1) & (theLimiter->size - 1); }
+
+	theLimiter->buckets[i].key = theKey;
+	IncrementLexemeCount(theKey);
+	theLimiter->buckets[i].tokens = theLimiter->burst;
+	theLimiter->buckets[i].updated = now;
+	theLimiter->count++;
+
+	return &theLimiter->buckets[i];
+}
+
+/*************************************************/
+/* ReturnRateLimiter: Releases a rate limiter,   */
+/*   its buckets and the lexemes it holds.       */
+/*************************************************/
+static void ReturnRateLimiter(
+		Environment *theEnv,
+		struct rateLimiter *theLimiter,
+		bool releaseLexemes)
+{
+	size_t i;
+
+	if (releaseLexemes)
+	{
+		for (i = 0; i < theLimiter->size; i++)
+		{
+			if (theLimiter->buckets[i].key != NULL)
+			{ ReleaseLexeme(theEnv,theLimiter->buckets[i].key); }
+		}
+		ReleaseLexeme(theEnv,theLimiter->name);
+	}
+
+	rm(theEnv,theLimiter->buckets,sizeof(struct rateBucket) * theLimiter->size);
+	rtn_struct(theEnv,rateLimiter,theLimiter);
+}
+
+/******************************************************/
+/* RateLimitCreateFunction: H/L access routine for    */
+/*   the rate-limit-create function. Creating an      */
+/*   existing limiter changes its rate and burst but  */
+/*   keeps the state of its buckets.                  */
+/******************************************************/
+void RateLimitCreateFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theName, theArg;
+	struct rateLimiter *theLimiter;
+	double rate, burst;
+	size_t i;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	UDFNextArgument(context,SYMBOL_BIT,&theName);
+	UDFNextArgument(context,NUMBER_BITS,&theArg);
+	rate = CVCoerceToFloat(&theArg);
+	UDFNextArgument(context,NUMBER_BITS,&theArg);
+	burst = CVCoerceToFloat(&theArg);
+
+	if (! (rate > 0.0))
+	{
+		WriteString(theEnv,STDERR,"rate-limit-create: the rate must be greater than zero\n");
+		return;
+	}
+
+	if (! (burst >= 1.0))
+	{
+		WriteString(theEnv,STDERR,"rate-limit-create: the burst must be at least one\n");
+		return;
+	}
+
+	theLimiter = FindRateLimiter(theEnv,theName.lexemeValue);
+	if (theLimiter == NULL)
+	{
+		theLimiter = get_struct(theEnv,rateLimiter);
+		theLimiter->name = theName.lexemeValue;
+		IncrementLexemeCount(theLimiter->name);
+		theLimiter->count = 0;
+		theLimiter->size = RATE_LIMIT_INITIAL_SIZE;
+		theLimiter->buckets = (struct rateBucket *) gm2(theEnv,sizeof(struct rateBucket) * theLimiter->size);
+		memset(theLimiter->buckets,0,sizeof(struct rateBucket) * theLimiter->size);
+		theLimiter->next = RateLimitData(theEnv)->ListOfRateLimiters;
+		RateLimitData(theEnv)->ListOfRateLimiters = theLimiter;
+	}
+	else
+	{
+		for (i = 0; i < theLimiter->size; i++)
+		{
+			if ((theLimiter->buckets[i].key != NULL) &&
+			    (theLimiter->buckets[i].tokens > burst))
+			{ theLimiter->buckets[i].tokens = burst; }
+		}
+	}
+
+	theLimiter->rate = rate;
+	theLimiter->burst = burst;
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/******************************************************/
+/* RateLimitTakeFunction: H/L access routine for the  */
+/*   rate-limit-take function. Removes the cost from  */
+/*   the key's bucket and returns TRUE, or returns    */
+/*   FALSE without removing anything if the bucket    */
+/*   holds fewer tokens than the cost.                */
+/******************************************************/
+void RateLimitTakeFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theName, theKey, theArg;
+	struct rateLimiter *theLimiter;
+	struct rateBucket *theBucket;
+	double cost = 1.0, now;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	UDFNextArgument(context,SYMBOL_BIT,&theName);
+	UDFNextArgument(context,LEXEME_BITS,&theKey);
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,NUMBER_BITS,&theArg);
+		cost = CVCoerceToFloat(&theArg);
+		if (cost < 0.0)
+		{
+			WriteString(theEnv,STDERR,"rate-limit-take: the cost must not be negative\n");
+			return;
+		}
+	}
+
+	theLimiter = FindRateLimiter(theEnv,theName.lexemeValue);
+	if (theLimiter == NULL)
+	{
+		WriteString(theEnv,STDERR,"rate-limit-take: could not find rate limiter ");
+		WriteString(theEnv,STDERR,theName.lexemeValue->contents);
+		WriteString(theEnv,STDERR,"\n");
+		return;
+	}
+
+	now = MonotonicSeconds();
+	theBucket = FindRateBucket(theLimiter,theKey.lexemeValue);
+	if (theBucket == NULL)
+	{
+		if (cost > theLimiter->burst) return;
+		theBucket = AddRateBucket(theEnv,theLimiter,theKey.lexemeValue,now);
+	}
+	else
+	{ RefillRateBucket(theLimiter,theBucket,now); }
+
+	if (theBucket->tokens < cost) return;
+
+	theBucket->tokens -= cost;
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/******************************************************/
+/* RateLimitTokensFunction: H/L access routine for    */
+/*   the rate-limit-tokens function. Returns the      */
+/*   tokens now available to a key without taking     */
+/*   any.                                             */
+/******************************************************/
+void RateLimitTokensFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theName, theKey;
+	struct rateLimiter *theLimiter;
+	struct rateBucket *theBucket;
+
+	UDFNextArgument(context,SYMBOL_BIT,&theName);
+	UDFNextArgument(context,LEXEME_BITS,&theKey);
+
+	theLimiter = FindRateLimiter(theEnv,theName.lexemeValue);
+	if (theLimiter == NULL)
+	{
+		WriteString(theEnv,STDERR,"rate-limit-tokens: could not find rate limiter ");
+		WriteString(theEnv,STDERR,theName.lexemeValue->contents);
+		WriteString(theEnv,STDERR,"\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	theBucket = FindRateBucket(theLimiter,theKey.lexemeValue);
+	if (theBucket == NULL)
+	{
+		returnValue->floatValue = CreateFloat(theEnv,theLimiter->burst);
+		return;
+	}
+
+	RefillRateBucket(theLimiter,theBucket,MonotonicSeconds());
+	returnValue->floatValue = CreateFloat(theEnv,theBucket->tokens);
+}
+
+/******************************************************/
+/* RateLimitDeleteFunction: H/L access routine for    */
+/*   the rate-limit-delete function.                  */
+/******************************************************/
+void RateLimitDeleteFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theName;
+	struct rateLimiter *theLimiter, *lastLimiter = NULL;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	UDFNextArgument(context,SYMBOL_BIT,&theName);
+
+	for (theLimiter = RateLimitData(theEnv)->ListOfRateLimiters;
+	     theLimiter != NULL;
+	     lastLimiter = theLimiter, theLimiter = theLimiter->next)
+	{
+		if (theLimiter->name != theName.lexemeValue) continue;
+
+		if (lastLimiter == NULL)
+		{ RateLimitData(theEnv)->ListOfRateLimiters = theLimiter->next; }
+		else
+		{ lastLimiter->next = theLimiter->next; }
+
+		ReturnRateLimiter(theEnv,theLimiter,true);
+		returnValue->lexemeValue = TrueSymbol(theEnv);
+		return;
+	}
+}
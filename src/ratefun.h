@@ -0,0 +1,65 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*            RATE LIMIT FUNCTIONS HEADER              */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: Named token-bucket rate limiters keyed by client */
+/*   address or logical name.                                */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_ratefun
+
+#pragma once
+
+#define _H_ratefun
+
+#include <stddef.h>
+
+#define RATE_LIMIT_DATA USER_ENVIRONMENT_DATA + 3
+
+#define RATE_LIMIT_INITIAL_SIZE 64
+
+struct rateBucket
+  {
+   CLIPSLexeme *key;
+   double tokens;
+   double updated;
+  };
+
+struct rateLimiter
+  {
+   CLIPSLexeme *name;
+   double rate;
+   double burst;
+   size_t count;
+   size_t size;
+   struct rateBucket *buckets;
+   struct rateLimiter *next;
+  };
+
+struct rateLimitData
+  {
+   struct rateLimiter *ListOfRateLimiters;
+  };
+
+#define RateLimitData(theEnv) ((struct rateLimitData *) GetEnvironmentData(theEnv,RATE_LIMIT_DATA))
+
+   void                           RateLimitFunctionDefinitions(Environment *);
+   void                           RateLimitCreateFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RateLimitTakeFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RateLimitTokensFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RateLimitDeleteFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_ratefun */
@@ -57,6 +57,8 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added support for the accumulate CE.           */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -496,6 +498,7 @@ static struct lhsParseNode *PerformReorder1(
                tempArg->value = NULL;
                tempArg->expression = NULL;
                tempArg->secondaryExpression = NULL;
+               tempArg->aggregateExpression = NULL;
                tempArg->right = newNode;
 
                tempArg = tempArg->bottom;
@@ -630,8 +633,12 @@ static struct lhsParseNode *PerformReorder2(
             argPtr->right->leftHash = NULL;
             argPtr->right->rightHash = NULL;
             argPtr->right->betaHash = NULL;
+            argPtr->right->leftRange = NULL;
+            argPtr->right->rightRange = NULL;
+            argPtr->right->aggregateValue = NULL;
             argPtr->right->expression = NULL;
             argPtr->right->secondaryExpression = NULL;
+            argPtr->right->aggregateExpression = NULL;
             argPtr->right->userData = NULL;
             argPtr->right->right = NULL;
             argPtr->right->bottom = NULL;
@@ -666,8 +673,12 @@ static struct lhsParseNode *PerformReorder2(
             argPtr->leftHash = NULL;
             argPtr->rightHash = NULL;
             argPtr->betaHash = NULL;
+            argPtr->leftRange = NULL;
+            argPtr->rightRange = NULL;
+            argPtr->aggregateValue = NULL;
             argPtr->expression = NULL;
             argPtr->secondaryExpression = NULL;
+            argPtr->aggregateExpression = NULL;
             argPtr->userData = NULL;
             argPtr->right = NULL;
             argPtr->bottom = NULL;
@@ -948,6 +959,7 @@ static struct lhsParseNode *CompressCEs(
                                               false) &&
                    (argPtr->negated == false) &&
                    (argPtr->exists == false) &&
+                   (argPtr->aggregate == NO_AGGREGATE) &&
                    (argPtr->beginNandDepth == argPtr->endNandDepth) &&
                    (argPtr->endNandDepth == argPtr->bottom->beginNandDepth))
            {
@@ -1055,8 +1067,12 @@ static struct lhsParseNode *CompressCEs(
             argPtr->leftHash = NULL;
             argPtr->rightHash = NULL;
             argPtr->betaHash = NULL;
+            argPtr->leftRange = NULL;
+            argPtr->rightRange = NULL;
+            argPtr->aggregateValue = NULL;
             argPtr->expression = NULL;
             argPtr->secondaryExpression = NULL;
+            argPtr->aggregateExpression = NULL;
             argPtr->userData = NULL;
             argPtr->right = NULL;
             argPtr->bottom = NULL;
@@ -1120,6 +1136,9 @@ void CopyLHSParseNode(
    dest->existsNand = src->existsNand;
    dest->goalCE = src->goalCE;
    dest->explicitCE = src->explicitCE;
+   dest->referenced = src->referenced;
+   dest->rangeAtMost = src->rangeAtMost;
+   dest->aggregate = src->aggregate;
    dest->bindingVariable = src->bindingVariable;
    dest->withinMultifieldSlot = src->withinMultifieldSlot;
    dest->multifieldSlot = src->multifieldSlot;
@@ -1159,6 +1178,9 @@ void CopyLHSParseNode(
       dest->leftHash = CopyExpression(theEnv,src->leftHash);
       dest->betaHash = CopyExpression(theEnv,src->betaHash);
       dest->rightHash = CopyExpression(theEnv,src->rightHash);
+      dest->leftRange = CopyExpression(theEnv,src->leftRange);
+      dest->rightRange = CopyExpression(theEnv,src->rightRange);
+      dest->aggregateValue = CopyExpression(theEnv,src->aggregateValue);
       if (src->userData == NULL)
         { dest->userData = NULL; }
       else if (src->patternType->copyUserDataFunction == NULL)
@@ -1167,6 +1189,7 @@ void CopyLHSParseNode(
         { dest->userData = (*src->patternType->copyUserDataFunction)(theEnv,src->userData); }
       dest->expression = CopyLHSParseNodes(theEnv,src->expression);
       dest->secondaryExpression = CopyLHSParseNodes(theEnv,src->secondaryExpression);
+      dest->aggregateExpression = CopyLHSParseNodes(theEnv,src->aggregateExpression);
       dest->constraints = CopyConstraintRecord(theEnv,src->constraints);
       if (dest->constraints != NULL) dest->derivedConstraints = true;
       else dest->derivedConstraints = false;
@@ -1183,9 +1206,13 @@ void CopyLHSParseNode(
       dest->leftHash = src->leftHash;
       dest->betaHash = src->betaHash;
       dest->rightHash = src->rightHash;
+      dest->leftRange = src->leftRange;
+      dest->rightRange = src->rightRange;
+      dest->aggregateValue = src->aggregateValue;
       dest->userData = src->userData;
       dest->expression = src->expression;
       dest->secondaryExpression = src->secondaryExpression;
+      dest->aggregateExpression = src->aggregateExpression;
       dest->derivedConstraints = false;
       dest->constraints = src->constraints;
      }
@@ -1208,6 +1235,9 @@ struct lhsParseNode *GetLHSParseNode(
    newNode->existsNand = false;
    newNode->goalCE = false;
    newNode->explicitCE = false;
+   newNode->referenced = false;
+   newNode->rangeAtMost = false;
+   newNode->aggregate = NO_AGGREGATE;
    newNode->bindingVariable = false;
    newNode->withinMultifieldSlot = false;
    newNode->multifieldSlot = false;
@@ -1241,8 +1271,12 @@ struct lhsParseNode *GetLHSParseNode(
    newNode->leftHash = NULL;
    newNode->betaHash = NULL;
    newNode->rightHash = NULL;
+   newNode->leftRange = NULL;
+   newNode->rightRange = NULL;
+   newNode->aggregateValue = NULL;
    newNode->expression = NULL;
    newNode->secondaryExpression = NULL;
+   newNode->aggregateExpression = NULL;
    newNode->right = NULL;
    newNode->bottom = NULL;
 
@@ -1269,10 +1303,14 @@ void ReturnLHSParseNodes(
       ReturnExpression(theEnv,waste->leftHash);
       ReturnExpression(theEnv,waste->betaHash);
       ReturnExpression(theEnv,waste->rightHash);
+      ReturnExpression(theEnv,waste->leftRange);
+      ReturnExpression(theEnv,waste->rightRange);
+      ReturnExpression(theEnv,waste->aggregateValue);
       ReturnLHSParseNodes(theEnv,waste->right);
       ReturnLHSParseNodes(theEnv,waste->bottom);
       ReturnLHSParseNodes(theEnv,waste->expression);
       ReturnLHSParseNodes(theEnv,waste->secondaryExpression);
+      ReturnLHSParseNodes(theEnv,waste->aggregateExpression);
       if (waste->derivedConstraints) RemoveConstraint(theEnv,waste->constraints);
       if ((waste->userData != NULL) &&
           (waste->patternType->returnUserDataFunction != NULL))
@@ -1598,6 +1636,24 @@ static struct lhsParseNode *AddRemainingInitialPatterns(
            { lastNode->bottom = thePattern; }
         }
 
+      /*=========================================================*/
+      /* An accumulate CE needs a partial match on its left side */
+      /* to which the aggregate value can be attached, so one is */
+      /* provided by an initial pattern if it's the first CE.    */
+      /*=========================================================*/
+
+      else if ((lastNode == NULL) &&
+               (theLHS->pnType == PATTERN_CE_NODE) &&
+               (theLHS->aggregate != NO_AGGREGATE))
+        {
+         thePattern = CreateInitialPattern(theEnv);
+         thePattern->beginNandDepth = 1;
+         thePattern->endNandDepth = 1;
+         thePattern->logical = theLHS->logical;
+         thePattern->bottom = theLHS;
+         rv = thePattern;
+        }
+
       lastNode = theLHS;
       currentDepth = theLHS->endNandDepth;
       theLHS = theLHS->bottom;
@@ -1686,6 +1742,12 @@ static struct lhsParseNode *AssignPatternIndices(
             PropagateNandDepth(theLHS->expression,theLHS->beginNandDepth,theLHS->endNandDepth);
            }
 
+         if (theLHS->aggregateExpression != NULL)
+           {
+            PropagateJoinDepth(theLHS->aggregateExpression,joinDepth);
+            PropagateNandDepth(theLHS->aggregateExpression,theLHS->beginNandDepth,theLHS->endNandDepth);
+           }
+
          theLHS->pattern = startIndex;
          theLHS->joinDepth = joinDepth;
          PropagateJoinDepth(theLHS->right,joinDepth);
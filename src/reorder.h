@@ -49,6 +49,12 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added referenced flag to lhsParseNode.         */
+/*                                                           */
+/*            Added range index expressions to lhsParseNode. */
+/*                                                           */
+/*            Added aggregate fields to lhsParseNode.        */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_reorder
@@ -122,6 +128,9 @@ struct lhsParseNode
    unsigned int withinMultifieldSlot : 1;
    unsigned int goalCE : 1;
    unsigned int explicitCE : 1;
+   unsigned int referenced : 1;
+   unsigned int rangeAtMost : 1;
+   unsigned int aggregate : 3;
    unsigned short multiFieldsBefore;
    unsigned short multiFieldsAfter;
    unsigned short singleFieldsBefore;
@@ -146,8 +155,12 @@ struct lhsParseNode
    struct expr *leftHash;
    struct expr *rightHash;
    struct expr *betaHash;
+   struct expr *leftRange;
+   struct expr *rightRange;
    struct lhsParseNode *expression;
    struct lhsParseNode *secondaryExpression;
+   struct lhsParseNode *aggregateExpression;
+   struct expr *aggregateValue;
    void *userData;
    struct lhsParseNode *right;
    struct lhsParseNode *bottom;
@@ -0,0 +1,833 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*                 RESP FUNCTIONS MODULE               */
+/*******************************************************/
+
+/***********************************************************************/
+/* Purpose: Speaks the Redis serialization protocol on socket          */
+/*   connections. Commands are parsed incrementally from a             */
+/*   connection's pending buffer into resp-command facts, and replies  */
+/*   are written straight to the connection's output buffer.           */
+/*                                                                     */
+/* Principal Programmer(s):                                            */
+/*      Ryan P. Johnston                                               */
+/*                                                                     */
+/* Revision History:                                                   */
+/*                                                                     */
+/*      ?.??: Added this file.                                         */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clips.h"
+
+#include "respfun.h"
+#include "socketrtr.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+	static Deftemplate            *GetRespCommandDeftemplate(Environment *);
+	static bool                    FindRespCommandSlots(Deftemplate *,int *);
+	static enum respParseResult    ParseRespLine(struct respParser *,const char **,size_t *);
+	static bool                    ParseRespLength(const char *,size_t,long long *);
+	static enum respParseResult    ParseRespValue(struct respParser *,MultifieldBuilder *,int);
+	static enum respParseResult    ParseRespCommand(struct respParser *,MultifieldBuilder *,MultifieldBuilder *);
+	static enum respParseResult    ParseRespInline(struct respParser *,MultifieldBuilder *,MultifieldBuilder *);
+	static const char             *RespScratchCopy(struct respParser *,const char *,size_t);
+	static CLIPSLexeme            *RespCommandName(struct respParser *,CLIPSValue *);
+	static bool                    WriteRespLine(Environment *,FILE *,char,const char *,const char *);
+	static void                    WriteRespBulk(FILE *,const char *,size_t);
+	static void                    WriteRespValue(FILE *,CLIPSValue *);
+	static FILE                   *GetRespConnection(Environment *,UDFContext *,const char *);
+
+/*******************************************************/
+/* RespFunctionDefinitions: Registers the RESP         */
+/*   functions.                                        */
+/*******************************************************/
+void RespFunctionDefinitions(
+		Environment *theEnv)
+{
+	AddUDF(theEnv,"resp-read","bl",1,1,"lsy",RespReadFunction,"RespReadFunction",NULL);
+	AddUDF(theEnv,"resp-send-simple","b",2,2,";lsy;sy",RespSendSimpleFunction,"RespSendSimpleFunction",NULL);
+	AddUDF(theEnv,"resp-send-error","b",2,2,";lsy;sy",RespSendErrorFunction,"RespSendErrorFunction",NULL);
+	AddUDF(theEnv,"resp-send-integer","b",2,2,";lsy;l",RespSendIntegerFunction,"RespSendIntegerFunction",NULL);
+	AddUDF(theEnv,"resp-send-bulk","b",2,2,";lsy;synld",RespSendBulkFunction,"RespSendBulkFunction",NULL);
+	AddUDF(theEnv,"resp-send-array","b",1,UNBOUNDED,"*;lsy",RespSendArrayFunction,"RespSendArrayFunction",NULL);
+}
+
+/*******************************************************/
+/* GetRespCommandDeftemplate: Returns the deftemplate  */
+/*   commands are asserted as, defining it the first   */
+/*   time it is needed (and again after a clear).      */
+/*******************************************************/
+static Deftemplate *GetRespCommandDeftemplate(
+		Environment *theEnv)
+{
+	Deftemplate *theDeftemplate;
+
+	theDeftemplate = FindDeftemplate(theEnv,RESP_COMMAND_DEFTEMPLATE);
+	if (theDeftemplate != NULL)
+	{ return theDeftemplate; }
+
+	if (Build(theEnv,"(deftemplate " RESP_COMMAND_DEFTEMPLATE
+	                 " (slot connection) (slot id) (slot name) (multislot args))") != BE_NO_ERROR)
+	{ return NULL; }
+
+	return FindDeftemplate(theEnv,RESP_COMMAND_DEFTEMPLATE);
+}
+
+/**********************************************************/
+/* FindRespCommandSlots: Finds the positions of the       */
+/*   connection, name, args and id slots, so a user       */
+/*   defined resp-command deftemplate may add slots of    */
+/*   its own. The id slot is optional; without it,        */
+/*   repeated identical commands are only asserted once   */
+/*   unless fact duplication is enabled.                  */
+/**********************************************************/
+static bool FindRespCommandSlots(
+		Deftemplate *theDeftemplate,
+		int *positions)
+{
+	static const char *slotNames[4] = { "connection", "name", "args", "id" };
+	struct templateSlot *theSlot;
+	unsigned short whichSlot;
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		for (theSlot = theDeftemplate->slotList, whichSlot = 0;
+		     theSlot != NULL;
+		     theSlot = theSlot->next, whichSlot++)
+		{
+			if (strcmp(theSlot->slotName->contents,slotNames[i]) == 0)
+			{ break; }
+		}
+
+		if ((theSlot == NULL) && (i == 3))
+		{
+			positions[i] = -1;
+			break;
+		}
+
+		if ((theSlot == NULL) || ((i == 2) != (theSlot->multislot == 1)))
+		{ return false; }
+
+		positions[i] = whichSlot;
+	}
+
+	return true;
+}
+
+/*****************************************************/
+/* RespScratchCopy: Copies bytes into the parser's   */
+/*   scratch buffer so they can be null terminated.  */
+/*****************************************************/
+static const char *RespScratchCopy(
+		struct respParser *parser,
+		const char *bytes,
+		size_t length)
+{
+	size_t newSize;
+
+	if ((length + 1) > parser->scratchSize)
+	{
+		newSize = parser->scratchSize * 2;
+		while ((length + 1) > newSize)
+		{ newSize *= 2; }
+
+		rm(parser->theEnv,parser->scratch,parser->scratchSize);
+		parser->scratch = (char *) gm2(parser->theEnv,newSize);
+		parser->scratchSize = newSize;
+	}
+
+	memcpy(parser->scratch,bytes,length);
+	parser->scratch[length] = '\0';
+
+	return parser->scratch;
+}
+
+/*********************************************************/
+/* ParseRespLine: Finds the end of the line starting at  */
+/*   the current position and steps past its CRLF.       */
+/*********************************************************/
+static enum respParseResult ParseRespLine(
+		struct respParser *parser,
+		const char **line,
+		size_t *length)
+{
+	const char *newline;
+
+	newline = (const char *) memchr(parser->current,'\n',(size_t) (parser->end - parser->current));
+	if (newline == NULL)
+	{ return RESP_PARSE_INCOMPLETE; }
+
+	*line = parser->current;
+	*length = (size_t) (newline - parser->current);
+	if ((*length > 0) && ((*line)[*length - 1] == '\r'))
+	{ (*length)--; }
+
+	parser->current = newline + 1;
+	return RESP_PARSE_OK;
+}
+
+/**************************************************/
+/* ParseRespLength: Reads the decimal integer of  */
+/*   a length, count or integer line.             */
+/**************************************************/
+static bool ParseRespLength(
+		const char *line,
+		size_t length,
+		long long *value)
+{
+	size_t i = 0;
+	bool negative = false;
+	long long result = 0;
+
+	if ((length > 0) && ((line[0] == '-') || (line[0] == '+')))
+	{
+		negative = (line[0] == '-');
+		i = 1;
+	}
+
+	if ((i == length) || ((length - i) > 18))
+	{ return false; }
+
+	for ( ; i < length; i++)
+	{
+		if ((line[i] < '0') || (line[i] > '9'))
+		{ return false; }
+		result = (result * 10) + (line[i] - '0');
+	}
+
+	*value = negative ? -result : result;
+	return true;
+}
+
+/*************************************************************/
+/* ParseRespValue: Parses one RESP2 or RESP3 value and adds  */
+/*   it to a multifield builder. Aggregates (arrays, sets,   */
+/*   pushes and maps) are flattened into their elements;     */
+/*   nulls become nil and booleans TRUE or FALSE. Attributes */
+/*   are parsed and dropped.                                 */
+/*************************************************************/
+static enum respParseResult ParseRespValue(
+		struct respParser *parser,
+		MultifieldBuilder *theMB,
+		int depth)
+{
+	Environment *theEnv = parser->theEnv;
+	enum respParseResult rv;
+	const char *line;
+	size_t lineLength;
+	long long count, i;
+	char type;
+	char *numberEnd;
+	MultifieldBuilder *attributes;
+
+	if (depth > RESP_MAX_DEPTH)
+	{ return RESP_PARSE_ERROR; }
+
+	if (parser->current >= parser->end)
+	{ return RESP_PARSE_INCOMPLETE; }
+
+	type = *parser->current++;
+
+	if ((rv = ParseRespLine(parser,&line,&lineLength)) != RESP_PARSE_OK)
+	{ return rv; }
+
+	switch (type)
+	{
+		case '+':
+		case '-':
+		case '(':
+			MBAppendString(theMB,RespScratchCopy(parser,line,lineLength));
+			return RESP_PARSE_OK;
+
+		case ':':
+			if (! ParseRespLength(line,lineLength,&count))
+			{ return RESP_PARSE_ERROR; }
+			MBAppendInteger(theMB,count);
+			return RESP_PARSE_OK;
+
+		case ',':
+			RespScratchCopy(parser,line,lineLength);
+			MBAppendFloat(theMB,strtod(parser->scratch,&numberEnd));
+			return (*numberEnd == '\0') ? RESP_PARSE_OK : RESP_PARSE_ERROR;
+
+		case '#':
+			if ((lineLength != 1) || ((line[0] != 't') && (line[0] != 'f')))
+			{ return RESP_PARSE_ERROR; }
+			MBAppendCLIPSLexeme(theMB,(line[0] == 't') ? TrueSymbol(theEnv) : FalseSymbol(theEnv));
+			return RESP_PARSE_OK;
+
+		case '_':
+			MBAppendSymbol(theMB,"nil");
+			return RESP_PARSE_OK;
+
+		case '$':
+		case '=':
+		case '!':
+			if (! ParseRespLength(line,lineLength,&count) ||
+			    (count < -1) || (count > RESP_MAX_BULK_LENGTH))
+			{ return RESP_PARSE_ERROR; }
+
+			if (count == -1)
+			{
+				MBAppendSymbol(theMB,"nil");
+				return RESP_PARSE_OK;
+			}
+
+			if ((parser->end - parser->current) < (count + 2))
+			{ return RESP_PARSE_INCOMPLETE; }
+
+			line = parser->current;
+			parser->current += count + 2;
+
+			/*=========================================*/
+			/* Verbatim strings start with a three     */
+			/* letter format and a colon, e.g. "txt:". */
+			/*=========================================*/
+			if ((type == '=') && (count >= 4))
+			{
+				line += 4;
+				count -= 4;
+			}
+
+			MBAppendString(theMB,RespScratchCopy(parser,line,(size_t) count));
+			return RESP_PARSE_OK;
+
+		case '*':
+		case '~':
+		case '>':
+		case '%':
+		case '|':
+			if (! ParseRespLength(line,lineLength,&count) ||
+			    (count < -1) || (count > RESP_MAX_ELEMENTS))
+			{ return RESP_PARSE_ERROR; }
+
+			if (count == -1)
+			{
+				MBAppendSymbol(theMB,"nil");
+				return RESP_PARSE_OK;
+			}
+
+			if ((type == '%') || (type == '|'))
+			{ count *= 2; }
+
+			if (type == '|')
+			{
+				attributes = CreateMultifieldBuilder(theEnv,0);
+				for (i = 0; i < count; i++)
+				{
+					if ((rv = ParseRespValue(parser,attributes,depth + 1)) != RESP_PARSE_OK)
+					{ break; }
+				}
+				MBDispose(attributes);
+				if (rv != RESP_PARSE_OK)
+				{ return rv; }
+				return ParseRespValue(parser,theMB,depth);
+			}
+
+			for (i = 0; i < count; i++)
+			{
+				if ((rv = ParseRespValue(parser,theMB,depth + 1)) != RESP_PARSE_OK)
+				{ return rv; }
+			}
+			return RESP_PARSE_OK;
+
+		default:
+			return RESP_PARSE_ERROR;
+	}
+}
+
+/************************************************************/
+/* ParseRespInline: Parses an inline command, a line of     */
+/*   words separated by spaces, as sent by telnet clients.  */
+/************************************************************/
+static enum respParseResult ParseRespInline(
+		struct respParser *parser,
+		MultifieldBuilder *nameMB,
+		MultifieldBuilder *argsMB)
+{
+	enum respParseResult rv;
+	const char *line, *word;
+	size_t lineLength, i;
+	bool first = true;
+
+	if ((rv = ParseRespLine(parser,&line,&lineLength)) != RESP_PARSE_OK)
+	{ return rv; }
+
+	i = 0;
+	while (i < lineLength)
+	{
+		while ((i < lineLength) && ((line[i] == ' ') || (line[i] == '\t')))
+		{ i++; }
+		if (i == lineLength)
+		{ break; }
+
+		word = &line[i];
+		while ((i < lineLength) && (line[i] != ' ') && (line[i] != '\t'))
+		{ i++; }
+
+		MBAppendString(first ? nameMB : argsMB,RespScratchCopy(parser,word,(size_t) (&line[i] - word)));
+		first = false;
+	}
+
+	return RESP_PARSE_OK;
+}
+
+/*************************************************************/
+/* ParseRespCommand: Parses one command, normally an array   */
+/*   of bulk strings, putting its first element in nameMB    */
+/*   and the rest in argsMB.                                 */
+/*************************************************************/
+static enum respParseResult ParseRespCommand(
+		struct respParser *parser,
+		MultifieldBuilder *nameMB,
+		MultifieldBuilder *argsMB)
+{
+	enum respParseResult rv;
+	const char *line;
+	size_t lineLength;
+	long long count, i;
+
+	if (*parser->current != '*')
+	{ return ParseRespInline(parser,nameMB,argsMB); }
+
+	parser->current++;
+	if ((rv = ParseRespLine(parser,&line,&lineLength)) != RESP_PARSE_OK)
+	{ return rv; }
+
+	if (! ParseRespLength(line,lineLength,&count) ||
+	    (count < 0) || (count > RESP_MAX_ELEMENTS))
+	{ return RESP_PARSE_ERROR; }
+
+	for (i = 0; i < count; i++)
+	{
+		if ((rv = ParseRespValue(parser,(i == 0) ? nameMB : argsMB,1)) != RESP_PARSE_OK)
+		{ return rv; }
+	}
+
+	return RESP_PARSE_OK;
+}
+
+/*******************************************************/
+/* RespCommandName: Returns the command name as an     */
+/*   upper case symbol, since commands are not case    */
+/*   sensitive but rules match symbols exactly.        */
+/*******************************************************/
+static CLIPSLexeme *RespCommandName(
+		struct respParser *parser,
+		CLIPSValue *theValue)
+{
+	const char *name;
+	size_t i, length;
+
+	if ((theValue->header->type != STRING_TYPE) && (theValue->header->type != SYMBOL_TYPE))
+	{ return CreateSymbol(parser->theEnv,"nil"); }
+
+	name = theValue->lexemeValue->contents;
+	length = strlen(name);
+	RespScratchCopy(parser,name,length);
+	for (i = 0; i < length; i++)
+	{ parser->scratch[i] = (char) toupper((unsigned char) parser->scratch[i]); }
+
+	return CreateSymbol(parser->theEnv,parser->scratch);
+}
+
+/*************************************************************/
+/* RespReadFunction: H/L access function for resp-read.      */
+/*   Reads what is available on a connection (waiting if it  */
+/*   is blocking and nothing is) and asserts a resp-command  */
+/*   fact for each complete command, numbered by id within   */
+/*   the connection, parsing pipelined commands in one       */
+/*   pass. A trailing partial command is kept for the next   */
+/*   call. Returns the number of commands, or FALSE on a     */
+/*   protocol error or once the peer has closed and no       */
+/*   complete commands remain.                               */
+/*   (resp-read ?socket)                                     */
+/*************************************************************/
+void RespReadFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	struct respParser parser;
+	Deftemplate *theDeftemplate;
+	FactBuilder *theFB;
+	MultifieldBuilder *nameMB, *argsMB;
+	int positions[4];
+	CLIPSValue theValue;
+	const char *commandStart;
+	enum respParseResult rv = RESP_PARSE_OK;
+	long long count = 0;
+	GCBlock gcb;
+	bool eof;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"resp-read: could not find connection\n");
+		return;
+	}
+
+	if (((theDeftemplate = GetRespCommandDeftemplate(theEnv)) == NULL) ||
+	    theDeftemplate->implied ||
+	    ! FindRespCommandSlots(theDeftemplate,positions))
+	{
+		WriteString(theEnv,STDERR,"resp-read: resp-command must be a deftemplate with connection, name and args slots\n");
+		return;
+	}
+
+	if (! ReadSocketAvailable(theEnv,sptr,&eof))
+	{
+		perror("perror");
+		return;
+	}
+
+	parser.theEnv = theEnv;
+	parser.current = sptr->pending;
+	parser.end = sptr->pending + sptr->pendingLength;
+	parser.scratchSize = BUFSIZ;
+	parser.scratch = (char *) gm2(theEnv,parser.scratchSize);
+
+	theFB = CreateFactBuilder(theEnv,RESP_COMMAND_DEFTEMPLATE);
+	nameMB = CreateMultifieldBuilder(theEnv,1);
+	argsMB = CreateMultifieldBuilder(theEnv,8);
+
+	while (parser.current < parser.end)
+	{
+		commandStart = parser.current;
+
+		GCBlockStart(theEnv,&gcb);
+
+		rv = ParseRespCommand(&parser,nameMB,argsMB);
+		if (rv != RESP_PARSE_OK)
+		{
+			MBReset(nameMB);
+			MBReset(argsMB);
+			GCBlockEnd(theEnv,&gcb);
+			parser.current = commandStart;
+			break;
+		}
+
+		/*=========================================*/
+		/* Empty inline lines are not commands.    */
+		/*=========================================*/
+		if (nameMB->length > 0)
+		{
+			if (sptr->logicalName != NULL)
+			{ theValue.lexemeValue = CreateSymbol(theEnv,sptr->logicalName); }
+			else
+			{ theValue.integerValue = CreateInteger(theEnv,SocketRouterFileno(sptr)); }
+			FBPutSlotByPosition(theFB,(unsigned short) positions[0],&theValue);
+
+			theValue.lexemeValue = RespCommandName(&parser,&nameMB->contents[0]);
+			FBPutSlotByPosition(theFB,(unsigned short) positions[1],&theValue);
+
+			theValue.multifieldValue = MBCreate(argsMB);
+			FBPutSlotByPosition(theFB,(unsigned short) positions[2],&theValue);
+
+			sptr->respCommandCount++;
+			if (positions[3] >= 0)
+			{
+				theValue.integerValue = CreateInteger(theEnv,sptr->respCommandCount);
+				FBPutSlotByPosition(theFB,(unsigned short) positions[3],&theValue);
+			}
+
+			if (FBAssert(theFB) != NULL)
+			{ count++; }
+
+			MBReset(nameMB);
+		}
+
+		GCBlockEnd(theEnv,&gcb);
+	}
+
+	MBDispose(nameMB);
+	MBDispose(argsMB);
+	FBDispose(theFB);
+	rm(theEnv,parser.scratch,parser.scratchSize);
+
+	if (rv == RESP_PARSE_ERROR)
+	{
+		WriteString(theEnv,STDERR,"resp-read: protocol error\n");
+		ConsumeSocketPending(theEnv,sptr,sptr->pendingLength);
+		return;
+	}
+
+	ConsumeSocketPending(theEnv,sptr,(size_t) (parser.current - sptr->pending));
+
+	if ((count > 0) || ! eof)
+	{ returnValue->integerValue = CreateInteger(theEnv,count); }
+}
+
+/******************************************************/
+/* GetRespConnection: Gets the stream of a connection */
+/*   argument of a resp-send function.                */
+/******************************************************/
+static FILE *GetRespConnection(
+		Environment *theEnv,
+		UDFContext *context,
+		const char *functionName)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,functionName);
+		WriteString(theEnv,STDERR,": could not find connection\n");
+		return NULL;
+	}
+
+	return sptr->stream;
+}
+
+/********************************************************/
+/* WriteRespLine: Writes a simple string or error line. */
+/*   These may not contain CR or LF.                    */
+/********************************************************/
+static bool WriteRespLine(
+		Environment *theEnv,
+		FILE *stream,
+		char type,
+		const char *text,
+		const char *functionName)
+{
+	if (strpbrk(text,"\r\n") != NULL)
+	{
+		WriteString(theEnv,STDERR,functionName);
+		WriteString(theEnv,STDERR,": text may not contain CR or LF\n");
+		return false;
+	}
+
+	fputc(type,stream);
+	fputs(text,stream);
+	fputs("\r\n",stream);
+	return true;
+}
+
+/********************************************/
+/* WriteRespBulk: Writes a bulk string.     */
+/********************************************/
+static void WriteRespBulk(
+		FILE *stream,
+		const char *text,
+		size_t length)
+{
+	fprintf(stream,"$%zu\r\n",length);
+	fwrite(text,1,length,stream);
+	fputs("\r\n",stream);
+}
+
+/*************************************************************/
+/* WriteRespValue: Writes an array element. Integers are     */
+/*   written as RESP integers and nil as a null bulk string; */
+/*   everything else is written as a bulk string of its text. */
+/*************************************************************/
+static void WriteRespValue(
+		FILE *stream,
+		CLIPSValue *theValue)
+{
+	char buffer[64];
+	int length;
+
+	switch (theValue->header->type)
+	{
+		case INTEGER_TYPE:
+			fprintf(stream,":%lld\r\n",theValue->integerValue->contents);
+			break;
+
+		case FLOAT_TYPE:
+			length = snprintf(buffer,sizeof(buffer),"%.17g",theValue->floatValue->contents);
+			WriteRespBulk(stream,buffer,(size_t) length);
+			break;
+
+		case SYMBOL_TYPE:
+			if (strcmp(theValue->lexemeValue->contents,"nil") == 0)
+			{
+				fputs("$-1\r\n",stream);
+				break;
+			}
+			/* Fall through */
+
+		case STRING_TYPE:
+		case INSTANCE_NAME_TYPE:
+			WriteRespBulk(stream,theValue->lexemeValue->contents,strlen(theValue->lexemeValue->contents));
+			break;
+
+		default:
+			fputs("$-1\r\n",stream);
+			break;
+	}
+}
+
+/*******************************************************/
+/* RespSendSimpleFunction: H/L access function for     */
+/*   resp-send-simple. Writes a simple string reply    */
+/*   such as OK.                                       */
+/*   (resp-send-simple ?socket ?text)                  */
+/*******************************************************/
+void RespSendSimpleFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	FILE *stream;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((stream = GetRespConnection(theEnv,context,"resp-send-simple")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,LEXEME_BITS,&theArg);
+
+	if (WriteRespLine(theEnv,stream,'+',theArg.lexemeValue->contents,"resp-send-simple"))
+	{ returnValue->lexemeValue = TrueSymbol(theEnv); }
+}
+
+/*******************************************************/
+/* RespSendErrorFunction: H/L access function for      */
+/*   resp-send-error. Writes an error reply; by        */
+/*   convention the text starts with a code like ERR.  */
+/*   (resp-send-error ?socket ?text)                   */
+/*******************************************************/
+void RespSendErrorFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	FILE *stream;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((stream = GetRespConnection(theEnv,context,"resp-send-error")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,LEXEME_BITS,&theArg);
+
+	if (WriteRespLine(theEnv,stream,'-',theArg.lexemeValue->contents,"resp-send-error"))
+	{ returnValue->lexemeValue = TrueSymbol(theEnv); }
+}
+
+/*******************************************************/
+/* RespSendIntegerFunction: H/L access function for    */
+/*   resp-send-integer.                                */
+/*   (resp-send-integer ?socket ?integer)              */
+/*******************************************************/
+void RespSendIntegerFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	FILE *stream;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((stream = GetRespConnection(theEnv,context,"resp-send-integer")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,INTEGER_BIT,&theArg);
+
+	fprintf(stream,":%lld\r\n",theArg.integerValue->contents);
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*******************************************************/
+/* RespSendBulkFunction: H/L access function for       */
+/*   resp-send-bulk. Writes a bulk string reply, or a  */
+/*   null reply for nil.                               */
+/*   (resp-send-bulk ?socket ?value)                   */
+/*******************************************************/
+void RespSendBulkFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	CLIPSValue theValue;
+	char buffer[64];
+	int length;
+	FILE *stream;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((stream = GetRespConnection(theEnv,context,"resp-send-bulk")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,LEXEME_BITS|NUMBER_BITS|INSTANCE_NAME_BIT,&theArg);
+
+	/*=============================================*/
+	/* Unlike an array element, an integer sent as */
+	/* a bulk reply is sent as its text.           */
+	/*=============================================*/
+	if (theArg.header->type == INTEGER_TYPE)
+	{
+		length = snprintf(buffer,sizeof(buffer),"%lld",theArg.integerValue->contents);
+		WriteRespBulk(stream,buffer,(size_t) length);
+	}
+	else
+	{
+		theValue.value = theArg.value;
+		WriteRespValue(stream,&theValue);
+	}
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*******************************************************/
+/* RespSendArrayFunction: H/L access function for      */
+/*   resp-send-array. Writes an array reply of all the */
+/*   remaining arguments, with multifields expanded.   */
+/*   (resp-send-array ?socket $?values)                */
+/*******************************************************/
+void RespSendArrayFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	MultifieldBuilder *theMB;
+	FILE *stream;
+	size_t i;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((stream = GetRespConnection(theEnv,context,"resp-send-array")) == NULL)
+	{ return; }
+
+	theMB = CreateMultifieldBuilder(theEnv,8);
+	while (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,ANY_TYPE_BITS,&theArg);
+		MBAppendUDFValue(theMB,&theArg);
+	}
+
+	fprintf(stream,"*%zu\r\n",theMB->length);
+	for (i = 0; i < theMB->length; i++)
+	{ WriteRespValue(stream,&theMB->contents[i]); }
+
+	MBDispose(theMB);
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
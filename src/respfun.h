@@ -0,0 +1,60 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*                RESP FUNCTIONS HEADER                */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: Redis serialization protocol (RESP2/RESP3)       */
+/*   command parsing and reply writing for socket            */
+/*   connections.                                            */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_respfun
+
+#pragma once
+
+#define _H_respfun
+
+#include <stddef.h>
+
+#define RESP_COMMAND_DEFTEMPLATE "resp-command"
+#define RESP_MAX_BULK_LENGTH (512L * 1024L * 1024L)
+#define RESP_MAX_ELEMENTS (1024L * 1024L)
+#define RESP_MAX_DEPTH 32
+
+enum respParseResult
+  {
+   RESP_PARSE_OK,
+   RESP_PARSE_INCOMPLETE,
+   RESP_PARSE_ERROR
+  };
+
+struct respParser
+  {
+   Environment *theEnv;
+   const char *current;
+   const char *end;
+   char *scratch;
+   size_t scratchSize;
+  };
+
+   void                           RespFunctionDefinitions(Environment *);
+   void                           RespReadFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RespSendSimpleFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RespSendErrorFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RespSendIntegerFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RespSendBulkFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RespSendArrayFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_respfun */
@@ -61,14 +61,29 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added range indexes to alpha memories.         */
+/*                                                           */
+/*            Added support for the accumulate CE.           */
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
+/*            Join keys are hashed by value and mixed.       */
+/*                                                           */
+/*            Beta memories shrink as well as grow.          */
+/*                                                           */
+/*            Partial matches can be unlinked from and       */
+/*            relinked to their memories.                    */
+/*                                                           */
 /*************************************************************/
 
+#include <math.h>
 #include <stdio.h>
 
 #include "setup.h"
 
 #if DEFRULE_CONSTRUCT
 
+#include "aggregat.h"
 #include "drive.h"
 #include "engine.h"
 #include "envrnmnt.h"
@@ -84,6 +99,12 @@
 
 #include "reteutil.h"
 
+/***************************************/
+/* LOCAL INTERNAL CONSTANT DEFINITIONS */
+/***************************************/
+
+#define RangeIndexNodeSize(level) (sizeof(struct rangeIndexNode *) * (((level) > 1) ? ((level) - 1) : 0))
+
 /***************************************/
 /* LOCAL INTERNAL FUNCTION DEFINITIONS */
 /***************************************/
@@ -93,10 +114,14 @@
    static unsigned long               AlphaMemoryHashValue(struct patternNodeHeader *,unsigned long);
    static void                        UnlinkAlphaMemory(Environment *,struct patternNodeHeader *,struct alphaMemoryHash *);
    static void                        UnlinkAlphaMemoryBucketSiblings(Environment *,struct alphaMemoryHash *);
+   static bool                        RangeIndexKey(UDFValue *,double *);
+   static void                        AddRangeIndexMatch(Environment *,struct alphaMemoryHash *,struct expr *,struct partialMatch *);
+   static void                        RemoveRangeIndexMatch(Environment *,struct alphaMemoryHash *,struct alphaMatch *);
+   static void                        DestroyRangeIndex(Environment *,struct alphaMemoryHash *);
    static void                        InitializePMLinks(struct partialMatch *);
-   static void                        UnlinkBetaPartialMatchfromAlphaAndBetaLineage(struct partialMatch *);
+   static void                        UnlinkBetaPartialMatchfromAlphaAndBetaLineage(Environment *,struct partialMatch *);
    static int                         CountPriorPatterns(struct joinNode *);
-   static void                        ResizeBetaMemory(Environment *,struct betaMemory *);
+   static void                        ResizeBetaMemory(Environment *,struct betaMemory *,unsigned long);
    static void                        ResetBetaMemory(Environment *,struct betaMemory *);
 #if (CONSTRUCT_COMPILER || BLOAD_AND_BSAVE) && (! RUN_TIME)
    static void                        TagNetworkTraverseJoins(Environment *,unsigned long *,unsigned long *,struct joinNode *);
@@ -149,6 +174,7 @@ struct partialMatch *CopyPartialMatch(
    linker->rhsMemory = false;
    linker->deleting = false;
    linker->goalMarker = false;
+   linker->aggregateMarker = false;
    linker->bcount = list->bcount;
    linker->hashValue = 0;
 
@@ -173,6 +199,7 @@ struct partialMatch *CreateEmptyPartialMatch(
    linker->rhsMemory = false;
    linker->deleting = false;
    linker->goalMarker = false;
+   linker->aggregateMarker = false;
    linker->bcount = 1;
    linker->hashValue = 0;
    linker->binds[0].gm.theValue = NULL;
@@ -214,7 +241,55 @@ void UpdateBetaPMLinks(
   unsigned long hashValue,
   int side)
   {
-   unsigned long betaLocation;
+   thePM->hashValue = hashValue;
+
+   /*======================================*/
+   /* Update the alpha memory linked list. */
+   /*======================================*/
+
+   if (rhsBinds != NULL)
+     {
+      thePM->nextRightChild = rhsBinds->children;
+      if (rhsBinds->children != NULL)
+        { rhsBinds->children->prevRightChild = thePM; }
+      rhsBinds->children = thePM;
+      thePM->rightParent = rhsBinds;
+    }
+
+   /*=====================================*/
+   /* Update the beta memory linked list. */
+   /*=====================================*/
+
+   if (lhsBinds != NULL)
+     {
+      thePM->nextLeftChild = lhsBinds->children;
+      if (lhsBinds->children != NULL)
+        { lhsBinds->children->prevLeftChild = thePM; }
+      lhsBinds->children = thePM;
+      thePM->leftParent = lhsBinds;
+     }
+
+   /*================================*/
+   /* Update the node's linked list. */
+   /*================================*/
+
+   LinkBetaPMToNode(theEnv,thePM,join,side);
+  }
+
+/*************************************************************/
+/* LinkBetaPMToNode: Adds a partial match to the left or     */
+/*   right beta memory of a join using the match's hash      */
+/*   value. The match is placed where a new match is placed: */
+/*   at the front of its bucket in a left memory and at the  */
+/*   end of its bucket in a right memory.                    */
+/*************************************************************/
+void LinkBetaPMToNode(
+  Environment *theEnv,
+  struct partialMatch *thePM,
+  struct joinNode *join,
+  int side)
+  {
+   unsigned long betaLocation, newSize;
    struct betaMemory *theMemory;
 
    if (side == LHS)
@@ -228,13 +303,7 @@ void UpdateBetaPMLinks(
       thePM->rhsMemory = true;
      }
 
-   thePM->hashValue = hashValue;
-
-   /*================================*/
-   /* Update the node's linked list. */
-   /*================================*/
-
-   betaLocation = hashValue % theMemory->size;
+   betaLocation = thePM->hashValue % theMemory->size;
 
    if (side == LHS)
      {
@@ -265,40 +334,86 @@ void UpdateBetaPMLinks(
     { join->memoryRightAdds++; }
 #endif
 
+#if PROFILING_FUNCTIONS
+   if (side == LHS)
+     {
+      if (theMemory->count > join->leftMemoryPeak)
+        { join->leftMemoryPeak = theMemory->count; }
+     }
+   else
+     {
+      if (theMemory->count > join->rightMemoryPeak)
+        { join->rightMemoryPeak = theMemory->count; }
+     }
+#endif
+
    thePM->owner = join;
 
-   /*======================================*/
-   /* Update the alpha memory linked list. */
-   /*======================================*/
+   if (! DefruleData(theEnv)->BetaMemoryResizingFlag)
+     { return; }
 
-   if (rhsBinds != NULL)
-     {
-      thePM->nextRightChild = rhsBinds->children;
-      if (rhsBinds->children != NULL)
-        { rhsBinds->children->prevRightChild = thePM; }
-      rhsBinds->children = thePM;
-      thePM->rightParent = rhsBinds;
-    }
+   /*=========================================================*/
+   /* Keep the load factor of a hashed memory in bounds. The  */
+   /* memory is shrunk here rather than as partial matches    */
+   /* are removed because callers removing a series of        */
+   /* partial matches rely on the remaining ones staying in   */
+   /* the buckets being traversed. An emptied memory is reset */
+   /* to its initial size when its last match is removed.     */
+   /*=========================================================*/
 
-   /*=====================================*/
-   /* Update the beta memory linked list. */
-   /*=====================================*/
+   if (theMemory->size == 1)
+     { return; }
 
-   if (lhsBinds != NULL)
+   if (theMemory->count > (theMemory->size * BETA_HASH_MAXIMUM_LOAD))
+     { ResizeBetaMemory(theEnv,theMemory,(theMemory->size * BETA_HASH_GROWTH) + 1); }
+   else if ((theMemory->size > INITIAL_BETA_HASH_SIZE) &&
+            ((theMemory->count * BETA_HASH_MINIMUM_LOAD) < theMemory->size))
      {
-      thePM->nextLeftChild = lhsBinds->children;
-      if (lhsBinds->children != NULL)
-        { lhsBinds->children->prevLeftChild = thePM; }
-      lhsBinds->children = thePM;
-      thePM->leftParent = lhsBinds;
+      newSize = theMemory->size;
+      while ((theMemory->count * BETA_HASH_MINIMUM_LOAD) < newSize)
+        { newSize = newSize / BETA_HASH_GROWTH; }
+
+      if (newSize < INITIAL_BETA_HASH_SIZE)
+        { newSize = INITIAL_BETA_HASH_SIZE; }
+      ResizeBetaMemory(theEnv,theMemory,newSize);
      }
+  }
 
-   if (! DefruleData(theEnv)->BetaMemoryResizingFlag)
-     { return; }
+/***********************************************************/
+/* MoveBetaPMToFrontOfLineage: Moves a partial match to    */
+/*   the front of the lists of children of its parents, as */
+/*   if it had just been created by UpdateBetaPMLinks.     */
+/***********************************************************/
+void MoveBetaPMToFrontOfLineage(
+  struct partialMatch *thePM)
+  {
+   struct partialMatch *theParent;
+
+   theParent = thePM->rightParent;
+   if ((theParent != NULL) && (theParent->children != thePM))
+     {
+      thePM->prevRightChild->nextRightChild = thePM->nextRightChild;
+      if (thePM->nextRightChild != NULL)
+        { thePM->nextRightChild->prevRightChild = thePM->prevRightChild; }
+
+      thePM->prevRightChild = NULL;
+      thePM->nextRightChild = theParent->children;
+      theParent->children->prevRightChild = thePM;
+      theParent->children = thePM;
+     }
 
-   if ((theMemory->size > 1) &&
-       (theMemory->count > (theMemory->size * 11)))
-     { ResizeBetaMemory(theEnv,theMemory); }
+   theParent = thePM->leftParent;
+   if ((theParent != NULL) && (theParent->children != thePM))
+     {
+      thePM->prevLeftChild->nextLeftChild = thePM->nextLeftChild;
+      if (thePM->nextLeftChild != NULL)
+        { thePM->nextLeftChild->prevLeftChild = thePM->prevLeftChild; }
+
+      thePM->prevLeftChild = NULL;
+      thePM->nextLeftChild = theParent->children;
+      theParent->children->prevLeftChild = thePM;
+      theParent->children = thePM;
+     }
   }
 
 /**********************************************************/
@@ -351,6 +466,21 @@ void RemoveBlockedLink(
 /* UnlinkBetaPMFromNodeAndLineage: */
 /***********************************/
 void UnlinkBetaPMFromNodeAndLineage(
+  Environment *theEnv,
+  struct joinNode *join,
+  struct partialMatch *thePM,
+  int side)
+  {
+   UnlinkBetaPMFromNode(theEnv,join,thePM,side);
+   UnlinkBetaPartialMatchfromAlphaAndBetaLineage(theEnv,thePM);
+  }
+
+/**********************************************************/
+/* UnlinkBetaPMFromNode: Removes a partial match from the */
+/*   left or right beta memory of a join. The links to    */
+/*   the parents and children of the match are unchanged. */
+/**********************************************************/
+void UnlinkBetaPMFromNode(
   Environment *theEnv,
   struct joinNode *join,
   struct partialMatch *thePM,
@@ -397,8 +527,6 @@ void UnlinkBetaPMFromNodeAndLineage(
    thePM->nextInMemory = NULL;
    thePM->prevInMemory = NULL;
 
-   UnlinkBetaPartialMatchfromAlphaAndBetaLineage(thePM);
-
    if (! DefruleData(theEnv)->BetaMemoryResizingFlag)
      { return; }
 
@@ -476,22 +604,29 @@ void UnlinkNonLeftLineage(
    if (thePM->nextRightChild != NULL)
      { thePM->nextRightChild->prevRightChild = thePM->prevRightChild; }
 
-   /*===========================*/
-   /* Update the blocked lists. */
-   /*===========================*/
+   /*==================================================*/
+   /* Update the blocked lists. The marker of a        */
+   /* partial match in the left memory of an aggregate */
+   /* join holds its group rather than a blocker.      */
+   /*==================================================*/
 
-   if (thePM->prevBlocked == NULL)
+   if (thePM->aggregateMarker)
+     { ReleaseAggregateGroup(theEnv,thePM); }
+   else
      {
-      tempPM = (struct partialMatch *) thePM->marker;
+      if (thePM->prevBlocked == NULL)
+        {
+         tempPM = (struct partialMatch *) thePM->marker;
 
-      if ((tempPM != NULL) && (! thePM->goalMarker))
-        { tempPM->blockList = thePM->nextBlocked; }
-     }
-   else
-     { thePM->prevBlocked->nextBlocked = thePM->nextBlocked; }
+         if ((tempPM != NULL) && (! thePM->goalMarker))
+           { tempPM->blockList = thePM->nextBlocked; }
+        }
+      else
+        { thePM->prevBlocked->nextBlocked = thePM->nextBlocked; }
 
-   if (thePM->nextBlocked != NULL)
-     { thePM->nextBlocked->prevBlocked = thePM->prevBlocked; }
+      if (thePM->nextBlocked != NULL)
+        { thePM->nextBlocked->prevBlocked = thePM->prevBlocked; }
+     }
 
    if (! DefruleData(theEnv)->BetaMemoryResizingFlag)
      { return; }
@@ -508,6 +643,7 @@ void UnlinkNonLeftLineage(
 /*   partial match and any of its children in other beta memories. */
 /*******************************************************************/
 static void UnlinkBetaPartialMatchfromAlphaAndBetaLineage(
+  Environment *theEnv,
   struct partialMatch *thePM)
   {
    struct partialMatch *tempPM;
@@ -554,7 +690,9 @@ static void UnlinkBetaPartialMatchfromAlphaAndBetaLineage(
    /* Update the blocked lists. */
    /*===========================*/
 
-   if (thePM->prevBlocked == NULL)
+   if (thePM->aggregateMarker)
+     { ReleaseAggregateGroup(theEnv,thePM); }
+   else if (thePM->prevBlocked == NULL)
      {
       tempPM = (struct partialMatch *) thePM->marker;
 
@@ -654,6 +792,9 @@ void InitializePatternHeader(
    theHeader->lastHash = NULL;
    theHeader->entryJoin = NULL;
    theHeader->rightHash = NULL;
+   theHeader->rightRange = NULL;
+   theHeader->alphaCount = 0;
+   theHeader->alphaPeak = 0;
    theHeader->singlefieldNode = false;
    theHeader->multifieldNode = false;
    theHeader->stopNode = false;
@@ -685,8 +826,6 @@ struct partialMatch *CreateAlphaMatch(
   {
    struct partialMatch *theMatch;
    struct alphaMatch *afbtemp;
-   unsigned long hashValue;
-   struct alphaMemoryHash *theAlphaMemory;
 
    /*==================================================*/
    /* Create the alpha match and intialize its values. */
@@ -699,11 +838,13 @@ struct partialMatch *CreateAlphaMatch(
    theMatch->rhsMemory = false;
    theMatch->deleting = false;
    theMatch->goalMarker = false;
+   theMatch->aggregateMarker = false;
    theMatch->bcount = 1;
    theMatch->hashValue = hashOffset;
 
    afbtemp = get_struct(theEnv,alphaMatch);
    afbtemp->next = NULL;
+   afbtemp->rangeNode = NULL;
    afbtemp->matchingItem = (struct patternEntity *) theEntity;
 
    if (markers != NULL)
@@ -713,13 +854,41 @@ struct partialMatch *CreateAlphaMatch(
 
    theMatch->binds[0].gm.theMatch = afbtemp;
 
+   /*====================================*/
+   /* Store the alpha match in the alpha */
+   /* memory of the pattern node.        */
+   /*====================================*/
+
+   LinkAlphaMatch(theEnv,theHeader,theMatch);
+
+   /*===================================================*/
+   /* Return a pointer to the newly create alpha match. */
+   /*===================================================*/
+
+   return(theMatch);
+  }
+
+/***********************************************************/
+/* LinkAlphaMatch: Adds an alpha match to the end of the   */
+/*   alpha memory of a pattern node (and its range index)  */
+/*   using the hash value of the match. The alpha memory   */
+/*   for the hash value is created if it doesn't exist.    */
+/***********************************************************/
+void LinkAlphaMatch(
+  Environment *theEnv,
+  struct patternNodeHeader *theHeader,
+  struct partialMatch *theMatch)
+  {
+   unsigned long hashValue;
+   struct alphaMemoryHash *theAlphaMemory;
+
    /*============================================*/
    /* Find the alpha memory of the pattern node. */
    /*============================================*/
 
-   hashValue = AlphaMemoryHashValue(theHeader,hashOffset);
+   hashValue = AlphaMemoryHashValue(theHeader,theMatch->hashValue);
    theAlphaMemory = FindAlphaMemory(theEnv,theHeader,hashValue);
-   afbtemp->bucket = hashValue;
+   theMatch->binds[0].gm.theMatch->bucket = hashValue;
 
    /*============================================*/
    /* Create an alpha memory if it wasn't found. */
@@ -733,6 +902,7 @@ struct partialMatch *CreateAlphaMatch(
       theAlphaMemory->alphaMemory = NULL;
       theAlphaMemory->endOfQueue = NULL;
       theAlphaMemory->nextHash = NULL;
+      theAlphaMemory->rangeIndex = NULL;
 
       theAlphaMemory->next = DefruleData(theEnv)->AlphaMemoryTable[hashValue];
       if (theAlphaMemory->next != NULL)
@@ -760,8 +930,9 @@ struct partialMatch *CreateAlphaMatch(
    /* memory of the pattern node.        */
    /*====================================*/
 
-    theMatch->prevInMemory = theAlphaMemory->endOfQueue;
-    if (theAlphaMemory->endOfQueue == NULL)
+   theMatch->nextInMemory = NULL;
+   theMatch->prevInMemory = theAlphaMemory->endOfQueue;
+   if (theAlphaMemory->endOfQueue == NULL)
      {
       theAlphaMemory->alphaMemory = theMatch;
       theAlphaMemory->endOfQueue = theMatch;
@@ -772,11 +943,17 @@ struct partialMatch *CreateAlphaMatch(
       theAlphaMemory->endOfQueue = theMatch;
      }
 
-   /*===================================================*/
-   /* Return a pointer to the newly create alpha match. */
-   /*===================================================*/
+   theHeader->alphaCount++;
+   if (theHeader->alphaCount > theHeader->alphaPeak)
+     { theHeader->alphaPeak = theHeader->alphaCount; }
 
-   return(theMatch);
+   /*=========================================*/
+   /* If the pattern has a range expression,  */
+   /* then add the match to the range index.  */
+   /*=========================================*/
+
+   if (theHeader->rightRange != NULL)
+     { AddRangeIndexMatch(theEnv,theAlphaMemory,theHeader->rightRange,theMatch); }
   }
 
 /*******************************************/
@@ -827,7 +1004,7 @@ void FlushAlphaBetaMemory(
      {
       pfltemp = pfl->nextInMemory;
 
-      UnlinkBetaPartialMatchfromAlphaAndBetaLineage(pfl);
+      UnlinkBetaPartialMatchfromAlphaAndBetaLineage(theEnv,pfl);
       ReturnPartialMatch(theEnv,pfl);
 
       pfl = pfltemp;
@@ -1229,15 +1406,45 @@ void RemoveAlphaMemoryMatches(
   struct partialMatch *theMatch,
   struct alphaMatch *theAlphaMatch)
   {
+#if MAC_XCD
+#pragma unused(theAlphaMatch)
+#endif
+
+   UnlinkAlphaMatch(theEnv,theHeader,theMatch);
+
+   /*====================================*/
+   /* Add the match to the garbage list. */
+   /*====================================*/
+
+   theMatch->nextInMemory = EngineData(theEnv)->GarbagePartialMatches;
+   EngineData(theEnv)->GarbagePartialMatches = theMatch;
+  }
+
+/**********************************************************/
+/* UnlinkAlphaMatch: Removes an alpha match from the      */
+/*   alpha memory of a pattern node (and its range index) */
+/*   without deleting it. The alpha memory for the hash   */
+/*   value of the match is deleted if it becomes empty.   */
+/**********************************************************/
+void UnlinkAlphaMatch(
+  Environment *theEnv,
+  struct patternNodeHeader *theHeader,
+  struct partialMatch *theMatch)
+  {
    struct alphaMemoryHash *theAlphaMemory = NULL;
+   struct alphaMatch *theAlphaMatch = theMatch->binds[0].gm.theMatch;
    unsigned long hashValue;
 
-   if ((theMatch->prevInMemory == NULL) || (theMatch->nextInMemory == NULL))
+   if ((theMatch->prevInMemory == NULL) || (theMatch->nextInMemory == NULL) ||
+       (theAlphaMatch->rangeNode != NULL))
      {
       hashValue = theAlphaMatch->bucket;
       theAlphaMemory = FindAlphaMemory(theEnv,theHeader,hashValue);
      }
 
+   if (theAlphaMatch->rangeNode != NULL)
+     { RemoveRangeIndexMatch(theEnv,theAlphaMemory,theAlphaMatch); }
+
    if (theMatch->prevInMemory != NULL)
      { theMatch->prevInMemory->nextInMemory = theMatch->nextInMemory; }
    else
@@ -1248,12 +1455,10 @@ void RemoveAlphaMemoryMatches(
    else
      { theAlphaMemory->endOfQueue = theMatch->prevInMemory; }
 
-   /*====================================*/
-   /* Add the match to the garbage list. */
-   /*====================================*/
+   theMatch->nextInMemory = NULL;
+   theMatch->prevInMemory = NULL;
 
-   theMatch->nextInMemory = EngineData(theEnv)->GarbagePartialMatches;
-   EngineData(theEnv)->GarbagePartialMatches = theMatch;
+   theHeader->alphaCount--;
 
    if ((theAlphaMemory != NULL) && (theAlphaMemory->alphaMemory == NULL))
      { UnlinkAlphaMemory(theEnv,theHeader,theAlphaMemory); }
@@ -1277,12 +1482,14 @@ void DestroyAlphaMemory(
       DestroyAlphaBetaMemory(theEnv,theAlphaMemory->alphaMemory);
       if (unlink)
         { UnlinkAlphaMemoryBucketSiblings(theEnv,theAlphaMemory); }
+      DestroyRangeIndex(theEnv,theAlphaMemory);
       rtn_struct(theEnv,alphaMemoryHash,theAlphaMemory);
       theAlphaMemory = tempMemory;
      }
 
    theHeader->firstHash = NULL;
    theHeader->lastHash = NULL;
+   theHeader->alphaCount = 0;
   }
 
 /*********************/
@@ -1301,12 +1508,14 @@ void FlushAlphaMemory(
       tempMemory = theAlphaMemory->nextHash;
       FlushAlphaBetaMemory(theEnv,theAlphaMemory->alphaMemory);
       UnlinkAlphaMemoryBucketSiblings(theEnv,theAlphaMemory);
+      DestroyRangeIndex(theEnv,theAlphaMemory);
       rtn_struct(theEnv,alphaMemoryHash,theAlphaMemory);
       theAlphaMemory = tempMemory;
      }
 
    theHeader->firstHash = NULL;
    theHeader->lastHash = NULL;
+   theHeader->alphaCount = 0;
   }
 
 /********************/
@@ -1387,6 +1596,7 @@ static void UnlinkAlphaMemory(
    if (theAlphaMemory->nextHash != NULL)
      { theAlphaMemory->nextHash->prevHash = theAlphaMemory->prevHash; }
 
+   DestroyRangeIndex(theEnv,theAlphaMemory);
    rtn_struct(theEnv,alphaMemoryHash,theAlphaMemory);
   }
 
@@ -1406,6 +1616,404 @@ static void UnlinkAlphaMemoryBucketSiblings(
      { theAlphaMemory->next->prev = theAlphaMemory->prev; }
   }
 
+/****************************************************************/
+/* GetJoinAlphaMemory: Retrieves the first match from the alpha */
+/*   memory on the right side of a join that may be consistent  */
+/*   with a partial match entering from the left. If the join   */
+/*   has a range expression, the value of the expression for    */
+/*   the partial match is used to skip the matches in the range */
+/*   index which can't satisfy the comparison. The cursor must  */
+/*   be passed to NextJoinAlphaMatch to retrieve the remaining  */
+/*   matches.                                                   */
+/****************************************************************/
+struct partialMatch *GetJoinAlphaMemory(
+  Environment *theEnv,
+  struct joinNode *theJoin,
+  struct partialMatch *lhsBinds,
+  unsigned long hashOffset,
+  struct rangeIndexCursor *theCursor)
+  {
+   struct patternNodeHeader *theHeader;
+   struct alphaMemoryHash *theAlphaMemory;
+   struct rangeIndex *theIndex;
+   struct rangeIndexNode *theNode;
+   struct partialMatch *oldLHSBinds, *oldRHSBinds;
+   struct joinNode *oldJoin;
+   UDFValue theResult;
+   double theKey;
+   bool validKey;
+   int i;
+
+   theCursor->indexed = false;
+
+   theHeader = (struct patternNodeHeader *) theJoin->rightSideEntryStructure;
+   theAlphaMemory = FindAlphaMemory(theEnv,theHeader,AlphaMemoryHashValue(theHeader,hashOffset));
+
+   if (theAlphaMemory == NULL)
+     { return NULL; }
+
+   if ((theJoin->leftRange == NULL) || (theAlphaMemory->rangeIndex == NULL))
+     { return theAlphaMemory->alphaMemory; }
+
+   /*========================================================*/
+   /* Determine the value being compared from the left side. */
+   /* If it isn't a number, then all of the matches have to  */
+   /* be checked.                                            */
+   /*========================================================*/
+
+   oldLHSBinds = EngineData(theEnv)->GlobalLHSBinds;
+   oldRHSBinds = EngineData(theEnv)->GlobalRHSBinds;
+   oldJoin = EngineData(theEnv)->GlobalJoin;
+   EngineData(theEnv)->GlobalLHSBinds = lhsBinds;
+   EngineData(theEnv)->GlobalRHSBinds = NULL;
+   EngineData(theEnv)->GlobalJoin = theJoin;
+
+   EvaluateExpression(theEnv,theJoin->leftRange,&theResult);
+   if (EvaluationData(theEnv)->EvaluationError)
+     {
+      SetEvaluationError(theEnv,false);
+      validKey = false;
+     }
+   else
+     { validKey = RangeIndexKey(&theResult,&theKey); }
+
+   EngineData(theEnv)->GlobalLHSBinds = oldLHSBinds;
+   EngineData(theEnv)->GlobalRHSBinds = oldRHSBinds;
+   EngineData(theEnv)->GlobalJoin = oldJoin;
+
+   if (! validKey)
+     { return theAlphaMemory->alphaMemory; }
+
+   /*=========================================================*/
+   /* Find the ordered match with the key closest to the left */
+   /* value that can satisfy the comparison. The matches are  */
+   /* then searched moving away from the left value, so that  */
+   /* the blocking match found is the nearest one and not the */
+   /* smallest or largest in the memory (which is often the   */
+   /* next one to be retracted). The bound is inclusive so    */
+   /* the range doesn't depend upon the strictness of the     */
+   /* comparison or rounding when integers become floats.     */
+   /*=========================================================*/
+
+   theIndex = theAlphaMemory->rangeIndex;
+   theCursor->indexed = true;
+   theCursor->atMost = theJoin->rangeAtMost;
+
+   theNode = theIndex->head;
+   for (i = theIndex->level - 1; i >= 0; i--)
+     {
+      if (theCursor->atMost)
+        {
+         while ((theNode->next[i] != NULL) && (theNode->next[i]->key <= theKey))
+           { theNode = theNode->next[i]; }
+        }
+      else
+        {
+         while ((theNode->next[i] != NULL) && (theNode->next[i]->key < theKey))
+           { theNode = theNode->next[i]; }
+        }
+     }
+
+   if (! theCursor->atMost)
+     { theNode = theNode->next[0]; }
+   else if (theNode == theIndex->head)
+     { theNode = NULL; }
+
+   theCursor->firstOrdered = theNode;
+
+   /*==================================================*/
+   /* The matches without a numeric value are returned */
+   /* before the matches from the ordered list.        */
+   /*==================================================*/
+
+   if (theIndex->unordered != NULL)
+     { theCursor->current = theIndex->unordered; }
+   else
+     { theCursor->current = theCursor->firstOrdered; }
+
+   if (theCursor->current == NULL)
+     { return NULL; }
+
+   return theCursor->current->theMatch;
+  }
+
+/*************************************************************/
+/* NextRangeMatch: Retrieves the next match from a range     */
+/*   index cursor created by GetJoinAlphaMemory. Callers use */
+/*   the nextInMemory link instead when the cursor indicates */
+/*   that the alpha memory isn't being searched by range.    */
+/*************************************************************/
+struct partialMatch *NextRangeMatch(
+  struct rangeIndexCursor *theCursor)
+  {
+   struct rangeIndexNode *theNode = theCursor->current;
+
+   if (theNode == NULL)
+     { return NULL; }
+
+   if (theNode->level == 0)
+     {
+      theNode = theNode->next[0];
+      if (theNode == NULL)
+        { theNode = theCursor->firstOrdered; }
+     }
+   else if (theCursor->atMost)
+     { theNode = theNode->prev; }
+   else
+     { theNode = theNode->next[0]; }
+
+   theCursor->current = theNode;
+
+   if (theNode == NULL)
+     { return NULL; }
+
+   return theNode->theMatch;
+  }
+
+/*****************************************************/
+/* RangeIndexKey: Converts the value of a range      */
+/*   expression to the key used for ordering matches */
+/*   in a range index. Returns false if the value    */
+/*   isn't a number that can be ordered.             */
+/*****************************************************/
+static bool RangeIndexKey(
+  UDFValue *theValue,
+  double *theKey)
+  {
+   switch (theValue->header->type)
+     {
+      case INTEGER_TYPE:
+        *theKey = (double) theValue->integerValue->contents;
+        return true;
+
+      case FLOAT_TYPE:
+        *theKey = theValue->floatValue->contents;
+        return ! isnan(*theKey);
+     }
+
+   return false;
+  }
+
+/*************************************************************/
+/* AddRangeIndexMatch: Adds an alpha match to the range      */
+/*   index of an alpha memory, creating the index if needed. */
+/*   Matches with equal keys are kept in the order in which  */
+/*   they were added.                                        */
+/*************************************************************/
+static void AddRangeIndexMatch(
+  Environment *theEnv,
+  struct alphaMemoryHash *theAlphaMemory,
+  struct expr *rightRange,
+  struct partialMatch *theMatch)
+  {
+   struct rangeIndex *theIndex;
+   struct rangeIndexNode *theNode, *update[RANGE_INDEX_MAX_LEVEL];
+   struct expr *oldArgument;
+   UDFValue theResult;
+   unsigned long randomBits;
+   unsigned short level;
+   double theKey;
+   int i;
+
+   /*================================*/
+   /* Create the index if necessary. */
+   /*================================*/
+
+   theIndex = theAlphaMemory->rangeIndex;
+   if (theIndex == NULL)
+     {
+      theIndex = get_struct(theEnv,rangeIndex);
+      theIndex->level = 1;
+      theIndex->seed = 2463534242UL;
+      theIndex->nextSequence = 0;
+      theIndex->unordered = NULL;
+      theIndex->lastUnordered = NULL;
+      theIndex->head = get_var_struct(theEnv,rangeIndexNode,RangeIndexNodeSize(RANGE_INDEX_MAX_LEVEL));
+      theIndex->head->level = RANGE_INDEX_MAX_LEVEL;
+      theIndex->head->theMatch = NULL;
+      theIndex->head->prev = NULL;
+      for (i = 0; i < RANGE_INDEX_MAX_LEVEL; i++)
+        { theIndex->head->next[i] = NULL; }
+      theAlphaMemory->rangeIndex = theIndex;
+     }
+
+   /*================================================*/
+   /* Evaluate the range expression for the match.   */
+   /* The pattern matching context is still in place */
+   /* from the computation of the right hash value.  */
+   /*================================================*/
+
+   oldArgument = EvaluationData(theEnv)->CurrentExpression;
+   EvaluationData(theEnv)->CurrentExpression = rightRange;
+   (*EvaluationData(theEnv)->PrimitivesArray[rightRange->type]->evaluateFunction)(theEnv,rightRange->value,&theResult);
+   EvaluationData(theEnv)->CurrentExpression = oldArgument;
+
+   /*=========================================*/
+   /* Matches without a numeric key are added */
+   /* to the end of the unordered list.       */
+   /*=========================================*/
+
+   if (! RangeIndexKey(&theResult,&theKey))
+     {
+      theNode = get_var_struct(theEnv,rangeIndexNode,RangeIndexNodeSize(0));
+      theNode->key = 0.0;
+      theNode->sequence = theIndex->nextSequence++;
+      theNode->theMatch = theMatch;
+      theNode->level = 0;
+      theNode->next[0] = NULL;
+      theNode->prev = theIndex->lastUnordered;
+      if (theIndex->lastUnordered == NULL)
+        { theIndex->unordered = theNode; }
+      else
+        { theIndex->lastUnordered->next[0] = theNode; }
+      theIndex->lastUnordered = theNode;
+      theMatch->binds[0].gm.theMatch->rangeNode = theNode;
+      return;
+     }
+
+   /*========================================================*/
+   /* Choose the level of the new node. Each level is one    */
+   /* fourth as likely as the level below it. A fixed seed   */
+   /* keeps the layout of the index reproducible from run to */
+   /* run.                                                   */
+   /*========================================================*/
+
+   theIndex->seed ^= (theIndex->seed << 13) & 0xFFFFFFFFUL;
+   theIndex->seed ^= theIndex->seed >> 17;
+   theIndex->seed ^= (theIndex->seed << 5) & 0xFFFFFFFFUL;
+
+   randomBits = theIndex->seed;
+   for (level = 1;
+        ((randomBits & 3) == 0) && (level < RANGE_INDEX_MAX_LEVEL);
+        level++)
+     { randomBits >>= 2; }
+
+   /*==============================================*/
+   /* Find the nodes after which the new node is   */
+   /* placed. New nodes follow nodes of equal key. */
+   /*==============================================*/
+
+   theNode = theIndex->head;
+   for (i = theIndex->level - 1; i >= 0; i--)
+     {
+      while ((theNode->next[i] != NULL) && (theNode->next[i]->key <= theKey))
+        { theNode = theNode->next[i]; }
+      update[i] = theNode;
+     }
+
+   for (i = theIndex->level; i < level; i++)
+     { update[i] = theIndex->head; }
+
+   if (level > theIndex->level)
+     { theIndex->level = level; }
+
+   /*=======================*/
+   /* Link in the new node. */
+   /*=======================*/
+
+   theNode = get_var_struct(theEnv,rangeIndexNode,RangeIndexNodeSize(level));
+   theNode->key = theKey;
+   theNode->sequence = theIndex->nextSequence++;
+   theNode->theMatch = theMatch;
+   theNode->level = level;
+
+   for (i = 0; i < level; i++)
+     {
+      theNode->next[i] = update[i]->next[i];
+      update[i]->next[i] = theNode;
+     }
+
+   theNode->prev = (update[0] == theIndex->head) ? NULL : update[0];
+   if (theNode->next[0] != NULL)
+     { theNode->next[0]->prev = theNode; }
+
+   theMatch->binds[0].gm.theMatch->rangeNode = theNode;
+  }
+
+/*************************************************************/
+/* RemoveRangeIndexMatch: Removes an alpha match from the    */
+/*   range index of an alpha memory.                         */
+/*************************************************************/
+static void RemoveRangeIndexMatch(
+  Environment *theEnv,
+  struct alphaMemoryHash *theAlphaMemory,
+  struct alphaMatch *theAlphaMatch)
+  {
+   struct rangeIndex *theIndex = theAlphaMemory->rangeIndex;
+   struct rangeIndexNode *theNode = theAlphaMatch->rangeNode, *searchNode, *nextNode;
+   int i;
+
+   theAlphaMatch->rangeNode = NULL;
+
+   if (theNode->level == 0)
+     {
+      if (theNode->prev == NULL)
+        { theIndex->unordered = theNode->next[0]; }
+      else
+        { theNode->prev->next[0] = theNode->next[0]; }
+
+      if (theNode->next[0] == NULL)
+        { theIndex->lastUnordered = theNode->prev; }
+      else
+        { theNode->next[0]->prev = theNode->prev; }
+     }
+   else
+     {
+      searchNode = theIndex->head;
+      for (i = theIndex->level - 1; i >= 0; i--)
+        {
+         for (nextNode = searchNode->next[i];
+              (nextNode != NULL) &&
+              ((nextNode->key < theNode->key) ||
+               ((nextNode->key == theNode->key) && (nextNode->sequence < theNode->sequence)));
+              nextNode = searchNode->next[i])
+           { searchNode = nextNode; }
+
+         if (nextNode == theNode)
+           { searchNode->next[i] = theNode->next[i]; }
+        }
+
+      if (theNode->next[0] != NULL)
+        { theNode->next[0]->prev = theNode->prev; }
+
+      while ((theIndex->level > 1) && (theIndex->head->next[theIndex->level - 1] == NULL))
+        { theIndex->level--; }
+     }
+
+   rtn_var_struct(theEnv,rangeIndexNode,RangeIndexNodeSize(theNode->level),theNode);
+  }
+
+/*****************************************************/
+/* DestroyRangeIndex: Returns the range index of an  */
+/*   alpha memory. The alpha matches themselves are  */
+/*   returned by the caller.                         */
+/*****************************************************/
+static void DestroyRangeIndex(
+  Environment *theEnv,
+  struct alphaMemoryHash *theAlphaMemory)
+  {
+   struct rangeIndex *theIndex = theAlphaMemory->rangeIndex;
+   struct rangeIndexNode *theNode, *nextNode;
+
+   if (theIndex == NULL)
+     { return; }
+
+   for (theNode = theIndex->unordered; theNode != NULL; theNode = nextNode)
+     {
+      nextNode = theNode->next[0];
+      rtn_var_struct(theEnv,rangeIndexNode,RangeIndexNodeSize(theNode->level),theNode);
+     }
+
+   for (theNode = theIndex->head; theNode != NULL; theNode = nextNode)
+     {
+      nextNode = theNode->next[0];
+      rtn_var_struct(theEnv,rangeIndexNode,RangeIndexNodeSize(theNode->level),theNode);
+     }
+
+   rtn_struct(theEnv,rangeIndex,theIndex);
+   theAlphaMemory->rangeIndex = NULL;
+  }
+
 /**************************/
 /* ComputeRightHashValue: */
 /**************************/
@@ -1416,11 +2024,6 @@ unsigned long ComputeRightHashValue(
    struct expr *tempExpr;
    unsigned long hashValue = 0;
    unsigned long multiplier = 1;
-   union
-     {
-      void *vv;
-      unsigned long liv;
-     } fis;
 
    if (theHeader->rightHash == NULL)
      { return hashValue; }
@@ -1437,48 +2040,94 @@ unsigned long ComputeRightHashValue(
        (*EvaluationData(theEnv)->PrimitivesArray[tempExpr->type]->evaluateFunction)(theEnv,tempExpr->value,&theResult);
        EvaluationData(theEnv)->CurrentExpression = oldArgument;
 
-       switch (theResult.header->type)
-         {
-          case STRING_TYPE:
-          case SYMBOL_TYPE:
-          case INSTANCE_NAME_TYPE:
-            hashValue += (theResult.lexemeValue->bucket * multiplier);
-            break;
+       hashValue += JoinKeyHashValue(&theResult) * multiplier;
+      }
 
-          case INTEGER_TYPE:
-            hashValue += (theResult.integerValue->bucket * multiplier);
-            break;
+   return MixJoinHashValue(hashValue);
+  }
 
-          case FLOAT_TYPE:
-            hashValue += (theResult.floatValue->bucket * multiplier);
-            break;
+/************************************************************/
+/* JoinKeyHashValue: Returns the hash value of one of the   */
+/*   keys used to hash the memories of a join. Numbers are  */
+/*   hashed by value rather than by their bucket in the     */
+/*   number tables, which only have a few thousand buckets. */
+/************************************************************/
+unsigned long JoinKeyHashValue(
+  UDFValue *theValue)
+  {
+   unsigned long long bits;
+   union
+     {
+      void *vv;
+      unsigned long liv;
+     } fis;
+   union
+     {
+      double dv;
+      unsigned long long llv;
+     } fds;
 
-          case FACT_ADDRESS_TYPE:
+   switch (theValue->header->type)
+     {
+      case STRING_TYPE:
+      case SYMBOL_TYPE:
+      case INSTANCE_NAME_TYPE:
+        return theValue->lexemeValue->bucket;
+
+      case INTEGER_TYPE:
+        bits = (unsigned long long) theValue->integerValue->contents;
+        return (unsigned long) (bits ^ (bits >> 32));
+
+      case FLOAT_TYPE:
+        fds.llv = 0;
+        fds.dv = theValue->floatValue->contents;
+        return (unsigned long) (fds.llv ^ (fds.llv >> 32));
+
+      case FACT_ADDRESS_TYPE:
 #if OBJECT_SYSTEM
-          case INSTANCE_ADDRESS_TYPE:
+      case INSTANCE_ADDRESS_TYPE:
 #endif
-            fis.liv = 0;
-            fis.vv = theResult.value;
-            hashValue += fis.liv * multiplier;
-            break;
-
-          case EXTERNAL_ADDRESS_TYPE:
-            fis.liv = 0;
-            fis.vv = theResult.externalAddressValue->contents;
-            hashValue += fis.liv * multiplier;
-            break;
-          }
-       }
-
-     return hashValue;
-    }
+        fis.liv = 0;
+        fis.vv = theValue->value;
+        return fis.liv;
+
+      case EXTERNAL_ADDRESS_TYPE:
+        fis.liv = 0;
+        fis.vv = theValue->externalAddressValue->contents;
+        return fis.liv;
+     }
 
-/*********************/
-/* ResizeBetaMemory: */
-/*********************/
-void ResizeBetaMemory(
+   return 0;
+  }
+
+/**************************************************************/
+/* MixJoinHashValue: Scrambles the combined hash value of the */
+/*   keys of a join so that keys differing only in their high */
+/*   bits, or by a multiple of a memory's size, don't end up  */
+/*   in the same bucket. Zero is left unchanged.              */
+/**************************************************************/
+unsigned long MixJoinHashValue(
+  unsigned long hashValue)
+  {
+   hashValue ^= (hashValue >> 16) >> 16;
+   hashValue ^= hashValue >> 16;
+   hashValue *= 0x45d9f3bUL;
+   hashValue ^= hashValue >> 16;
+   hashValue *= 0x45d9f3bUL;
+   hashValue ^= hashValue >> 16;
+
+   return hashValue;
+  }
+
+/**********************************************************/
+/* ResizeBetaMemory: Rehashes the partial matches of a    */
+/*   beta memory into a bucket array of the given size.   */
+/*   The order of the matches within a bucket is kept.    */
+/**********************************************************/
+static void ResizeBetaMemory(
   Environment *theEnv,
-  struct betaMemory *theMemory)
+  struct betaMemory *theMemory,
+  unsigned long newSize)
   {
    struct partialMatch **oldArray, **lastAdd, *thePM, *nextPM;
    unsigned long i, oldSize, betaLocation;
@@ -1486,7 +2135,8 @@ void ResizeBetaMemory(
    oldSize = theMemory->size;
    oldArray = theMemory->beta;
 
-   theMemory->size = oldSize * 11;
+   theMemory->size = newSize;
+   theMemory->resizes++;
    theMemory->beta = (struct partialMatch **) genalloc(theEnv,sizeof(struct partialMatch *) * theMemory->size);
 
    lastAdd = (struct partialMatch **) genalloc(theEnv,sizeof(struct partialMatch *) * theMemory->size);
@@ -1545,6 +2195,7 @@ static void ResetBetaMemory(
    oldArray = theMemory->beta;
 
    theMemory->size = INITIAL_BETA_HASH_SIZE;
+   theMemory->resizes++;
    theMemory->beta = (struct partialMatch **) genalloc(theEnv,sizeof(struct partialMatch *) * theMemory->size);
    memset(theMemory->beta,0,sizeof(struct partialMatch *) * theMemory->size);
    genfree(theEnv,oldArray,sizeof(struct partialMatch *) * oldSize);
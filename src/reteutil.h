@@ -51,6 +51,10 @@
 /*            Removed use of void pointers for specific      */
 /*            data structures.                               */
 /*                                                           */
+/*      ?.??: Added range indexes to alpha memories.         */
+/*                                                           */
+/*            Join keys are hashed by value and mixed.       */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_reteutil
@@ -72,6 +76,9 @@
    struct partialMatch           *MergePartialMatches(Environment *,struct partialMatch *,struct partialMatch *);
    long                           IncrementPseudoFactIndex(void);
    struct partialMatch           *GetAlphaMemory(Environment *,struct patternNodeHeader *,unsigned long);
+   struct partialMatch           *GetJoinAlphaMemory(Environment *,struct joinNode *,struct partialMatch *,
+                                                     unsigned long,struct rangeIndexCursor *);
+   struct partialMatch           *NextRangeMatch(struct rangeIndexCursor *);
    struct partialMatch           *GetLeftBetaMemory(struct joinNode *,unsigned long);
    struct partialMatch           *GetRightBetaMemory(struct joinNode *,unsigned long);
    void                           ReturnLeftMemory(Environment *,struct joinNode *);
@@ -81,6 +88,8 @@
    bool                           BetaMemoryNotEmpty(struct joinNode *);
    void                           RemoveAlphaMemoryMatches(Environment *,struct patternNodeHeader *,struct partialMatch *,
                                                                   struct alphaMatch *);
+   void                           UnlinkAlphaMatch(Environment *,struct patternNodeHeader *,struct partialMatch *);
+   void                           LinkAlphaMatch(Environment *,struct patternNodeHeader *,struct partialMatch *);
    void                           DestroyAlphaMemory(Environment *,struct patternNodeHeader *,bool);
    void                           FlushAlphaMemory(Environment *,struct patternNodeHeader *);
    void                           FlushAlphaBetaMemory(Environment *,struct partialMatch *);
@@ -95,9 +104,14 @@
    void                           TagRuleNetwork(Environment *,unsigned long *,unsigned long *,unsigned long *,unsigned long *);
    bool                           FindEntityInPartialMatch(struct patternEntity *,struct partialMatch *);
    unsigned long                  ComputeRightHashValue(Environment *,struct patternNodeHeader *);
+   unsigned long                  JoinKeyHashValue(UDFValue *);
+   unsigned long                  MixJoinHashValue(unsigned long);
    void                           UpdateBetaPMLinks(Environment *,struct partialMatch *,struct partialMatch *,struct partialMatch *,
                                                        struct joinNode *,unsigned long,int);
+   void                           LinkBetaPMToNode(Environment *,struct partialMatch *,struct joinNode *,int);
+   void                           MoveBetaPMToFrontOfLineage(struct partialMatch *);
    void                           UnlinkBetaPMFromNodeAndLineage(Environment *,struct joinNode *,struct partialMatch *,int);
+   void                           UnlinkBetaPMFromNode(Environment *,struct joinNode *,struct partialMatch *,int);
    void                           UnlinkNonLeftLineage(Environment *,struct joinNode *,struct partialMatch *,int);
    struct partialMatch           *CreateEmptyPartialMatch(Environment *);
    void                           MarkRuleJoins(struct joinNode *,bool);
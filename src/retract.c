@@ -46,6 +46,16 @@
 /*                                                           */
 /*            Support for non-reactive fact patterns.        */
 /*                                                           */
+/*      ?.??: Replacement blockers for not and exists CEs    */
+/*            are searched for using the range index.        */
+/*                                                           */
+/*            Added support for the accumulate CE.           */
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
+/*            Added NetworkDetachMatch for the matches kept  */
+/*            by the modify command.                         */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -56,6 +66,7 @@
 #if DEFRULE_CONSTRUCT
 
 #include "agenda.h"
+#include "aggregat.h"
 #include "argacces.h"
 #include "constant.h"
 #include "drive.h"
@@ -67,6 +78,7 @@
 #include "memalloc.h"
 #include "network.h"
 #include "prntutil.h"
+#include "proflfun.h"
 #include "reteutil.h"
 #include "router.h"
 #include "symbol.h"
@@ -83,12 +95,13 @@
 
    static void                    ReturnMarkers(Environment *,struct multifieldMarker *);
    static bool                    FindNextConflictingMatch(Environment *,struct partialMatch *,
-                                                           struct partialMatch *,
+                                                           struct partialMatch *,struct rangeIndexCursor *,
                                                            struct joinNode *,struct partialMatch *,int);
    static bool                    PartialMatchDefunct(Environment *,struct partialMatch *);
    static void                    NegEntryRetractAlpha(Environment *,struct partialMatch *,int);
    static void                    NegEntryRetractBeta(Environment *,struct joinNode *,struct partialMatch *,
                                                       struct partialMatch *,int);
+   static void                    DetachBetaMatches(Environment *,struct partialMatch *,bool);
 
 /************************************************************/
 /* NetworkRetract:  Retracts a data entity (such as a fact  */
@@ -142,6 +155,79 @@ void NetworkRetractMatch(
    rtn_struct(theEnv,patternMatch,theMatch);
   }
 
+/**************************************************************/
+/* NetworkDetachMatch: Removes a match kept by the modify     */
+/*   command from the alpha memory of its pattern and removes */
+/*   the partial matches derived from it from the memories    */
+/*   of the joins below, but doesn't delete them so they can  */
+/*   be restored by NetworkReattachMatch when the fact is     */
+/*   reasserted. The activations of the partial matches are   */
+/*   removed. Partial matches blocked by the match are        */
+/*   handled as they are by a retraction. Those left          */
+/*   unblocked are kept in the block list of the match        */
+/*   (without being marked as blocked) until it's reattached. */
+/**************************************************************/
+void NetworkDetachMatch(
+  Environment *theEnv,
+  struct patternMatch *theMatch)
+  {
+   struct partialMatch *alphaMatch, *betaMatch, *unblocked = NULL;
+
+   alphaMatch = theMatch->theMatch;
+
+   if (alphaMatch->children != NULL)
+     { DetachBetaMatches(theEnv,alphaMatch->children,true); }
+
+   while (alphaMatch->blockList != NULL)
+     {
+      betaMatch = alphaMatch->blockList;
+
+      NegEntryRetractBeta(theEnv,(struct joinNode *) betaMatch->owner,alphaMatch,betaMatch,NETWORK_RETRACT);
+
+      if ((betaMatch->marker == NULL) &&
+          (! PartialMatchWillBeDeleted(theEnv,betaMatch)))
+        {
+         betaMatch->nextBlocked = unblocked;
+         if (unblocked != NULL)
+           { unblocked->prevBlocked = betaMatch; }
+         unblocked = betaMatch;
+        }
+     }
+
+   UnlinkAlphaMatch(theEnv,theMatch->matchingPattern,alphaMatch);
+
+   alphaMatch->blockList = unblocked;
+  }
+
+/**************************************************************/
+/* DetachBetaMatches: Removes a list of partial matches and   */
+/*   their descendants from the memories of their joins and   */
+/*   removes their activations. The links between the partial */
+/*   matches and their parents are left in place.             */
+/**************************************************************/
+static void DetachBetaMatches(
+  Environment *theEnv,
+  struct partialMatch *betaMatch,
+  bool rightChildren)
+  {
+   struct joinNode *joinPtr;
+
+   for (;
+        betaMatch != NULL;
+        betaMatch = (rightChildren ? betaMatch->nextRightChild : betaMatch->nextLeftChild))
+     {
+      if (betaMatch->children != NULL)
+        { DetachBetaMatches(theEnv,betaMatch->children,false); }
+
+      joinPtr = (struct joinNode *) betaMatch->owner;
+
+      if ((joinPtr->ruleToActivate != NULL) && (betaMatch->marker != NULL))
+        { RemoveActivation(theEnv,(struct activation *) betaMatch->marker,true,true); }
+
+      UnlinkBetaPMFromNode(theEnv,joinPtr,betaMatch,LHS);
+     }
+  }
+
 /*************************/
 /* PosEntryRetractAlpha: */
 /*************************/
@@ -152,6 +238,7 @@ void PosEntryRetractAlpha(
   {
    struct partialMatch *betaMatch, *tempMatch;
    struct joinNode *joinPtr, *lastJoin;
+   bool aggregateGroup;
 #if DEFTEMPLATE_CONSTRUCT
    struct partialMatch *goalMatch;
 #endif
@@ -167,6 +254,20 @@ void PosEntryRetractAlpha(
      {
       joinPtr = (struct joinNode *) betaMatch->owner;
 
+      /*========================================================*/
+      /* A match contributing to the aggregate of an accumulate */
+      /* CE is removed from its group. Updating the aggregate   */
+      /* can remove other children of the alpha match, so the   */
+      /* loop continues with the first remaining child.         */
+      /*========================================================*/
+
+      if (betaMatch->rhsMemory && (joinPtr->aggregate != NO_AGGREGATE))
+        {
+         AggregateRetractLink(theEnv,betaMatch,operation);
+         betaMatch = alphaMatch->children;
+         continue;
+        }
+
       if (betaMatch->children != NULL)
         { PosEntryRetractBeta(theEnv,betaMatch,betaMatch->children,operation); }
 
@@ -197,11 +298,22 @@ void PosEntryRetractAlpha(
 
 	  tempMatch = betaMatch->nextRightChild;
 
+      /*=====================================================*/
+      /* Releasing the group of a partial match in the left  */
+      /* memory of an aggregate join removes its links, one  */
+      /* of which may be the next child of the alpha match.  */
+      /*=====================================================*/
+
+      aggregateGroup = betaMatch->aggregateMarker;
+
 	  if (betaMatch->rhsMemory)
 		{ UnlinkBetaPMFromNodeAndLineage(theEnv,joinPtr,betaMatch,RHS); }
 	  else
 		{ UnlinkBetaPMFromNodeAndLineage(theEnv,joinPtr,betaMatch,LHS); }
 
+      if (aggregateGroup)
+        { tempMatch = alphaMatch->children; }
+
 #if DEFTEMPLATE_CONSTRUCT
       if ((goalMatch != NULL) &&
           (goalMatch->children == NULL))
@@ -266,6 +378,9 @@ static void NegEntryRetractBeta(
   struct partialMatch *betaMatch,
   int operation)
   {
+   struct partialMatch *possibleConflicts;
+   struct rangeIndexCursor rangeCursor;
+
    /*======================================================*/
    /* Try to find another RHS partial match which prevents */
    /* the LHS partial match from being satisifed.          */
@@ -273,7 +388,24 @@ static void NegEntryRetractBeta(
 
    RemoveBlockedLink(betaMatch);
 
-   if (FindNextConflictingMatch(theEnv,betaMatch,alphaMatch->nextInMemory,joinPtr,alphaMatch,operation))
+   /*=======================================================*/
+   /* When the join uses a range index, the blocking match  */
+   /* was found in index order rather than in the order of  */
+   /* the alpha memory, so all of the matches in the range  */
+   /* have to be searched and not just those following the  */
+   /* match being retracted. If the index can't be used for */
+   /* the partial match, the blocking match was found by    */
+   /* searching the alpha memory in order.                  */
+   /*=======================================================*/
+
+   rangeCursor.indexed = false;
+   if (joinPtr->leftRange != NULL)
+     { possibleConflicts = GetJoinAlphaMemory(theEnv,joinPtr,betaMatch,betaMatch->hashValue,&rangeCursor); }
+
+   if (! rangeCursor.indexed)
+     { possibleConflicts = alphaMatch->nextInMemory; }
+
+   if (FindNextConflictingMatch(theEnv,betaMatch,possibleConflicts,&rangeCursor,joinPtr,alphaMatch,operation))
      { return; }
    else if (joinPtr->patternIsExists)
      {
@@ -372,11 +504,14 @@ void PosEntryRetractBeta(
 /* FindNextConflictingMatch: Finds the next conflicting partial   */
 /*    match in the right memory of a join that prevents a partial */
 /*    match in the beta memory of the join from being satisfied.  */
+/*    If the range cursor is indexed, the remaining matches are   */
+/*    retrieved from it rather than from the alpha memory list.   */
 /******************************************************************/
 static bool FindNextConflictingMatch(
   Environment *theEnv,
   struct partialMatch *theBind,
   struct partialMatch *possibleConflicts,
+  struct rangeIndexCursor *rangeCursor,
   struct joinNode *theJoin,
   struct partialMatch *skipMatch,
   int operation)
@@ -411,11 +546,15 @@ static bool FindNextConflictingMatch(
 
    for (;
         possibleConflicts != NULL;
-        possibleConflicts = possibleConflicts->nextInMemory)
+        possibleConflicts = rangeCursor->indexed ? NextRangeMatch(rangeCursor) : possibleConflicts->nextInMemory)
      {
 #if DEBUGGING_FUNCTIONS
       theJoin->memoryCompares++;
 #endif
+#if PROFILING_FUNCTIONS
+      if (ProfileFunctionData(theEnv)->ProfileJoins)
+        { theJoin->hashProbes++; }
+#endif
 
       /*=====================================*/
       /* Initially indicate that the partial */
@@ -709,6 +848,13 @@ void DestroyPartialMatch(
 
    if (waste->dependents != NULL) DestroyPMDependencies(theEnv,waste);
 
+   /*================================================*/
+   /* Return the group of a partial match in the     */
+   /* left memory of an aggregate join.              */
+   /*================================================*/
+
+   if (waste->aggregateMarker) DestroyAggregateGroup(theEnv,waste);
+
    /*======================================================*/
    /* Return the partial match to the pool of free memory. */
    /*======================================================*/
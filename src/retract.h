@@ -63,6 +63,7 @@ struct rdriveinfo
 
 void                           NetworkRetract(Environment *,struct patternMatch *);
 void                           NetworkRetractMatch(Environment *,struct patternMatch *);
+void                           NetworkDetachMatch(Environment *,struct patternMatch *);
 void                           ReturnPartialMatch(Environment *,struct partialMatch *);
 void                           DestroyPartialMatch(Environment *,struct partialMatch *);
 void                           FlushGarbagePartialMatches(Environment *);
@@ -0,0 +1,787 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*                ROUTE FUNCTIONS MODULE               */
+/*******************************************************/
+
+/*************************************************************/
+/* Purpose: A table of HTTP routes stored as one compressed  */
+/*   radix tree per method. Static text shares prefixes,     */
+/*   :name segments capture one path segment and a trailing  */
+/*   *name segment captures the rest of the path, so a       */
+/*   lookup costs the length of the path rather than the     */
+/*   number of routes.                                       */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "setup.h"
+
+#include "envrnmnt.h"
+#include "extnfunc.h"
+#include "memalloc.h"
+#include "multifld.h"
+#include "router.h"
+#include "symbol.h"
+
+#include "routefun.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+static void                    DeallocateRouteData(Environment *);
+static void                    ClearRoutes(Environment *,bool);
+static struct routeNode       *CreateRouteNode(Environment *,const char *,size_t);
+static void                    ReturnRouteNode(Environment *,struct routeNode *,bool);
+static void                    SetRouteNodePrefix(Environment *,struct routeNode *,const char *,size_t);
+static struct routeNode       *InsertStaticText(Environment *,struct routeNode *,const char *,size_t);
+static struct routeNode       *FindStaticText(struct routeNode *,const char *,size_t);
+static CLIPSLexeme            *CreateSegmentName(Environment *,const char *,size_t);
+static bool                    IsSegmentStart(const char *,const char *);
+static size_t                  StaticTextLength(const char *,const char *);
+static struct routeNode       *InsertRoute(Environment *,struct routeNode *,const char *);
+static struct routeNode       *FindRoute(Environment *,struct routeNode *,const char *);
+static struct routeNode       *MatchRoute(struct routeNode *,const char *,size_t,
+                                          struct routeCapture *,unsigned *);
+static struct routeTree       *FindRouteTree(Environment *,CLIPSLexeme *,bool);
+static void                    ListRouteNode(Environment *,struct routeNode *,CLIPSLexeme *,MultifieldBuilder *);
+
+/*****************************************************/
+/* RouteFunctionDefinitions: Allocates the route     */
+/*   table and registers the route table functions.  */
+/*****************************************************/
+void RouteFunctionDefinitions(
+		Environment *theEnv)
+{
+	AllocateEnvironmentData(
+			theEnv,
+			ROUTE_DATA,
+			sizeof(struct routeData),
+			DeallocateRouteData);
+
+	AddUDF(theEnv,"route-add","b",3,3,";y;sy;y",RouteAddFunction,"RouteAddFunction",NULL);
+	AddUDF(theEnv,"route-remove","b",2,2,";y;sy",RouteRemoveFunction,"RouteRemoveFunction",NULL);
+	AddUDF(theEnv,"route-lookup","bm",2,2,";y;sy",RouteLookupFunction,"RouteLookupFunction",NULL);
+	AddUDF(theEnv,"route-list","m",0,0,NULL,RouteListFunction,"RouteListFunction",NULL);
+	AddUDF(theEnv,"route-clear","v",0,0,NULL,RouteClearFunction,"RouteClearFunction",NULL);
+}
+
+/***********************************************/
+/* DeallocateRouteData: Deallocates the route  */
+/*   trees when the environment is destroyed.  */
+/*   The symbol table is already gone by then, */
+/*   so the lexemes are not released.          */
+/***********************************************/
+static void DeallocateRouteData(
+		Environment *theEnv)
+{
+	ClearRoutes(theEnv,false);
+}
+
+/*******************************************/
+/* ClearRoutes: Releases every route tree. */
+/*******************************************/
+static void ClearRoutes(
+		Environment *theEnv,
+		bool releaseLexemes)
+{
+	struct routeTree *theTree, *nextTree;
+
+	for (theTree = RouteData(theEnv)->ListOfRouteTrees;
+	     theTree != NULL;
+	     theTree = nextTree)
+	{
+		nextTree = theTree->next;
+		ReturnRouteNode(theEnv,theTree->root,releaseLexemes);
+		if (releaseLexemes) ReleaseLexeme(theEnv,theTree->method);
+		rtn_struct(theEnv,routeTree,theTree);
+	}
+
+	RouteData(theEnv)->ListOfRouteTrees = NULL;
+}
+
+/*************************************************/
+/* CreateRouteNode: Creates a node whose static  */
+/*   prefix is a copy of the given text.         */
+/*************************************************/
+static struct routeNode *CreateRouteNode(
+		Environment *theEnv,
+		const char *prefix,
+		size_t length)
+{
+	struct routeNode *theNode;
+
+	theNode = get_struct(theEnv,routeNode);
+	memset(theNode,0,sizeof(struct routeNode));
+	SetRouteNodePrefix(theEnv,theNode,prefix,length);
+
+	return theNode;
+}
+
+/***************************************************/
+/* ReturnRouteNode: Releases a node, its subtrees  */
+/*   and the lexemes it holds.                     */
+/***************************************************/
+static void ReturnRouteNode(
+		Environment *theEnv,
+		struct routeNode *theNode,
+		bool releaseLexemes)
+{
+	struct routeNode *theChild, *nextChild;
+
+	if (theNode == NULL) return;
+
+	for (theChild = theNode->children; theChild != NULL; theChild = nextChild)
+	{
+		nextChild = theChild->next;
+		ReturnRouteNode(theEnv,theChild,releaseLexemes);
+	}
+
+	ReturnRouteNode(theEnv,theNode->paramChild,releaseLexemes);
+	ReturnRouteNode(theEnv,theNode->wildcardChild,releaseLexemes);
+
+	if (releaseLexemes)
+	{
+		if (theNode->paramName != NULL) ReleaseLexeme(theEnv,theNode->paramName);
+		if (theNode->handler != NULL) ReleaseLexeme(theEnv,theNode->handler);
+		if (theNode->pattern != NULL) ReleaseLexeme(theEnv,theNode->pattern);
+	}
+
+	SetRouteNodePrefix(theEnv,theNode,NULL,0);
+	rtn_struct(theEnv,routeNode,theNode);
+}
+
+/***************************************************/
+/* SetRouteNodePrefix: Replaces the static prefix  */
+/*   of a node. The text may overlap the old one.  */
+/***************************************************/
+static void SetRouteNodePrefix(
+		Environment *theEnv,
+		struct routeNode *theNode,
+		const char *prefix,
+		size_t length)
+{
+	char *newPrefix = NULL;
+
+	if (length > 0)
+	{
+		newPrefix = (char *) gm2(theEnv,length + 1);
+		memcpy(newPrefix,prefix,length);
+		newPrefix[length] = EOS;
+	}
+
+	if (theNode->prefix != NULL)
+	{ rm(theEnv,theNode->prefix,theNode->prefixLength + 1); }
+
+	theNode->prefix = newPrefix;
+	theNode->prefixLength = length;
+}
+
+/****************************************************/
+/* InsertStaticText: Descends the static children   */
+/*   of a node along the given text, splitting any  */
+/*   node whose prefix only partially matches, and  */
+/*   returns the node at which the text ends.       */
+/****************************************************/
+static struct routeNode *InsertStaticText(
+		Environment *theEnv,
+		struct routeNode *theNode,
+		const char *text,
+		size_t length)
+{
+	struct routeNode *theChild, *theTail;
+	size_t common;
+
+	while (length > 0)
+	{
+		for (theChild = theNode->children; theChild != NULL; theChild = theChild->next)
+		{
+			if (theChild->prefix[0] == text[0]) break;
+		}
+
+		if (theChild == NULL)
+		{
+			theChild = CreateRouteNode(theEnv,text,length);
+			theChild->next = theNode->children;
+			theNode->children = theChild;
+			return theChild;
+		}
+
+		common = 1;
+		while ((common < length) &&
+		       (common < theChild->prefixLength) &&
+		       (theChild->prefix[common] == text[common]))
+		{ common++; }
+
+		/*==============================================*/
+		/* Split the child so that its prefix ends where */
+		/* the new text diverges. Everything hanging off */
+		/* the child moves down to the new tail node.    */
+		/*==============================================*/
+
+		if (common < theChild->prefixLength)
+		{
+			theTail = CreateRouteNode(theEnv,theChild->prefix + common,theChild->prefixLength - common);
+			theTail->children = theChild->children;
+			theTail->paramChild = theChild->paramChild;
+			theTail->wildcardChild = theChild->wildcardChild;
+			theTail->handler = theChild->handler;
+			theTail->pattern = theChild->pattern;
+
+			theChild->children = theTail;
+			theChild->paramChild = NULL;
+			theChild->wildcardChild = NULL;
+			theChild->handler = NULL;
+			theChild->pattern = NULL;
+			SetRouteNodePrefix(theEnv,theChild,theChild->prefix,common);
+		}
+
+		theNode = theChild;
+		text += common;
+		length -= common;
+	}
+
+	return theNode;
+}
+
+/****************************************************/
+/* FindStaticText: Descends the static children of  */
+/*   a node along the given text without modifying  */
+/*   the tree. Returns NULL if the text does not    */
+/*   end exactly on a node boundary.                */
+/****************************************************/
+static struct routeNode *FindStaticText(
+		struct routeNode *theNode,
+		const char *text,
+		size_t length)
+{
+	struct routeNode *theChild;
+
+	while (length > 0)
+	{
+		for (theChild = theNode->children; theChild != NULL; theChild = theChild->next)
+		{
+			if (theChild->prefix[0] == text[0]) break;
+		}
+
+		if ((theChild == NULL) ||
+		    (theChild->prefixLength > length) ||
+		    (memcmp(theChild->prefix,text,theChild->prefixLength) != 0))
+		{ return NULL; }
+
+		theNode = theChild;
+		text += theChild->prefixLength;
+		length -= theChild->prefixLength;
+	}
+
+	return theNode;
+}
+
+/***********************************************/
+/* CreateSegmentName: Creates a symbol for the */
+/*   name of a :param or *wildcard segment.    */
+/***********************************************/
+static CLIPSLexeme *CreateSegmentName(
+		Environment *theEnv,
+		const char *name,
+		size_t length)
+{
+	CLIPSLexeme *theSymbol;
+	char *buffer;
+
+	buffer = (char *) gm2(theEnv,length + 1);
+	memcpy(buffer,name,length);
+	buffer[length] = EOS;
+	theSymbol = CreateSymbol(theEnv,buffer);
+	rm(theEnv,buffer,length + 1);
+
+	return theSymbol;
+}
+
+/*************************************************/
+/* IsSegmentStart: Returns true if the character */
+/*   begins a path segment of the pattern.       */
+/*************************************************/
+static bool IsSegmentStart(
+		const char *pattern,
+		const char *position)
+{
+	return (position == pattern) || (position[-1] == '/');
+}
+
+/**************************************************/
+/* StaticTextLength: Returns the length of the    */
+/*   static text before the next :param or        */
+/*   *wildcard segment. The first character is    */
+/*   always static.                               */
+/**************************************************/
+static size_t StaticTextLength(
+		const char *pattern,
+		const char *position)
+{
+	const char *end = position + 1;
+
+	while ((*end != EOS) &&
+	       (! (((*end == ':') || (*end == '*')) && IsSegmentStart(pattern,end))))
+	{ end++; }
+
+	return (size_t) (end - position);
+}
+
+/****************************************************/
+/* InsertRoute: Adds the nodes for a pattern to a   */
+/*   tree and returns the node the pattern ends at. */
+/*   Returns NULL if the pattern is malformed or    */
+/*   conflicts with the segment names of an         */
+/*   existing route.                                */
+/****************************************************/
+static struct routeNode *InsertRoute(
+		Environment *theEnv,
+		struct routeNode *theNode,
+		const char *pattern)
+{
+	const char *position = pattern, *end;
+	CLIPSLexeme *theName;
+	struct routeNode **theSlot;
+	unsigned params = 0;
+	size_t length;
+
+	while (*position != EOS)
+	{
+		if (((*position == ':') || (*position == '*')) && IsSegmentStart(pattern,position))
+		{
+			if (*position == ':')
+			{
+				end = strchr(position,'/');
+				if (end == NULL) end = position + strlen(position);
+				theSlot = &theNode->paramChild;
+			}
+			else
+			{
+				end = position + strlen(position);
+				if (strchr(position,'/') != NULL)
+				{
+					WriteString(theEnv,STDERR,"route-add: a wildcard segment must be last\n");
+					return NULL;
+				}
+				theSlot = &theNode->wildcardChild;
+			}
+
+			if (end == position + 1)
+			{
+				WriteString(theEnv,STDERR,"route-add: a parameter segment must have a name\n");
+				return NULL;
+			}
+
+			if (++params > ROUTE_MAX_PARAMS)
+			{
+				WriteString(theEnv,STDERR,"route-add: too many parameter segments\n");
+				return NULL;
+			}
+
+			theName = CreateSegmentName(theEnv,position + 1,(size_t) (end - position - 1));
+
+			if (*theSlot == NULL)
+			{
+				*theSlot = CreateRouteNode(theEnv,NULL,0);
+				(*theSlot)->paramName = theName;
+				IncrementLexemeCount(theName);
+			}
+			else if ((*theSlot)->paramName != theName)
+			{
+				WriteString(theEnv,STDERR,"route-add: segment name ");
+				WriteString(theEnv,STDERR,theName->contents);
+				WriteString(theEnv,STDERR," conflicts with ");
+				WriteString(theEnv,STDERR,(*theSlot)->paramName->contents);
+				WriteString(theEnv,STDERR," of an existing route\n");
+				return NULL;
+			}
+
+			theNode = *theSlot;
+			position = end;
+		}
+		else
+		{
+			length = StaticTextLength(pattern,position);
+			theNode = InsertStaticText(theEnv,theNode,position,length);
+			position += length;
+		}
+	}
+
+	return theNode;
+}
+
+/*************************************************/
+/* FindRoute: Returns the node at which an added */
+/*   pattern ends, or NULL if there is none.     */
+/*************************************************/
+static struct routeNode *FindRoute(
+		Environment *theEnv,
+		struct routeNode *theNode,
+		const char *pattern)
+{
+	const char *position = pattern, *end;
+	size_t length;
+
+	while ((theNode != NULL) && (*position != EOS))
+	{
+		if (((*position == ':') || (*position == '*')) && IsSegmentStart(pattern,position))
+		{
+			if (*position == ':')
+			{
+				end = strchr(position,'/');
+				if (end == NULL) end = position + strlen(position);
+				theNode = theNode->paramChild;
+			}
+			else
+			{
+				end = position + strlen(position);
+				theNode = theNode->wildcardChild;
+			}
+
+			if ((theNode != NULL) &&
+			    (theNode->paramName != CreateSegmentName(theEnv,position + 1,(size_t) (end - position - 1))))
+			{ return NULL; }
+
+			position = end;
+		}
+		else
+		{
+			length = StaticTextLength(pattern,position);
+			theNode = FindStaticText(theNode,position,length);
+			position += length;
+		}
+	}
+
+	return theNode;
+}
+
+/******************************************************/
+/* MatchRoute: Matches a request path against a tree. */
+/*   Static text is preferred over a :param segment,  */
+/*   which is preferred over a *wildcard, and the     */
+/*   search backs up if a preferred branch fails.     */
+/******************************************************/
+static struct routeNode *MatchRoute(
+		struct routeNode *theNode,
+		const char *path,
+		size_t length,
+		struct routeCapture *captures,
+		unsigned *captureCount)
+{
+	struct routeNode *theChild, *theMatch;
+	size_t segment;
+
+	if (length == 0)
+	{
+		if (theNode->handler != NULL) return theNode;
+
+		if ((theNode->wildcardChild != NULL) &&
+		    (theNode->wildcardChild->handler != NULL))
+		{
+			captures[*captureCount].name = theNode->wildcardChild->paramName;
+			captures[*captureCount].value = path;
+			captures[*captureCount].length = 0;
+			(*captureCount)++;
+			return theNode->wildcardChild;
+		}
+
+		return NULL;
+	}
+
+	for (theChild = theNode->children; theChild != NULL; theChild = theChild->next)
+	{
+		if (theChild->prefix[0] != path[0]) continue;
+
+		if ((theChild->prefixLength <= length) &&
+		    (memcmp(theChild->prefix,path,theChild->prefixLength) == 0))
+		{
+			theMatch = MatchRoute(theChild,path + theChild->prefixLength,
+			                      length - theChild->prefixLength,captures,captureCount);
+			if (theMatch != NULL) return theMatch;
+		}
+
+		break;
+	}
+
+	if (theNode->paramChild != NULL)
+	{
+		segment = 0;
+		while ((segment < length) && (path[segment] != '/'))
+		{ segment++; }
+
+		if (segment > 0)
+		{
+			captures[*captureCount].name = theNode->paramChild->paramName;
+			captures[*captureCount].value = path;
+			captures[*captureCount].length = segment;
+			(*captureCount)++;
+
+			theMatch = MatchRoute(theNode->paramChild,path + segment,length - segment,captures,captureCount);
+			if (theMatch != NULL) return theMatch;
+
+			(*captureCount)--;
+		}
+	}
+
+	if ((theNode->wildcardChild != NULL) &&
+	    (theNode->wildcardChild->handler != NULL))
+	{
+		captures[*captureCount].name = theNode->wildcardChild->paramName;
+		captures[*captureCount].value = path;
+		captures[*captureCount].length = length;
+		(*captureCount)++;
+		return theNode->wildcardChild;
+	}
+
+	return NULL;
+}
+
+/*****************************************************/
+/* FindRouteTree: Returns the tree for a method and, */
+/*   if requested, creates it when it doesn't exist. */
+/*****************************************************/
+static struct routeTree *FindRouteTree(
+		Environment *theEnv,
+		CLIPSLexeme *method,
+		bool create)
+{
+	struct routeTree *theTree;
+
+	for (theTree = RouteData(theEnv)->ListOfRouteTrees;
+	     theTree != NULL;
+	     theTree = theTree->next)
+	{
+		if (theTree->method == method) return theTree;
+	}
+
+	if (! create) return NULL;
+
+	theTree = get_struct(theEnv,routeTree);
+	theTree->method = method;
+	IncrementLexemeCount(method);
+	theTree->root = CreateRouteNode(theEnv,NULL,0);
+	theTree->next = RouteData(theEnv)->ListOfRouteTrees;
+	RouteData(theEnv)->ListOfRouteTrees = theTree;
+
+	return theTree;
+}
+
+/*************************************************/
+/* RouteAddFunction: H/L access routine for the  */
+/*   route-add function. Adding a pattern that   */
+/*   already exists replaces its handler.        */
+/*************************************************/
+void RouteAddFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theMethod, thePattern, theHandler;
+	struct routeTree *theTree;
+	struct routeNode *theNode;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	UDFNextArgument(context,SYMBOL_BIT,&theMethod);
+	UDFNextArgument(context,LEXEME_BITS,&thePattern);
+	UDFNextArgument(context,SYMBOL_BIT,&theHandler);
+
+	if (thePattern.lexemeValue->contents[0] == EOS)
+	{
+		WriteString(theEnv,STDERR,"route-add: the pattern must not be empty\n");
+		return;
+	}
+
+	theTree = FindRouteTree(theEnv,theMethod.lexemeValue,true);
+	theNode = InsertRoute(theEnv,theTree->root,thePattern.lexemeValue->contents);
+	if (theNode == NULL) return;
+
+	if (theNode->handler != NULL) ReleaseLexeme(theEnv,theNode->handler);
+	if (theNode->pattern != NULL) ReleaseLexeme(theEnv,theNode->pattern);
+
+	theNode->handler = theHandler.lexemeValue;
+	IncrementLexemeCount(theNode->handler);
+	theNode->pattern = CreateString(theEnv,thePattern.lexemeValue->contents);
+	IncrementLexemeCount(theNode->pattern);
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/****************************************************/
+/* RouteRemoveFunction: H/L access routine for the  */
+/*   route-remove function. The nodes of a removed  */
+/*   route stay in the tree for later additions.    */
+/****************************************************/
+void RouteRemoveFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theMethod, thePattern;
+	struct routeTree *theTree;
+	struct routeNode *theNode = NULL;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	UDFNextArgument(context,SYMBOL_BIT,&theMethod);
+	UDFNextArgument(context,LEXEME_BITS,&thePattern);
+
+	theTree = FindRouteTree(theEnv,theMethod.lexemeValue,false);
+	if (theTree != NULL)
+	{ theNode = FindRoute(theEnv,theTree->root,thePattern.lexemeValue->contents); }
+
+	if ((theNode == NULL) || (theNode->handler == NULL)) return;
+
+	ReleaseLexeme(theEnv,theNode->handler);
+	ReleaseLexeme(theEnv,theNode->pattern);
+	theNode->handler = NULL;
+	theNode->pattern = NULL;
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*****************************************************/
+/* RouteLookupFunction: H/L access routine for the   */
+/*   route-lookup function. Returns a multifield of  */
+/*   the handler followed by name/value pairs for    */
+/*   the captured segments, or FALSE if no route     */
+/*   matches. Routes added for the * method are used */
+/*   when the request method has no match.           */
+/*****************************************************/
+void RouteLookupFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theMethod, thePath;
+	struct routeTree *theTree;
+	struct routeNode *theMatch = NULL;
+	struct routeCapture captures[ROUTE_MAX_PARAMS];
+	unsigned captureCount = 0, i;
+	const char *path, *query;
+	size_t length;
+	MultifieldBuilder *theMB;
+	char *buffer;
+
+	UDFNextArgument(context,SYMBOL_BIT,&theMethod);
+	UDFNextArgument(context,LEXEME_BITS,&thePath);
+
+	path = thePath.lexemeValue->contents;
+	query = strchr(path,'?');
+	length = (query == NULL) ? strlen(path) : (size_t) (query - path);
+
+	theTree = FindRouteTree(theEnv,theMethod.lexemeValue,false);
+	if (theTree != NULL)
+	{ theMatch = MatchRoute(theTree->root,path,length,captures,&captureCount); }
+
+	if (theMatch == NULL)
+	{
+		captureCount = 0;
+		theTree = FindRouteTree(theEnv,CreateSymbol(theEnv,ROUTE_ANY_METHOD),false);
+		if (theTree != NULL)
+		{ theMatch = MatchRoute(theTree->root,path,length,captures,&captureCount); }
+	}
+
+	if (theMatch == NULL)
+	{
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	theMB = CreateMultifieldBuilder(theEnv,1 + (2 * captureCount));
+	MBAppendCLIPSLexeme(theMB,theMatch->handler);
+
+	for (i = 0; i < captureCount; i++)
+	{
+		buffer = (char *) gm2(theEnv,captures[i].length + 1);
+		memcpy(buffer,captures[i].value,captures[i].length);
+		buffer[captures[i].length] = EOS;
+
+		MBAppendCLIPSLexeme(theMB,captures[i].name);
+		MBAppendString(theMB,buffer);
+
+		rm(theEnv,buffer,captures[i].length + 1);
+	}
+
+	returnValue->multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+}
+
+/*************************************************/
+/* ListRouteNode: Appends the method, pattern    */
+/*   and handler of every route below a node.    */
+/*************************************************/
+static void ListRouteNode(
+		Environment *theEnv,
+		struct routeNode *theNode,
+		CLIPSLexeme *method,
+		MultifieldBuilder *theMB)
+{
+	struct routeNode *theChild;
+
+	if (theNode == NULL) return;
+
+	if (theNode->handler != NULL)
+	{
+		MBAppendCLIPSLexeme(theMB,method);
+		MBAppendCLIPSLexeme(theMB,theNode->pattern);
+		MBAppendCLIPSLexeme(theMB,theNode->handler);
+	}
+
+	for (theChild = theNode->children; theChild != NULL; theChild = theChild->next)
+	{ ListRouteNode(theEnv,theChild,method,theMB); }
+
+	ListRouteNode(theEnv,theNode->paramChild,method,theMB);
+	ListRouteNode(theEnv,theNode->wildcardChild,method,theMB);
+}
+
+/************************************************/
+/* RouteListFunction: H/L access routine for    */
+/*   the route-list function. Returns a         */
+/*   multifield of method, pattern and handler  */
+/*   triples.                                   */
+/************************************************/
+void RouteListFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	MultifieldBuilder *theMB;
+	struct routeTree *theTree;
+
+	theMB = CreateMultifieldBuilder(theEnv,0);
+
+	for (theTree = RouteData(theEnv)->ListOfRouteTrees;
+	     theTree != NULL;
+	     theTree = theTree->next)
+	{ ListRouteNode(theEnv,theTree->root,theTree->method,theMB); }
+
+	returnValue->multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+}
+
+/***********************************************/
+/* RouteClearFunction: H/L access routine for  */
+/*   the route-clear function.                 */
+/***********************************************/
+void RouteClearFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	ClearRoutes(theEnv,true);
+}
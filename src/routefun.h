@@ -0,0 +1,77 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*              ROUTE FUNCTIONS HEADER                 */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: A table of HTTP routes stored as one compressed  */
+/*   radix tree per method, with :param and *wildcard        */
+/*   segments.                                               */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_routefun
+
+#pragma once
+
+#define _H_routefun
+
+#include <stddef.h>
+
+#define ROUTE_DATA USER_ENVIRONMENT_DATA + 2
+
+#define ROUTE_MAX_PARAMS 32
+#define ROUTE_ANY_METHOD "*"
+
+struct routeNode
+  {
+   char *prefix;
+   size_t prefixLength;
+   struct routeNode *children;
+   struct routeNode *next;
+   struct routeNode *paramChild;
+   struct routeNode *wildcardChild;
+   CLIPSLexeme *paramName;
+   CLIPSLexeme *handler;
+   CLIPSLexeme *pattern;
+  };
+
+struct routeTree
+  {
+   CLIPSLexeme *method;
+   struct routeNode *root;
+   struct routeTree *next;
+  };
+
+struct routeCapture
+  {
+   CLIPSLexeme *name;
+   const char *value;
+   size_t length;
+  };
+
+struct routeData
+  {
+   struct routeTree *ListOfRouteTrees;
+  };
+
+#define RouteData(theEnv) ((struct routeData *) GetEnvironmentData(theEnv,ROUTE_DATA))
+
+   void                           RouteFunctionDefinitions(Environment *);
+   void                           RouteAddFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RouteRemoveFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RouteLookupFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RouteListFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RouteClearFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_routefun */
@@ -60,8 +60,20 @@
 /*                                                           */
 /*            UDF redesign.                                  */
 /*                                                           */
+/*      ?.??: Added a cache of the routers that handle each  */
+/*            logical name so that character I/O does not    */
+/*            query every router on every call.              */
+/*                                                           */
+/*            Added block read and write callbacks so that   */
+/*            routers can move more than one character per   */
+/*            call.                                          */
+/*                                                           */
+/*            Blocks are read directly from the fast string  */
+/*            get string.                                    */
+/*                                                           */
 /*************************************************************/
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -97,6 +109,9 @@
 
    static bool                    QueryRouter(Environment *,const char *,struct router *);
    static void                    DeallocateRouterData(Environment *);
+   static struct routerCacheEntry *LookupRouterCache(Environment *,const char *);
+   static size_t                  ReadBlockFastCharGet(Environment *,char *,size_t,const char *);
+   static void                    ResolveRouters(Environment *,const char *,struct routerCacheEntry *);
 
 /*********************************************************/
 /* InitializeDefaultRouters: Initializes output streams. */
@@ -109,6 +124,7 @@ void InitializeDefaultRouters(
    RouterData(theEnv)->CommandBufferInputCount = 0;
    RouterData(theEnv)->InputUngets = 0;
    RouterData(theEnv)->AwaitingInput = true;
+   RouterData(theEnv)->CacheGeneration = 1;
 
    InitializeFileRouter(theEnv);
    InitializeStringRouter(theEnv);
@@ -141,20 +157,10 @@ bool PrintRouterExists(
   Environment *theEnv,
   const char *logicalName)
   {
-   struct router *currentPtr;
-   
    if (((char *) RouterData(theEnv)->FastSaveFilePtr) == logicalName)
      { return true; }
-     
-   currentPtr = RouterData(theEnv)->ListOfRouters;
-   while (currentPtr != NULL)
-     {
-      if ((currentPtr->writeCallback != NULL) ? QueryRouter(theEnv,logicalName,currentPtr) : false)
-        { return true; }
-      currentPtr = currentPtr->next;
-     }
-     
-   return false;
+
+   return (LookupRouterCache(theEnv,logicalName)->writeRouter != NULL);
   }
 
 /**********************************/
@@ -203,20 +209,16 @@ void WriteString(
       return;
      }
 
-   /*==============================================*/
-   /* Search through the list of routers until one */
-   /* is found that will handle the print request. */
-   /*==============================================*/
+   /*=============================================*/
+   /* Find the router that handles print requests */
+   /* for the logical name.                       */
+   /*=============================================*/
 
-   currentPtr = RouterData(theEnv)->ListOfRouters;
-   while (currentPtr != NULL)
+   currentPtr = LookupRouterCache(theEnv,logicalName)->writeRouter;
+   if (currentPtr != NULL)
      {
-      if ((currentPtr->writeCallback != NULL) ? QueryRouter(theEnv,logicalName,currentPtr) : false)
-        {
-         (*currentPtr->writeCallback)(theEnv,logicalName,str,currentPtr->context);
-         return;
-        }
-      currentPtr = currentPtr->next;
+      (*currentPtr->writeCallback)(theEnv,logicalName,str,currentPtr->context);
+      return;
      }
 
    /*=====================================================*/
@@ -283,28 +285,24 @@ int ReadRouter(
       return(inchar);
      }
 
-   /*==============================================*/
-   /* Search through the list of routers until one */
-   /* is found that will handle the getc request.  */
-   /*==============================================*/
+   /*============================================*/
+   /* Find the router that handles getc requests */
+   /* for the logical name.                      */
+   /*============================================*/
 
-   currentPtr = RouterData(theEnv)->ListOfRouters;
-   while (currentPtr != NULL)
+   currentPtr = LookupRouterCache(theEnv,logicalName)->readRouter;
+   if (currentPtr != NULL)
      {
-      if ((currentPtr->readCallback != NULL) ? QueryRouter(theEnv,logicalName,currentPtr) : false)
-        {
-         inchar = (*currentPtr->readCallback)(theEnv,logicalName,currentPtr->context);
+      inchar = (*currentPtr->readCallback)(theEnv,logicalName,currentPtr->context);
 
-         if (inchar == '\n')
-           {
-            if ((RouterData(theEnv)->LineCountRouter != NULL) &&
-                (strcmp(logicalName,RouterData(theEnv)->LineCountRouter) == 0))
-              { IncrementLineCount(theEnv); }
-           }
-
-         return(inchar);
+      if (inchar == '\n')
+        {
+         if ((RouterData(theEnv)->LineCountRouter != NULL) &&
+             (strcmp(logicalName,RouterData(theEnv)->LineCountRouter) == 0))
+           { IncrementLineCount(theEnv); }
         }
-      currentPtr = currentPtr->next;
+
+      return(inchar);
      }
 
    /*=====================================================*/
@@ -362,27 +360,22 @@ int UnreadRouter(
       return ch;
      }
 
-   /*===============================================*/
-   /* Search through the list of routers until one  */
-   /* is found that will handle the ungetc request. */
-   /*===============================================*/
+   /*==============================================*/
+   /* Find the router that handles ungetc requests */
+   /* for the logical name.                        */
+   /*==============================================*/
 
-   currentPtr = RouterData(theEnv)->ListOfRouters;
-   while (currentPtr != NULL)
+   currentPtr = LookupRouterCache(theEnv,logicalName)->unreadRouter;
+   if (currentPtr != NULL)
      {
-      if ((currentPtr->unreadCallback != NULL) ? QueryRouter(theEnv,logicalName,currentPtr) : false)
+      if (ch == '\n')
         {
-         if (ch == '\n')
-           {
-            if ((RouterData(theEnv)->LineCountRouter != NULL) &&
-                (strcmp(logicalName,RouterData(theEnv)->LineCountRouter) == 0))
-              { DecrementLineCount(theEnv); }
-           }
-
-         return (*currentPtr->unreadCallback)(theEnv,logicalName,ch,currentPtr->context);
+         if ((RouterData(theEnv)->LineCountRouter != NULL) &&
+             (strcmp(logicalName,RouterData(theEnv)->LineCountRouter) == 0))
+           { DecrementLineCount(theEnv); }
         }
 
-      currentPtr = currentPtr->next;
+      return (*currentPtr->unreadCallback)(theEnv,logicalName,ch,currentPtr->context);
      }
 
    /*=====================================================*/
@@ -393,6 +386,133 @@ int UnreadRouter(
    return -1;
   }
 
+/**************************************************/
+/* ReadBlockRouter: Generic get block function.   */
+/*   Reads characters until the buffer is full or */
+/*   a character in delimiters has been read (it  */
+/*   is the last character stored). The end of    */
+/*   the input has been reached if fewer than     */
+/*   size characters are returned and the last is */
+/*   not a delimiter. A NUL character always ends */
+/*   the block.                                   */
+/**************************************************/
+size_t ReadBlockRouter(
+  Environment *theEnv,
+  const char *logicalName,
+  char *buffer,
+  size_t size,
+  const char *delimiters)
+  {
+   struct router *currentPtr = NULL;
+   size_t count = 0, i;
+   int inchar;
+
+   /*===============================================*/
+   /* The fast string get option is read directly   */
+   /* from the string. The delimiters are kept in a */
+   /* bit set rather than searched with strchr.     */
+   /*===============================================*/
+
+   if (RouterData(theEnv)->FastCharGetRouter == logicalName)
+     { return ReadBlockFastCharGet(theEnv,buffer,size,delimiters); }
+
+   if (((char *) RouterData(theEnv)->FastLoadFilePtr) != logicalName)
+     { currentPtr = LookupRouterCache(theEnv,logicalName)->readRouter; }
+
+   /*===============================================*/
+   /* Routers without a block callback (and the     */
+   /* fast load option) are read a character at a   */
+   /* time.                                         */
+   /*===============================================*/
+
+   if ((currentPtr == NULL) || (currentPtr->readBlockCallback == NULL))
+     {
+      while (count < size)
+        {
+         inchar = ReadRouter(theEnv,logicalName);
+         if (inchar == EOF)
+           { break; }
+
+         buffer[count++] = (char) inchar;
+
+         if (strchr(delimiters,inchar) != NULL)
+           { break; }
+        }
+
+      return count;
+     }
+
+   count = (*currentPtr->readBlockCallback)(theEnv,logicalName,buffer,size,delimiters,currentPtr->context);
+
+   if ((RouterData(theEnv)->LineCountRouter != NULL) &&
+       (strcmp(logicalName,RouterData(theEnv)->LineCountRouter) == 0))
+     {
+      for (i = 0; i < count; i++)
+        {
+         if (buffer[i] == '\n')
+           { IncrementLineCount(theEnv); }
+        }
+     }
+
+   return count;
+  }
+
+/*****************************************************/
+/* ReadBlockFastCharGet: Reads a block for the fast  */
+/*   string get option. Characters are copied until  */
+/*   the buffer is full or a delimiter is copied. At */
+/*   the end of the string the index is incremented  */
+/*   once, as it is when ReadRouter returns EOF.     */
+/*****************************************************/
+static size_t ReadBlockFastCharGet(
+  Environment *theEnv,
+  char *buffer,
+  size_t size,
+  const char *delimiters)
+  {
+   unsigned long stops[(UCHAR_MAX + 1) / (sizeof(unsigned long) * CHAR_BIT)];
+   const unsigned char *theString, *start;
+   size_t count = 0, lines = 0, bits = sizeof(unsigned long) * CHAR_BIT;
+   unsigned char inchar;
+
+   memset(stops,0,sizeof(stops));
+   for (start = (const unsigned char *) delimiters; *start != '\0'; start++)
+     { stops[*start / bits] |= 1UL << (*start % bits); }
+
+   theString = (const unsigned char *) RouterData(theEnv)->FastCharGetString;
+   start = theString + RouterData(theEnv)->FastCharGetIndex;
+
+   while (count < size)
+     {
+      inchar = start[count];
+
+      if (inchar == '\0')
+        {
+         RouterData(theEnv)->FastCharGetIndex++;
+         break;
+        }
+
+      buffer[count++] = (char) inchar;
+
+      if (inchar == '\n')
+        { lines++; }
+
+      if (stops[inchar / bits] & (1UL << (inchar % bits)))
+        { break; }
+     }
+
+   RouterData(theEnv)->FastCharGetIndex += (long) count;
+
+   if ((lines > 0) &&
+       (RouterData(theEnv)->FastCharGetRouter == RouterData(theEnv)->LineCountRouter))
+     {
+      while (lines-- > 0)
+        { IncrementLineCount(theEnv); }
+     }
+
+   return count;
+  }
+
 /********************************************/
 /* ExitRouter: Generic exit function. Calls */
 /*   all of the router exit functions.      */
@@ -475,8 +595,12 @@ bool AddRouter(
    newPtr->exitCallback = exitFunction;
    newPtr->readCallback = readFunction;
    newPtr->unreadCallback = unreadFunction;
+   newPtr->readBlockCallback = NULL;
+   newPtr->writeBlockCallback = NULL;
    newPtr->next = NULL;
 
+   InvalidateRouterCache(theEnv);
+
    if (RouterData(theEnv)->ListOfRouters == NULL)
      {
       RouterData(theEnv)->ListOfRouters = newPtr;
@@ -505,6 +629,30 @@ bool AddRouter(
    return true;
   }
 
+/*********************************************************/
+/* SetRouterBlockCallbacks: Gives a router callbacks for */
+/*   reading and writing blocks of characters. Either    */
+/*   may be NULL, in which case the router is used a     */
+/*   character or a string at a time.                    */
+/*********************************************************/
+bool SetRouterBlockCallbacks(
+  Environment *theEnv,
+  const char *routerName,
+  RouterReadBlockFunction *readBlockFunction,
+  RouterWriteBlockFunction *writeBlockFunction)
+  {
+   struct router *currentPtr;
+
+   currentPtr = FindRouter(theEnv,routerName);
+   if (currentPtr == NULL)
+     { return false; }
+
+   currentPtr->readBlockCallback = readBlockFunction;
+   currentPtr->writeBlockCallback = writeBlockFunction;
+
+   return true;
+  }
+
 /*****************************************************************/
 /* DeleteRouter: Removes an I/O router from the list of routers. */
 /*****************************************************************/
@@ -521,6 +669,7 @@ bool DeleteRouter(
      {
       if (strcmp(currentPtr->name,routerName) == 0)
         {
+         InvalidateRouterCache(theEnv);
          genfree(theEnv,(void *) currentPtr->name,strlen(currentPtr->name) + 1);
          if (lastPtr == NULL)
            {
@@ -591,6 +740,131 @@ static bool QueryRouter(
    return false;
   }
 
+/*****************************************************/
+/* LookupRouterCache: Returns the cache entry for a  */
+/*   logical name, querying the routers only if the  */
+/*   entry is missing or out of date. The entry is   */
+/*   found by the address of the logical name, which */
+/*   is usually the contents of an interned symbol,  */
+/*   and then checked against a copy of the name in  */
+/*   case that address has since been reused.        */
+/*****************************************************/
+static struct routerCacheEntry *LookupRouterCache(
+  Environment *theEnv,
+  const char *logicalName)
+  {
+   struct routerCacheEntry *theEntry;
+   size_t tally;
+   union
+     {
+      const char *cv;
+      size_t sv;
+     } fis;
+
+   fis.sv = 0;
+   fis.cv = logicalName;
+   tally = (fis.sv >> 4) ^ (fis.sv >> 10);
+
+   theEntry = &RouterData(theEnv)->RouterCache[tally % ROUTER_CACHE_SIZE];
+
+   if ((theEntry->logicalName == logicalName) &&
+       (theEntry->generation == RouterData(theEnv)->CacheGeneration) &&
+       (strcmp(theEntry->name,logicalName) == 0))
+     { return theEntry; }
+
+   /*================================================*/
+   /* Names too long to copy are resolved each time. */
+   /*================================================*/
+
+   if (strlen(logicalName) >= ROUTER_CACHE_NAME_SIZE)
+     {
+      theEntry = &RouterData(theEnv)->UncachedRouters;
+      ResolveRouters(theEnv,logicalName,theEntry);
+      theEntry->logicalName = NULL;
+      return theEntry;
+     }
+
+   ResolveRouters(theEnv,logicalName,theEntry);
+   theEntry->logicalName = logicalName;
+   theEntry->generation = RouterData(theEnv)->CacheGeneration;
+   genstrcpy(theEntry->name,logicalName);
+
+   return theEntry;
+  }
+
+/**************************************************/
+/* ResolveRouters: Finds the highest priority     */
+/*   router that recognizes a logical name for    */
+/*   each of writing, reading, and unreading in a */
+/*   single pass over the routers.                */
+/**************************************************/
+static void ResolveRouters(
+  Environment *theEnv,
+  const char *logicalName,
+  struct routerCacheEntry *theEntry)
+  {
+   struct router *currentPtr;
+
+   theEntry->writeRouter = NULL;
+   theEntry->readRouter = NULL;
+   theEntry->unreadRouter = NULL;
+
+   for (currentPtr = RouterData(theEnv)->ListOfRouters;
+        currentPtr != NULL;
+        currentPtr = currentPtr->next)
+     {
+      if (((theEntry->writeRouter != NULL) || (currentPtr->writeCallback == NULL)) &&
+          ((theEntry->readRouter != NULL) || (currentPtr->readCallback == NULL)) &&
+          ((theEntry->unreadRouter != NULL) || (currentPtr->unreadCallback == NULL)))
+        { continue; }
+
+      if (! QueryRouter(theEnv,logicalName,currentPtr))
+        { continue; }
+
+      if ((theEntry->writeRouter == NULL) && (currentPtr->writeCallback != NULL))
+        { theEntry->writeRouter = currentPtr; }
+
+      if ((theEntry->readRouter == NULL) && (currentPtr->readCallback != NULL))
+        { theEntry->readRouter = currentPtr; }
+
+      if ((theEntry->unreadRouter == NULL) && (currentPtr->unreadCallback != NULL))
+        { theEntry->unreadRouter = currentPtr; }
+     }
+  }
+
+/********************************************************/
+/* InvalidateRouterCache: Forgets which routers handle  */
+/*   every logical name. Called whenever a router is    */
+/*   added, deleted, activated, or deactivated.         */
+/********************************************************/
+void InvalidateRouterCache(
+  Environment *theEnv)
+  {
+   RouterData(theEnv)->CacheGeneration++;
+  }
+
+/*******************************************************/
+/* RouterNameChanged: Forgets which routers handle a   */
+/*   logical name. Routers whose set of recognized     */
+/*   names changes, such as when a file or connection  */
+/*   is opened or closed, call this for that name.     */
+/*******************************************************/
+void RouterNameChanged(
+  Environment *theEnv,
+  const char *logicalName)
+  {
+   int i;
+   struct routerCacheEntry *theEntry;
+
+   for (i = 0; i < ROUTER_CACHE_SIZE; i++)
+     {
+      theEntry = &RouterData(theEnv)->RouterCache[i];
+      if ((theEntry->logicalName != NULL) &&
+          (strcmp(theEntry->name,logicalName) == 0))
+        { theEntry->logicalName = NULL; }
+     }
+  }
+
 /*******************************************************/
 /* DeactivateRouter: Deactivates a specific router. */
 /*******************************************************/
@@ -607,6 +881,7 @@ bool DeactivateRouter(
       if (strcmp(currentPtr->name,routerName) == 0)
         {
          currentPtr->active = false;
+         InvalidateRouterCache(theEnv);
          return true;
         }
       currentPtr = currentPtr->next;
@@ -631,6 +906,7 @@ bool ActivateRouter(
       if (strcmp(currentPtr->name,routerName) == 0)
         {
          currentPtr->active = true;
+         InvalidateRouterCache(theEnv);
          return true;
         }
       currentPtr = currentPtr->next;
@@ -720,7 +996,29 @@ void PrintNRouter(
   const char *str,
   unsigned long length)
   {
+   struct router *currentPtr;
    char *tempStr;
+   const char *endOfString;
+
+   /*===============================================*/
+   /* A router with a block callback is handed the  */
+   /* characters directly, up to any NUL character, */
+   /* rather than a terminated copy of them.        */
+   /*===============================================*/
+
+   if (((char *) RouterData(theEnv)->FastSaveFilePtr) != logicalName)
+     {
+      currentPtr = LookupRouterCache(theEnv,logicalName)->writeRouter;
+      if ((currentPtr != NULL) && (currentPtr->writeBlockCallback != NULL))
+        {
+         endOfString = (const char *) memchr(str,EOS,length);
+         if (endOfString != NULL)
+           { length = (unsigned long) (endOfString - str); }
+
+         (*currentPtr->writeBlockCallback)(theEnv,logicalName,str,length,currentPtr->context);
+         return;
+        }
+     }
 
    tempStr = (char *) genalloc(theEnv,length+1);
    tempStr[0] = EOS;
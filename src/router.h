@@ -63,6 +63,11 @@
 /*            Removed WPROMPT, WDISPLAY, WTRACE, and WDIALOG */
 /*            logical names.                                 */
 /*                                                           */
+/*      ?.??: Added a cache of the routers that handle each  */
+/*            logical name.                                  */
+/*                                                           */
+/*            Added block read and write callbacks.          */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_router
@@ -79,6 +84,8 @@ typedef void RouterWriteFunction(Environment *,const char *,const char *,void *)
 typedef void RouterExitFunction(Environment *,int,void *);
 typedef int RouterReadFunction(Environment *,const char *,void *);
 typedef int RouterUnreadFunction(Environment *,const char *,int,void *);
+typedef size_t RouterReadBlockFunction(Environment *,const char *,char *,size_t,const char *,void *);
+typedef void RouterWriteBlockFunction(Environment *,const char *,const char *,size_t,void *);
 
 extern const char *STDOUT;
 extern const char *STDIN;
@@ -87,6 +94,11 @@ extern const char *STDWRN;
 
 #define ROUTER_DATA 46
 
+#define ROUTER_CACHE_SIZE 64
+#define ROUTER_CACHE_NAME_SIZE 64
+
+#define ROUTER_BLOCK_SIZE 256
+
 struct router
   {
    const char *name;
@@ -98,9 +110,21 @@ struct router
    RouterExitFunction *exitCallback;
    RouterReadFunction *readCallback;
    RouterUnreadFunction *unreadCallback;
+   RouterReadBlockFunction *readBlockCallback;
+   RouterWriteBlockFunction *writeBlockCallback;
    Router *next;
   };
 
+struct routerCacheEntry
+  {
+   const char *logicalName;
+   unsigned long generation;
+   Router *writeRouter;
+   Router *readRouter;
+   Router *unreadRouter;
+   char name[ROUTER_CACHE_NAME_SIZE];
+  };
+
 struct routerData
   {
    size_t CommandBufferInputCount;
@@ -114,6 +138,9 @@ struct routerData
    FILE *FastLoadFilePtr;
    FILE *FastSaveFilePtr;
    bool Abort;
+   unsigned long CacheGeneration;
+   struct routerCacheEntry RouterCache[ROUTER_CACHE_SIZE];
+   struct routerCacheEntry UncachedRouters;
   };
 
 #define RouterData(theEnv) ((struct routerData *) GetEnvironmentData(theEnv,ROUTER_DATA))
@@ -124,12 +151,16 @@ struct routerData
    void                           Writeln(Environment *,const char *);
    int                            ReadRouter(Environment *,const char *);
    int                            UnreadRouter(Environment *,const char *,int);
+   size_t                         ReadBlockRouter(Environment *,const char *,char *,size_t,const char *);
    void                           ExitRouter(Environment *,int);
    void                           AbortExit(Environment *);
    bool                           AddRouter(Environment *,const char *,int,
                                             RouterQueryFunction *,RouterWriteFunction *,
                                             RouterReadFunction *,RouterUnreadFunction *,
                                             RouterExitFunction *,void *);
+   bool                           SetRouterBlockCallbacks(Environment *,const char *,
+                                                          RouterReadBlockFunction *,
+                                                          RouterWriteBlockFunction *);
    bool                           DeleteRouter(Environment *,const char *);
    bool                           QueryRouters(Environment *,const char *);
    bool                           DeactivateRouter(Environment *,const char *);
@@ -143,5 +174,7 @@ struct routerData
    size_t                         InputBufferCount(Environment *);
    Router                        *FindRouter(Environment *,const char *);
    bool                           PrintRouterExists(Environment *,const char *);
+   void                           InvalidateRouterCache(Environment *);
+   void                           RouterNameChanged(Environment *,const char *);
 
 #endif /* _H_router */
@@ -42,6 +42,12 @@
 /*                                                           */
 /*            Support for certainty factors.                 */
 /*                                                           */
+/*      ?.??: Bsave support for range index expressions.     */
+/*                                                           */
+/*            Bsave support for aggregate joins.             */
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -625,6 +631,8 @@ static void BsaveJoin(
    joinPtr->marked = 0;
    tempJoin.depth = joinPtr->depth;
    tempJoin.rhsType = joinPtr->rhsType;
+   tempJoin.rangeAtMost = joinPtr->rangeAtMost;
+   tempJoin.aggregate = joinPtr->aggregate;
    tempJoin.firstJoin = joinPtr->firstJoin;
    tempJoin.logicalJoin = joinPtr->logicalJoin;
    tempJoin.goalJoin = joinPtr->goalJoin;
@@ -646,6 +654,8 @@ static void BsaveJoin(
    tempJoin.goalExpression = HashedExpressionIndex(theEnv,joinPtr->goalExpression);
    tempJoin.leftHash = HashedExpressionIndex(theEnv,joinPtr->leftHash);
    tempJoin.rightHash = HashedExpressionIndex(theEnv,joinPtr->rightHash);
+   tempJoin.leftRange = HashedExpressionIndex(theEnv,joinPtr->leftRange);
+   tempJoin.aggregateExpression = HashedExpressionIndex(theEnv,joinPtr->aggregateExpression);
 
    if (joinPtr->ruleToActivate != NULL)
      {
@@ -777,6 +787,7 @@ void AssignBsavePatternHeaderValues(
    theBsaveHeader->multifieldNode = theHeader->multifieldNode;
    theBsaveHeader->entryJoin = BsaveJoinIndex(theHeader->entryJoin);
    theBsaveHeader->rightHash = HashedExpressionIndex(theEnv,theHeader->rightHash);
+   theBsaveHeader->rightRange = HashedExpressionIndex(theEnv,theHeader->rightRange);
    theBsaveHeader->singlefieldNode = theHeader->singlefieldNode;
    theBsaveHeader->stopNode = theHeader->stopNode;
    theBsaveHeader->beginSlot = theHeader->beginSlot;
@@ -990,11 +1001,15 @@ static void UpdateJoin(
    DefruleBinaryData(theEnv)->JoinArray[obji].patternIsExists = bj->patternIsExists;
    DefruleBinaryData(theEnv)->JoinArray[obji].depth = bj->depth;
    DefruleBinaryData(theEnv)->JoinArray[obji].rhsType = bj->rhsType;
+   DefruleBinaryData(theEnv)->JoinArray[obji].rangeAtMost = bj->rangeAtMost;
+   DefruleBinaryData(theEnv)->JoinArray[obji].aggregate = bj->aggregate;
    DefruleBinaryData(theEnv)->JoinArray[obji].networkTest = HashedExpressionPointer(bj->networkTest);
    DefruleBinaryData(theEnv)->JoinArray[obji].secondaryNetworkTest = HashedExpressionPointer(bj->secondaryNetworkTest);
    DefruleBinaryData(theEnv)->JoinArray[obji].goalExpression = HashedExpressionPointer(bj->goalExpression);
    DefruleBinaryData(theEnv)->JoinArray[obji].leftHash = HashedExpressionPointer(bj->leftHash);
    DefruleBinaryData(theEnv)->JoinArray[obji].rightHash = HashedExpressionPointer(bj->rightHash);
+   DefruleBinaryData(theEnv)->JoinArray[obji].leftRange = HashedExpressionPointer(bj->leftRange);
+   DefruleBinaryData(theEnv)->JoinArray[obji].aggregateExpression = HashedExpressionPointer(bj->aggregateExpression);
    DefruleBinaryData(theEnv)->JoinArray[obji].nextLinks = BloadJoinLinkPointer(bj->nextLinks);
    DefruleBinaryData(theEnv)->JoinArray[obji].lastLevel = BloadJoinPointer(bj->lastLevel);
 
@@ -1010,6 +1025,14 @@ static void UpdateJoin(
    DefruleBinaryData(theEnv)->JoinArray[obji].bsaveID = 0L;
    DefruleBinaryData(theEnv)->JoinArray[obji].leftMemory = NULL;
    DefruleBinaryData(theEnv)->JoinArray[obji].rightMemory = NULL;
+#if PROFILING_FUNCTIONS
+   DefruleBinaryData(theEnv)->JoinArray[obji].leftActivations = 0;
+   DefruleBinaryData(theEnv)->JoinArray[obji].rightActivations = 0;
+   DefruleBinaryData(theEnv)->JoinArray[obji].testEvaluations = 0;
+   DefruleBinaryData(theEnv)->JoinArray[obji].hashProbes = 0;
+   DefruleBinaryData(theEnv)->JoinArray[obji].leftMemoryPeak = 0;
+   DefruleBinaryData(theEnv)->JoinArray[obji].rightMemoryPeak = 0;
+#endif
 
    AddBetaMemoriesToJoin(theEnv,&DefruleBinaryData(theEnv)->JoinArray[obji]);
   }
@@ -1053,6 +1076,9 @@ void UpdatePatternNodeHeader(
    theHeader->firstHash = NULL;
    theHeader->lastHash = NULL;
    theHeader->rightHash = HashedExpressionPointer(theBsaveHeader->rightHash);
+   theHeader->rightRange = HashedExpressionPointer(theBsaveHeader->rightRange);
+   theHeader->alphaCount = 0;
+   theHeader->alphaPeak = 0;
 
    theJoin = BloadJoinPointer(theBsaveHeader->entryJoin);
    theHeader->entryJoin = theJoin;
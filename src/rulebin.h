@@ -41,6 +41,10 @@
 /*                                                           */
 /*            Support for certainty factors.                 */
 /*                                                           */
+/*      ?.??: Bsave support for range index expressions.     */
+/*                                                           */
+/*            Bsave support for aggregate joins.             */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_rulebin
@@ -74,6 +78,7 @@ struct bsavePatternNodeHeader
   {
    unsigned long entryJoin;
    unsigned long rightHash;
+   unsigned long rightRange;
    unsigned int singlefieldNode : 1;
    unsigned int multifieldNode : 1;
    unsigned int stopNode : 1;
@@ -107,12 +112,16 @@ struct bsaveJoinNode
    unsigned int patternIsNegated : 1;
    unsigned int patternIsExists : 1;
    unsigned int rhsType : 3;
+   unsigned int rangeAtMost : 1;
+   unsigned int aggregate : 3;
    unsigned int depth : 7;
    unsigned long networkTest;
    unsigned long secondaryNetworkTest;
    unsigned long goalExpression;
    unsigned long leftHash;
    unsigned long rightHash;
+   unsigned long leftRange;
+   unsigned long aggregateExpression;
    unsigned long rightSideEntryStructure;
    unsigned long nextLinks;
    unsigned long lastLevel;
@@ -46,6 +46,15 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Joins for not and exists CEs store the range   */
+/*            index expression of the pattern.               */
+/*                                                           */
+/*            Added the aggregate joins of the accumulate CE.*/
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
+/*            Beta memories count their resizes.             */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -75,12 +84,15 @@
 
    static struct joinNode        *FindShareableJoin(struct joinLink *,struct joinNode *,bool,void *,bool,bool,
                                                     bool,bool,struct expr *,struct expr *,
-                                                    struct expr *,struct expr *,bool);
+                                                    struct expr *,struct expr *,struct expr *,bool,bool,
+                                                    unsigned int,struct expr *);
    static bool                    TestJoinForReuse(struct joinNode *,bool,bool,
                                                    bool,bool,struct expr *,struct expr *,
-                                                   struct expr *,struct expr *,bool);
+                                                   struct expr *,struct expr *,struct expr *,bool,bool,
+                                                   unsigned int,struct expr *);
    static struct joinNode        *CreateNewJoin(Environment *,struct expr *,struct expr *,struct joinNode *,void *,
-                                                bool,bool,bool,struct expr *,struct expr *,struct expr *,bool);
+                                                bool,bool,bool,struct expr *,struct expr *,struct expr *,bool,
+                                                struct expr *,bool);
 
 /****************************************************************/
 /* ConstructJoins: Integrates a set of pattern and join tests   */
@@ -104,6 +116,7 @@ struct joinNode *ConstructJoins(
    bool lastIteration = false;
    unsigned short rhsType;
    struct expr *leftHash, *rightHash;
+   struct expr *leftRange;
    void *rhsStruct;
    struct lhsParseNode *nextLHS;
    struct expr *networkTest, *secondaryNetworkTest, *secondaryExternalTest;
@@ -116,10 +129,11 @@ struct joinNode *ConstructJoins(
    if (theLHS == NULL)
      {
       lastJoin = FindShareableJoin(DefruleData(theEnv)->RightPrimeJoins,NULL,true,NULL,true,
-                                   false,false,false,NULL,NULL,NULL,NULL,false);
+                                   false,false,false,NULL,NULL,NULL,NULL,NULL,false,false,
+                                   NO_AGGREGATE,NULL);
 
       if (lastJoin == NULL)
-        { lastJoin = CreateNewJoin(theEnv,NULL,NULL,NULL,NULL,false,false,false,NULL,NULL,NULL,false); }
+        { lastJoin = CreateNewJoin(theEnv,NULL,NULL,NULL,NULL,false,false,false,NULL,NULL,NULL,false,NULL,false); }
      }
 
    /*=====================================================*/
@@ -213,6 +227,7 @@ struct joinNode *ConstructJoins(
          secondaryNetworkTest = secondaryExternalTest;
          leftHash = theLHS->externalLeftHash;
          rightHash = theLHS->externalRightHash;
+         leftRange = NULL;
         }
 
       /*=======================================================*/
@@ -233,6 +248,7 @@ struct joinNode *ConstructJoins(
          secondaryNetworkTest = theLHS->secondaryNetworkTest;
          leftHash = NULL;
          rightHash = NULL;
+         leftRange = NULL;
         }
       else
         {
@@ -246,6 +262,7 @@ struct joinNode *ConstructJoins(
          secondaryNetworkTest = theLHS->secondaryNetworkTest;
          leftHash = theLHS->leftHash;
          rightHash = theLHS->rightHash;
+         leftRange = theLHS->leftRange;
         }
 
       /*======================================================*/
@@ -282,7 +299,9 @@ struct joinNode *ConstructJoins(
           ((oldJoin = FindShareableJoin(theLinks,listOfJoins,useLinks,rhsStruct,firstJoin,
                                         theLHS->negated,isExists,isLogical,
                                         networkTest,secondaryNetworkTest,
-                                        leftHash,rightHash,theLHS->explicitCE)) != NULL) )
+                                        leftHash,rightHash,leftRange,theLHS->rangeAtMost,
+                                        theLHS->explicitCE,theLHS->aggregate,
+                                        theLHS->aggregateValue)) != NULL) )
         {
 #if DEBUGGING_FUNCTIONS
          if ((GetWatchItem(theEnv,"compilations") == 1) && GetPrintWhileLoading(theEnv))
@@ -297,8 +316,20 @@ struct joinNode *ConstructJoins(
            {
             lastJoin = CreateNewJoin(theEnv,networkTest,secondaryNetworkTest,lastJoin,
                                      lastPattern,false,theLHS->negated, isExists,
-                                     leftHash,rightHash,goalExpression,theLHS->explicitCE);
+                                     leftHash,rightHash,goalExpression,theLHS->explicitCE,
+                                     leftRange,theLHS->rangeAtMost);
             lastJoin->rhsType = rhsType;
+
+            /*=========================================*/
+            /* The join of an accumulate CE aggregates */
+            /* the matches of its right memory.        */
+            /*=========================================*/
+
+            if (theLHS->aggregate != NO_AGGREGATE)
+              {
+               lastJoin->aggregate = theLHS->aggregate;
+               lastJoin->aggregateExpression = AddHashedExpression(theEnv,theLHS->aggregateValue);
+              }
             
             if ((! theLHS->negated) &&
                 (! theLHS->explicitCE) && generatesGoal)
@@ -308,7 +339,8 @@ struct joinNode *ConstructJoins(
            {
             lastJoin = CreateNewJoin(theEnv,networkTest,secondaryNetworkTest,lastJoin,
                                      lastRightJoin,true,theLHS->negated, isExists,
-                                     leftHash,rightHash,goalExpression,theLHS->explicitCE);
+                                     leftHash,rightHash,goalExpression,theLHS->explicitCE,
+                                     NULL,false);
             lastJoin->rhsType = rhsType;
            }
         }
@@ -340,7 +372,7 @@ struct joinNode *ConstructJoins(
    if (startDepth == 1)
      {
       lastJoin = CreateNewJoin(theEnv,NULL,NULL,lastJoin,NULL,
-                               false,false,false,NULL,NULL,NULL,false);
+                               false,false,false,NULL,NULL,NULL,false,NULL,false);
      }
 
    /*===================================================*/
@@ -399,6 +431,20 @@ void AttachTestCEsToPatternCEs(
          continue;
         }
 
+      /*=======================================================*/
+      /* The network test of an accumulate CE is applied to    */
+      /* each match being aggregated, so a TEST CE following   */
+      /* it is left as a separate join that tests the value.   */
+      /*=======================================================*/
+
+      if (lastNode->aggregate != NO_AGGREGATE)
+        {
+         lastLastNode = lastNode;
+         lastNode = theLHS;
+         theLHS = theLHS->bottom;
+         continue;
+        }
+
       /*=====================================================*/
       /* If this is the beginning of a new NOT/AND CE group, */
       /* then we can't attach this TEST CE to a preceding    */
@@ -933,7 +979,11 @@ static struct joinNode *FindShareableJoin(
   struct expr *secondaryJoinTest,
   struct expr *leftHash,
   struct expr *rightHash,
-  bool isExplicit)
+  struct expr *leftRange,
+  bool rangeAtMost,
+  bool isExplicit,
+  unsigned int aggregate,
+  struct expr *aggregateExpression)
   {
    /*========================================*/
    /* Loop through all of the joins in the   */
@@ -961,7 +1011,8 @@ static struct joinNode *FindShareableJoin(
         {
          if (TestJoinForReuse(listOfJoins,firstJoin,negatedRHS,existsRHS,
                               isLogical,joinTest,secondaryJoinTest,
-                              leftHash,rightHash,isExplicit))
+                              leftHash,rightHash,leftRange,rangeAtMost,isExplicit,
+                              aggregate,aggregateExpression))
            { return(listOfJoins); }
         }
 
@@ -1009,7 +1060,11 @@ static bool TestJoinForReuse(
   struct expr *secondaryJoinTest,
   struct expr *leftHash,
   struct expr *rightHash,
-  bool isExplicit)
+  struct expr *leftRange,
+  bool rangeAtMost,
+  bool isExplicit,
+  unsigned int aggregate,
+  struct expr *aggregateExpression)
   {
    /*==================================================*/
    /* The first join of a rule may only be shared with */
@@ -1065,6 +1120,16 @@ static bool TestJoinForReuse(
 
    if (IdenticalExpression(testJoin->rightHash,rightHash) != true)
      { return false; }
+
+   /*===========================================================*/
+   /* The range index expression and direction must also match. */
+   /*===========================================================*/
+
+   if (IdenticalExpression(testJoin->leftRange,leftRange) != true)
+     { return false; }
+
+   if (testJoin->rangeAtMost != rangeAtMost)
+     { return false; }
      
    /*=======================================*/
    /* An explicit join can't be shared with */
@@ -1073,6 +1138,16 @@ static bool TestJoinForReuse(
    
    if (testJoin->explicitJoin != isExplicit) return false;
 
+   /*==================================================*/
+   /* The join of an accumulate CE can only be shared  */
+   /* with a join computing the identical aggregate.   */
+   /*==================================================*/
+
+   if (testJoin->aggregate != aggregate) return false;
+
+   if (IdenticalExpression(testJoin->aggregateExpression,aggregateExpression) != true)
+     { return false; }
+
    /*=============================================*/
    /* The join can be shared since all conditions */
    /* for sharing have been satisfied.            */
@@ -1096,7 +1171,9 @@ static struct joinNode *CreateNewJoin(
   struct expr *leftHash,
   struct expr *rightHash,
   struct expr *goalExpression,
-  bool isExplicit)
+  bool isExplicit,
+  struct expr *leftRange,
+  bool rangeAtMost)
   {
    struct joinNode *newJoin;
    struct joinLink *theLink;
@@ -1133,6 +1210,7 @@ static struct joinNode *CreateNewJoin(
          newJoin->leftMemory->beta[0] = NULL;
          newJoin->leftMemory->last = NULL;
          newJoin->leftMemory->size = 1;
+         newJoin->leftMemory->resizes = 0;
          newJoin->leftMemory->count = 0;
          }
       else
@@ -1142,6 +1220,7 @@ static struct joinNode *CreateNewJoin(
          memset(newJoin->leftMemory->beta,0,sizeof(struct partialMatch *) * INITIAL_BETA_HASH_SIZE);
          newJoin->leftMemory->last = NULL;
          newJoin->leftMemory->size = INITIAL_BETA_HASH_SIZE;
+         newJoin->leftMemory->resizes = 0;
          newJoin->leftMemory->count = 0;
         }
 
@@ -1172,6 +1251,7 @@ static struct joinNode *CreateNewJoin(
          newJoin->rightMemory->beta[0] = NULL;
          newJoin->rightMemory->last[0] = NULL;
          newJoin->rightMemory->size = 1;
+         newJoin->rightMemory->resizes = 0;
          newJoin->rightMemory->count = 0;
          }
       else
@@ -1182,6 +1262,7 @@ static struct joinNode *CreateNewJoin(
          memset(newJoin->rightMemory->beta,0,sizeof(struct partialMatch *) * INITIAL_BETA_HASH_SIZE);
          memset(newJoin->rightMemory->last,0,sizeof(struct partialMatch *) * INITIAL_BETA_HASH_SIZE);
          newJoin->rightMemory->size = INITIAL_BETA_HASH_SIZE;
+         newJoin->rightMemory->resizes = 0;
          newJoin->rightMemory->count = 0;
         }
      }
@@ -1195,6 +1276,7 @@ static struct joinNode *CreateNewJoin(
       newJoin->rightMemory->beta[0]->rhsMemory = true;
       newJoin->rightMemory->last[0] = newJoin->rightMemory->beta[0];
       newJoin->rightMemory->size = 1;
+      newJoin->rightMemory->resizes = 0;
       newJoin->rightMemory->count = 1;
      }
    else
@@ -1222,6 +1304,14 @@ static struct joinNode *CreateNewJoin(
    newJoin->memoryRightDeletes = 0;
    newJoin->memoryCompares = 0;
 #endif
+#if PROFILING_FUNCTIONS
+   newJoin->leftActivations = 0;
+   newJoin->rightActivations = 0;
+   newJoin->testEvaluations = 0;
+   newJoin->hashProbes = 0;
+   newJoin->leftMemoryPeak = 0;
+   newJoin->rightMemoryPeak = 0;
+#endif
 
    /*==============================================*/
    /* Install the expressions used to determine    */
@@ -1269,6 +1359,17 @@ static struct joinNode *CreateNewJoin(
    newJoin->leftHash = AddHashedExpression(theEnv,leftHash);
    newJoin->rightHash = AddHashedExpression(theEnv,rightHash);
 
+   /*=================================================*/
+   /* Install the expression used to search the range */
+   /* index of the alpha memory for a partial match.  */
+   /*=================================================*/
+
+   newJoin->leftRange = AddHashedExpression(theEnv,leftRange);
+   newJoin->rangeAtMost = rangeAtMost;
+
+   newJoin->aggregate = NO_AGGREGATE;
+   newJoin->aggregateExpression = NULL;
+
    /*============================================================*/
    /* Initialize the values associated with the LHS of the join. */
    /*============================================================*/
@@ -47,6 +47,13 @@
 /*                                                           */
 /*            Support for certainty factors.                 */
 /*                                                           */
+/*      ?.??: Constructs-to-c support for range index        */
+/*            expressions.                                   */
+/*                                                           */
+/*            Constructs-to-c support for aggregate joins.   */
+/*                                                           */
+/*            Added join profiling counters.                 */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -523,7 +530,7 @@ static void JoinToCode(
    /* Flags and Integer Values. */
    /*===========================*/
 
-   fprintf(joinFile,"{%d,%d,%d,%d,%d,%d,%d,0,0,0,%d,%d,0,",
+   fprintf(joinFile,"{%d,%d,%d,%d,%d,%d,%d,0,0,0,%d,%d,%d,%d,0,",
                    theJoin->firstJoin,theJoin->logicalJoin,
                    theJoin->goalJoin,
                    theJoin->explicitJoin,
@@ -532,7 +539,8 @@ static void JoinToCode(
                    // initialize,
                    // marked
                    // goalMarked
-                   theJoin->rhsType,theJoin->depth);
+                   theJoin->rhsType,theJoin->rangeAtMost,theJoin->aggregate,
+                   theJoin->depth);
                    // bsaveID
 
    fprintf(joinFile,"0,0,0,0,0,");
@@ -542,6 +550,14 @@ static void JoinToCode(
                    // memoryRightDeletes
                    // memoryCompares
 
+   fprintf(joinFile,"0,0,0,0,0,0,");
+                   // leftActivations
+                   // rightActivations
+                   // testEvaluations
+                   // hashProbes
+                   // leftMemoryPeak
+                   // rightMemoryPeak
+
    /*==========================*/
    /* Left and right Memories. */
    /*==========================*/
@@ -567,6 +583,12 @@ static void JoinToCode(
    PrintHashedExpressionReference(theEnv,joinFile,theJoin->rightHash,imageID,maxIndices);
    fprintf(joinFile,",");
 
+   PrintHashedExpressionReference(theEnv,joinFile,theJoin->leftRange,imageID,maxIndices);
+   fprintf(joinFile,",");
+
+   PrintHashedExpressionReference(theEnv,joinFile,theJoin->aggregateExpression,imageID,maxIndices);
+   fprintf(joinFile,",");
+
    /*============================*/
    /* Right Side Entry Structure */
    /*============================*/
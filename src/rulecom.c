@@ -76,6 +76,16 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Join display includes the range index          */
+/*            expression.                                    */
+/*                                                           */
+/*            Join display includes the aggregate of an      */
+/*            accumulate CE.                                 */
+/*                                                           */
+/*            Added profiling of joins.                      */
+/*                                                           */
+/*            Added beta-memory-statistics command.          */
+/*                                                           */
 /*************************************************************/
 
 #include <stdio.h>
@@ -85,6 +95,7 @@
 
 #if DEFRULE_CONSTRUCT
 
+#include "aggregat.h"
 #include "argacces.h"
 #include "constant.h"
 #include "constrct.h"
@@ -135,6 +146,12 @@
    static const char             *BetaHeaderString(Environment *,struct joinInformation *,long,long);
    static const char             *ActivityHeaderString(Environment *,struct joinInformation *,long,long);
    static void                    JoinActivityReset(Environment *,ConstructHeader *,void *);
+   static void                    ListBetaMemoryStatistics(Environment *,const char *,const char *,struct betaMemory *);
+#if PROFILING_FUNCTIONS
+   static bool                    JoinProfileHasActivity(struct joinInformation *,unsigned short);
+   static void                    ListBetaJoinProfile(Environment *,struct joinInformation *,long,long);
+   static void                    JoinProfileMemoryString(char *,size_t,struct betaMemory *,unsigned long);
+#endif
 #if DEFTEMPLATE_CONSTRUCT
    static void                    WhyTraversePatternNetwork(Environment *,struct factPatternNode *,struct fact *);
    static void                    WhyListRules(Environment *,struct joinLink *);
@@ -162,6 +179,7 @@ void DefruleCommands(
    AddUDF(theEnv,"matches","bm",1,2,"y",MatchesCommand,"MatchesCommand",NULL);
    AddUDF(theEnv,"join-activity","bm",1,2,"y",JoinActivityCommand,"JoinActivityCommand",NULL);
    AddUDF(theEnv,"join-activity-reset","v",0,0,NULL,JoinActivityResetCommand,"JoinActivityResetCommand",NULL);
+   AddUDF(theEnv,"beta-memory-statistics","v",1,1,"y",BetaMemoryStatisticsCommand,"BetaMemoryStatisticsCommand",NULL);
    AddUDF(theEnv,"list-focus-stack","v",0,0,NULL,ListFocusStackCommand,"ListFocusStackCommand",NULL);
    AddUDF(theEnv,"dependencies","v",1,1,"infly",DependenciesCommand,"DependenciesCommand",NULL);
    AddUDF(theEnv,"dependents","v",1,1,"infly",DependentsCommand,"DependentsCommand",NULL);
@@ -1312,6 +1330,325 @@ void JoinActivityResetCommand(
                       DefruleData(theEnv)->DefruleModuleIndex,true,NULL);
   }
 
+#if PROFILING_FUNCTIONS
+
+/*****************************************************/
+/* ListJoinProfile: Prints the activity counted for  */
+/*   each join of a rule while joins were profiled.  */
+/*   Rules with no activity aren't listed.           */
+/*****************************************************/
+void ListJoinProfile(
+  Environment *theEnv,
+  Defrule *theRule)
+  {
+   Defrule *rulePtr;
+   long disjunctCount, disjunctIndex, joinIndex;
+   unsigned short arraySize;
+   struct joinInformation *theInfo;
+   char buffer[32];
+
+   disjunctCount = GetDisjunctCount(theEnv,theRule);
+
+   for (disjunctIndex = 1; disjunctIndex <= disjunctCount; disjunctIndex++)
+     {
+      if (GetHaltExecution(theEnv) == true)
+        { return; }
+
+      rulePtr = GetNthDisjunct(theEnv,theRule,disjunctIndex);
+
+      arraySize = BetaJoinCount(theEnv,rulePtr);
+      theInfo = CreateJoinArray(theEnv,arraySize);
+      BetaJoins(theEnv,rulePtr,arraySize,theInfo);
+
+      if (JoinProfileHasActivity(theInfo,arraySize))
+        {
+         WriteString(theEnv,STDOUT,DefruleName(theRule));
+         if (disjunctCount > 1)
+           {
+            snprintf(buffer,sizeof(buffer)," (disjunct %ld)",disjunctIndex);
+            WriteString(theEnv,STDOUT,buffer);
+           }
+         WriteString(theEnv,STDOUT,"\n");
+
+         for (joinIndex = 0; joinIndex < arraySize; joinIndex++)
+           { ListBetaJoinProfile(theEnv,theInfo,joinIndex,arraySize); }
+        }
+
+      FreeJoinArray(theEnv,theInfo,arraySize);
+     }
+  }
+
+/********************************************************/
+/* JoinProfileHasActivity: Returns true if any join of  */
+/*   a rule was activated while joins were profiled.    */
+/********************************************************/
+static bool JoinProfileHasActivity(
+  struct joinInformation *theInfo,
+  unsigned short arraySize)
+  {
+   unsigned short i;
+
+   for (i = 0; i < arraySize; i++)
+     {
+      if ((theInfo[i].theJoin->leftActivations != 0) ||
+          (theInfo[i].theJoin->rightActivations != 0))
+        { return true; }
+     }
+
+   return false;
+  }
+
+/***********************************************************/
+/* ListBetaJoinProfile: Prints the activation, test, probe */
+/*   and memory size counts of a join. The right memory of */
+/*   a join attached to a pattern is its alpha memory.     */
+/***********************************************************/
+static void ListBetaJoinProfile(
+  Environment *theEnv,
+  struct joinInformation *infoArray,
+  long joinIndex,
+  long arraySize)
+  {
+   struct joinNode *theJoin = infoArray[joinIndex].theJoin;
+   struct patternNodeHeader *theHeader;
+   char theCE[64], leftMemory[32], rightMemory[32];
+   char buffer[256];
+   unsigned long peak;
+
+   snprintf(theCE,sizeof(theCE),"   CE %s",ActivityHeaderString(theEnv,infoArray,joinIndex,arraySize));
+
+   JoinProfileMemoryString(leftMemory,sizeof(leftMemory),theJoin->leftMemory,theJoin->leftMemoryPeak);
+
+   if (theJoin->joinFromTheRight || (theJoin->rightSideEntryStructure == NULL))
+     { JoinProfileMemoryString(rightMemory,sizeof(rightMemory),theJoin->rightMemory,theJoin->rightMemoryPeak); }
+   else
+     {
+      theHeader = (struct patternNodeHeader *) theJoin->rightSideEntryStructure;
+      peak = (theHeader->alphaPeak > theHeader->alphaCount) ? theHeader->alphaPeak : theHeader->alphaCount;
+      snprintf(rightMemory,sizeof(rightMemory),"%lu/%lu",theHeader->alphaCount,peak);
+     }
+
+   snprintf(buffer,sizeof(buffer),"%-30s%11lld%11lld%11lld%11lld%14s%14s\n",
+            theCE,theJoin->leftActivations,theJoin->rightActivations,
+            theJoin->testEvaluations,theJoin->hashProbes,
+            leftMemory,rightMemory);
+   WriteString(theEnv,STDOUT,buffer);
+  }
+
+/***********************************************************/
+/* JoinProfileMemoryString: Formats the current and peak   */
+/*   number of partial matches in a beta memory.           */
+/***********************************************************/
+static void JoinProfileMemoryString(
+  char *buffer,
+  size_t bufferSize,
+  struct betaMemory *theMemory,
+  unsigned long peak)
+  {
+   if (theMemory == NULL)
+     {
+      snprintf(buffer,bufferSize,"-");
+      return;
+     }
+
+   if (theMemory->count > peak)
+     { peak = theMemory->count; }
+
+   snprintf(buffer,bufferSize,"%lu/%lu",theMemory->count,peak);
+  }
+
+/*******************************************************/
+/* ResetJoinProfile: Sets the profile counts of each   */
+/*   join of a rule back to 0 and the peak memory      */
+/*   sizes to the current sizes.                       */
+/*******************************************************/
+void ResetJoinProfile(
+  Environment *theEnv,
+  Defrule *theRule)
+  {
+   Defrule *rulePtr;
+   unsigned short arraySize, i;
+   struct joinInformation *theInfo;
+   struct joinNode *theJoin;
+   struct patternNodeHeader *theHeader;
+
+   for (rulePtr = theRule; rulePtr != NULL; rulePtr = rulePtr->disjunct)
+     {
+      arraySize = BetaJoinCount(theEnv,rulePtr);
+      theInfo = CreateJoinArray(theEnv,arraySize);
+      BetaJoins(theEnv,rulePtr,arraySize,theInfo);
+
+      for (i = 0; i < arraySize; i++)
+        {
+         theJoin = theInfo[i].theJoin;
+
+         theJoin->leftActivations = 0;
+         theJoin->rightActivations = 0;
+         theJoin->testEvaluations = 0;
+         theJoin->hashProbes = 0;
+         theJoin->leftMemoryPeak = (theJoin->leftMemory == NULL) ? 0 : theJoin->leftMemory->count;
+         theJoin->rightMemoryPeak = (theJoin->rightMemory == NULL) ? 0 : theJoin->rightMemory->count;
+
+         if ((! theJoin->joinFromTheRight) && (theJoin->rightSideEntryStructure != NULL))
+           {
+            theHeader = (struct patternNodeHeader *) theJoin->rightSideEntryStructure;
+            theHeader->alphaPeak = theHeader->alphaCount;
+           }
+        }
+
+      FreeJoinArray(theEnv,theInfo,arraySize);
+     }
+  }
+
+#endif /* PROFILING_FUNCTIONS */
+
+/****************************************************/
+/* BetaMemoryStatisticsCommand: H/L access routine  */
+/*   for the beta-memory-statistics command.        */
+/****************************************************/
+void BetaMemoryStatisticsCommand(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   const char *ruleName;
+   Defrule *rulePtr;
+   UDFValue theArg;
+
+   if (! UDFFirstArgument(context,SYMBOL_BIT,&theArg))
+     { return; }
+
+   ruleName = theArg.lexemeValue->contents;
+
+   rulePtr = FindDefrule(theEnv,ruleName);
+   if (rulePtr == NULL)
+     {
+      CantFindItemErrorMessage(theEnv,"defrule",ruleName,true);
+      return;
+     }
+
+   BetaMemoryStatistics(theEnv,rulePtr);
+  }
+
+/************************************************************/
+/* BetaMemoryStatistics: C access routine for the           */
+/*   beta-memory-statistics command. Lists the size, load   */
+/*   factor and bucket chain lengths of the left and right  */
+/*   beta memories of each join of a rule.                  */
+/************************************************************/
+void BetaMemoryStatistics(
+  Environment *theEnv,
+  Defrule *theRule)
+  {
+   Defrule *rulePtr;
+   long disjunctCount, disjunctIndex, joinIndex;
+   unsigned short arraySize;
+   struct joinInformation *theInfo;
+   struct joinNode *theJoin;
+   const char *theCE;
+   char buffer[32];
+
+   disjunctCount = GetDisjunctCount(theEnv,theRule);
+
+   for (disjunctIndex = 1; disjunctIndex <= disjunctCount; disjunctIndex++)
+     {
+      if (GetHaltExecution(theEnv) == true)
+        { return; }
+
+      rulePtr = GetNthDisjunct(theEnv,theRule,disjunctIndex);
+
+      if (disjunctCount > 1)
+        {
+         snprintf(buffer,sizeof(buffer),"Disjunct #%ld\n",disjunctIndex);
+         WriteString(theEnv,STDOUT,buffer);
+        }
+
+      arraySize = BetaJoinCount(theEnv,rulePtr);
+      theInfo = CreateJoinArray(theEnv,arraySize);
+      BetaJoins(theEnv,rulePtr,arraySize,theInfo);
+
+      for (joinIndex = 0; joinIndex < arraySize; joinIndex++)
+        {
+         theJoin = theInfo[joinIndex].theJoin;
+         theCE = ActivityHeaderString(theEnv,theInfo,joinIndex,arraySize);
+
+         if (theJoin->leftMemory != NULL)
+           { ListBetaMemoryStatistics(theEnv,theCE,"left",theJoin->leftMemory); }
+         if (theJoin->rightMemory != NULL)
+           { ListBetaMemoryStatistics(theEnv,theCE,"right",theJoin->rightMemory); }
+        }
+
+      FreeJoinArray(theEnv,theInfo,arraySize);
+     }
+  }
+
+/**************************************************************/
+/* ListBetaMemoryStatistics: Prints the size and load factor  */
+/*   of a beta memory and the number of its buckets holding   */
+/*   chains of 0, 1, 2, 3-4, 5-8, ... partial matches.        */
+/**************************************************************/
+static void ListBetaMemoryStatistics(
+  Environment *theEnv,
+  const char *theCE,
+  const char *side,
+  struct betaMemory *theMemory)
+  {
+   static const unsigned long lengthLimits[] = { 0, 1, 2, 4, 8, 16, 32 };
+   unsigned long lengthCounts[8];
+   unsigned long i, length, longest = 0;
+   unsigned short bin;
+   struct partialMatch *thePM;
+   const char *separator = "";
+   char buffer[160];
+
+   memset(lengthCounts,0,sizeof(lengthCounts));
+
+   for (i = 0; i < theMemory->size; i++)
+     {
+      length = 0;
+      for (thePM = theMemory->beta[i]; thePM != NULL; thePM = thePM->nextInMemory)
+        { length++; }
+
+      if (length > longest)
+        { longest = length; }
+
+      for (bin = 0; (bin < 7) && (length > lengthLimits[bin]); bin++)
+        { /* Do Nothing */ }
+
+      lengthCounts[bin]++;
+     }
+
+   snprintf(buffer,sizeof(buffer),"CE %s %s: %lu bucket%s, %lu match%s, load %.2f, %lu resize%s, longest %lu\n",
+            theCE,side,
+            theMemory->size,(theMemory->size == 1) ? "" : "s",
+            theMemory->count,(theMemory->count == 1) ? "" : "es",
+            (double) theMemory->count / (double) theMemory->size,
+            theMemory->resizes,(theMemory->resizes == 1) ? "" : "s",
+            longest);
+   WriteString(theEnv,STDOUT,buffer);
+
+   WriteString(theEnv,STDOUT,"   lengths ");
+   for (bin = 0; bin < 8; bin++)
+     {
+      if (lengthCounts[bin] == 0)
+        { continue; }
+
+      if (bin < 3)
+        { snprintf(buffer,sizeof(buffer),"%s%lu: %lu",separator,lengthLimits[bin],lengthCounts[bin]); }
+      else if (bin < 7)
+        {
+         snprintf(buffer,sizeof(buffer),"%s%lu-%lu: %lu",separator,
+                  lengthLimits[bin-1] + 1,lengthLimits[bin],lengthCounts[bin]);
+        }
+      else
+        { snprintf(buffer,sizeof(buffer),"%s%lu+: %lu",separator,lengthLimits[6] + 1,lengthCounts[bin]); }
+
+      WriteString(theEnv,STDOUT,buffer);
+      separator = ", ";
+     }
+   WriteString(theEnv,STDOUT,"\n");
+  }
+
 /***************************************/
 /* TimetagFunction: H/L access routine */
 /*   for the timetag function.         */
@@ -1644,6 +1981,28 @@ static void ShowJoins(
             WriteString(theEnv,STDOUT,"\n");
            }
 
+         if (joinList[numberOfJoins]->leftRange != NULL)
+           {
+            WriteString(theEnv,STDOUT,"    LR : ");
+            PrintExpression(theEnv,STDOUT,joinList[numberOfJoins]->leftRange);
+            if (joinList[numberOfJoins]->rangeAtMost)
+              { WriteString(theEnv,STDOUT," (upper bound)\n"); }
+            else
+              { WriteString(theEnv,STDOUT," (lower bound)\n"); }
+           }
+
+         if (joinList[numberOfJoins]->aggregate != NO_AGGREGATE)
+           {
+            WriteString(theEnv,STDOUT,"    AG : ");
+            WriteString(theEnv,STDOUT,AggregateName(joinList[numberOfJoins]->aggregate));
+            if (joinList[numberOfJoins]->aggregateExpression != NULL)
+              {
+               WriteString(theEnv,STDOUT," ");
+               PrintExpression(theEnv,STDOUT,joinList[numberOfJoins]->aggregateExpression);
+              }
+            WriteString(theEnv,STDOUT,"\n");
+           }
+
          if (! joinList[numberOfJoins]->firstJoin)
            {
             WriteString(theEnv,STDOUT,"    LM : ");
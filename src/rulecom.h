@@ -62,6 +62,10 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added profiling of joins.                      */
+/*                                                           */
+/*            Added beta-memory-statistics command.          */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_rulecom
@@ -107,9 +111,15 @@ typedef enum
    void                           AlphaJoins(Environment *,Defrule *,unsigned short,struct joinInformation *);
    void                           BetaJoins(Environment *,Defrule *,unsigned short,struct joinInformation *);
    void                           JoinActivityResetCommand(Environment *,UDFContext *,UDFValue *);
+   void                           BetaMemoryStatisticsCommand(Environment *,UDFContext *,UDFValue *);
+   void                           BetaMemoryStatistics(Environment *,Defrule *);
    void                           WhyCommand(Environment *,UDFContext *,UDFValue *);
    void                           GetFocusFunction(Environment *,UDFContext *,UDFValue *);
    Defmodule                     *GetFocus(Environment *);
+#if PROFILING_FUNCTIONS
+   void                           ListJoinProfile(Environment *,Defrule *);
+   void                           ResetJoinProfile(Environment *,Defrule *);
+#endif
 #if DEVELOPER
    void                           ShowJoinsCommand(Environment *,UDFContext *,UDFValue *);
    void                           RuleComplexityCommand(Environment *,UDFContext *,UDFValue *);
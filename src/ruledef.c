@@ -71,6 +71,10 @@
 /*                                                           */
 /*            Construct hashing for quick lookup.            */
 /*                                                           */
+/*      ?.??: Added support for the accumulate CE.           */
+/*                                                           */
+/*            Beta memories count their resizes.             */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -80,6 +84,7 @@
 #include <stdio.h>
 
 #include "agenda.h"
+#include "aggregat.h"
 #include "drive.h"
 #include "engine.h"
 #include "envrnmnt.h"
@@ -132,6 +137,7 @@ void InitializeDefrules(
    InitializeAgenda(theEnv);
    InitializePatterns(theEnv);
    InitializeDefruleModules(theEnv);
+   InitializeAggregates(theEnv);
 
    AddReservedPatternSymbol(theEnv,"and",NULL);
    AddReservedPatternSymbol(theEnv,"not",NULL);
@@ -142,6 +148,7 @@ void InitializeDefrules(
    AddReservedPatternSymbol(theEnv,"forall",NULL);
    AddReservedPatternSymbol(theEnv,"goal",NULL);
    AddReservedPatternSymbol(theEnv,"explicit",NULL);
+   AddReservedPatternSymbol(theEnv,"accumulate",NULL);
 
    DefruleBasicCommands(theEnv);
 
@@ -570,6 +577,7 @@ void AddBetaMemoriesToJoin(
          theNode->leftMemory->beta = (struct partialMatch **) genalloc(theEnv,sizeof(struct partialMatch *));
          theNode->leftMemory->beta[0] = NULL;
          theNode->leftMemory->size = 1;
+         theNode->leftMemory->resizes = 0;
          theNode->leftMemory->count = 0;
          theNode->leftMemory->last = NULL;
         }
@@ -579,6 +587,7 @@ void AddBetaMemoriesToJoin(
          theNode->leftMemory->beta = (struct partialMatch **) genalloc(theEnv,sizeof(struct partialMatch *) * INITIAL_BETA_HASH_SIZE);
          memset(theNode->leftMemory->beta,0,sizeof(struct partialMatch *) * INITIAL_BETA_HASH_SIZE);
          theNode->leftMemory->size = INITIAL_BETA_HASH_SIZE;
+         theNode->leftMemory->resizes = 0;
          theNode->leftMemory->count = 0;
          theNode->leftMemory->last = NULL;
         }
@@ -603,6 +612,7 @@ void AddBetaMemoriesToJoin(
          theNode->rightMemory->beta[0] = NULL;
          theNode->rightMemory->last[0] = NULL;
          theNode->rightMemory->size = 1;
+         theNode->rightMemory->resizes = 0;
          theNode->rightMemory->count = 0;
         }
       else
@@ -613,6 +623,7 @@ void AddBetaMemoriesToJoin(
          memset(theNode->rightMemory->beta,0,sizeof(struct partialMatch **) * INITIAL_BETA_HASH_SIZE);
          memset(theNode->rightMemory->last,0,sizeof(struct partialMatch **) * INITIAL_BETA_HASH_SIZE);
          theNode->rightMemory->size = INITIAL_BETA_HASH_SIZE;
+         theNode->rightMemory->resizes = 0;
          theNode->rightMemory->count = 0;
         }
      }
@@ -626,6 +637,7 @@ void AddBetaMemoriesToJoin(
       theNode->rightMemory->beta[0]->rhsMemory = true;
       theNode->rightMemory->last[0] = theNode->rightMemory->beta[0];
       theNode->rightMemory->size = 1;
+      theNode->rightMemory->resizes = 0;
       theNode->rightMemory->count = 1;
      }
    else
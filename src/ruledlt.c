@@ -42,6 +42,11 @@
 /*                                                           */
 /*            Construct hashing for quick lookup.            */
 /*                                                           */
+/*      ?.??: Range index expressions are removed with       */
+/*            the join.                                      */
+/*                                                           */
+/*            Added support for aggregate joins.             */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -338,6 +343,16 @@ static void DetachJoins(
       /* are no longer needed.                           */
       /*=================================================*/
 
+      /*=====================================================*/
+      /* The left memory of an aggregate join is flushed     */
+      /* first since its partial matches are linked to the   */
+      /* matches in the alpha memory of the pattern, which   */
+      /* may be released when the pattern is removed.        */
+      /*=====================================================*/
+
+      if ((! destroy) && (join->aggregate != NO_AGGREGATE))
+        { FlushBetaMemory(theEnv,join,LHS); }
+
 #if (! RUN_TIME) && (! BLOAD_ONLY)
       if (! destroy)
         {
@@ -358,7 +373,8 @@ static void DetachJoins(
         }
       else
         {
-         FlushBetaMemory(theEnv,join,LHS);
+         if (join->aggregate == NO_AGGREGATE)
+           { FlushBetaMemory(theEnv,join,LHS); }
          FlushBetaMemory(theEnv,join,RHS);
         }
 
@@ -378,6 +394,8 @@ static void DetachJoins(
          RemoveHashedExpression(theEnv,join->goalExpression);
          RemoveHashedExpression(theEnv,join->leftHash);
          RemoveHashedExpression(theEnv,join->rightHash);
+         RemoveHashedExpression(theEnv,join->leftRange);
+         RemoveHashedExpression(theEnv,join->aggregateExpression);
         }
 #endif
 
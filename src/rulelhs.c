@@ -39,6 +39,8 @@
 /*            Removed the restriction of using pattern       */
 /*            address within a not conditional element.      */
 /*                                                           */
+/*      ?.??: Added the accumulate CE.                       */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -79,6 +81,7 @@
    static struct lhsParseNode    *ConnectedPatternParse(Environment *,const char *,struct token *,bool *);
    static struct lhsParseNode    *GroupPatterns(Environment *,const char *,TokenType,const char *,bool *);
    static struct lhsParseNode    *TestPattern(Environment *,const char *,bool *);
+   static struct lhsParseNode    *AccumulatePattern(Environment *,const char *,bool *);
    static struct lhsParseNode    *AssignmentParse(Environment *,const char *,CLIPSLexeme *,bool *);
    static void                    TagLHSLogicalNodes(struct lhsParseNode *);
    static struct lhsParseNode    *SimplePatternParse(Environment *,const char *,struct token *,bool *);
@@ -566,7 +569,8 @@ static void ParseAutoFocus(
 /*                           <assigned-pattern-CE> |             */
 /*                           <not-CE> | <and-CE> | <or-CE> |     */
 /*                           <logical-CE> | <test-CE> |          */
-/*                           <forall-CE> | <exists-CE>           */
+/*                           <forall-CE> | <exists-CE> |         */
+/*                           <accumulate-CE>                     */
 /*****************************************************************/
 static struct lhsParseNode *LHSPattern(
   Environment *theEnv,
@@ -627,6 +631,13 @@ static struct lhsParseNode *LHSPattern(
       else if (strcmp(theToken.lexemeValue->contents,"test") == 0)
         { theNode = TestPattern(theEnv,readSource,error); }
 
+      /*=======================================*/
+      /* Otherwise check for an accumulate CE. */
+      /*=======================================*/
+
+      else if (strcmp(theToken.lexemeValue->contents,"accumulate") == 0)
+        { theNode = AccumulatePattern(theEnv,readSource,error); }
+
       /*============================================*/
       /* Otherwise check for an *and*, *or*, *not*, */
       /* *logical*, *exists*, or *forall* CE.       */
@@ -1086,6 +1097,196 @@ static struct lhsParseNode *TestPattern(
    return(theNode);
   }
 
+/*******************************************************************/
+/* AccumulatePattern: Handles parsing of accumulate conditional    */
+/*   elements. The value of the aggregate computed over the        */
+/*   matches of the pattern CE is bound to the variable. The       */
+/*   count and sum aggregates are zero if there are no matches,    */
+/*   while the min and max aggregates are only satisfied if a      */
+/*   match has a numeric value for the expression.                 */
+/*                                                                 */
+/* <accumulate-CE> ::= (accumulate <single-field-variable>         */
+/*                                 <aggregate> <pattern-CE>)       */
+/*                                                                 */
+/* <aggregate>     ::= (count) | (sum <expression>) |              */
+/*                     (min <expression>) | (max <expression>)     */
+/*******************************************************************/
+static struct lhsParseNode *AccumulatePattern(
+  Environment *theEnv,
+  const char *readSource,
+  bool *error)
+  {
+   struct lhsParseNode *theNode, *theExpression = NULL;
+   struct token theToken;
+   struct expr *tempExpression;
+   CLIPSLexeme *theVariable;
+   unsigned int aggregate;
+   const char *theName;
+
+   /*=================================================*/
+   /* The aggregate is computed from the matches of a */
+   /* pattern, so it can't be used within a not CE.   */
+   /*=================================================*/
+
+   if (PatternData(theEnv)->WithinNotCE)
+     {
+      PrintErrorID(theEnv,"RULELHS",6,true);
+      WriteString(theEnv,STDERR,"The accumulate CE cannot be used within a not/exists/forall CE.\n");
+      *error = true;
+      return NULL;
+     }
+
+   /*==============================================*/
+   /* Get the variable to which the aggregate will */
+   /* be bound when the CE is satisfied.           */
+   /*==============================================*/
+
+   SavePPBuffer(theEnv," ");
+   GetToken(theEnv,readSource,&theToken);
+   if (theToken.tknType != SF_VARIABLE_TOKEN)
+     {
+      SyntaxErrorMessage(theEnv,"accumulate conditional element");
+      *error = true;
+      return NULL;
+     }
+
+   theVariable = theToken.lexemeValue;
+
+   /*=============================*/
+   /* Parse the aggregate to use. */
+   /*=============================*/
+
+   SavePPBuffer(theEnv," ");
+   GetToken(theEnv,readSource,&theToken);
+   if (theToken.tknType == LEFT_PARENTHESIS_TOKEN)
+     { GetToken(theEnv,readSource,&theToken); }
+   else
+     { theToken.tknType = UNKNOWN_VALUE_TOKEN; }
+
+   theName = (theToken.tknType == SYMBOL_TOKEN) ? theToken.lexemeValue->contents : "";
+
+   if (strcmp(theName,"count") == 0)
+     { aggregate = COUNT_AGGREGATE; }
+   else if (strcmp(theName,"sum") == 0)
+     { aggregate = SUM_AGGREGATE; }
+   else if (strcmp(theName,"min") == 0)
+     { aggregate = MIN_AGGREGATE; }
+   else if (strcmp(theName,"max") == 0)
+     { aggregate = MAX_AGGREGATE; }
+   else
+     {
+      SyntaxErrorMessage(theEnv,"accumulate conditional element");
+      *error = true;
+      return NULL;
+     }
+
+   /*==============================================*/
+   /* The sum, min, and max aggregates combine the */
+   /* values of an expression evaluated for each   */
+   /* match of the pattern.                        */
+   /*==============================================*/
+
+   if (aggregate != COUNT_AGGREGATE)
+     {
+      SavePPBuffer(theEnv," ");
+      tempExpression = ParseAtomOrExpression(theEnv,readSource,NULL);
+      if (tempExpression == NULL)
+        {
+         *error = true;
+         return NULL;
+        }
+
+      theExpression = ExpressionToLHSParseNodes(theEnv,tempExpression);
+      ReturnExpression(theEnv,tempExpression);
+     }
+
+   GetToken(theEnv,readSource,&theToken);
+   if (theToken.tknType != RIGHT_PARENTHESIS_TOKEN)
+     {
+      SyntaxErrorMessage(theEnv,"accumulate conditional element");
+      ReturnLHSParseNodes(theEnv,theExpression);
+      *error = true;
+      return NULL;
+     }
+
+   /*==================================================*/
+   /* Parse the pattern CE whose matches are combined. */
+   /*==================================================*/
+
+   SavePPBuffer(theEnv," ");
+   GetToken(theEnv,readSource,&theToken);
+   if (theToken.tknType == LEFT_PARENTHESIS_TOKEN)
+     { GetToken(theEnv,readSource,&theToken); }
+   else
+     { theToken.tknType = UNKNOWN_VALUE_TOKEN; }
+
+   if ((theToken.tknType != SYMBOL_TOKEN) ||
+       (strcmp(theToken.lexemeValue->contents,"and") == 0) ||
+       (strcmp(theToken.lexemeValue->contents,"or") == 0) ||
+       (strcmp(theToken.lexemeValue->contents,"not") == 0) ||
+       (strcmp(theToken.lexemeValue->contents,"test") == 0) ||
+       (strcmp(theToken.lexemeValue->contents,"logical") == 0) ||
+       (strcmp(theToken.lexemeValue->contents,"exists") == 0) ||
+       (strcmp(theToken.lexemeValue->contents,"forall") == 0) ||
+       (strcmp(theToken.lexemeValue->contents,"accumulate") == 0))
+     {
+      SyntaxErrorMessage(theEnv,"accumulate conditional element");
+      ReturnLHSParseNodes(theEnv,theExpression);
+      *error = true;
+      return NULL;
+     }
+
+   theNode = SimplePatternParse(theEnv,readSource,&theToken,error);
+   if (*error == true)
+     {
+      ReturnLHSParseNodes(theEnv,theExpression);
+      ReturnLHSParseNodes(theEnv,theNode);
+      return NULL;
+     }
+
+   /*=========================================================*/
+   /* The matches of a goal pattern are not facts that can be */
+   /* combined, so goal patterns are not allowed.             */
+   /*=========================================================*/
+
+   if (theNode->goalCE)
+     {
+      PrintErrorID(theEnv,"RULELHS",7,true);
+      WriteString(theEnv,STDERR,"The accumulate CE cannot contain a goal pattern.\n");
+      ReturnLHSParseNodes(theEnv,theExpression);
+      ReturnLHSParseNodes(theEnv,theNode);
+      *error = true;
+      return NULL;
+     }
+
+   /*===============================================================*/
+   /* Check for the closing right parenthesis of the accumulate CE. */
+   /*===============================================================*/
+
+   GetToken(theEnv,readSource,&theToken);
+   if (theToken.tknType != RIGHT_PARENTHESIS_TOKEN)
+     {
+      SyntaxErrorMessage(theEnv,"accumulate conditional element");
+      ReturnLHSParseNodes(theEnv,theExpression);
+      ReturnLHSParseNodes(theEnv,theNode);
+      *error = true;
+      return NULL;
+     }
+
+   /*================================================*/
+   /* The variable is stored as the pattern address. */
+   /* The matches of the pattern never generate      */
+   /* goals since they're only counted.              */
+   /*================================================*/
+
+   theNode->value = theVariable;
+   theNode->aggregate = aggregate;
+   theNode->aggregateExpression = theExpression;
+   theNode->explicitCE = true;
+
+   return(theNode);
+  }
+
 /****************************************************************/
 /* AssignmentParse: Finishes the parsing of pattern conditional */
 /*   elements that have been bound to a  variable.              */
@@ -59,6 +59,9 @@
 /*            Support for ?var:slot references to facts in   */
 /*            methods and rule actions.                      */
 /*                                                           */
+/*      ?.??: Variables of an accumulate CE pattern are not  */
+/*            visible on the RHS.                            */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -77,6 +80,7 @@
 #include "engine.h"
 #include "envrnmnt.h"
 #include "exprnpsr.h"
+#include "generate.h"
 #include "incrrset.h"
 #include "memalloc.h"
 #include "modulutl.h"
@@ -673,7 +677,7 @@ static int ReplaceRHSVariable(
    /*================================================*/
 
    if (theVariable->patternType != NULL)
-     { (*theVariable->patternType->replaceGetJNValueFunction)(theEnv,list,theVariable,LHS); }
+     { ReplaceJNGetvar(theEnv,list,theVariable,LHS); }
    else
      { return 0; }
 
@@ -1106,6 +1110,14 @@ struct lhsParseNode *FindVariable(
       if (theLHS->lexemeValue == name)
         { theReturnValue = theLHS; }
 
+      /*=================================================*/
+      /* The variables of the pattern of an accumulate   */
+      /* CE are only visible within the accumulate CE.   */
+      /*=================================================*/
+
+      if (theLHS->aggregate != NO_AGGREGATE)
+        { continue; }
+
       /*============================================*/
       /* Check for the variable inside the pattern. */
       /*============================================*/
@@ -0,0 +1,436 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*          STRING BUILDER FUNCTIONS MODULE            */
+/*******************************************************/
+
+/*************************************************************/
+/* Purpose: Mutable string builders exposed as external      */
+/*   address values. Each builder is also opened as a        */
+/*   string builder destination under a unique logical name  */
+/*   so that printout, format and the other output functions */
+/*   can write to it directly. Appending doubles the buffer  */
+/*   when it grows and sb-reset keeps the buffer, so a       */
+/*   builder that is reused for each response stops          */
+/*   allocating once it has reached its largest size.        */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "setup.h"
+
+#include "argacces.h"
+#include "envrnmnt.h"
+#include "evaluatn.h"
+#include "extnfunc.h"
+#include "memalloc.h"
+#include "router.h"
+#include "strngrtr.h"
+#include "symbol.h"
+#include "utility.h"
+
+#include "sbfun.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+static void                    DeallocateStringBuilderFunctionData(Environment *);
+static void                    PrintStringBuilderAddress(Environment *,const char *,void *);
+static bool                    DiscardStringBuilderAddress(Environment *,void *);
+static const char             *StringBuilderLogicalName(Environment *,void *);
+static struct stringBuilderValue
+                              *GetStringBuilderArgument(UDFContext *);
+static void                    SBAppendValue(Environment *,struct stringBuilderValue *,UDFValue *);
+
+/*******************************************************/
+/* StringBuilderFunctionDefinitions: Installs the      */
+/*   string builder external address type and          */
+/*   registers the sb functions.                       */
+/*******************************************************/
+void StringBuilderFunctionDefinitions(
+		Environment *theEnv)
+{
+	struct externalAddressType stringBuilderType =
+		{ "StringBuilder",
+		  PrintStringBuilderAddress,
+		  PrintStringBuilderAddress,
+		  DiscardStringBuilderAddress,
+		  NULL,
+		  NULL,
+		  StringBuilderLogicalName };
+
+	AllocateEnvironmentData(
+			theEnv,
+			STRING_BUILDER_FUNCTION_DATA,
+			sizeof(struct stringBuilderFunctionData),
+			DeallocateStringBuilderFunctionData);
+
+	StringBuilderFunctionData(theEnv)->AddressType =
+		InstallExternalAddressType(theEnv,&stringBuilderType);
+
+	AddUDF(theEnv,"sb-create","e",0,1,"l",SBCreateFunction,"SBCreateFunction",NULL);
+	AddUDF(theEnv,"sb-append","e",1,UNBOUNDED,"*;e",SBAppendFunction,"SBAppendFunction",NULL);
+	AddUDF(theEnv,"sb-length","l",1,1,"e",SBLengthFunction,"SBLengthFunction",NULL);
+	AddUDF(theEnv,"sb-to-string","s",1,1,"e",SBToStringFunction,"SBToStringFunction",NULL);
+	AddUDF(theEnv,"sb-write","b",2,2,"*;e",SBWriteFunction,"SBWriteFunction",NULL);
+	AddUDF(theEnv,"sb-reset","e",1,1,"e",SBResetFunction,"SBResetFunction",NULL);
+}
+
+/***********************************************************/
+/* DeallocateStringBuilderFunctionData: Deallocates the    */
+/*   builders when the environment is destroyed. The       */
+/*   string router data is already gone by then, so the    */
+/*   destinations are not closed.                          */
+/***********************************************************/
+static void DeallocateStringBuilderFunctionData(
+		Environment *theEnv)
+{
+	struct stringBuilderValue *theValue, *nextValue;
+
+	for (theValue = StringBuilderFunctionData(theEnv)->ListOfStringBuilders;
+	     theValue != NULL;
+	     theValue = nextValue)
+	{
+		nextValue = theValue->next;
+		SBDispose(theValue->theSB);
+		rtn_struct(theEnv,stringBuilderValue,theValue);
+	}
+}
+
+/*****************************************************/
+/* PrintStringBuilderAddress: Prints a builder using */
+/*   its logical name, <StringBuilder-n>.            */
+/*****************************************************/
+static void PrintStringBuilderAddress(
+		Environment *theEnv,
+		const char *logicalName,
+		void *theValue)
+{
+	struct stringBuilderValue *theBuilder;
+
+	theBuilder = (struct stringBuilderValue *) ((CLIPSExternalAddress *) theValue)->contents;
+
+	WriteString(theEnv,logicalName,theBuilder->logicalName);
+}
+
+/******************************************************/
+/* DiscardStringBuilderAddress: Closes and frees the  */
+/*   builder once nothing refers to its address.      */
+/******************************************************/
+static bool DiscardStringBuilderAddress(
+		Environment *theEnv,
+		void *theContents)
+{
+	struct stringBuilderValue *theBuilder = (struct stringBuilderValue *) theContents;
+
+	CloseStringBuilderDestination(theEnv,theBuilder->logicalName);
+
+	if (theBuilder->prev == NULL)
+	{ StringBuilderFunctionData(theEnv)->ListOfStringBuilders = theBuilder->next; }
+	else
+	{ theBuilder->prev->next = theBuilder->next; }
+
+	if (theBuilder->next != NULL)
+	{ theBuilder->next->prev = theBuilder->prev; }
+
+	SBDispose(theBuilder->theSB);
+	rtn_struct(theEnv,stringBuilderValue,theBuilder);
+
+	return true;
+}
+
+/***************************************************/
+/* StringBuilderLogicalName: Lets a builder stand  */
+/*   in for a logical name, as in (printout ?sb).  */
+/***************************************************/
+static const char *StringBuilderLogicalName(
+		Environment *theEnv,
+		void *theContents)
+{
+#if MAC_XCD
+#pragma unused(theEnv)
+#endif
+
+	return ((struct stringBuilderValue *) theContents)->logicalName;
+}
+
+/******************************************************/
+/* GetStringBuilderArgument: Returns the builder held */
+/*   by the first argument, or NULL with an error if  */
+/*   it is some other kind of external address.       */
+/******************************************************/
+static struct stringBuilderValue *GetStringBuilderArgument(
+		UDFContext *context)
+{
+	Environment *theEnv = context->environment;
+	UDFValue theArg;
+
+	if (! UDFFirstArgument(context,EXTERNAL_ADDRESS_BIT,&theArg))
+	{ return NULL; }
+
+	if (theArg.externalAddressValue->type != StringBuilderFunctionData(theEnv)->AddressType)
+	{
+		UDFInvalidArgumentMessage(context,"string builder");
+		SetEvaluationError(theEnv,true);
+		return NULL;
+	}
+
+	return (struct stringBuilderValue *) theArg.externalAddressValue->contents;
+}
+
+/******************************************************/
+/* SBAppendValue: Appends the printed form of a value */
+/*   to a builder. Lexemes are appended without their */
+/*   quotes, and numbers are formatted in place       */
+/*   rather than through a new symbol.                */
+/******************************************************/
+static void SBAppendValue(
+		Environment *theEnv,
+		struct stringBuilderValue *theBuilder,
+		UDFValue *theValue)
+{
+	char buffer[48];
+	int length;
+
+	switch (theValue->header->type)
+	{
+		case STRING_TYPE:
+		case SYMBOL_TYPE:
+		case INSTANCE_NAME_TYPE:
+			SBAppend(theBuilder->theSB,theValue->lexemeValue->contents);
+			break;
+
+		case INTEGER_TYPE:
+			length = snprintf(buffer,sizeof(buffer),"%lld",theValue->integerValue->contents);
+			SBAppendLength(theBuilder->theSB,buffer,(size_t) length);
+			break;
+
+		case FLOAT_TYPE:
+			length = snprintf(buffer,sizeof(buffer),"%.15g",theValue->floatValue->contents);
+			if (strpbrk(buffer,".e") == NULL)
+			{
+				buffer[length++] = '.';
+				buffer[length++] = '0';
+			}
+			SBAppendLength(theBuilder->theSB,buffer,(size_t) length);
+			break;
+
+		default:
+			WriteUDFValue(theEnv,theBuilder->logicalName,theValue);
+			break;
+	}
+}
+
+/***************************************************/
+/* SBCreateFunction: H/L access routine for the    */
+/*   sb-create function. The optional argument is  */
+/*   the initial size of the buffer.               */
+/***************************************************/
+void SBCreateFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct stringBuilderValue *theBuilder;
+	long long initialSize = SB_INITIAL_SIZE;
+
+	if (UDFHasNextArgument(context))
+	{
+		if (! UDFFirstArgument(context,INTEGER_BIT,&theArg))
+		{ return; }
+
+		initialSize = theArg.integerValue->contents;
+		if (initialSize < 1)
+		{
+			UDFInvalidArgumentMessage(context,"integer (greater than or equal to 1)");
+			SetEvaluationError(theEnv,true);
+			return;
+		}
+	}
+
+	theBuilder = get_struct(theEnv,stringBuilderValue);
+	theBuilder->theSB = CreateStringBuilder(theEnv,(size_t) initialSize);
+	snprintf(theBuilder->logicalName,SB_NAME_SIZE,"<StringBuilder-%llu>",
+	         ++StringBuilderFunctionData(theEnv)->NextID);
+
+	theBuilder->prev = NULL;
+	theBuilder->next = StringBuilderFunctionData(theEnv)->ListOfStringBuilders;
+	if (theBuilder->next != NULL)
+	{ theBuilder->next->prev = theBuilder; }
+	StringBuilderFunctionData(theEnv)->ListOfStringBuilders = theBuilder;
+
+	OpenStringBuilderDestination(theEnv,theBuilder->logicalName,theBuilder->theSB);
+
+	returnValue->externalAddressValue =
+		CreateExternalAddress(theEnv,theBuilder,(unsigned short) StringBuilderFunctionData(theEnv)->AddressType);
+}
+
+/****************************************************/
+/* SBAppendFunction: H/L access routine for the     */
+/*   sb-append function. Appends each argument in   */
+/*   turn, splicing multifields, and returns the    */
+/*   builder so that calls can be nested.           */
+/****************************************************/
+void SBAppendFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct stringBuilderValue *theBuilder;
+	UDFValue theArg, theField;
+	size_t i;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	theBuilder = GetStringBuilderArgument(context);
+	if (theBuilder == NULL) return;
+
+	while (UDFHasNextArgument(context))
+	{
+		if (! UDFNextArgument(context,ANY_TYPE_BITS,&theArg))
+		{ return; }
+
+		if (theArg.header->type != MULTIFIELD_TYPE)
+		{
+			SBAppendValue(theEnv,theBuilder,&theArg);
+			continue;
+		}
+
+		for (i = theArg.begin; i < (theArg.begin + theArg.range); i++)
+		{
+			theField.value = theArg.multifieldValue->contents[i].value;
+			SBAppendValue(theEnv,theBuilder,&theField);
+		}
+	}
+
+	returnValue->externalAddressValue = CreateExternalAddress(theEnv,theBuilder,
+	                                                         (unsigned short) StringBuilderFunctionData(theEnv)->AddressType);
+}
+
+/****************************************************/
+/* SBLengthFunction: H/L access routine for the     */
+/*   sb-length function. The length is in bytes.    */
+/****************************************************/
+void SBLengthFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct stringBuilderValue *theBuilder;
+
+	theBuilder = GetStringBuilderArgument(context);
+	if (theBuilder == NULL)
+	{
+		returnValue->integerValue = CreateInteger(theEnv,-1);
+		return;
+	}
+
+	returnValue->integerValue = CreateInteger(theEnv,(long long) theBuilder->theSB->length);
+}
+
+/****************************************************/
+/* SBToStringFunction: H/L access routine for the   */
+/*   sb-to-string function.                         */
+/****************************************************/
+void SBToStringFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct stringBuilderValue *theBuilder;
+
+	theBuilder = GetStringBuilderArgument(context);
+	if (theBuilder == NULL)
+	{
+		returnValue->lexemeValue = CreateString(theEnv,"");
+		return;
+	}
+
+	returnValue->lexemeValue = CreateString(theEnv,theBuilder->theSB->contents);
+}
+
+/*****************************************************/
+/* SBWriteFunction: H/L access routine for the       */
+/*   sb-write function. Writes the contents to a     */
+/*   logical name with a single call to the router,  */
+/*   so a socket router sees one block rather than   */
+/*   the pieces the response was built from.         */
+/*****************************************************/
+void SBWriteFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct stringBuilderValue *theBuilder;
+	const char *logicalName;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	theBuilder = GetStringBuilderArgument(context);
+	if (theBuilder == NULL) return;
+
+	logicalName = GetLogicalName(context,STDOUT);
+	if (logicalName == NULL)
+	{
+		IllegalLogicalNameMessage(theEnv,"sb-write");
+		SetEvaluationError(theEnv,true);
+		return;
+	}
+
+	if (strcmp(logicalName,"nil") == 0)
+	{
+		returnValue->lexemeValue = TrueSymbol(theEnv);
+		return;
+	}
+
+	if (strcmp(logicalName,theBuilder->logicalName) == 0)
+	{ return; }
+
+	if (! QueryRouters(theEnv,logicalName))
+	{
+		UnrecognizedRouterMessage(theEnv,logicalName);
+		return;
+	}
+
+	WriteString(theEnv,logicalName,theBuilder->theSB->contents);
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/****************************************************/
+/* SBResetFunction: H/L access routine for the      */
+/*   sb-reset function. Empties the builder but,    */
+/*   unlike SBReset, keeps the buffer it has grown. */
+/****************************************************/
+void SBResetFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct stringBuilderValue *theBuilder;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	theBuilder = GetStringBuilderArgument(context);
+	if (theBuilder == NULL) return;
+
+	theBuilder->theSB->length = 0;
+	theBuilder->theSB->contents[0] = EOS;
+
+	returnValue->externalAddressValue = CreateExternalAddress(theEnv,theBuilder,
+	                                                         (unsigned short) StringBuilderFunctionData(theEnv)->AddressType);
+}
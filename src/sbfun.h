@@ -0,0 +1,60 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*          STRING BUILDER FUNCTIONS HEADER            */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: Mutable string builders exposed as external      */
+/*   address values.                                         */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_sbfun
+
+#pragma once
+
+#define _H_sbfun
+
+#include <stddef.h>
+
+#define STRING_BUILDER_FUNCTION_DATA USER_ENVIRONMENT_DATA + 5
+
+#define SB_INITIAL_SIZE 256
+#define SB_NAME_SIZE 40
+
+struct stringBuilderValue
+  {
+   StringBuilder *theSB;
+   char logicalName[SB_NAME_SIZE];
+   struct stringBuilderValue *prev;
+   struct stringBuilderValue *next;
+  };
+
+struct stringBuilderFunctionData
+  {
+   int AddressType;
+   unsigned long long NextID;
+   struct stringBuilderValue *ListOfStringBuilders;
+  };
+
+#define StringBuilderFunctionData(theEnv) ((struct stringBuilderFunctionData *) GetEnvironmentData(theEnv,STRING_BUILDER_FUNCTION_DATA))
+
+   void                           StringBuilderFunctionDefinitions(Environment *);
+   void                           SBCreateFunction(Environment *,UDFContext *,UDFValue *);
+   void                           SBAppendFunction(Environment *,UDFContext *,UDFValue *);
+   void                           SBLengthFunction(Environment *,UDFContext *,UDFValue *);
+   void                           SBToStringFunction(Environment *,UDFContext *,UDFValue *);
+   void                           SBWriteFunction(Environment *,UDFContext *,UDFValue *);
+   void                           SBResetFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_sbfun */
@@ -42,6 +42,11 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Symbols and strings are read in blocks from    */
+/*            routers that support it.                       */
+/*                                                           */
+/*            Comments are skipped a block at a time.        */
+/*                                                           */
 /*************************************************************/
 
 #include <ctype.h>
@@ -64,6 +69,22 @@
 
 #include "scanner.h"
 
+/*********************************************************/
+/* Characters that may end a symbol: the special tokens, */
+/* the control characters, and the bytes that are not    */
+/* part of a UTF-8 sequence. ScanSymbol checks each of   */
+/* these again since isprint depends on the locale.      */
+/*********************************************************/
+
+#define SYMBOL_DELIMITERS "<\"()&|~ ;" \
+                          "\001\002\003\004\005\006\007\010\011\012\013\014\015\016\017" \
+                          "\020\021\022\023\024\025\026\027\030\031\032\033\034\035\036\037" \
+                          "\177\370\371\372\373\374\375\376\377"
+
+#define STRING_DELIMITERS "\"\\\b"
+
+#define COMMENT_DELIMITERS "\n\r"
+
 /***************************************/
 /* LOCAL INTERNAL FUNCTION DEFINITIONS */
 /***************************************/
@@ -109,6 +130,8 @@ void GetToken(
  {
    int inchar;
    TokenType type;
+   char block[ROUTER_BLOCK_SIZE];
+   size_t blockCount;
 
    /*=======================================*/
    /* Set Unknown default values for token. */
@@ -135,9 +158,20 @@ void GetToken(
 
       if (inchar == ';')
         {
-         inchar = ReadRouter(theEnv,logicalName);
-         while ((inchar != '\n') && (inchar != '\r') && (inchar != EOF) )
-           { inchar = ReadRouter(theEnv,logicalName); }
+         while (true)
+           {
+            blockCount = ReadBlockRouter(theEnv,logicalName,block,ROUTER_BLOCK_SIZE,COMMENT_DELIMITERS);
+            inchar = (blockCount > 0) ? (unsigned char) block[blockCount-1] : EOF;
+
+            if ((inchar == '\n') || (inchar == '\r'))
+              { break; }
+
+            if ((blockCount < ROUTER_BLOCK_SIZE) && (inchar != '\0'))
+              {
+               inchar = EOF;
+               break;
+              }
+           }
         }
       inchar = ReadRouter(theEnv,logicalName);
      }
@@ -442,6 +476,9 @@ static CLIPSLexeme *ScanSymbol(
   TokenType *type)
   {
    int inchar;
+   char block[ROUTER_BLOCK_SIZE];
+   size_t blockCount, length;
+   bool delimited;
 #if OBJECT_SYSTEM
    CLIPSLexeme *symbol;
 #endif
@@ -451,19 +488,46 @@ static CLIPSLexeme *ScanSymbol(
    /* symbol until a delimiter is found.  */
    /*=====================================*/
 
-   inchar = ReadRouter(theEnv,logicalName);
-   while ( (inchar != '<') && (inchar != '"') &&
-           (inchar != '(') && (inchar != ')') &&
-           (inchar != '&') && (inchar != '|') && (inchar != '~') &&
-           (inchar != ' ') && (inchar != ';') &&
-           (IsUTF8MultiByteStart(inchar) ||
-            IsUTF8MultiByteContinuation(inchar) ||
-            isprint(inchar)))
+   while (true)
      {
-      ScannerData(theEnv)->GlobalString = ExpandStringWithChar(theEnv,inchar,ScannerData(theEnv)->GlobalString,&ScannerData(theEnv)->GlobalPos,&ScannerData(theEnv)->GlobalMax,ScannerData(theEnv)->GlobalMax+80);
+      blockCount = ReadBlockRouter(theEnv,logicalName,block,ROUTER_BLOCK_SIZE,SYMBOL_DELIMITERS);
+      if (blockCount == 0)
+        {
+         inchar = EOF;
+         break;
+        }
 
+      inchar = (unsigned char) block[blockCount-1];
+      delimited = (strchr(SYMBOL_DELIMITERS,inchar) != NULL);
+      length = delimited ? (blockCount - 1) : blockCount;
+
+      if (length > 0)
+        {
+         ScannerData(theEnv)->GlobalString = AppendNToString(theEnv,block,ScannerData(theEnv)->GlobalString,length,&ScannerData(theEnv)->GlobalPos,&ScannerData(theEnv)->GlobalMax);
+         count += (int) length;
+        }
+
+      if (! delimited)
+        {
+         if (blockCount < ROUTER_BLOCK_SIZE)
+           {
+            inchar = EOF;
+            break;
+           }
+         continue;
+        }
+
+      if ((inchar == '<') || (inchar == '"') ||
+          (inchar == '(') || (inchar == ')') ||
+          (inchar == '&') || (inchar == '|') || (inchar == '~') ||
+          (inchar == ' ') || (inchar == ';') ||
+          (! (IsUTF8MultiByteStart(inchar) ||
+              IsUTF8MultiByteContinuation(inchar) ||
+              isprint(inchar))))
+        { break; }
+
+      ScannerData(theEnv)->GlobalString = ExpandStringWithChar(theEnv,inchar,ScannerData(theEnv)->GlobalString,&ScannerData(theEnv)->GlobalPos,&ScannerData(theEnv)->GlobalMax,ScannerData(theEnv)->GlobalMax+80);
       count++;
-      inchar = ReadRouter(theEnv,logicalName);
      }
 
    /*===================================================*/
@@ -521,6 +585,9 @@ static CLIPSLexeme *ScanString(
    size_t pos = 0;
    size_t max = 0;
    char *theString = NULL;
+   char block[ROUTER_BLOCK_SIZE];
+   size_t blockCount, length;
+   bool delimited;
    CLIPSLexeme *thePtr;
 
    /*============================================*/
@@ -528,14 +595,39 @@ static CLIPSLexeme *ScanString(
    /* until the " delimiter is found.            */
    /*============================================*/
 
-   inchar = ReadRouter(theEnv,logicalName);
-   while ((inchar != '"') && (inchar != EOF))
+   while (true)
      {
+      blockCount = ReadBlockRouter(theEnv,logicalName,block,ROUTER_BLOCK_SIZE,STRING_DELIMITERS);
+      if (blockCount == 0)
+        {
+         inchar = EOF;
+         break;
+        }
+
+      inchar = (unsigned char) block[blockCount-1];
+      delimited = (strchr(STRING_DELIMITERS,inchar) != NULL);
+      length = delimited ? (blockCount - 1) : blockCount;
+
+      if (length > 0)
+        { theString = AppendNToString(theEnv,block,theString,length,&pos,&max); }
+
+      if (! delimited)
+        {
+         if (blockCount < ROUTER_BLOCK_SIZE)
+           {
+            inchar = EOF;
+            break;
+           }
+         continue;
+        }
+
+      if (inchar == '"')
+        { break; }
+
       if (inchar == '\\')
         { inchar = ReadRouter(theEnv,logicalName); }
 
       theString = ExpandStringWithChar(theEnv,inchar,theString,&pos,&max,max+80);
-      inchar = ReadRouter(theEnv,logicalName);
      }
 
    if ((inchar == EOF) && (ScannerData(theEnv)->IgnoreCompletionErrors == false))
@@ -98,6 +98,8 @@
 /*                                                           */
 /*            Support for certainty factors.                 */
 /*                                                           */
+/*      ?.??: Added REGEX_FUNCTIONS compiler flag.           */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_setup
@@ -436,6 +438,21 @@
 #define STRING_FUNCTIONS 1
 #endif
 
+/*****************************************************/
+/* REGEX_FUNCTIONS: Includes the POSIX regular       */
+/*   expression string functions regex-match,        */
+/*   regex-captures, and regex-replace. Requires     */
+/*   STRING_FUNCTIONS and <regex.h>.                 */
+/*****************************************************/
+
+#ifndef REGEX_FUNCTIONS
+#if WIN_MVC
+#define REGEX_FUNCTIONS 0
+#else
+#define REGEX_FUNCTIONS 1
+#endif
+#endif
+
 /*********************************************/
 /* MULTIFIELD_FUNCTIONS: Includes multifield */
 /*   functions:  mv-subseq, mv-delete,       */
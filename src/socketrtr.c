@@ -19,6 +19,9 @@
 /*                                                                     */
 /**********************************************************************/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #define _POSIX_C_SOURCE 200112L
 #define NI_MAXHOST      1025
 
@@ -27,6 +30,7 @@
 #include <poll.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <netdb.h>
@@ -51,7 +55,9 @@
 #include "sysdep.h"
 #include "utility.h"
 
+#include "compressfun.h"
 #include "socketrtr.h"
+#include "tlsfun.h"
 
 /***************************************/
 /* LOCAL INTERNAL FUNCTION DEFINITIONS */
@@ -60,8 +66,17 @@
 static void                    WriteSocket(Environment *, const char *, const char *, void *);
 static int                     ReadSocket(Environment *, const char *, void *);
 static int                     UnreadSocket(Environment *, const char *, int, void *);
+static size_t                  ReadBlockSocket(Environment *, const char *, char *, size_t, const char *, void *);
+static void                    WriteBlockSocket(Environment *, const char *, const char *, size_t, void *);
 static void                    ExitSocket(Environment *, int, void *);
 static void                    DeallocateSocketRouterData(Environment *);
+static void                    RemoveSocketSplices(Environment *,int);
+static void                    DestroySocketRouter(Environment *,struct socketRouter *);
+static struct socketRouter    *CreateArenaSocketRouter(Environment *,FILE *,const char *);
+static bool                    StepSpliceDirection(struct socketSplice *,int);
+static long long               DrainBufferedInput(FILE *,int);
+static bool                    SpliceableSocket(Environment *,int);
+static bool                    AppendSocketAddress(StringBuilder *,struct sockaddr_storage *);
 
 /********************************************************************/
 /* InitializeSocketRouter: Initializes socket router structure. */
@@ -77,6 +92,9 @@ void InitializeSocketRouter(
 
 	AddRouter(theEnv,"socketio",0,FindSocket,
 			WriteSocket,ReadSocket,UnreadSocket,ExitSocket,NULL);
+	SetRouterBlockCallbacks(theEnv,"socketio",ReadBlockSocket,WriteBlockSocket);
+
+	AddPeriodicFunction(theEnv,"socket-splice",StepSocketSplices,0,NULL);
 }
 
 /*******************************************/
@@ -126,11 +144,35 @@ static void WriteSocket(
 		const char *str,
 		void *context)
 {
-	FILE *sptr;
+	struct socketRouter *sptr;
 
-	sptr = FindSptr(theEnv,logicalName);
+	sptr = LogicalNameToSocketRouter(theEnv,logicalName);
+
+	if (sptr->compression != NULL)
+	{
+		WriteCompressed(theEnv,sptr,str,strlen(str));
+		return;
+	}
+
+	genprintfile(theEnv,sptr->stream,str);
+}
+
+/*************************************************************/
+/* WriteSocketBytes: Writes bytes to a connection's output,  */
+/*   through its deflate stream if compression is on. Used   */
+/*   by functions that write to the stream directly rather   */
+/*   than through the router.                                */
+/*************************************************************/
+bool WriteSocketBytes(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		const void *data,
+		size_t length)
+{
+	if (sptr->compression != NULL)
+	{ return WriteCompressed(theEnv,sptr,data,length); }
 
-	genprintfile(theEnv,sptr,str);
+	return fwrite(data,1,length,sptr->stream) == length;
 }
 
 /***************************************************************/
@@ -167,6 +209,54 @@ static int UnreadSocket(
 	return ungetc(ch,sptr);
 }
 
+/******************************************************/
+/* ReadBlockSocket: Block read callback for socket    */
+/*   router. Stops after a delimiter so that bytes    */
+/*   past it stay in the stream for the protocol      */
+/*   functions that read it directly.                 */
+/******************************************************/
+static size_t ReadBlockSocket(
+		Environment *theEnv,
+		const char *logicalName,
+		char *buffer,
+		size_t size,
+		const char *delimiters,
+		void *context)
+{
+	FILE *sptr;
+	int theChar;
+	size_t count = 0;
+
+	sptr = FindSptr(theEnv,logicalName);
+
+	while (count < size)
+	{
+		if ((theChar = getc(sptr)) == EOF)
+		{ break; }
+
+		buffer[count++] = (char) theChar;
+
+		if (strchr(delimiters,theChar) != NULL)
+		{ break; }
+	}
+
+	return count;
+}
+
+/******************************************************/
+/* WriteBlockSocket: Block write callback for socket  */
+/*   router.                                          */
+/******************************************************/
+static void WriteBlockSocket(
+		Environment *theEnv,
+		const char *logicalName,
+		const char *str,
+		size_t length,
+		void *context)
+{
+	WriteSocketBytes(theEnv,LogicalNameToSocketRouter(theEnv,logicalName),str,length);
+}
+
 /******************************************************/
 /* LogicalNameToSocketRouter: Loop through            */
 /* all socket routers                                 */
@@ -180,7 +270,7 @@ struct socketRouter *LogicalNameToSocketRouter(
 	struct socketRouter *sptr;
 
 	sptr = SocketRouterData(theEnv)->ListOfSocketRouters;
-	while ((sptr != NULL) ? 0 != strcmp(logicalName, sptr->logicalName) : false)
+	while ((sptr != NULL) ? (sptr->logicalName == NULL || 0 != strcmp(logicalName, sptr->logicalName)) : false)
 	{ sptr = sptr->next; }
 
 	if (sptr != NULL) return sptr;
@@ -188,6 +278,24 @@ struct socketRouter *LogicalNameToSocketRouter(
 	return NULL;
 }
 
+/****************************************************/
+/* SocketRouterFileno: Returns the file descriptor  */
+/*   of a connection. Once TLS is started the       */
+/*   connection's stream no longer has one, so the  */
+/*   descriptor comes from the plain stream kept    */
+/*   underneath it.                                 */
+/****************************************************/
+int SocketRouterFileno(
+		struct socketRouter *sptr)
+{
+#ifndef NO_OPENSSL
+	if (sptr->tls != NULL)
+	{ return fileno(sptr->tls->rawStream); }
+#endif
+
+	return fileno(sptr->stream);
+}
+
 /*********************************************************/
 /* FileDescriptorToSocketRouter: Loop through all        */
 /* socket routers                                        */
@@ -201,7 +309,7 @@ struct socketRouter *FileDescriptorToSocketRouter(
 	struct socketRouter *sptr;
 
 	sptr = SocketRouterData(theEnv)->ListOfSocketRouters;
-	while ((sptr != NULL) ? (fileno(sptr->stream) != sockfd) : false)
+	while ((sptr != NULL) ? (SocketRouterFileno(sptr) != sockfd) : false)
 	{ sptr = sptr->next; }
 
 	if (sptr != NULL) return sptr;
@@ -220,7 +328,7 @@ int GetFilenoFromArgument(
 		UDFContext *context,
 		UDFValue *theArg)
 {
-	FILE *stream;
+	struct socketRouter *sptr;
 	int sockfd = -1;
 	UDFNextArgument(context,INTEGER_BIT|LEXEME_BITS,theArg);
 	if (theArg->header->type == INTEGER_TYPE)
@@ -229,10 +337,10 @@ int GetFilenoFromArgument(
 	}
 	else if (theArg->header->type == STRING_TYPE || theArg->header->type == SYMBOL_TYPE)
 	{
-		stream = FindSptr(theEnv, theArg->lexemeValue->contents);
-		if (stream != NULL)
+		sptr = LogicalNameToSocketRouter(theEnv, theArg->lexemeValue->contents);
+		if (sptr != NULL)
 		{
-			sockfd = fileno(stream);
+			sockfd = SocketRouterFileno(sptr);
 		}
 	}
 	return sockfd;
@@ -421,149 +529,342 @@ int GenSocket(
 	return rv;
 }
 
-/******************************************************************/
-/* GetsockoptFunction: HL function for getsockopt socket function */
-/******************************************************************/
-void GetsockoptFunction(
+/*****************************************************/
+/* SocketOptionLevels: Levels that can be passed to  */
+/*   getsockopt and setsockopt by name.              */
+/*****************************************************/
+static const struct socketOptionLevel SocketOptionLevels[] =
+  {
+   { "SOL_SOCKET", SOL_SOCKET },
+   { "IPPROTO_IP", IPPROTO_IP },
+   { "IPPROTO_IPV6", IPPROTO_IPV6 },
+   { "IPPROTO_TCP", IPPROTO_TCP },
+   { NULL, 0 }
+  };
+
+/*****************************************************/
+/* SocketOptions: Options that can be passed to      */
+/*   getsockopt and setsockopt by name, along with   */
+/*   the level they belong to and how their value is */
+/*   converted to and from CLIPS values.             */
+/*****************************************************/
+static const struct socketOption SocketOptions[] =
+  {
+   { "SO_REUSEADDR", SOL_SOCKET, SO_REUSEADDR, SOCKOPT_BOOL },
+#ifdef SO_REUSEPORT
+   { "SO_REUSEPORT", SOL_SOCKET, SO_REUSEPORT, SOCKOPT_BOOL },
+#endif
+   { "SO_KEEPALIVE", SOL_SOCKET, SO_KEEPALIVE, SOCKOPT_BOOL },
+   { "SO_BROADCAST", SOL_SOCKET, SO_BROADCAST, SOCKOPT_BOOL },
+   { "SO_RCVBUF", SOL_SOCKET, SO_RCVBUF, SOCKOPT_INT },
+   { "SO_SNDBUF", SOL_SOCKET, SO_SNDBUF, SOCKOPT_INT },
+   { "SO_RCVLOWAT", SOL_SOCKET, SO_RCVLOWAT, SOCKOPT_INT },
+   { "SO_RCVTIMEO", SOL_SOCKET, SO_RCVTIMEO, SOCKOPT_TIMEVAL },
+   { "SO_SNDTIMEO", SOL_SOCKET, SO_SNDTIMEO, SOCKOPT_TIMEVAL },
+   { "SO_LINGER", SOL_SOCKET, SO_LINGER, SOCKOPT_LINGER },
+   { "SO_ERROR", SOL_SOCKET, SO_ERROR, SOCKOPT_INT },
+#ifdef SO_PRIORITY
+   { "SO_PRIORITY", SOL_SOCKET, SO_PRIORITY, SOCKOPT_INT },
+#endif
+#ifdef SO_BUSY_POLL
+   { "SO_BUSY_POLL", SOL_SOCKET, SO_BUSY_POLL, SOCKOPT_INT },
+#endif
+#ifdef SO_INCOMING_CPU
+   { "SO_INCOMING_CPU", SOL_SOCKET, SO_INCOMING_CPU, SOCKOPT_INT },
+#endif
+#ifdef SO_BINDTODEVICE
+   { "SO_BINDTODEVICE", SOL_SOCKET, SO_BINDTODEVICE, SOCKOPT_STRING },
+#endif
+   { "IP_TOS", IPPROTO_IP, IP_TOS, SOCKOPT_INT },
+   { "IP_TTL", IPPROTO_IP, IP_TTL, SOCKOPT_INT },
+   { "IPV6_V6ONLY", IPPROTO_IPV6, IPV6_V6ONLY, SOCKOPT_BOOL },
+   { "IPV6_UNICAST_HOPS", IPPROTO_IPV6, IPV6_UNICAST_HOPS, SOCKOPT_INT },
+#ifdef IPV6_TCLASS
+   { "IPV6_TCLASS", IPPROTO_IPV6, IPV6_TCLASS, SOCKOPT_INT },
+#endif
+   { "TCP_NODELAY", IPPROTO_TCP, TCP_NODELAY, SOCKOPT_BOOL },
+#ifdef TCP_CORK
+   { "TCP_CORK", IPPROTO_TCP, TCP_CORK, SOCKOPT_BOOL },
+#endif
+#ifdef TCP_QUICKACK
+   { "TCP_QUICKACK", IPPROTO_TCP, TCP_QUICKACK, SOCKOPT_BOOL },
+#endif
+#ifdef TCP_DEFER_ACCEPT
+   { "TCP_DEFER_ACCEPT", IPPROTO_TCP, TCP_DEFER_ACCEPT, SOCKOPT_INT },
+#endif
+#ifdef TCP_FASTOPEN
+   { "TCP_FASTOPEN", IPPROTO_TCP, TCP_FASTOPEN, SOCKOPT_INT },
+#endif
+#ifdef TCP_KEEPIDLE
+   { "TCP_KEEPIDLE", IPPROTO_TCP, TCP_KEEPIDLE, SOCKOPT_INT },
+#endif
+#ifdef TCP_KEEPINTVL
+   { "TCP_KEEPINTVL", IPPROTO_TCP, TCP_KEEPINTVL, SOCKOPT_INT },
+#endif
+#ifdef TCP_KEEPCNT
+   { "TCP_KEEPCNT", IPPROTO_TCP, TCP_KEEPCNT, SOCKOPT_INT },
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+   { "TCP_NOTSENT_LOWAT", IPPROTO_TCP, TCP_NOTSENT_LOWAT, SOCKOPT_INT },
+#endif
+#ifdef TCP_USER_TIMEOUT
+   { "TCP_USER_TIMEOUT", IPPROTO_TCP, TCP_USER_TIMEOUT, SOCKOPT_INT },
+#endif
+   { "TCP_MAXSEG", IPPROTO_TCP, TCP_MAXSEG, SOCKOPT_INT },
+#ifdef TCP_CONGESTION
+   { "TCP_CONGESTION", IPPROTO_TCP, TCP_CONGESTION, SOCKOPT_STRING },
+#endif
+   { NULL, 0, 0, SOCKOPT_INT }
+  };
+
+/***************************************************/
+/* LookupSocketOption: Reads the level and option  */
+/*   name arguments of getsockopt/setsockopt and   */
+/*   returns the matching entry of the option      */
+/*   table, or NULL (after printing an error) if   */
+/*   either is unknown or they do not belong       */
+/*   together.                                     */
+/***************************************************/
+static const struct socketOption *LookupSocketOption(
 		Environment *theEnv,
 		UDFContext *context,
-		UDFValue *returnValue)
+		const char *func)
 {
 	UDFValue theArg;
-	int sockfd, level, optname, flag; 
-	/*====================*/
-	/* Get the sockfd.    */
-	/*====================*/
-	if (-1 == (sockfd = GetFilenoFromArgument(theEnv,context,&theArg)))
-	{
-		WriteString(theEnv,STDERR,"remove-status-flags: could not find router for socket file descriptor\n");
-		returnValue->lexemeValue = FalseSymbol(theEnv);
-		return;
-	}
+	const struct socketOptionLevel *lptr;
+	const struct socketOption *optr;
+
 	/*====================*/
-	/* Get the level. */
+	/* Get the level.     */
 	/*====================*/
 	UDFNextArgument(context,SYMBOL_BIT,&theArg);
-	const char *UDFlevel = theArg.lexemeValue->contents;
-	if (0 == strcmp(UDFlevel,"SOL_SOCKET"))
-	{
-		level = SOL_SOCKET;
-	}
-	else if (0 == strcmp(UDFlevel,"IPPROTO_TCP"))
+	for (lptr = SocketOptionLevels; lptr->name != NULL; lptr++)
 	{
-		level = IPPROTO_TCP;
+		if (0 == strcmp(lptr->name,theArg.lexemeValue->contents)) break;
 	}
-	else
+	if (lptr->name == NULL)
 	{
-		WriteString(theEnv,STDERR,"Level '");
+		WriteString(theEnv,STDERR,func);
+		WriteString(theEnv,STDERR,": Level '");
 		WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
 		WriteString(theEnv,STDERR,"' not supported.\n");
-		returnValue->lexemeValue = FalseSymbol(theEnv);
-		return;
+		return NULL;
 	}
+
 	/*====================*/
-	/* Get the optname. */
+	/* Get the optname.   */
 	/*====================*/
 	UDFNextArgument(context,SYMBOL_BIT,&theArg);
-	const char *UDFoptname = theArg.lexemeValue->contents;
-	if (0 == strcmp(UDFoptname,"SO_REUSEADDR"))
-	{
-		optname = SO_REUSEADDR;
-	}
-	
-	else if (0 == strcmp(UDFoptname,"TCP_NODELAY"))
+	for (optr = SocketOptions; optr->name != NULL; optr++)
 	{
-		optname = TCP_NODELAY;
+		if (0 == strcmp(optr->name,theArg.lexemeValue->contents)) break;
 	}
-	else
+	if (optr->name == NULL)
 	{
-		WriteString(theEnv,STDERR,"optname '");
+		WriteString(theEnv,STDERR,func);
+		WriteString(theEnv,STDERR,": optname '");
 		WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
 		WriteString(theEnv,STDERR,"' not supported.\n");
-		returnValue->lexemeValue = FalseSymbol(theEnv);
-		return;
+		return NULL;
 	}
-
-	flag = -1;
-	socklen_t flag_len = sizeof(flag);
-	if (0 > GenGetsockopt(theEnv, sockfd, level, optname, &flag, &flag_len))
+	if (optr->level != lptr->level)
 	{
-		WriteString(theEnv,STDERR,"Something went wrong with getsockopt\n");
-		perror("perror");
-		returnValue->lexemeValue = FalseSymbol(theEnv);
-		return;
+		WriteString(theEnv,STDERR,func);
+		WriteString(theEnv,STDERR,": optname '");
+		WriteString(theEnv,STDERR,optr->name);
+		WriteString(theEnv,STDERR,"' is not a ");
+		WriteString(theEnv,STDERR,lptr->name);
+		WriteString(theEnv,STDERR," option.\n");
+		return NULL;
 	}
-	returnValue->integerValue = CreateInteger(theEnv, flag);
+
+	return optr;
 }
 
 /******************************************************************/
-/* SetsockoptFunction: HL function for setsockopt socket function */
+/* GetsockoptFunction: HL function for getsockopt socket function */
+/*   Returns an integer (0 or 1 for boolean options) or a string  */
+/*   depending on the option, or FALSE on error.                  */
 /******************************************************************/
-void SetsockoptFunction(
+void GetsockoptFunction(
 		Environment *theEnv,
 		UDFContext *context,
 		UDFValue *returnValue)
 {
 	UDFValue theArg;
-	int sockfd, level, optname, flag; 
+	const struct socketOption *optr;
+	int sockfd, flag;
+	struct timeval tv;
+	struct linger lg;
+	char str[64];
+	socklen_t optlen;
 	/*====================*/
 	/* Get the sockfd.    */
 	/*====================*/
 	if (-1 == (sockfd = GetFilenoFromArgument(theEnv,context,&theArg)))
 	{
-		WriteString(theEnv,STDERR,"remove-status-flags: could not find router for socket file descriptor\n");
+		WriteString(theEnv,STDERR,"getsockopt: could not find router for socket file descriptor\n");
 		returnValue->lexemeValue = FalseSymbol(theEnv);
 		return;
 	}
-	/*====================*/
-	/* Get the level.     */
-	/*====================*/
-	UDFNextArgument(context,SYMBOL_BIT,&theArg);
-	const char *UDFlevel = theArg.lexemeValue->contents;
-	if (0 == strcmp(UDFlevel,"SOL_SOCKET"))
-	{
-		level = SOL_SOCKET;
-	}
-	else if (0 == strcmp(UDFlevel,"IPPROTO_TCP"))
-	{
-		level = IPPROTO_TCP;
-	}
-	else
+
+	if (NULL == (optr = LookupSocketOption(theEnv,context,"getsockopt")))
 	{
-		WriteString(theEnv,STDERR,"Level '");
-		WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
-		WriteString(theEnv,STDERR,"' not supported.\n");
 		returnValue->lexemeValue = FalseSymbol(theEnv);
 		return;
 	}
-	/*====================*/
-	/* Get the optname. */
-	/*====================*/
-	UDFNextArgument(context,SYMBOL_BIT,&theArg);
-	const char *UDFoptname = theArg.lexemeValue->contents;
-	if (0 == strcmp(UDFoptname,"SO_REUSEADDR"))
+
+	switch (optr->type)
 	{
-		optname = SO_REUSEADDR;
+		case SOCKOPT_INT:
+		case SOCKOPT_BOOL:
+			flag = -1;
+			optlen = sizeof(flag);
+			if (0 > GenGetsockopt(theEnv, sockfd, optr->level, optr->optname, &flag, &optlen)) break;
+			if (optr->type == SOCKOPT_BOOL)
+			{ flag = (flag != 0); }
+			returnValue->integerValue = CreateInteger(theEnv, flag);
+			return;
+		case SOCKOPT_TIMEVAL:
+			optlen = sizeof(tv);
+			if (0 > GenGetsockopt(theEnv, sockfd, optr->level, optr->optname, &tv, &optlen)) break;
+			returnValue->integerValue = CreateInteger(theEnv, (long long) tv.tv_sec * 1000000 + tv.tv_usec);
+			return;
+		case SOCKOPT_LINGER:
+			optlen = sizeof(lg);
+			if (0 > GenGetsockopt(theEnv, sockfd, optr->level, optr->optname, &lg, &optlen)) break;
+			if (lg.l_onoff)
+			{ returnValue->integerValue = CreateInteger(theEnv, lg.l_linger); }
+			else
+			{ returnValue->lexemeValue = FalseSymbol(theEnv); }
+			return;
+		case SOCKOPT_STRING:
+			memset(str, 0, sizeof(str));
+			optlen = sizeof(str) - 1;
+			if (0 > GenGetsockopt(theEnv, sockfd, optr->level, optr->optname, str, &optlen)) break;
+			returnValue->lexemeValue = CreateString(theEnv, str);
+			return;
 	}
-	else if (0 == strcmp(UDFoptname,"TCP_NODELAY"))
+
+	WriteString(theEnv,STDERR,"Something went wrong with getsockopt\n");
+	perror("perror");
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+}
+
+/******************************************************************/
+/* SetsockoptFunction: HL function for setsockopt socket function */
+/*   The value is converted according to the option's type in     */
+/*   the option table. Returns TRUE on success, FALSE on error.   */
+/******************************************************************/
+void SetsockoptFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	const struct socketOption *optr;
+	int sockfd, flag, rv = -1;
+	long long usec;
+	struct timeval tv;
+	struct linger lg;
+	const char *str;
+	/*====================*/
+	/* Get the sockfd.    */
+	/*====================*/
+	if (-1 == (sockfd = GetFilenoFromArgument(theEnv,context,&theArg)))
 	{
-		optname = TCP_NODELAY;
+		WriteString(theEnv,STDERR,"setsockopt: could not find router for socket file descriptor\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
 	}
-	else
+
+	if (NULL == (optr = LookupSocketOption(theEnv,context,"setsockopt")))
 	{
-		WriteString(theEnv,STDERR,"optname '");
-		WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
-		WriteString(theEnv,STDERR,"' not supported.\n");
 		returnValue->lexemeValue = FalseSymbol(theEnv);
 		return;
 	}
+
 	/*====================*/
-	/* Get the flag.      */
+	/* Get the value.     */
 	/*====================*/
-	UDFNextArgument(context,INTEGER_BIT,&theArg);
-	flag = theArg.integerValue->contents;
+	UDFNextArgument(context,NUMBER_BITS|LEXEME_BITS,&theArg);
+	switch (optr->type)
+	{
+		case SOCKOPT_INT:
+		case SOCKOPT_BOOL:
+			if (theArg.header->type == INTEGER_TYPE)
+			{ flag = (int) theArg.integerValue->contents; }
+			else if (optr->type == SOCKOPT_BOOL && theArg.value == TrueSymbol(theEnv))
+			{ flag = 1; }
+			else if (optr->type == SOCKOPT_BOOL && theArg.value == FalseSymbol(theEnv))
+			{ flag = 0; }
+			else
+			{
+				UDFInvalidArgumentMessage(context,(optr->type == SOCKOPT_BOOL) ? "integer, TRUE or FALSE" : "integer");
+				returnValue->lexemeValue = FalseSymbol(theEnv);
+				return;
+			}
+			rv = GenSetsockopt(theEnv, sockfd, optr->level, optr->optname, (const void *)&flag, sizeof(flag));
+			break;
+		case SOCKOPT_TIMEVAL:
+			if (theArg.header->type == INTEGER_TYPE)
+			{ usec = theArg.integerValue->contents; }
+			else if (theArg.header->type == FLOAT_TYPE)
+			{ usec = (long long) (theArg.floatValue->contents * 1000000.0); }
+			else
+			{
+				UDFInvalidArgumentMessage(context,"integer microseconds or float seconds");
+				returnValue->lexemeValue = FalseSymbol(theEnv);
+				return;
+			}
+			if (usec < 0)
+			{
+				UDFInvalidArgumentMessage(context,"number (greater than or equal to 0)");
+				returnValue->lexemeValue = FalseSymbol(theEnv);
+				return;
+			}
+			tv.tv_sec = usec / 1000000;
+			tv.tv_usec = usec % 1000000;
+			rv = GenSetsockopt(theEnv, sockfd, optr->level, optr->optname, (const void *)&tv, sizeof(tv));
+			break;
+		case SOCKOPT_LINGER:
+			if (theArg.header->type == INTEGER_TYPE && theArg.integerValue->contents < 0)
+			{
+				UDFInvalidArgumentMessage(context,"integer (greater than or equal to 0)");
+				returnValue->lexemeValue = FalseSymbol(theEnv);
+				return;
+			}
+			else if (theArg.header->type == INTEGER_TYPE)
+			{
+				lg.l_onoff = 1;
+				lg.l_linger = (int) theArg.integerValue->contents;
+			}
+			else if (theArg.value == FalseSymbol(theEnv))
+			{
+				lg.l_onoff = 0;
+				lg.l_linger = 0;
+			}
+			else
+			{
+				UDFInvalidArgumentMessage(context,"integer seconds or FALSE");
+				returnValue->lexemeValue = FalseSymbol(theEnv);
+				return;
+			}
+			rv = GenSetsockopt(theEnv, sockfd, optr->level, optr->optname, (const void *)&lg, sizeof(lg));
+			break;
+		case SOCKOPT_STRING:
+			if (! (theArg.header->type == STRING_TYPE || theArg.header->type == SYMBOL_TYPE))
+			{
+				UDFInvalidArgumentMessage(context,"string or symbol");
+				returnValue->lexemeValue = FalseSymbol(theEnv);
+				return;
+			}
+			str = theArg.lexemeValue->contents;
+			rv = GenSetsockopt(theEnv, sockfd, optr->level, optr->optname, (const void *)str, (socklen_t) strlen(str));
+			break;
+	}
 
-	if (0 > GenSetsockopt(theEnv, sockfd, level, optname, (const void *)&flag, sizeof(flag)))
+	if (0 > rv)
 	{
 		WriteString(theEnv,STDERR,"Something went wrong with setsockopt\n");
 		perror("perror");
@@ -669,6 +970,22 @@ void CreateSocketFunction(
 	/* Create a new socket router. */
 	/*=============================*/
 	newRouter = get_struct(theEnv,socketRouter);
+	newRouter->logicalName = NULL;
+	newRouter->arena = NULL;
+	newRouter->pending = NULL;
+	newRouter->pendingLength = 0;
+	newRouter->pendingSize = 0;
+	newRouter->jsonArrayCount = -1;
+	newRouter->respCommandCount = 0;
+	newRouter->websocket = false;
+	newRouter->websocketClosed = false;
+	newRouter->websocketOpcode = 0;
+	newRouter->websocketMessage = NULL;
+	newRouter->websocketMessageLength = 0;
+	newRouter->websocketMessageSize = 0;
+	newRouter->websocketMessageCount = 0;
+	newRouter->compression = NULL;
+	newRouter->tls = NULL;
 	newRouter->domain = domain;
 	newRouter->type = type;
 	newRouter->stream = fdopen(sock, "r+");
@@ -723,16 +1040,23 @@ FlushConnectionFunction(
 		UDFValue *returnValue)
 {
 	UDFValue theArg;
-	FILE *socketStream;
+	struct socketRouter *sptr;
 
-	if (NULL == (socketStream = GetBoundOrConnectedFilenoFromArgument(theEnv,context,&theArg)))
+	if (NULL == (sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)))
 	{
 		WriteString(theEnv,STDERR,"flush-connection: Could not find socket with that logical name\n");
 		returnValue->lexemeValue = FalseSymbol(theEnv);
 		return;
 	}
 
-	returnValue->lexemeValue = CreateBoolean(theEnv,FlushConnection(theEnv,socketStream));
+	/*==============================================*/
+	/* Output held in a deflate stream is pushed    */
+	/* out with a sync flush before the stream is.  */
+	/*==============================================*/
+	if (sptr->compression != NULL)
+	{ FlushCompressed(theEnv,sptr); }
+
+	returnValue->lexemeValue = CreateBoolean(theEnv,FlushConnection(theEnv,sptr->stream));
 }
 
 bool EmptyConnection(
@@ -769,6 +1093,221 @@ EmptyConnectionFunction(
 	returnValue->lexemeValue = CreateBoolean(theEnv,EmptyConnection(theEnv,socketStream));
 }
 
+/*******************************************************/
+/* CreateArenaSocketRouter: Creates the router for a   */
+/*   connection inside an arena owned by that          */
+/*   connection. The router, its logical name and its  */
+/*   stdio buffer all come from the arena so they are  */
+/*   released together when the connection is closed.  */
+/*   The router is added to the list of sockets.       */
+/*******************************************************/
+static struct socketRouter *CreateArenaSocketRouter(
+		Environment *theEnv,
+		FILE *stream,
+		const char *logicalName)
+{
+	struct memoryArena *theArena;
+	struct socketRouter *newRouter;
+	char *theName;
+
+	theArena = CreateArena(theEnv,SOCKET_ARENA_SIZE);
+
+	newRouter = (struct socketRouter *) ArenaAllocate(theEnv,theArena,sizeof(struct socketRouter));
+	theName = (char *) ArenaAllocate(theEnv,theArena,strlen(logicalName) + 1);
+	genstrcpy(theName,logicalName);
+	newRouter->logicalName = theName;
+	newRouter->stream = stream;
+	newRouter->arena = theArena;
+	newRouter->pending = NULL;
+	newRouter->pendingLength = 0;
+	newRouter->pendingSize = 0;
+	newRouter->jsonArrayCount = -1;
+	newRouter->respCommandCount = 0;
+	newRouter->websocket = false;
+	newRouter->websocketClosed = false;
+	newRouter->websocketOpcode = 0;
+	newRouter->websocketMessage = NULL;
+	newRouter->websocketMessageLength = 0;
+	newRouter->websocketMessageSize = 0;
+	newRouter->websocketMessageCount = 0;
+	newRouter->compression = NULL;
+	newRouter->tls = NULL;
+	newRouter->domain = AF_UNSPEC;
+	newRouter->type = 0;
+
+	GenSetvbuf(theEnv,stream,(char *) ArenaAllocate(theEnv,theArena,BUFSIZ),_IOFBF,BUFSIZ);
+
+	newRouter->next = SocketRouterData(theEnv)->ListOfSocketRouters;
+	SocketRouterData(theEnv)->ListOfSocketRouters = newRouter;
+	RouterNameChanged(theEnv,theName);
+
+	return newRouter;
+}
+
+/*******************************************************/
+/* ReadSocketAvailable: Appends whatever input is      */
+/*   available on a connection to its pending buffer,  */
+/*   for native protocol parsers that work on blocks   */
+/*   of bytes instead of characters. Bytes already in  */
+/*   the stdio buffer come first. If nothing is        */
+/*   available on a blocking connection, waits for     */
+/*   some to arrive. Sets eof once the peer has closed */
+/*   its side. Returns false on a read error, or with  */
+/*   errno set to EMSGSIZE once the pending buffer is  */
+/*   full and more input is waiting.                   */
+/*******************************************************/
+bool ReadSocketAvailable(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		bool *eof)
+{
+	int sockfd, flags;
+	size_t nread, total = 0;
+	size_t newSize;
+	char *newPending;
+	bool rv = true;
+
+	*eof = false;
+	sockfd = SocketRouterFileno(sptr);
+	flags = GenFcntl(theEnv, sockfd, F_GETFL, 0);
+
+	if (! (flags & O_NONBLOCK))
+	{ GenFcntl(theEnv, sockfd, F_SETFL, flags | O_NONBLOCK); }
+
+	while (true)
+	{
+		if ((sptr->pendingSize - sptr->pendingLength) < BUFSIZ &&
+		    sptr->pendingSize < SOCKET_MAX_PENDING_LENGTH)
+		{
+			newSize = (sptr->pendingSize == 0) ? (BUFSIZ * 2) : (sptr->pendingSize * 2);
+			if (newSize > SOCKET_MAX_PENDING_LENGTH)
+			{ newSize = SOCKET_MAX_PENDING_LENGTH; }
+			newPending = (char *) gm2(theEnv,newSize);
+			if (sptr->pendingLength > 0)
+			{ memcpy(newPending,sptr->pending,sptr->pendingLength); }
+			if (sptr->pending != NULL)
+			{ rm(theEnv,sptr->pending,sptr->pendingSize); }
+			sptr->pending = newPending;
+			sptr->pendingSize = newSize;
+		}
+
+		/*=========================================*/
+		/* A parser that has not been able to make */
+		/* use of this much input is never going   */
+		/* to, so the read fails rather than keep  */
+		/* buffering whatever the peer sends.      */
+		/*=========================================*/
+		if (sptr->pendingLength == sptr->pendingSize)
+		{
+			WriteString(theEnv,STDERR,"Pending input on socket ");
+			WriteInteger(theEnv,STDERR,sockfd);
+			WriteString(theEnv,STDERR," is too large\n");
+			errno = EMSGSIZE;
+			rv = false;
+			break;
+		}
+
+		errno = 0;
+		nread = fread(sptr->pending + sptr->pendingLength, 1,
+				sptr->pendingSize - sptr->pendingLength, sptr->stream);
+		sptr->pendingLength += nread;
+		total += nread;
+
+		if (feof(sptr->stream))
+		{
+			*eof = true;
+			break;
+		}
+
+		if (ferror(sptr->stream))
+		{
+			clearerr(sptr->stream);
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				rv = false;
+				break;
+			}
+
+			/*=========================================*/
+			/* Nothing more is available. A blocking   */
+			/* connection waits until at least one     */
+			/* byte has arrived before returning.      */
+			/*=========================================*/
+			if (total > 0 || (flags & O_NONBLOCK))
+			{ break; }
+
+			GenPoll(theEnv, sockfd, -1, POLLIN);
+		}
+	}
+
+	clearerr(sptr->stream);
+
+	if (! (flags & O_NONBLOCK))
+	{ GenFcntl(theEnv, sockfd, F_SETFL, flags); }
+
+	return rv;
+}
+
+/*****************************************************/
+/* ConsumeSocketPending: Drops the first count bytes */
+/*   of a connection's pending buffer once a parser  */
+/*   has dealt with them.                            */
+/*****************************************************/
+void ConsumeSocketPending(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		size_t count)
+{
+	if (count >= sptr->pendingLength)
+	{
+		sptr->pendingLength = 0;
+		return;
+	}
+
+	memmove(sptr->pending, sptr->pending + count, sptr->pendingLength - count);
+	sptr->pendingLength -= count;
+}
+
+/*******************************************************/
+/* DestroySocketRouter: Closes a socket router that    */
+/*   has already been unlinked from the list of        */
+/*   sockets and returns its memory, in one shot if    */
+/*   the router lives in its own arena.                */
+/*******************************************************/
+static void DestroySocketRouter(
+		Environment *theEnv,
+		struct socketRouter *sptr)
+{
+	if (sptr->logicalName != NULL)
+	{ RouterNameChanged(theEnv,sptr->logicalName); }
+
+	RemoveSocketSplices(theEnv,SocketRouterFileno(sptr));
+
+	if (sptr->compression != NULL)
+	{ EndCompression(theEnv,sptr); }
+
+	if (sptr->tls != NULL)
+	{ EndTls(theEnv,sptr); }
+
+	GenClose(theEnv,sptr->stream);
+
+	if (sptr->pending != NULL)
+	{ rm(theEnv,sptr->pending,sptr->pendingSize); }
+
+	if (sptr->websocketMessage != NULL)
+	{ rm(theEnv,sptr->websocketMessage,sptr->websocketMessageSize); }
+
+	if (sptr->arena != NULL)
+	{
+		ReleaseArena(theEnv,sptr->arena);
+		return;
+	}
+
+	if (sptr->logicalName != NULL)
+	{ rm(theEnv,(void *) sptr->logicalName,strlen(sptr->logicalName) + 1); }
+	rm(theEnv,sptr,sizeof(struct socketRouter));
+}
+
 /***************************************************************************************/
 /* CloseFileDescriptorConnection: Closes the connection associated with the specified  */
 /*   connection file descriptor. Returns true if the connection was successfully       */
@@ -784,16 +1323,13 @@ bool CloseFileDescriptorConnection(
 			sptr != NULL;
 			sptr = sptr->next)
 	{
-		if (fileno(sptr->stream) == socketfd)
+		if (SocketRouterFileno(sptr) == socketfd)
 		{
-			GenClose(theEnv,sptr->stream);
-			rm(theEnv,(void *) sptr->logicalName,strlen(sptr->logicalName) + 1);
-
 			if (prev == NULL)
 			{ SocketRouterData(theEnv)->ListOfSocketRouters = sptr->next; }
 			else
 			{ prev->next = sptr->next; }
-			rm(theEnv,sptr,sizeof(struct socketRouter));
+			DestroySocketRouter(theEnv,sptr);
 
 			return true;
 		}
@@ -819,15 +1355,13 @@ bool CloseNamedConnection(
 			sptr != NULL;
 			sptr = sptr->next)
 	{
-		if (strcmp(sptr->logicalName,logicalName) == 0)
+		if ((sptr->logicalName != NULL) && (strcmp(sptr->logicalName,logicalName) == 0))
 		{
-			GenClose(theEnv,sptr->stream);
-			rm(theEnv,(void *) sptr->logicalName,strlen(sptr->logicalName) + 1);
 			if (prev == NULL)
 			{ SocketRouterData(theEnv)->ListOfSocketRouters = sptr->next; }
 			else
 			{ prev->next = sptr->next; }
-			rm(theEnv,sptr,sizeof(struct socketRouter));
+			DestroySocketRouter(theEnv,sptr);
 
 			return true;
 		}
@@ -1061,7 +1595,7 @@ void BindSocketFunction(
 	/* Bind the socket with the address.  */
 	/*====================================*/
 
-	if (bind(fileno(sptr->stream), (struct sockaddr *)&serv_addr, addr_len) < 0)
+	if (bind(SocketRouterFileno(sptr), (struct sockaddr *)&serv_addr, addr_len) < 0)
 	{
 		WriteString(theEnv,STDERR,"Could not bind ");
 		WriteString(theEnv,STDERR,theArg.lexemeValue->contents);
@@ -1075,6 +1609,7 @@ void BindSocketFunction(
 	theName = (char *) gm2(theEnv,strlen(logicalNameStringBuilder->contents) + 1);
 	genstrcpy(theName,logicalNameStringBuilder->contents);
 	sptr->logicalName = theName;
+	RouterNameChanged(theEnv,theName);
 	SBDispose(logicalNameStringBuilder);
 
 	returnValue->lexemeValue = CreateSymbol(theEnv, sptr->logicalName);
@@ -1166,7 +1701,6 @@ void AcceptFunction(
 	int connection_fd;
 	struct socketRouter *newRouter;
 	socklen_t client_addr_len;
-	char *theName;
 
 	if (NULL == (sptr = GetSocketRouterFromArgument(theEnv, context, &theArg)))
 	{
@@ -1180,7 +1714,7 @@ void AcceptFunction(
 	/*====================================*/
 	/* Accept a connection on the socket.  */
 	/*====================================*/
-	if ((connection_fd = accept(fileno(sptr->stream), (struct sockaddr *)&client_addr, &client_addr_len)) < 0)
+	if ((connection_fd = accept(SocketRouterFileno(sptr), (struct sockaddr *)&client_addr, &client_addr_len)) < 0)
 	{
 		WriteString(theEnv,STDERR,"Could not accept connection on socket '");
 		WriteString(theEnv,STDERR,sptr->logicalName);
@@ -1194,43 +1728,20 @@ void AcceptFunction(
 	/* Build logical name for accepted client */
 	/*========================================*/
 
-	switch (sptr->domain)
-	{
-		case AF_INET:
-			struct sockaddr_in *addr = (struct sockaddr_in *)&client_addr;
-			char client_ip[INET_ADDRSTRLEN];
-			inet_ntop(AF_INET, &(addr->sin_addr), client_ip, INET_ADDRSTRLEN);
-			int client_port = ntohs(addr->sin_port);
-
-			SBAppend(logicalNameStringBuilder, client_ip);
-			SBAddChar(logicalNameStringBuilder, ':');
-			SBAppendInteger(logicalNameStringBuilder, client_port);
-			break;
-		case AF_INET6:
-			struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&client_addr;
-			char client_ip6[INET6_ADDRSTRLEN];
-			inet_ntop(AF_INET6, &(addr6->sin6_addr), client_ip6, INET6_ADDRSTRLEN);
-			int client_port6 = ntohs(addr6->sin6_port);
+	/*============================================*/
+	/* IPv6 peers are named [ip]:port, the same   */
+	/* way bind-socket and connect name sockets.  */
+	/*============================================*/
 
-			SBAddChar(logicalNameStringBuilder, '[');
-			SBAppend(logicalNameStringBuilder, client_ip6);
-			SBAddChar(logicalNameStringBuilder, ':');
-			SBAppendInteger(logicalNameStringBuilder, client_port6);
-			SBAddChar(logicalNameStringBuilder, ']');
-			break;
-		case AF_UNIX:
-			struct sockaddr_un *addrun = (struct sockaddr_un *)&client_addr;
-			char *socket_path = addrun->sun_path;
-			SBAppend(logicalNameStringBuilder, socket_path);
-			break;
-		case AF_UNSPEC:
-		default:
-			WriteString(theEnv,STDERR,"Could not accept; socket domain '");
-			WriteInteger(theEnv,STDERR,sptr->domain);
-			WriteString(theEnv,STDERR,"' not supported.\n");
-			SBDispose(logicalNameStringBuilder);
-			returnValue->lexemeValue = FalseSymbol(theEnv);
-			return;
+	if (! AppendSocketAddress(logicalNameStringBuilder, &client_addr))
+	{
+		WriteString(theEnv,STDERR,"Could not accept; socket domain '");
+		WriteInteger(theEnv,STDERR,sptr->domain);
+		WriteString(theEnv,STDERR,"' not supported.\n");
+		close(connection_fd);
+		SBDispose(logicalNameStringBuilder);
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
 	}
 
 	/*=========================================*/
@@ -1252,20 +1763,11 @@ void AcceptFunction(
 	/* Create a new socket router. */
 	/*=============================*/
 
-	newRouter = get_struct(theEnv,socketRouter);
-	theName = (char *) gm2(theEnv,strlen(logicalNameStringBuilder->contents) + 1);
-	genstrcpy(theName,logicalNameStringBuilder->contents);
-	newRouter->logicalName = theName;
+	newRouter = CreateArenaSocketRouter(theEnv,newstream,logicalNameStringBuilder->contents);
 	SBDispose(logicalNameStringBuilder);
-	newRouter->stream = newstream;
-
-	/*==========================================*/
-	/* Add the newly opened file to the list of */
-	/* files associated with logical names.     */
-	/*==========================================*/
+	newRouter->domain = sptr->domain;
+	newRouter->type = sptr->type;
 
-	newRouter->next = SocketRouterData(theEnv)->ListOfSocketRouters;
-	SocketRouterData(theEnv)->ListOfSocketRouters = newRouter;
 	returnValue->integerValue = CreateInteger(theEnv, connection_fd);
 	return;
 }
@@ -1430,7 +1932,7 @@ void ConnectFunction(
 			return;
 	}
 
-	if (0 > connect(fileno(sptr->stream), (struct sockaddr*)&serv_addr, addr_len))
+	if (0 > connect(SocketRouterFileno(sptr), (struct sockaddr*)&serv_addr, addr_len))
 	{
 		WriteString(theEnv,STDERR,"Could not connect to '");
 		WriteString(theEnv,STDERR,logicalNameStringBuilder->contents);
@@ -1444,6 +1946,7 @@ void ConnectFunction(
 	theName = (char *) gm2(theEnv,strlen(logicalNameStringBuilder->contents) + 1);
 	genstrcpy(theName,logicalNameStringBuilder->contents);
 	sptr->logicalName = theName;
+	RouterNameChanged(theEnv,theName);
 	SBDispose(logicalNameStringBuilder);
 
 	returnValue->lexemeValue = CreateSymbol(theEnv, sptr->logicalName);
@@ -1697,17 +2200,17 @@ void CloseAllSockets(Environment *theEnv)
 {
 	struct socketRouter *sptr, *prev;
 
+	RemoveSocketSplices(theEnv,-1);
+
 	if (SocketRouterData(theEnv)->ListOfSocketRouters == NULL) return;
 
 	sptr = SocketRouterData(theEnv)->ListOfSocketRouters;
 
 	while (sptr != NULL)
 	{
-		GenClose(theEnv,sptr->stream);
 		prev = sptr;
-		rm(theEnv,(void *) sptr->logicalName,strlen(sptr->logicalName) + 1);
 		sptr = sptr->next;
-		rm(theEnv,prev,sizeof(struct socketRouter));
+		DestroySocketRouter(theEnv,prev);
 	}
 
 	SocketRouterData(theEnv)->ListOfSocketRouters = NULL;
@@ -1779,7 +2282,7 @@ void RecvfromFunction(
                         maxlen = (long) theArg.integerValue->contents;
         }
 
-        fd = fileno(sptr->stream);
+        fd = SocketRouterFileno(sptr);
         memset(&peer, 0, sizeof(peer));
         nread = recvfrom(fd, buf, (size_t)maxlen, flags, (struct sockaddr *)&peer, &peer_len);
         if (nread < 0)
@@ -2023,7 +2526,7 @@ void SendtoFunction(
                 }
         }
 
-        fd = fileno(sptr->stream);
+        fd = SocketRouterFileno(sptr);
 
         ssize_t nsent = sendto(fd, data, data_len, flags, (struct sockaddr *)&dst, dst_len);
         if (nsent < 0)
@@ -2038,3 +2541,1086 @@ void SendtoFunction(
 
         returnValue->integerValue = CreateInteger(theEnv, (long long)nsent);
 }
+
+/*********************************************************/
+/* DrainBufferedInput: Queues any bytes already read     */
+/*   into a connection's stdio buffer in the pipe that   */
+/*   carries its data to the other side, so nothing is   */
+/*   lost when the connection is handed off to splice.   */
+/*   The pipe is empty and larger than the buffer, so    */
+/*   this never waits on the peer. Returns the number of */
+/*   bytes queued, or -1 if they could not all be queued.*/
+/*********************************************************/
+static long long DrainBufferedInput(
+		FILE *from,
+		int topipe)
+{
+	char buf[BUFSIZ];
+	size_t nread, nwritten;
+	ssize_t rv;
+	long long total = 0;
+
+	while ((nread = fread(buf, 1, sizeof(buf), from)) > 0)
+	{
+		nwritten = 0;
+		while (nwritten < nread)
+		{
+			rv = write(topipe, buf + nwritten, nread - nwritten);
+			if (rv > 0)
+			{
+				nwritten += (size_t) rv;
+			}
+			else if (rv < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			else
+			{
+				clearerr(from);
+				return -1;
+			}
+		}
+		total += (long long) nwritten;
+	}
+
+	clearerr(from);
+	return total;
+}
+
+/*******************************************************/
+/* SpliceableSocket: Returns true if a file descriptor */
+/*   is a connected stream socket. Datagram sockets    */
+/*   and listening sockets can't be spliced.           */
+/*******************************************************/
+static bool SpliceableSocket(
+		Environment *theEnv,
+		int sockfd)
+{
+	int type = 0, listening = 0;
+	socklen_t opt_len;
+
+	opt_len = sizeof(type);
+	if (0 > GenGetsockopt(theEnv, sockfd, SOL_SOCKET, SO_TYPE, &type, &opt_len) ||
+	    type != SOCK_STREAM)
+	{
+		WriteString(theEnv,STDERR,"splice-connections: only stream sockets can be spliced\n");
+		return false;
+	}
+
+	opt_len = sizeof(listening);
+	if (0 > GenGetsockopt(theEnv, sockfd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &opt_len) ||
+	    listening)
+	{
+		WriteString(theEnv,STDERR,"splice-connections: cannot splice a listening socket\n");
+		return false;
+	}
+
+	return true;
+}
+
+/*******************************************************/
+/* SpliceConnectionsFunction: H/L access function for  */
+/*   splice-connections. Hands two connections off to */
+/*   the kernel so bytes flow between them through a   */
+/*   pair of pipes without passing through CLIPS.      */
+/*   Returns TRUE on success, FALSE on failure.        */
+/*******************************************************/
+void SpliceConnectionsFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *a, *b;
+	struct socketSplice *ssptr;
+	UDFValue theArg;
+	long long maxBytes = 65536;
+	long long queued[2];
+	int d;
+
+	if (NULL == (a = GetSocketRouterFromArgument(theEnv, context, &theArg)) ||
+	    NULL == (b = GetSocketRouterFromArgument(theEnv, context, &theArg)))
+	{
+		WriteString(theEnv,STDERR,"splice-connections: argument was not recognized as a connection\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	if (a == b)
+	{
+		WriteString(theEnv,STDERR,"splice-connections: cannot splice a connection to itself\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	if ((a->tls != NULL) || (b->tls != NULL))
+	{
+		WriteString(theEnv,STDERR,"splice-connections: cannot splice a TLS connection\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	if (! SpliceableSocket(theEnv, SocketRouterFileno(a)) ||
+	    ! SpliceableSocket(theEnv, SocketRouterFileno(b)))
+	{
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,INTEGER_BIT,&theArg);
+		maxBytes = theArg.integerValue->contents;
+		if (maxBytes <= 0)
+		{
+			WriteString(theEnv,STDERR,"splice-connections: ?maxBytes must be greater than 0\n");
+			returnValue->lexemeValue = FalseSymbol(theEnv);
+			return;
+		}
+	}
+
+	for (ssptr = SocketRouterData(theEnv)->ListOfSocketSplices; ssptr != NULL; ssptr = ssptr->next)
+	{
+		if (ssptr->fds[0] == SocketRouterFileno(a) || ssptr->fds[1] == SocketRouterFileno(a) ||
+		    ssptr->fds[0] == SocketRouterFileno(b) || ssptr->fds[1] == SocketRouterFileno(b))
+		{
+			WriteString(theEnv,STDERR,"splice-connections: connection is already spliced\n");
+			returnValue->lexemeValue = FalseSymbol(theEnv);
+			return;
+		}
+	}
+
+	ssptr = get_struct(theEnv,socketSplice);
+	memset(ssptr, 0, sizeof(struct socketSplice));
+	ssptr->fds[0] = SocketRouterFileno(a);
+	ssptr->fds[1] = SocketRouterFileno(b);
+	ssptr->maxBytes = (size_t) maxBytes;
+
+	if (0 > pipe2(ssptr->pipes[0], O_NONBLOCK | O_CLOEXEC))
+	{
+		WriteString(theEnv,STDERR,"splice-connections: could not create pipe\n");
+		perror("perror");
+		rtn_struct(theEnv,socketSplice,ssptr);
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+	if (0 > pipe2(ssptr->pipes[1], O_NONBLOCK | O_CLOEXEC))
+	{
+		WriteString(theEnv,STDERR,"splice-connections: could not create pipe\n");
+		perror("perror");
+		close(ssptr->pipes[0][0]);
+		close(ssptr->pipes[0][1]);
+		rtn_struct(theEnv,socketSplice,ssptr);
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	/*==============================================*/
+	/* Anything still sitting in the stdio buffers  */
+	/* has to reach the other side before the       */
+	/* kernel takes over the data path. Buffered    */
+	/* input is queued in the pipes and delivered   */
+	/* by the steps like any other spliced bytes.   */
+	/*==============================================*/
+	GenFlush(theEnv,a->stream);
+	GenFlush(theEnv,b->stream);
+	for (d = 0; d < 2; d++)
+	{
+		GenFcntl(theEnv, ssptr->fds[d], F_SETFL, GenFcntl(theEnv, ssptr->fds[d], F_GETFL, 0) | O_NONBLOCK);
+	}
+	queued[0] = DrainBufferedInput(a->stream, ssptr->pipes[0][1]);
+	queued[1] = DrainBufferedInput(b->stream, ssptr->pipes[1][1]);
+	if (queued[0] < 0 || queued[1] < 0)
+	{
+		WriteString(theEnv,STDERR,"splice-connections: could not queue buffered input\n");
+		for (d = 0; d < 2; d++)
+		{
+			close(ssptr->pipes[d][0]);
+			close(ssptr->pipes[d][1]);
+		}
+		rtn_struct(theEnv,socketSplice,ssptr);
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+	ssptr->pending[0] = (size_t) queued[0];
+	ssptr->pending[1] = (size_t) queued[1];
+
+	ssptr->next = SocketRouterData(theEnv)->ListOfSocketSplices;
+	SocketRouterData(theEnv)->ListOfSocketSplices = ssptr;
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*****************************************************/
+/* StepSpliceDirection: Moves at most maxBytes from  */
+/*   one side of a splice into its pipe and from the */
+/*   pipe out to the other side without blocking.    */
+/*   Returns true if any progress was made.          */
+/*****************************************************/
+static bool StepSpliceDirection(
+		struct socketSplice *ssptr,
+		int d)
+{
+	ssize_t n;
+	bool progress = false;
+	int src = ssptr->fds[d], dst = ssptr->fds[1 - d];
+
+	if (! ssptr->eof[d] && ssptr->pending[d] < ssptr->maxBytes)
+	{
+		n = splice(src, NULL, ssptr->pipes[d][1], NULL,
+				ssptr->maxBytes - ssptr->pending[d], SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (n > 0)
+		{
+			ssptr->pending[d] += (size_t) n;
+			progress = true;
+		}
+		else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+		{
+			ssptr->eof[d] = true;
+			progress = true;
+		}
+	}
+
+	if (ssptr->pending[d] > 0)
+	{
+		n = splice(ssptr->pipes[d][0], NULL, dst, NULL,
+				ssptr->pending[d], SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (n > 0)
+		{
+			ssptr->pending[d] -= (size_t) n;
+			ssptr->bytes[d] += n;
+			progress = true;
+		}
+		else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			/* The destination is gone; nothing more can be delivered. */
+			ssptr->eof[d] = true;
+			ssptr->pending[d] = 0;
+			progress = true;
+		}
+	}
+
+	if (ssptr->eof[d] && ssptr->pending[d] == 0 && ! ssptr->shut[d])
+	{
+		shutdown(dst, SHUT_WR);
+		ssptr->shut[d] = true;
+		progress = true;
+	}
+
+	return progress;
+}
+
+/**************************************************/
+/* StepSocketSplices: Periodic task for the socket */
+/*   router that advances every active splice      */
+/*   until no more data can be moved without       */
+/*   blocking, or until maxBytes have been         */
+/*   delivered in either direction so that a busy  */
+/*   splice can't keep the engine from running.    */
+/**************************************************/
+void StepSocketSplices(
+		Environment *theEnv,
+		void *context)
+{
+	struct socketSplice *ssptr;
+	bool progress;
+	long long start[2];
+
+	for (ssptr = SocketRouterData(theEnv)->ListOfSocketSplices; ssptr != NULL; ssptr = ssptr->next)
+	{
+		start[0] = ssptr->bytes[0];
+		start[1] = ssptr->bytes[1];
+		do
+		{
+			progress = StepSpliceDirection(ssptr, 0);
+			progress = StepSpliceDirection(ssptr, 1) || progress;
+		} while (progress && ! (ssptr->shut[0] && ssptr->shut[1]) &&
+		         (size_t) (ssptr->bytes[0] - start[0]) < ssptr->maxBytes &&
+		         (size_t) (ssptr->bytes[1] - start[1]) < ssptr->maxBytes);
+	}
+}
+
+/*******************************************************/
+/* SpliceStepFunction: H/L access function for         */
+/*   splice-step. Optionally waits up to ?milliseconds */
+/*   for any spliced connection to become readable,    */
+/*   then advances all splices. Returns the number of  */
+/*   splices that are not yet closed in both           */
+/*   directions.                                       */
+/*******************************************************/
+void SpliceStepFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketSplice *ssptr;
+	struct pollfd *fds;
+	UDFValue theArg;
+	int timeout = 0;
+	size_t nfds = 0, count = 0;
+	long long active = 0;
+	int d;
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,INTEGER_BIT,&theArg);
+		timeout = (int) theArg.integerValue->contents;
+	}
+
+	for (ssptr = SocketRouterData(theEnv)->ListOfSocketSplices; ssptr != NULL; ssptr = ssptr->next)
+	{ count += 2; }
+
+	if (timeout != 0 && count > 0)
+	{
+		fds = (struct pollfd *) gm2(theEnv,sizeof(struct pollfd) * count);
+		for (ssptr = SocketRouterData(theEnv)->ListOfSocketSplices; ssptr != NULL; ssptr = ssptr->next)
+		{
+			for (d = 0; d < 2; d++)
+			{
+				if (ssptr->eof[d]) continue;
+				fds[nfds].fd = ssptr->fds[d];
+				fds[nfds].events = POLLIN;
+				fds[nfds].revents = 0;
+				nfds++;
+			}
+		}
+		if (nfds > 0)
+		{ poll(fds, nfds, timeout); }
+		rm(theEnv,fds,sizeof(struct pollfd) * count);
+	}
+
+	StepSocketSplices(theEnv,NULL);
+
+	for (ssptr = SocketRouterData(theEnv)->ListOfSocketSplices; ssptr != NULL; ssptr = ssptr->next)
+	{
+		if (! (ssptr->shut[0] && ssptr->shut[1])) active++;
+	}
+
+	returnValue->integerValue = CreateInteger(theEnv, active);
+}
+
+/*****************************************************/
+/* SpliceStatusFunction: H/L access function for     */
+/*   splice-status. Returns a multifield of the      */
+/*   bytes moved from the first connection to the    */
+/*   second, the bytes moved back, and a state       */
+/*   symbol (SPLICING, HALF_CLOSED or CLOSED), or    */
+/*   FALSE if the connection is not spliced.         */
+/*****************************************************/
+void SpliceStatusFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketSplice *ssptr;
+	MultifieldBuilder *mb;
+	UDFValue theArg;
+	int sockfd;
+
+	if (-1 == (sockfd = GetFilenoFromArgument(theEnv,context,&theArg)))
+	{
+		WriteString(theEnv,STDERR,"splice-status: could not find router for socket file descriptor\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	for (ssptr = SocketRouterData(theEnv)->ListOfSocketSplices; ssptr != NULL; ssptr = ssptr->next)
+	{
+		if (ssptr->fds[0] == sockfd || ssptr->fds[1] == sockfd) break;
+	}
+
+	if (ssptr == NULL)
+	{
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	mb = CreateMultifieldBuilder(theEnv, 3L);
+	MBAppendInteger(mb, ssptr->bytes[0]);
+	MBAppendInteger(mb, ssptr->bytes[1]);
+	if (ssptr->shut[0] && ssptr->shut[1])
+	{ MBAppendSymbol(mb, "CLOSED"); }
+	else if (ssptr->shut[0] || ssptr->shut[1])
+	{ MBAppendSymbol(mb, "HALF_CLOSED"); }
+	else
+	{ MBAppendSymbol(mb, "SPLICING"); }
+
+	returnValue->multifieldValue = MBCreate(mb);
+	MBDispose(mb);
+}
+
+/*****************************************************/
+/* RemoveSocketSplices: Tears down any splice using  */
+/*   the given file descriptor, or every splice if   */
+/*   the descriptor is -1.                           */
+/*****************************************************/
+static void RemoveSocketSplices(
+		Environment *theEnv,
+		int sockfd)
+{
+	struct socketSplice *ssptr, *prev, *next;
+	int d;
+
+	for (ssptr = SocketRouterData(theEnv)->ListOfSocketSplices, prev = NULL;
+			ssptr != NULL;
+			ssptr = next)
+	{
+		next = ssptr->next;
+
+		if (sockfd != -1 && ssptr->fds[0] != sockfd && ssptr->fds[1] != sockfd)
+		{
+			prev = ssptr;
+			continue;
+		}
+
+		for (d = 0; d < 2; d++)
+		{
+			close(ssptr->pipes[d][0]);
+			close(ssptr->pipes[d][1]);
+		}
+
+		if (prev == NULL)
+		{ SocketRouterData(theEnv)->ListOfSocketSplices = next; }
+		else
+		{ prev->next = next; }
+		rtn_struct(theEnv,socketSplice,ssptr);
+	}
+}
+
+/*******************************************************/
+/* AppendSocketAddress: Appends the logical name form  */
+/*   of a socket address (ip:port, [ip6]:port or path) */
+/*   to a string builder. Returns false if the address */
+/*   family is not supported.                          */
+/*******************************************************/
+static bool AppendSocketAddress(
+		StringBuilder *theSB,
+		struct sockaddr_storage *theAddr)
+{
+	char ip[INET6_ADDRSTRLEN];
+
+	switch (theAddr->ss_family)
+	{
+		case AF_INET:
+		{
+			struct sockaddr_in *addr = (struct sockaddr_in *)theAddr;
+			inet_ntop(AF_INET, &(addr->sin_addr), ip, INET_ADDRSTRLEN);
+			SBAppend(theSB, ip);
+			SBAddChar(theSB, ':');
+			SBAppendInteger(theSB, ntohs(addr->sin_port));
+			return true;
+		}
+		case AF_INET6:
+		{
+			struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)theAddr;
+			inet_ntop(AF_INET6, &(addr6->sin6_addr), ip, INET6_ADDRSTRLEN);
+			SBAddChar(theSB, '[');
+			SBAppend(theSB, ip);
+			SBAddChar(theSB, ']');
+			SBAddChar(theSB, ':');
+			SBAppendInteger(theSB, ntohs(addr6->sin6_port));
+			return true;
+		}
+		case AF_UNIX:
+		{
+			struct sockaddr_un *addrun = (struct sockaddr_un *)theAddr;
+			SBAppend(theSB, addrun->sun_path);
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+/**********************************************************/
+/* CreateSocketRouterFromDescriptor: Registers a socket   */
+/*   file descriptor that was not created by this         */
+/*   environment (passed over a unix socket or inherited  */
+/*   from a parent process) as a socket router. The       */
+/*   domain and type are read back from the kernel and    */
+/*   the logical name is built from the peer address for  */
+/*   connections or the local address for listeners.     */
+/*   Returns NULL on failure.                             */
+/**********************************************************/
+struct socketRouter *CreateSocketRouterFromDescriptor(
+		Environment *theEnv,
+		int sockfd)
+{
+	struct socketRouter *newRouter;
+	struct sockaddr_storage addr;
+	socklen_t addr_len, opt_len;
+	StringBuilder *logicalNameStringBuilder;
+	int domain, type;
+	FILE *newstream;
+
+	opt_len = sizeof(domain);
+	if (0 > GenGetsockopt(theEnv, sockfd, SOL_SOCKET, SO_DOMAIN, &domain, &opt_len))
+	{
+		WriteString(theEnv,STDERR,"File descriptor ");
+		WriteInteger(theEnv,STDERR,sockfd);
+		WriteString(theEnv,STDERR," is not a socket\n");
+		return NULL;
+	}
+	opt_len = sizeof(type);
+	if (0 > GenGetsockopt(theEnv, sockfd, SOL_SOCKET, SO_TYPE, &type, &opt_len))
+	{
+		WriteString(theEnv,STDERR,"Could not get socket type of file descriptor ");
+		WriteInteger(theEnv,STDERR,sockfd);
+		WriteString(theEnv,STDERR,"\n");
+		return NULL;
+	}
+
+	/*=========================================*/
+	/* Connections are named after their peer, */
+	/* listeners after the address they are    */
+	/* bound to, matching accept and bind.     */
+	/*=========================================*/
+	memset(&addr, 0, sizeof(addr));
+	addr_len = sizeof(addr);
+	if (0 > getpeername(sockfd, (struct sockaddr *)&addr, &addr_len))
+	{
+		memset(&addr, 0, sizeof(addr));
+		addr_len = sizeof(addr);
+		if (0 > getsockname(sockfd, (struct sockaddr *)&addr, &addr_len))
+		{
+			WriteString(theEnv,STDERR,"Could not get address of file descriptor ");
+			WriteInteger(theEnv,STDERR,sockfd);
+			WriteString(theEnv,STDERR,"\n");
+			perror("perror");
+			return NULL;
+		}
+	}
+	addr.ss_family = (sa_family_t) domain;
+
+	logicalNameStringBuilder = CreateStringBuilder(theEnv, 0);
+	if (! AppendSocketAddress(logicalNameStringBuilder, &addr))
+	{
+		WriteString(theEnv,STDERR,"Socket domain '");
+		WriteInteger(theEnv,STDERR,domain);
+		WriteString(theEnv,STDERR,"' not supported.\n");
+		SBDispose(logicalNameStringBuilder);
+		return NULL;
+	}
+
+	if (NULL == (newstream = fdopen(sockfd, "r+")))
+	{
+		WriteString(theEnv,STDERR,"Could not fdopen sock file descriptor for ");
+		WriteString(theEnv,STDERR,logicalNameStringBuilder->contents);
+		WriteString(theEnv,STDERR,"\n");
+		perror("perror");
+		SBDispose(logicalNameStringBuilder);
+		return NULL;
+	}
+
+	newRouter = CreateArenaSocketRouter(theEnv,newstream,logicalNameStringBuilder->contents);
+	SBDispose(logicalNameStringBuilder);
+	newRouter->domain = domain;
+	newRouter->type = type;
+
+	return newRouter;
+}
+
+/*******************************************************/
+/* SendFdFunction: H/L access function for send-fd.    */
+/*   Passes a socket file descriptor to another        */
+/*   process over an AF_UNIX socket with SCM_RIGHTS,   */
+/*   along with an optional payload string. The local  */
+/*   connection stays open; close it with              */
+/*   close-connection once it has been handed off.     */
+/*   Returns TRUE on success, FALSE on failure.        */
+/*******************************************************/
+void SendFdFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *sptr;
+	UDFValue theArg;
+	int unixfd, passfd, domain;
+	socklen_t opt_len = sizeof(domain);
+	const char *payload = "";
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char dummy = '\0';
+	union
+	{
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+
+	if (-1 == (unixfd = GetFilenoFromArgument(theEnv,context,&theArg)))
+	{
+		WriteString(theEnv,STDERR,"send-fd: could not find router for unix socket\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	if (0 > GenGetsockopt(theEnv, unixfd, SOL_SOCKET, SO_DOMAIN, &domain, &opt_len) ||
+	    domain != AF_UNIX)
+	{
+		WriteString(theEnv,STDERR,"send-fd: first argument must be an AF_UNIX socket\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	if (NULL == (sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)))
+	{
+		if (theArg.header->type != INTEGER_TYPE)
+		{
+			WriteString(theEnv,STDERR,"send-fd: could not find router for socket to send\n");
+			returnValue->lexemeValue = FalseSymbol(theEnv);
+			return;
+		}
+		passfd = (int) theArg.integerValue->contents;
+	}
+	else
+	{
+		/*==========================================*/
+		/* The TLS session lives in this process    */
+		/* and cannot travel with the descriptor.   */
+		/*==========================================*/
+		if (sptr->tls != NULL)
+		{
+			WriteString(theEnv,STDERR,"send-fd: cannot send a TLS connection\n");
+			returnValue->lexemeValue = FalseSymbol(theEnv);
+			return;
+		}
+
+		/*==========================================*/
+		/* Pending output belongs to the connection */
+		/* and must not be left behind in our FILE. */
+		/*==========================================*/
+		GenFlush(theEnv,sptr->stream);
+		passfd = SocketRouterFileno(sptr);
+	}
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,LEXEME_BITS,&theArg);
+		payload = theArg.lexemeValue->contents;
+	}
+
+	/*====================================*/
+	/* At least one byte of data must be  */
+	/* sent for the ancillary data to go. */
+	/*====================================*/
+	if (payload[0] == '\0')
+	{
+		iov.iov_base = &dummy;
+		iov.iov_len = 1;
+	}
+	else
+	{
+		iov.iov_base = (void *) payload;
+		iov.iov_len = strlen(payload);
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &passfd, sizeof(int));
+
+	if (0 > sendmsg(unixfd, &msg, MSG_NOSIGNAL))
+	{
+		WriteString(theEnv,STDERR,"send-fd: sendmsg failed\n");
+		perror("perror");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*******************************************************/
+/* RecvFdFunction: H/L access function for recv-fd.    */
+/*   Receives a socket file descriptor sent with       */
+/*   send-fd over an AF_UNIX socket and registers it   */
+/*   as a new socket router. Returns a multifield of   */
+/*   the new file descriptor, its logical name and the */
+/*   payload string, or FALSE on failure.              */
+/*******************************************************/
+void RecvFdFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *newRouter;
+	UDFValue theArg;
+	int unixfd, passfd = -1;
+	ssize_t nread;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char buf[4096 + 1];
+	MultifieldBuilder *mb;
+	union
+	{
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+
+	if (-1 == (unixfd = GetFilenoFromArgument(theEnv,context,&theArg)))
+	{
+		WriteString(theEnv,STDERR,"recv-fd: could not find router for unix socket\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf) - 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	if (0 >= (nread = recvmsg(unixfd, &msg, MSG_CMSG_CLOEXEC)))
+	{
+		if (nread < 0)
+		{
+			WriteString(theEnv,STDERR,"recv-fd: recvmsg failed\n");
+			perror("perror");
+		}
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+	buf[nread] = '\0';
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		{
+			memcpy(&passfd, CMSG_DATA(cmsg), sizeof(int));
+			break;
+		}
+	}
+
+	if (passfd < 0)
+	{
+		WriteString(theEnv,STDERR,"recv-fd: message did not carry a file descriptor\n");
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	if (NULL == (newRouter = CreateSocketRouterFromDescriptor(theEnv, passfd)))
+	{
+		close(passfd);
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	mb = CreateMultifieldBuilder(theEnv, 3L);
+	MBAppendInteger(mb, passfd);
+	MBAppendSymbol(mb, newRouter->logicalName);
+	/* A lone NUL byte is the placeholder for an empty payload. */
+	MBAppendString(mb, (nread == 1 && buf[0] == '\0') ? "" : buf);
+	returnValue->multifieldValue = MBCreate(mb);
+	MBDispose(mb);
+}
+
+/*******************************************************/
+/* InheritedSocketsFunction: H/L access function for   */
+/*   inherited-sockets. Implements the receiving side  */
+/*   of systemd-style socket activation: if LISTEN_PID */
+/*   names this process, the LISTEN_FDS descriptors    */
+/*   starting at fd 3 are registered as socket routers */
+/*   named after the address they are bound to.       */
+/*   Returns a multifield of the file descriptors.     */
+/*******************************************************/
+void InheritedSocketsFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	MultifieldBuilder *mb;
+	const char *pidString, *fdsString;
+	char *end;
+	long pid, nfds, i;
+	int sockfd;
+
+	mb = CreateMultifieldBuilder(theEnv, 0);
+
+	pidString = getenv("LISTEN_PID");
+	fdsString = getenv("LISTEN_FDS");
+	if (pidString == NULL || fdsString == NULL)
+	{
+		returnValue->multifieldValue = MBCreate(mb);
+		MBDispose(mb);
+		return;
+	}
+
+	pid = strtol(pidString, &end, 10);
+	if (*end != '\0' || pid != (long) getpid())
+	{
+		returnValue->multifieldValue = MBCreate(mb);
+		MBDispose(mb);
+		return;
+	}
+
+	nfds = strtol(fdsString, &end, 10);
+	if (*end != '\0' || nfds < 0)
+	{
+		WriteString(theEnv,STDERR,"inherited-sockets: invalid LISTEN_FDS '");
+		WriteString(theEnv,STDERR,fdsString);
+		WriteString(theEnv,STDERR,"'\n");
+		returnValue->multifieldValue = MBCreate(mb);
+		MBDispose(mb);
+		return;
+	}
+
+	/*=============================================*/
+	/* The descriptors are only meant for us, not  */
+	/* for any process we might start after this.  */
+	/*=============================================*/
+	unsetenv("LISTEN_PID");
+	unsetenv("LISTEN_FDS");
+	unsetenv("LISTEN_FDNAMES");
+
+	for (i = 0; i < nfds; i++)
+	{
+		sockfd = LISTEN_FDS_START + (int) i;
+		GenFcntl(theEnv, sockfd, F_SETFD, FD_CLOEXEC);
+
+		if (FileDescriptorToSocketRouter(theEnv, sockfd) == NULL &&
+		    CreateSocketRouterFromDescriptor(theEnv, sockfd) == NULL)
+		{ continue; }
+
+		MBAppendInteger(mb, sockfd);
+	}
+
+	returnValue->multifieldValue = MBCreate(mb);
+	MBDispose(mb);
+}
+
+/*******************************************************/
+/* ExecWithSocketsFunction: H/L access function for    */
+/*   exec-with-sockets. Replaces the running process   */
+/*   with ?argv while handing every listening socket   */
+/*   to it using the LISTEN_FDS/LISTEN_PID protocol,   */
+/*   so a restarted server can pick them up with       */
+/*   inherited-sockets without refusing connections.   */
+/*   Other sockets are closed by the exec. Only        */
+/*   returns (FALSE) if the exec fails, after putting  */
+/*   back every descriptor it renumbered.              */
+/*******************************************************/
+void ExecWithSocketsFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *sptr;
+	UDFValue theArg;
+	Multifield *theArgv;
+	char **argv;
+	int *fds, *saved, *savedFlags, *routerFlags;
+	size_t i, argc, nfds = 0, nsaved = 0, nrouters = 0, count = 0;
+	int listening, sockfd;
+	bool ok = true;
+	socklen_t opt_len;
+	char buf[32];
+
+	UDFNextArgument(context,MULTIFIELD_BIT|LEXEME_BITS,&theArg);
+	if (theArg.header->type == MULTIFIELD_TYPE)
+	{
+		theArgv = theArg.multifieldValue;
+		argc = theArg.range;
+		if (argc == 0)
+		{
+			WriteString(theEnv,STDERR,"exec-with-sockets: ?argv must not be empty\n");
+			returnValue->lexemeValue = FalseSymbol(theEnv);
+			return;
+		}
+	}
+	else
+	{
+		theArgv = NULL;
+		argc = 1;
+	}
+
+	argv = (char **) gm2(theEnv,sizeof(char *) * (argc + 1));
+	for (i = 0; i < argc; i++)
+	{
+		if (theArgv == NULL)
+		{ argv[i] = (char *) theArg.lexemeValue->contents; }
+		else if (theArgv->contents[theArg.begin + i].header->type == STRING_TYPE ||
+		         theArgv->contents[theArg.begin + i].header->type == SYMBOL_TYPE)
+		{ argv[i] = (char *) theArgv->contents[theArg.begin + i].lexemeValue->contents; }
+		else
+		{
+			WriteString(theEnv,STDERR,"exec-with-sockets: ?argv must only contain strings and symbols\n");
+			rm(theEnv,argv,sizeof(char *) * (argc + 1));
+			returnValue->lexemeValue = FalseSymbol(theEnv);
+			return;
+		}
+	}
+	argv[argc] = NULL;
+
+	for (sptr = SocketRouterData(theEnv)->ListOfSocketRouters; sptr != NULL; sptr = sptr->next)
+	{ count++; }
+	fds = (int *) gm2(theEnv,sizeof(int) * (count + 1));
+	saved = (int *) gm2(theEnv,sizeof(int) * (count + 1));
+	savedFlags = (int *) gm2(theEnv,sizeof(int) * (count + 1));
+	routerFlags = (int *) gm2(theEnv,sizeof(int) * (count + 1));
+
+	/*==============================================*/
+	/* Move every listener out of the way first so  */
+	/* that renumbering them from fd 3 upward never */
+	/* clobbers one that has not been moved yet.    */
+	/* The original close-on-exec state of every    */
+	/* socket is kept in case the exec fails.       */
+	/*==============================================*/
+	for (sptr = SocketRouterData(theEnv)->ListOfSocketRouters; sptr != NULL && ok; sptr = sptr->next)
+	{
+		sockfd = SocketRouterFileno(sptr);
+		GenFlush(theEnv,sptr->stream);
+		routerFlags[nrouters++] = GenFcntl(theEnv, sockfd, F_GETFD, 0);
+
+		listening = 0;
+		opt_len = sizeof(listening);
+		if (0 > GenGetsockopt(theEnv, sockfd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &opt_len) || ! listening)
+		{
+			GenFcntl(theEnv, sockfd, F_SETFD, FD_CLOEXEC);
+			continue;
+		}
+
+		if (0 > (fds[nfds] = GenFcntl(theEnv, sockfd, F_DUPFD_CLOEXEC, LISTEN_FDS_START + (int) count)))
+		{ ok = false; }
+		else
+		{ nfds++; }
+		GenFcntl(theEnv, sockfd, F_SETFD, FD_CLOEXEC);
+	}
+
+	/*==============================================*/
+	/* Whatever currently occupies the target fds   */
+	/* is saved above the temporaries so it can be  */
+	/* put back if the exec fails.                  */
+	/*==============================================*/
+	for (i = 0; i < nfds && ok; i++)
+	{
+		savedFlags[i] = GenFcntl(theEnv, LISTEN_FDS_START + (int) i, F_GETFD, 0);
+		saved[i] = -1;
+		if (savedFlags[i] >= 0 &&
+		    0 > (saved[i] = GenFcntl(theEnv, LISTEN_FDS_START + (int) i, F_DUPFD_CLOEXEC, LISTEN_FDS_START + (int) count)))
+		{ ok = false; }
+		else
+		{ nsaved++; }
+	}
+
+	for (i = 0; i < nfds && ok; i++)
+	{
+		if (0 > dup2(fds[i], LISTEN_FDS_START + (int) i))
+		{ ok = false; }
+		else
+		{ GenFcntl(theEnv, LISTEN_FDS_START + (int) i, F_SETFD, 0); }
+	}
+
+	if (ok)
+	{
+		snprintf(buf, sizeof(buf), "%zu", nfds);
+		setenv("LISTEN_FDS", buf, 1);
+		snprintf(buf, sizeof(buf), "%ld", (long) getpid());
+		setenv("LISTEN_PID", buf, 1);
+
+		fflush(stdout);
+		fflush(stderr);
+		execvp(argv[0], argv);
+
+		WriteString(theEnv,STDERR,"exec-with-sockets: could not exec '");
+		WriteString(theEnv,STDERR,argv[0]);
+		WriteString(theEnv,STDERR,"'\n");
+		perror("perror");
+		unsetenv("LISTEN_FDS");
+		unsetenv("LISTEN_PID");
+	}
+	else
+	{
+		WriteString(theEnv,STDERR,"exec-with-sockets: could not renumber listening sockets\n");
+		perror("perror");
+	}
+
+	/*==============================================*/
+	/* Put back the descriptors the renumbering     */
+	/* replaced, drop the temporaries and restore   */
+	/* the close-on-exec state of every socket.     */
+	/*==============================================*/
+	for (i = 0; i < nsaved; i++)
+	{
+		if (saved[i] < 0)
+		{
+			close(LISTEN_FDS_START + (int) i);
+			continue;
+		}
+		dup2(saved[i], LISTEN_FDS_START + (int) i);
+		GenFcntl(theEnv, LISTEN_FDS_START + (int) i, F_SETFD, savedFlags[i]);
+		close(saved[i]);
+	}
+
+	for (i = 0; i < nfds; i++)
+	{ close(fds[i]); }
+
+	i = 0;
+	for (sptr = SocketRouterData(theEnv)->ListOfSocketRouters; sptr != NULL && i < nrouters; sptr = sptr->next, i++)
+	{
+		if (routerFlags[i] >= 0)
+		{ GenFcntl(theEnv, SocketRouterFileno(sptr), F_SETFD, routerFlags[i]); }
+	}
+
+	rm(theEnv,routerFlags,sizeof(int) * (count + 1));
+	rm(theEnv,savedFlags,sizeof(int) * (count + 1));
+	rm(theEnv,saved,sizeof(int) * (count + 1));
+	rm(theEnv,fds,sizeof(int) * (count + 1));
+	rm(theEnv,argv,sizeof(char *) * (argc + 1));
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+}
+
+/*******************************************************/
+/* ArenaStatisticsFunction: H/L access function for    */
+/*   arena-statistics. With no arguments returns a     */
+/*   multifield of the number of live connection       */
+/*   arenas, the bytes they reserve and the peak size  */
+/*   reached by any arena. Given a connection, returns */
+/*   the bytes used and reserved by its arena, or      */
+/*   FALSE if it does not own one.                     */
+/*******************************************************/
+void ArenaStatisticsFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *sptr;
+	MultifieldBuilder *mb;
+	UDFValue theArg;
+
+	if (! UDFHasNextArgument(context))
+	{
+		mb = CreateMultifieldBuilder(theEnv, 3L);
+		MBAppendInteger(mb, MemoryData(theEnv)->ArenaCount);
+		MBAppendInteger(mb, MemoryData(theEnv)->ArenaMemoryAmount);
+		MBAppendInteger(mb, (long long) MemoryData(theEnv)->ArenaPeakSize);
+		returnValue->multifieldValue = MBCreate(mb);
+		MBDispose(mb);
+		return;
+	}
+
+	if (NULL == (sptr = GetSocketRouterFromArgument(theEnv, context, &theArg)) ||
+	    sptr->arena == NULL)
+	{
+		returnValue->lexemeValue = FalseSymbol(theEnv);
+		return;
+	}
+
+	mb = CreateMultifieldBuilder(theEnv, 2L);
+	MBAppendInteger(mb, (long long) sptr->arena->size);
+	MBAppendInteger(mb, (long long) sptr->arena->reserved);
+	returnValue->multifieldValue = MBCreate(mb);
+	MBDispose(mb);
+}
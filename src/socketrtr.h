@@ -8,6 +8,15 @@
 
 #define SOCKET_ROUTER_DATA USER_ENVIRONMENT_DATA + 1
 
+#define LISTEN_FDS_START 3
+
+#define SOCKET_ARENA_SIZE (BUFSIZ + 1024)
+
+#define SOCKET_MAX_PENDING_LENGTH (32UL * 1024UL * 1024UL)
+
+struct socketCompression;
+struct socketTls;
+
 struct socketRouter
   {
    const char *logicalName;
@@ -15,11 +24,62 @@ struct socketRouter
    struct socketRouter *next;
    int domain;
    int type;
+   struct memoryArena *arena;
+   char *pending;
+   size_t pendingLength;
+   size_t pendingSize;
+   long long jsonArrayCount;
+   long long respCommandCount;
+   bool websocket;
+   bool websocketClosed;
+   int websocketOpcode;
+   char *websocketMessage;
+   size_t websocketMessageLength;
+   size_t websocketMessageSize;
+   long long websocketMessageCount;
+   struct socketCompression *compression;
+   struct socketTls *tls;
+  };
+
+enum socketOptionType
+  {
+   SOCKOPT_INT,
+   SOCKOPT_BOOL,
+   SOCKOPT_TIMEVAL,
+   SOCKOPT_LINGER,
+   SOCKOPT_STRING
+  };
+
+struct socketOptionLevel
+  {
+   const char *name;
+   int level;
+  };
+
+struct socketOption
+  {
+   const char *name;
+   int level;
+   int optname;
+   enum socketOptionType type;
+  };
+
+struct socketSplice
+  {
+   int fds[2];
+   int pipes[2][2];
+   size_t pending[2];
+   long long bytes[2];
+   bool eof[2];
+   bool shut[2];
+   size_t maxBytes;
+   struct socketSplice *next;
   };
 
 struct socketRouterData
   {
    struct socketRouter *ListOfSocketRouters;
+   struct socketSplice *ListOfSocketSplices;
   };
 
 struct connectionRouter
@@ -32,6 +92,7 @@ struct connectionRouter
 
    void                           InitializeSocketRouter(Environment *);
    FILE                          *FindSptr(Environment *,const char *);
+   struct socketRouter            *GetSocketRouterFromArgument(Environment *,UDFContext *,UDFValue *);
    void                           CreateSocketFunction(Environment *,UDFContext *,UDFValue *);
    void                           BindSocketFunction(Environment *,UDFContext *,UDFValue *);
    void                           ListenFunction(Environment *,UDFContext *,UDFValue *);
@@ -55,10 +116,25 @@ struct connectionRouter
    void                           ResolveDomainNameFunction(Environment *, UDFContext *, UDFValue *);
    struct socketRouter            *LogicalNameToSocketRouter(Environment *,const char *);
    struct socketRouter            *FileDescriptorToSocketRouter(Environment *,int);
+   int                            SocketRouterFileno(struct socketRouter *);
+   struct socketRouter            *CreateSocketRouterFromDescriptor(Environment *,int);
+   bool                           ReadSocketAvailable(Environment *,struct socketRouter *,bool *);
+   void                           ConsumeSocketPending(Environment *,struct socketRouter *,size_t);
+   bool                           WriteSocketBytes(Environment *,struct socketRouter *,const void *,size_t);
+   int                            GenFcntl(Environment *,int,int,int);
+   void                           ArenaStatisticsFunction(Environment *, UDFContext *, UDFValue *);
 
    bool                           FindSocket(Environment *,const char *,void *);
    void                           CloseAllSockets(Environment *);
    void                           RecvfromFunction(Environment *, UDFContext *, UDFValue *);
    void                           SendtoFunction(Environment *, UDFContext *, UDFValue *);
+   void                           SendFdFunction(Environment *, UDFContext *, UDFValue *);
+   void                           RecvFdFunction(Environment *, UDFContext *, UDFValue *);
+   void                           InheritedSocketsFunction(Environment *, UDFContext *, UDFValue *);
+   void                           ExecWithSocketsFunction(Environment *, UDFContext *, UDFValue *);
+   void                           SpliceConnectionsFunction(Environment *, UDFContext *, UDFValue *);
+   void                           SpliceStatusFunction(Environment *, UDFContext *, UDFValue *);
+   void                           SpliceStepFunction(Environment *, UDFContext *, UDFValue *);
+   void                           StepSocketSplices(Environment *, void *);
 
 #endif /* _H_socketrtr */
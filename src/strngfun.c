@@ -83,6 +83,14 @@
 /*                                                           */
 /*      6.42: Added str-byte-length function.                */
 /*                                                           */
+/*      ?.??: Added regex-match, regex-captures, and         */
+/*            regex-replace functions with a cache of        */
+/*            compiled patterns.                             */
+/*                                                           */
+/*            Added codes-to-string, string-to-codes,        */
+/*            string-to-bytes, and bytes-to-string           */
+/*            functions.                                     */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -124,6 +132,11 @@
 /***************************************/
 
    static void                    StrOrSymCatFunction(UDFContext *,UDFValue *,unsigned short);
+   static size_t                  UTF8SequenceLength(const unsigned char *,long long *);
+#if REGEX_FUNCTIONS
+   static void                    DeallocateStringFunctionData(Environment *);
+   static regex_t                *GetCompiledRegex(Environment *,CLIPSLexeme *,const char *);
+#endif
 
 /******************************************/
 /* StringFunctionDefinitions: Initializes */
@@ -132,6 +145,10 @@
 void StringFunctionDefinitions(
   Environment *theEnv)
   {
+#if REGEX_FUNCTIONS
+   AllocateEnvironmentData(theEnv,STRING_FUNCTION_DATA,sizeof(struct stringFunctionData),DeallocateStringFunctionData);
+#endif
+
 #if ! RUN_TIME
    AddUDF(theEnv,"str-cat","sy",1,UNBOUNDED,"synld" ,StrCatFunction,"StrCatFunction",NULL);
    AddUDF(theEnv,"sym-cat","sy",1,UNBOUNDED,"synld" ,SymCatFunction,"SymCatFunction",NULL);
@@ -146,6 +163,15 @@ void StringFunctionDefinitions(
    AddUDF(theEnv,"build","b",1,1,"sy",BuildFunction,"BuildFunction",NULL);
    AddUDF(theEnv,"string-to-field","*",1,1,"syn",StringToFieldFunction,"StringToFieldFunction",NULL);
    AddUDF(theEnv,"str-replace","syn",3,3,"syn",StrReplaceFunction,"StrReplaceFunction",NULL);
+   AddUDF(theEnv,"codes-to-string","s",0,UNBOUNDED,"lm",CodesToStringFunction,"CodesToStringFunction",NULL);
+   AddUDF(theEnv,"string-to-codes","m",1,1,"syn",StringToCodesFunction,"StringToCodesFunction",NULL);
+   AddUDF(theEnv,"string-to-bytes","m",1,1,"syn",StringToBytesFunction,"StringToBytesFunction",NULL);
+   AddUDF(theEnv,"bytes-to-string","s",0,UNBOUNDED,"lm",BytesToStringFunction,"BytesToStringFunction",NULL);
+#if REGEX_FUNCTIONS
+   AddUDF(theEnv,"regex-match","b",2,2,"syn;sy",RegexMatchFunction,"RegexMatchFunction",NULL);
+   AddUDF(theEnv,"regex-captures","bm",2,2,"syn;sy",RegexCapturesFunction,"RegexCapturesFunction",NULL);
+   AddUDF(theEnv,"regex-replace","syn",3,3,"syn;sy",RegexReplaceFunction,"RegexReplaceFunction",NULL);
+#endif
 #else
 #if MAC_XCD
 #pragma unused(theEnv)
@@ -862,6 +888,721 @@ void StrReplaceFunction(
    rm(theEnv,returnString,returnLength);
   }
 
+/**************************************************************/
+/* CodesToStringFunction: H/L access routine for the          */
+/*   codes-to-string function. Each argument is an integer or */
+/*   a multifield of integers giving a Unicode code point.    */
+/*   The codes are checked and their UTF-8 length totalled in */
+/*   one pass, so the string is built in a single buffer.     */
+/**************************************************************/
+void CodesToStringFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   UDFValue *theArgs;
+   CLIPSValue *contents, single;
+   unsigned int numArgs, i;
+   size_t j, first, count, length = 1;
+   long long code;
+   char *theString, *target;
+
+   returnValue->lexemeValue = CreateString(theEnv,"");
+
+   numArgs = UDFArgumentCount(context);
+   if (numArgs == 0)
+     { return; }
+
+   theArgs = (UDFValue *) gm2(theEnv,sizeof(UDFValue) * numArgs);
+
+   /*=============================================*/
+   /* Evaluate the arguments, check each code and */
+   /* determine the length of the UTF-8 string.   */
+   /*=============================================*/
+
+   for (i = 0; i < numArgs; i++)
+     {
+      if (! UDFNextArgument(context,INTEGER_BIT | MULTIFIELD_BIT,&theArgs[i]))
+        {
+         rm(theEnv,theArgs,sizeof(UDFValue) * numArgs);
+         return;
+        }
+
+      if (theArgs[i].header->type == INTEGER_TYPE)
+        {
+         single.value = theArgs[i].value;
+         contents = &single;
+         first = 0;
+         count = 1;
+        }
+      else
+        {
+         contents = theArgs[i].multifieldValue->contents;
+         first = theArgs[i].begin;
+         count = theArgs[i].range;
+        }
+
+      for (j = first; j < first + count; j++)
+        {
+         if (contents[j].header->type != INTEGER_TYPE)
+           { code = 0; }
+         else
+           { code = contents[j].integerValue->contents; }
+
+         if (code < 1)
+           { length = 0; }
+         else if (code < 0x80)
+           { length += 1; }
+         else if (code < 0x800)
+           { length += 2; }
+         else if ((code >= 0xD800) && (code <= 0xDFFF))
+           { length = 0; }
+         else if (code < 0x10000)
+           { length += 3; }
+         else if (code <= 0x10FFFF)
+           { length += 4; }
+         else
+           { length = 0; }
+
+         if (length == 0)
+           {
+            ExpectedTypeError1(theEnv,"codes-to-string",i + 1,
+                               "integer or multifield of Unicode code points");
+            SetEvaluationError(theEnv,true);
+            rm(theEnv,theArgs,sizeof(UDFValue) * numArgs);
+            return;
+           }
+        }
+     }
+
+   /*=============================*/
+   /* Encode the codes as UTF-8.  */
+   /*=============================*/
+
+   theString = (char *) gm2(theEnv,length);
+   target = theString;
+
+   for (i = 0; i < numArgs; i++)
+     {
+      if (theArgs[i].header->type == INTEGER_TYPE)
+        {
+         single.value = theArgs[i].value;
+         contents = &single;
+         first = 0;
+         count = 1;
+        }
+      else
+        {
+         contents = theArgs[i].multifieldValue->contents;
+         first = theArgs[i].begin;
+         count = theArgs[i].range;
+        }
+
+      for (j = first; j < first + count; j++)
+        {
+         code = contents[j].integerValue->contents;
+
+         if (code < 0x80)
+           { *target++ = (char) code; }
+         else if (code < 0x800)
+           {
+            *target++ = (char) (0xC0 | (code >> 6));
+            *target++ = (char) (0x80 | (code & 0x3F));
+           }
+         else if (code < 0x10000)
+           {
+            *target++ = (char) (0xE0 | (code >> 12));
+            *target++ = (char) (0x80 | ((code >> 6) & 0x3F));
+            *target++ = (char) (0x80 | (code & 0x3F));
+           }
+         else
+           {
+            *target++ = (char) (0xF0 | (code >> 18));
+            *target++ = (char) (0x80 | ((code >> 12) & 0x3F));
+            *target++ = (char) (0x80 | ((code >> 6) & 0x3F));
+            *target++ = (char) (0x80 | (code & 0x3F));
+           }
+        }
+     }
+
+   *target = EOS;
+
+   returnValue->lexemeValue = CreateString(theEnv,theString);
+
+   rm(theEnv,theString,length);
+   rm(theEnv,theArgs,sizeof(UDFValue) * numArgs);
+  }
+
+/*************************************************************/
+/* StringToCodesFunction: H/L access routine for the         */
+/*   string-to-codes function. Returns the Unicode code      */
+/*   points of a string as a multifield of integers. A byte  */
+/*   that isn't part of a well formed UTF-8 sequence is      */
+/*   returned as its own value.                              */
+/*************************************************************/
+void StringToCodesFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   UDFValue theArg;
+   const unsigned char *theString;
+   Multifield *theMultifield;
+   size_t length, count, i, size, n;
+   long long code;
+
+   if (! UDFFirstArgument(context,LEXEME_BITS | INSTANCE_NAME_BIT,&theArg))
+     { return; }
+
+   theString = (const unsigned char *) theArg.lexemeValue->contents;
+   length = strlen((const char *) theString);
+
+   /*===============================================*/
+   /* A string with no byte above 0x7F has one code */
+   /* per byte, so it's checked eight bytes at a    */
+   /* time before falling back to decoding UTF-8.   */
+   /*===============================================*/
+
+   count = length;
+   for (i = 0; i + 8 <= length; i += 8)
+     {
+      unsigned long long word;
+
+      memcpy(&word,theString + i,8);
+      if (word & 0x8080808080808080ULL)
+        { break; }
+     }
+
+   while ((i < length) && (theString[i] < 0x80))
+     { i++; }
+
+   if (i < length)
+     {
+      count = i;
+      while (i < length)
+        {
+         i += UTF8SequenceLength(theString + i,&code);
+         count++;
+        }
+     }
+
+   /*=====================================*/
+   /* Fill in the multifield in one pass. */
+   /*=====================================*/
+
+   theMultifield = CreateMultifield(theEnv,count);
+
+   for (i = 0, n = 0; n < count; n++)
+     {
+      if (theString[i] < 0x80)
+        {
+         code = theString[i];
+         size = 1;
+        }
+      else
+        { size = UTF8SequenceLength(theString + i,&code); }
+
+      theMultifield->contents[n].integerValue = CreateInteger(theEnv,code);
+      i += size;
+     }
+
+   returnValue->begin = 0;
+   returnValue->range = count;
+   returnValue->multifieldValue = theMultifield;
+  }
+
+/**********************************************************/
+/* StringToBytesFunction: H/L access routine for the      */
+/*   string-to-bytes function. Returns the bytes of a     */
+/*   string (its UTF-8 encoding) as a multifield of       */
+/*   integers from 0 to 255.                              */
+/**********************************************************/
+void StringToBytesFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   UDFValue theArg;
+   const unsigned char *theString;
+   Multifield *theMultifield;
+   size_t length, i;
+
+   if (! UDFFirstArgument(context,LEXEME_BITS | INSTANCE_NAME_BIT,&theArg))
+     { return; }
+
+   theString = (const unsigned char *) theArg.lexemeValue->contents;
+   length = strlen((const char *) theString);
+
+   theMultifield = CreateMultifield(theEnv,length);
+
+   for (i = 0; i < length; i++)
+     { theMultifield->contents[i].integerValue = CreateInteger(theEnv,theString[i]); }
+
+   returnValue->begin = 0;
+   returnValue->range = length;
+   returnValue->multifieldValue = theMultifield;
+  }
+
+/************************************************************/
+/* BytesToStringFunction: H/L access routine for the        */
+/*   bytes-to-string function, the inverse of               */
+/*   string-to-bytes. Each argument is an integer or a      */
+/*   multifield of integers from 1 to 255 that is copied    */
+/*   into the string as a single byte, so bytes read off a  */
+/*   connection are not UTF-8 encoded a second time.        */
+/************************************************************/
+void BytesToStringFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   UDFValue *theArgs;
+   CLIPSValue *contents, single;
+   unsigned int numArgs, i;
+   size_t j, first, count, length = 1;
+   long long byte;
+   char *theString, *target;
+
+   returnValue->lexemeValue = CreateString(theEnv,"");
+
+   numArgs = UDFArgumentCount(context);
+   if (numArgs == 0)
+     { return; }
+
+   theArgs = (UDFValue *) gm2(theEnv,sizeof(UDFValue) * numArgs);
+
+   /*=============================================*/
+   /* Evaluate the arguments, check each byte and */
+   /* determine the length of the string.         */
+   /*=============================================*/
+
+   for (i = 0; i < numArgs; i++)
+     {
+      if (! UDFNextArgument(context,INTEGER_BIT | MULTIFIELD_BIT,&theArgs[i]))
+        {
+         rm(theEnv,theArgs,sizeof(UDFValue) * numArgs);
+         return;
+        }
+
+      if (theArgs[i].header->type == INTEGER_TYPE)
+        {
+         single.value = theArgs[i].value;
+         contents = &single;
+         first = 0;
+         count = 1;
+        }
+      else
+        {
+         contents = theArgs[i].multifieldValue->contents;
+         first = theArgs[i].begin;
+         count = theArgs[i].range;
+        }
+
+      for (j = first; j < first + count; j++)
+        {
+         if ((contents[j].header->type != INTEGER_TYPE) ||
+             (contents[j].integerValue->contents < 1) ||
+             (contents[j].integerValue->contents > 255))
+           {
+            ExpectedTypeError1(theEnv,"bytes-to-string",i + 1,
+                               "integer or multifield of integers from 1 to 255");
+            SetEvaluationError(theEnv,true);
+            rm(theEnv,theArgs,sizeof(UDFValue) * numArgs);
+            return;
+           }
+        }
+
+      length += count;
+     }
+
+   /*=========================*/
+   /* Copy the bytes across.  */
+   /*=========================*/
+
+   theString = (char *) gm2(theEnv,length);
+   target = theString;
+
+   for (i = 0; i < numArgs; i++)
+     {
+      if (theArgs[i].header->type == INTEGER_TYPE)
+        {
+         single.value = theArgs[i].value;
+         contents = &single;
+         first = 0;
+         count = 1;
+        }
+      else
+        {
+         contents = theArgs[i].multifieldValue->contents;
+         first = theArgs[i].begin;
+         count = theArgs[i].range;
+        }
+
+      for (j = first; j < first + count; j++)
+        {
+         byte = contents[j].integerValue->contents;
+         *target++ = (char) byte;
+        }
+     }
+
+   *target = EOS;
+
+   returnValue->lexemeValue = CreateString(theEnv,theString);
+
+   rm(theEnv,theString,length);
+   rm(theEnv,theArgs,sizeof(UDFValue) * numArgs);
+  }
+
+/************************************************************/
+/* UTF8SequenceLength: Decodes the UTF-8 sequence at the    */
+/*   start of a string, returning its length in bytes and   */
+/*   storing its code point. Overlong forms, surrogates and */
+/*   truncated sequences are treated as a single byte whose */
+/*   code is the value of the byte.                         */
+/************************************************************/
+static size_t UTF8SequenceLength(
+  const unsigned char *theString,
+  long long *code)
+  {
+   unsigned char lead = theString[0];
+   unsigned char low = 0x80, high = 0xBF;
+   size_t size, i;
+   long long value;
+
+   if ((lead >= 0xC2) && (lead <= 0xDF))
+     {
+      size = 2;
+      value = lead & 0x1F;
+     }
+   else if ((lead >= 0xE0) && (lead <= 0xEF))
+     {
+      size = 3;
+      value = lead & 0x0F;
+      if (lead == 0xE0) low = 0xA0;
+      else if (lead == 0xED) high = 0x9F;
+     }
+   else if ((lead >= 0xF0) && (lead <= 0xF4))
+     {
+      size = 4;
+      value = lead & 0x07;
+      if (lead == 0xF0) low = 0x90;
+      else if (lead == 0xF4) high = 0x8F;
+     }
+   else
+     {
+      *code = lead;
+      return 1;
+     }
+
+   for (i = 1; i < size; i++)
+     {
+      if ((theString[i] < low) || (theString[i] > high))
+        {
+         *code = lead;
+         return 1;
+        }
+
+      value = (value << 6) | (theString[i] & 0x3F);
+      low = 0x80;
+      high = 0xBF;
+     }
+
+   *code = value;
+   return size;
+  }
+
+#if REGEX_FUNCTIONS
+
+/*********************************************************/
+/* DeallocateStringFunctionData: Deallocates environment */
+/*    data for the string functions.                     */
+/*********************************************************/
+static void DeallocateStringFunctionData(
+  Environment *theEnv)
+  {
+   unsigned int i;
+
+   for (i = 0; i < REGEX_CACHE_SIZE; i++)
+     {
+      if (StringFunctionData(theEnv)->RegexCache[i].pattern != NULL)
+        { regfree(&StringFunctionData(theEnv)->RegexCache[i].compiled); }
+     }
+  }
+
+/******************************************************/
+/* GetCompiledRegex: Returns the compiled form of a   */
+/*   pattern from the regex cache, compiling it if    */
+/*   necessary. The cache is keyed by the pattern's   */
+/*   lexeme, so a constant pattern in a rule's LHS is */
+/*   found with a pointer comparison. When the cache  */
+/*   is full, the least recently used entry is        */
+/*   replaced.                                        */
+/******************************************************/
+static regex_t *GetCompiledRegex(
+  Environment *theEnv,
+  CLIPSLexeme *pattern,
+  const char *functionName)
+  {
+   struct regexCacheEntry *cache = StringFunctionData(theEnv)->RegexCache;
+   struct regexCacheEntry *victim;
+   unsigned int i;
+   int rv;
+   char errorBuffer[256];
+
+   /*================================*/
+   /* Look for the compiled pattern. */
+   /*================================*/
+
+   for (i = 0; i < REGEX_CACHE_SIZE; i++)
+     {
+      if (cache[i].pattern == pattern)
+        {
+         cache[i].lastUsed = ++StringFunctionData(theEnv)->RegexUseCount;
+         return &cache[i].compiled;
+        }
+     }
+
+   /*=================================================*/
+   /* Pick an empty entry, or else the least recently */
+   /* used one, and release the pattern it holds.     */
+   /*=================================================*/
+
+   victim = &cache[0];
+   for (i = 1; (i < REGEX_CACHE_SIZE) && (victim->pattern != NULL); i++)
+     {
+      if ((cache[i].pattern == NULL) || (cache[i].lastUsed < victim->lastUsed))
+        { victim = &cache[i]; }
+     }
+
+   if (victim->pattern != NULL)
+     {
+      regfree(&victim->compiled);
+      ReleaseLexeme(theEnv,victim->pattern);
+      victim->pattern = NULL;
+     }
+
+   /*======================*/
+   /* Compile the pattern. */
+   /*======================*/
+
+   rv = regcomp(&victim->compiled,pattern->contents,REG_EXTENDED);
+   if (rv != 0)
+     {
+      regerror(rv,&victim->compiled,errorBuffer,sizeof(errorBuffer));
+      PrintErrorID(theEnv,"STRNGFUN",3,false);
+      WriteString(theEnv,STDERR,"Function '");
+      WriteString(theEnv,STDERR,functionName);
+      WriteString(theEnv,STDERR,"' could not compile the pattern ");
+      WriteString(theEnv,STDERR,pattern->contents);
+      WriteString(theEnv,STDERR,": ");
+      WriteString(theEnv,STDERR,errorBuffer);
+      WriteString(theEnv,STDERR,".\n");
+      SetEvaluationError(theEnv,true);
+      return NULL;
+     }
+
+   IncrementLexemeCount(pattern);
+   victim->pattern = pattern;
+   victim->lastUsed = ++StringFunctionData(theEnv)->RegexUseCount;
+
+   return &victim->compiled;
+  }
+
+/*******************************************/
+/* RegexMatchFunction: H/L access routine  */
+/*   for the regex-match function.         */
+/*******************************************/
+void RegexMatchFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   UDFValue thePattern, theString;
+   regex_t *compiled;
+
+   if (! UDFFirstArgument(context,LEXEME_BITS,&thePattern))
+     { return; }
+
+   if (! UDFNextArgument(context,LEXEME_BITS | INSTANCE_NAME_BIT,&theString))
+     { return; }
+
+   if ((compiled = GetCompiledRegex(theEnv,thePattern.lexemeValue,"regex-match")) == NULL)
+     {
+      returnValue->lexemeValue = FalseSymbol(theEnv);
+      return;
+     }
+
+   returnValue->lexemeValue = CreateBoolean(theEnv,(regexec(compiled,theString.lexemeValue->contents,0,NULL,0) == 0));
+  }
+
+/**********************************************/
+/* RegexCapturesFunction: H/L access routine  */
+/*   for the regex-captures function. Returns */
+/*   the whole match followed by each group,  */
+/*   with nil for groups that did not take    */
+/*   part in the match, or FALSE if the       */
+/*   pattern does not match.                  */
+/**********************************************/
+void RegexCapturesFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   UDFValue thePattern, theString;
+   regex_t *compiled;
+   regmatch_t *matches;
+   size_t matchCount, i;
+   const char *contents;
+   MultifieldBuilder *theMB;
+   StringBuilder *theSB;
+
+   returnValue->lexemeValue = FalseSymbol(theEnv);
+
+   if (! UDFFirstArgument(context,LEXEME_BITS,&thePattern))
+     { return; }
+
+   if (! UDFNextArgument(context,LEXEME_BITS | INSTANCE_NAME_BIT,&theString))
+     { return; }
+
+   if ((compiled = GetCompiledRegex(theEnv,thePattern.lexemeValue,"regex-captures")) == NULL)
+     { return; }
+
+   contents = theString.lexemeValue->contents;
+   matchCount = compiled->re_nsub + 1;
+   matches = (regmatch_t *) gm2(theEnv,sizeof(regmatch_t) * matchCount);
+
+   if (regexec(compiled,contents,matchCount,matches,0) == 0)
+     {
+      theMB = CreateMultifieldBuilder(theEnv,matchCount);
+      theSB = CreateStringBuilder(theEnv,0);
+
+      for (i = 0; i < matchCount; i++)
+        {
+         if (matches[i].rm_so < 0)
+           {
+            MBAppendSymbol(theMB,"nil");
+            continue;
+           }
+
+         SBReset(theSB);
+         SBAppendLength(theSB,contents + matches[i].rm_so,(size_t) (matches[i].rm_eo - matches[i].rm_so));
+         MBAppendString(theMB,theSB->contents);
+        }
+
+      returnValue->multifieldValue = MBCreate(theMB);
+      SBDispose(theSB);
+      MBDispose(theMB);
+     }
+
+   rm(theEnv,matches,sizeof(regmatch_t) * matchCount);
+  }
+
+/*********************************************/
+/* RegexReplaceFunction: H/L access routine  */
+/*   for the regex-replace function. Replaces */
+/*   every match of the pattern. In the       */
+/*   replacement, \0 stands for the whole     */
+/*   match, \1 through \9 for the groups, and */
+/*   \\ for a backslash.                      */
+/*********************************************/
+void RegexReplaceFunction(
+  Environment *theEnv,
+  UDFContext *context,
+  UDFValue *returnValue)
+  {
+   UDFValue thePattern, theString, theReplacement;
+   regex_t *compiled;
+   regmatch_t *matches;
+   size_t matchCount, group;
+   const char *contents, *traverse, *replacement;
+   StringBuilder *theSB;
+   int flags = 0;
+
+   if (! UDFFirstArgument(context,LEXEME_BITS,&thePattern))
+     { return; }
+
+   if (! UDFNextArgument(context,LEXEME_BITS | INSTANCE_NAME_BIT,&theString))
+     { return; }
+
+   if (! UDFNextArgument(context,LEXEME_BITS | INSTANCE_NAME_BIT,&theReplacement))
+     { return; }
+
+   if ((compiled = GetCompiledRegex(theEnv,thePattern.lexemeValue,"regex-replace")) == NULL)
+     {
+      returnValue->lexemeValue = FalseSymbol(theEnv);
+      return;
+     }
+
+   contents = theString.lexemeValue->contents;
+   replacement = theReplacement.lexemeValue->contents;
+   matchCount = compiled->re_nsub + 1;
+   matches = (regmatch_t *) gm2(theEnv,sizeof(regmatch_t) * matchCount);
+   theSB = CreateStringBuilder(theEnv,strlen(contents) + 1);
+
+   traverse = contents;
+   while (regexec(compiled,traverse,matchCount,matches,flags) == 0)
+     {
+      /*==========================================*/
+      /* Copy the portion before the match, then  */
+      /* the replacement with its groups filled.  */
+      /*==========================================*/
+
+      SBAppendLength(theSB,traverse,(size_t) matches[0].rm_so);
+
+      for (contents = replacement; *contents != EOS; contents++)
+        {
+         if ((*contents == '\\') && isdigit((unsigned char) contents[1]))
+           {
+            contents++;
+            group = (size_t) (*contents - '0');
+            if ((group < matchCount) && (matches[group].rm_so >= 0))
+              { SBAppendLength(theSB,traverse + matches[group].rm_so,(size_t) (matches[group].rm_eo - matches[group].rm_so)); }
+           }
+         else if ((*contents == '\\') && (contents[1] == '\\'))
+           {
+            contents++;
+            SBAddChar(theSB,'\\');
+           }
+         else
+           { SBAddChar(theSB,*contents); }
+        }
+
+      /*=============================================*/
+      /* An empty match copies the next character so */
+      /* the search moves forward.                   */
+      /*=============================================*/
+
+      if (matches[0].rm_eo == matches[0].rm_so)
+        {
+         if (traverse[matches[0].rm_eo] == EOS)
+           {
+            traverse += matches[0].rm_eo;
+            break;
+           }
+         SBAddChar(theSB,traverse[matches[0].rm_eo]);
+         traverse += matches[0].rm_eo + 1;
+        }
+      else
+        { traverse += matches[0].rm_eo; }
+
+      flags = REG_NOTBOL;
+     }
+
+   SBAppend(theSB,traverse);
+
+   if (theString.header->type == STRING_TYPE)
+     { returnValue->value = CreateString(theEnv,theSB->contents); }
+   else if (theString.header->type == SYMBOL_TYPE)
+     { returnValue->value = CreateSymbol(theEnv,theSB->contents); }
+   else
+     { returnValue->value = CreateInstanceName(theEnv,theSB->contents); }
+
+   SBDispose(theSB);
+   rm(theEnv,matches,sizeof(regmatch_t) * matchCount);
+  }
+
+#endif /* REGEX_FUNCTIONS */
+
 /**************************************/
 /* EvalFunction: H/L access routine   */
 /*   for the eval function.           */
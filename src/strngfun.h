@@ -53,6 +53,14 @@
 /*                                                           */
 /*      6.42: Added str-byte-length function.                */
 /*                                                           */
+/*      ?.??: Added regex-match, regex-captures, and         */
+/*            regex-replace functions with a cache of        */
+/*            compiled patterns.                             */
+/*                                                           */
+/*            Added codes-to-string, string-to-codes,        */
+/*            string-to-bytes, and bytes-to-string           */
+/*            functions.                                     */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_strngfun
@@ -63,6 +71,29 @@
 
 #include "entities.h"
 
+#if REGEX_FUNCTIONS
+#include <regex.h>
+
+#define STRING_FUNCTION_DATA 67
+
+#define REGEX_CACHE_SIZE 32
+
+struct regexCacheEntry
+  {
+   CLIPSLexeme *pattern;
+   regex_t compiled;
+   unsigned long long lastUsed;
+  };
+
+struct stringFunctionData
+  {
+   struct regexCacheEntry RegexCache[REGEX_CACHE_SIZE];
+   unsigned long long RegexUseCount;
+  };
+
+#define StringFunctionData(theEnv) ((struct stringFunctionData *) GetEnvironmentData(theEnv,STRING_FUNCTION_DATA))
+#endif
+
 typedef enum
   {
    EE_NO_ERROR = 0,
@@ -95,5 +126,14 @@ typedef enum
    void                           StringToFieldFunction(Environment *,UDFContext *,UDFValue *);
    void                           StringToField(Environment *,const char *,UDFValue *);
    void                           StrReplaceFunction(Environment *,UDFContext *,UDFValue *);
+   void                           CodesToStringFunction(Environment *,UDFContext *,UDFValue *);
+   void                           StringToCodesFunction(Environment *,UDFContext *,UDFValue *);
+   void                           StringToBytesFunction(Environment *,UDFContext *,UDFValue *);
+   void                           BytesToStringFunction(Environment *,UDFContext *,UDFValue *);
+#if REGEX_FUNCTIONS
+   void                           RegexMatchFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RegexCapturesFunction(Environment *,UDFContext *,UDFValue *);
+   void                           RegexReplaceFunction(Environment *,UDFContext *,UDFValue *);
+#endif
 
 #endif /* _H_strngfun */
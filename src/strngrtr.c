@@ -69,6 +69,9 @@
    static StringBuilderRouter    *FindStringBuilderRouter(Environment *,const char *);
    static bool                    QueryStringBuilderCallback(Environment *,const char *,void *);
    static void                    WriteStringBuilderCallback(Environment *,const char *,const char *,void *);
+   static size_t                  ReadBlockStringCallback(Environment *,const char *,char *,size_t,const char *,void *);
+   static void                    WriteBlockStringCallback(Environment *,const char *,const char *,size_t,void *);
+   static void                    WriteBlockStringBuilderCallback(Environment *,const char *,const char *,size_t,void *);
 
 /**********************************************************/
 /* InitializeStringRouter: Initializes string I/O router. */
@@ -80,6 +83,8 @@ void InitializeStringRouter(
 
    AddRouter(theEnv,"string",0,QueryStringCallback,WriteStringCallback,ReadStringCallback,UnreadStringCallback,NULL,NULL);
    AddRouter(theEnv,"stringBuilder",0,QueryStringBuilderCallback,WriteStringBuilderCallback,NULL,NULL,NULL,NULL);
+   SetRouterBlockCallbacks(theEnv,"string",ReadBlockStringCallback,WriteBlockStringCallback);
+   SetRouterBlockCallbacks(theEnv,"stringBuilder",NULL,WriteBlockStringBuilderCallback);
   }
 
 /*******************************************/
@@ -197,6 +202,84 @@ static int ReadStringCallback(
    return(rc);
   }
 
+/***************************************************/
+/* ReadBlockStringCallback: Block read routine for */
+/*   string routers. Reaching the end of the       */
+/*   string moves past it just as reading EOF a    */
+/*   character at a time does, so that a following */
+/*   unread of EOF leaves the position unchanged.  */
+/***************************************************/
+static size_t ReadBlockStringCallback(
+  Environment *theEnv,
+  const char *logicalName,
+  char *buffer,
+  size_t size,
+  const char *delimiters,
+  void *context)
+  {
+   struct stringRouter *head;
+   size_t count = 0;
+   char theChar;
+
+   head = FindStringRouter(theEnv,logicalName);
+   if (head == NULL)
+     {
+      SystemError(theEnv,"ROUTER",1);
+      ExitRouter(theEnv,EXIT_FAILURE);
+      return 0;
+     }
+
+   if (head->readWriteType != READ_STRING) return 0;
+
+   while (count < size)
+     {
+      if (head->currentPosition >= head->maximumPosition)
+        {
+         head->currentPosition++;
+         break;
+        }
+
+      theChar = head->readString[head->currentPosition++];
+      buffer[count++] = theChar;
+
+      if (strchr(delimiters,theChar) != NULL)
+        { break; }
+     }
+
+   return count;
+  }
+
+/**********************************************/
+/* WriteBlockStringCallback: Block print      */
+/*   routine for string routers.              */
+/**********************************************/
+static void WriteBlockStringCallback(
+  Environment *theEnv,
+  const char *logicalName,
+  const char *str,
+  size_t length,
+  void *context)
+  {
+   struct stringRouter *head;
+
+   head = FindStringRouter(theEnv,logicalName);
+   if (head == NULL)
+     {
+      SystemError(theEnv,"ROUTER",3);
+      ExitRouter(theEnv,EXIT_FAILURE);
+      return;
+     }
+
+   if (head->readWriteType != WRITE_STRING) return;
+
+   if ((length + head->currentPosition + 1) > head->maximumPosition)
+     { return; }
+
+   memcpy(&head->writeString[head->currentPosition],str,length);
+   head->currentPosition += length;
+   head->writeString[head->currentPosition] = EOS;
+  }
+
 /************************************************************/
 /* UnreadStringCallback: Ungetc routine for string routers. */
 /************************************************************/
@@ -294,6 +377,7 @@ static bool CreateReadStringSource(
    newStringRouter->maximumPosition = maximumPosition;
    newStringRouter->next = StringRouterData(theEnv)->ListOfStringRouters;
    StringRouterData(theEnv)->ListOfStringRouters = newStringRouter;
+   RouterNameChanged(theEnv,name);
 
    return true;
   }
@@ -313,6 +397,7 @@ bool CloseStringSource(
      {
       if (strcmp(head->name,name) == 0)
         {
+         RouterNameChanged(theEnv,name);
          if (last == NULL)
            {
             StringRouterData(theEnv)->ListOfStringRouters = head->next;
@@ -360,6 +445,7 @@ bool OpenStringDestination(
    newStringRouter->maximumPosition = maximumPosition;
    newStringRouter->next = StringRouterData(theEnv)->ListOfStringRouters;
    StringRouterData(theEnv)->ListOfStringRouters = newStringRouter;
+   RouterNameChanged(theEnv,name);
 
    return true;
   }
@@ -415,6 +501,7 @@ bool OpenStringBuilderDestination(
    newStringRouter->SBR = theSB;
    newStringRouter->next = StringRouterData(theEnv)->ListOfStringBuilderRouters;
    StringRouterData(theEnv)->ListOfStringBuilderRouters = newStringRouter;
+   RouterNameChanged(theEnv,name);
 
    return true;
   }
@@ -435,6 +522,7 @@ bool CloseStringBuilderDestination(
      {
       if (strcmp(head->name,name) == 0)
         {
+         RouterNameChanged(theEnv,name);
          if (last == NULL)
            {
             StringRouterData(theEnv)->ListOfStringBuilderRouters = head->next;
@@ -523,4 +611,27 @@ static void WriteStringBuilderCallback(
    SBAppend(head->SBR,str);
   }
 
+/**************************************************/
+/* WriteBlockStringBuilderCallback: Block print   */
+/*   routine for stringBuilder routers.           */
+/**************************************************/
+static void WriteBlockStringBuilderCallback(
+  Environment *theEnv,
+  const char *logicalName,
+  const char *str,
+  size_t length,
+  void *context)
+  {
+   StringBuilderRouter *head;
+
+   head = FindStringBuilderRouter(theEnv,logicalName);
+   if (head == NULL)
+     {
+      SystemError(theEnv,"ROUTER",3);
+      ExitRouter(theEnv,EXIT_FAILURE);
+      return;
+     }
+
+   SBAppendLength(head->SBR,str,length);
+  }
 
@@ -131,8 +131,14 @@
 /*                                                           */
 /*            Removed gensnprintf and gensprintf functions.  */
 /*                                                           */
+/*      ?.??: Added GenMapFile and GenUnmapFile functions.   */
+/*                                                           */
 /*************************************************************/
 
+#if LINUX
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "setup.h"
 
 #include <stdio.h>
@@ -165,6 +171,8 @@
 
 #if   UNIX_V || LINUX || DARWIN
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <signal.h>
 #include <unistd.h>
 #endif
@@ -704,6 +712,112 @@ int GenSeek(
    return fseek(theFile,offset,whereFrom);
   }
 
+/**********************************************************/
+/* GenMapFile: Returns the contents of an open file as a  */
+/*   single buffer followed by a NUL character, or NULL   */
+/*   if the file is empty, is not a regular file, or the  */
+/*   system has no support for mapping files. Files whose */
+/*   length is not a multiple of the page size are memory */
+/*   mapped since the rest of the last page is zero       */
+/*   filled. Other files are read into a buffer one byte  */
+/*   longer than the file. The position of the file is    */
+/*   not changed.                                         */
+/**********************************************************/
+char *GenMapFile(
+  Environment *theEnv,
+  FILE *theFile,
+  size_t *length)
+  {
+#if UNIX_V || LINUX || DARWIN
+   struct stat fileInfo;
+   long pageSize, position;
+   char *buffer;
+   size_t size, count;
+   int fd;
+
+   fd = fileno(theFile);
+   if ((fstat(fd,&fileInfo) != 0) ||
+       (! S_ISREG(fileInfo.st_mode)) ||
+       (fileInfo.st_size <= 0))
+     { return NULL; }
+
+   size = (size_t) fileInfo.st_size;
+   pageSize = sysconf(_SC_PAGESIZE);
+
+   /*==============================================*/
+   /* Map the file if the end of the file does not */
+   /* fall on a page boundary.                     */
+   /*==============================================*/
+
+   if ((pageSize > 0) && ((size % (size_t) pageSize) != 0))
+     {
+      buffer = (char *) mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+      if (buffer == MAP_FAILED)
+        { return NULL; }
+
+      posix_madvise(buffer,size,POSIX_MADV_SEQUENTIAL);
+
+      *length = size;
+      return buffer;
+     }
+
+   /*===================================*/
+   /* Otherwise read the whole file and */
+   /* restore the original position.    */
+   /*===================================*/
+
+   if ((position = ftell(theFile)) < 0)
+     { return NULL; }
+
+   buffer = (char *) genalloc(theEnv,size + 1);
+
+   rewind(theFile);
+   count = fread(buffer,1,size,theFile);
+   fseek(theFile,position,SEEK_SET);
+
+   if (count != size)
+     {
+      genfree(theEnv,buffer,size + 1);
+      return NULL;
+     }
+
+   buffer[size] = '\0';
+
+   *length = size;
+   return buffer;
+#else
+#if MAC_XCD
+#pragma unused(theEnv,theFile,length)
+#endif
+   return NULL;
+#endif
+  }
+
+/******************************************************/
+/* GenUnmapFile: Releases a buffer returned by        */
+/*   GenMapFile. The length must be the one returned. */
+/******************************************************/
+void GenUnmapFile(
+  Environment *theEnv,
+  char *buffer,
+  size_t length)
+  {
+#if UNIX_V || LINUX || DARWIN
+   long pageSize;
+
+   pageSize = sysconf(_SC_PAGESIZE);
+
+   if ((pageSize > 0) && ((length % (size_t) pageSize) != 0))
+     { munmap(buffer,length); }
+   else
+     { genfree(theEnv,buffer,length + 1); }
+#else
+#if MAC_XCD
+#pragma unused(theEnv,buffer,length)
+#endif
+#endif
+  }
+
 /************************************************************/
 /* GenOpenReadBinary: Generic and machine specific code for */
 /*   opening a file for binary access. Only one file may be */
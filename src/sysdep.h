@@ -108,6 +108,8 @@
 /*                                                           */
 /*      7.00: Removed gensnprintf and gensprintf functions.  */
 /*                                                           */
+/*      ?.??: Added GenMapFile and GenUnmapFile functions.   */
+/*                                                           */
 /*************************************************************/
 
 #ifndef _H_sysdep
@@ -135,6 +137,8 @@
    void                        GenRewind(Environment *,FILE *);
    long long                   GenTell(Environment *,FILE *);
    int                         GenSeek(Environment *,FILE *,long,int);
+   char                       *GenMapFile(Environment *,FILE *,size_t *);
+   void                        GenUnmapFile(Environment *,char *,size_t);
    void                        genexit(Environment *,int);
    int                         genrand(void);
    void                        genseed(unsigned int);
@@ -0,0 +1,891 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*                 TLS FUNCTIONS MODULE                */
+/*******************************************************/
+
+/*************************************************************/
+/* Purpose: OpenSSL backed TLS on socket connections. After  */
+/*   the handshake the connection's stream is replaced by a  */
+/*   stream whose reads and writes go through SSL_read and   */
+/*   SSL_write, so printout, readline, send-file and the     */
+/*   protocol functions keep working unchanged. Kernel TLS   */
+/*   is requested for every connection; where the kernel     */
+/*   takes over the record layer, OpenSSL hands data         */
+/*   straight to the socket and send-file uses SSL_sendfile. */
+/*   Server contexts are shared per certificate so session   */
+/*   tickets and the session cache work across connections,  */
+/*   and client sessions are kept per peer for resumption.   */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <netdb.h>
+
+#include "setup.h"
+
+#include "envrnmnt.h"
+#include "extnfunc.h"
+#include "memalloc.h"
+#include "multifld.h"
+#include "router.h"
+#include "symbol.h"
+#include "sysdep.h"
+
+#include "socketrtr.h"
+#include "tlsfun.h"
+
+#ifndef NO_OPENSSL
+#include <openssl/err.h>
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+static void                    DeallocateTlsData(Environment *);
+static void                    WriteTlsError(Environment *,const char *,const char *);
+static struct tlsServerContext *GetServerContext(Environment *,CLIPSLexeme *,CLIPSLexeme *,const char *);
+static struct tlsClientContext *GetClientContext(Environment *,CLIPSLexeme *,const char *);
+static int                     NewClientSession(SSL *,SSL_SESSION *);
+static void                    StoreClientSession(Environment *,struct tlsClientContext *,const char *,SSL_SESSION *);
+static struct tlsSession      *FindClientSession(struct tlsClientContext *,CLIPSLexeme *);
+static CLIPSLexeme            *CreatePeerName(Environment *,int,const char *);
+static bool                    WaitForTls(SSL *,int);
+static bool                    StartTls(Environment *,struct socketRouter *,SSL *,bool,
+                                        struct tlsClientContext *,const char *,const char *);
+static ssize_t                 ReadTlsStream(void *,char *,size_t);
+static ssize_t                 WriteTlsStream(void *,const char *,size_t);
+static int                     CloseTlsStream(void *);
+#endif
+
+/*****************************************************/
+/* TlsFunctionDefinitions: Allocates the TLS context */
+/*   lists and registers the TLS functions.          */
+/*****************************************************/
+void TlsFunctionDefinitions(
+		Environment *theEnv)
+{
+#ifndef NO_OPENSSL
+	AllocateEnvironmentData(
+			theEnv,
+			TLS_DATA,
+			sizeof(struct tlsData),
+			DeallocateTlsData);
+#endif
+
+	AddUDF(theEnv,"tls-wrap","b",3,3,";lsy;sy;sy",TlsWrapFunction,"TlsWrapFunction",NULL);
+	AddUDF(theEnv,"tls-connect","b",1,3,";lsy;sy;sy",TlsConnectFunction,"TlsConnectFunction",NULL);
+	AddUDF(theEnv,"tls-info","bm",1,1,"lsy",TlsInfoFunction,"TlsInfoFunction",NULL);
+}
+
+#ifndef NO_OPENSSL
+
+/*************************************************/
+/* DeallocateTlsData: Frees the server contexts, */
+/*   client contexts and cached client sessions. */
+/*   Connections still open hold their own       */
+/*   references to their context.                */
+/*************************************************/
+static void DeallocateTlsData(
+		Environment *theEnv)
+{
+	struct tlsServerContext *theServer, *nextServer;
+	struct tlsClientContext *theClient, *nextClient;
+	struct tlsSession *theSession, *nextSession;
+
+	for (theServer = TlsData(theEnv)->ListOfServerContexts;
+	     theServer != NULL;
+	     theServer = nextServer)
+	{
+		nextServer = theServer->next;
+		SSL_CTX_free(theServer->ctx);
+		rtn_struct(theEnv,tlsServerContext,theServer);
+	}
+
+	for (theClient = TlsData(theEnv)->ListOfClientContexts;
+	     theClient != NULL;
+	     theClient = nextClient)
+	{
+		nextClient = theClient->next;
+		for (theSession = theClient->sessions; theSession != NULL; theSession = nextSession)
+		{
+			nextSession = theSession->next;
+			SSL_SESSION_free(theSession->session);
+			rtn_struct(theEnv,tlsSession,theSession);
+		}
+		SSL_CTX_free(theClient->ctx);
+		rtn_struct(theEnv,tlsClientContext,theClient);
+	}
+}
+
+/***************************************************/
+/* WriteTlsError: Writes an error message followed */
+/*   by the most recent OpenSSL error, if any.     */
+/***************************************************/
+static void WriteTlsError(
+		Environment *theEnv,
+		const char *functionName,
+		const char *message)
+{
+	char buffer[256];
+	unsigned long theError;
+
+	WriteString(theEnv,STDERR,functionName);
+	WriteString(theEnv,STDERR,": ");
+	WriteString(theEnv,STDERR,message);
+
+	if ((theError = ERR_peek_last_error()) != 0)
+	{
+		ERR_error_string_n(theError,buffer,sizeof(buffer));
+		WriteString(theEnv,STDERR," (");
+		WriteString(theEnv,STDERR,buffer);
+		WriteString(theEnv,STDERR,")");
+	}
+
+	WriteString(theEnv,STDERR,"\n");
+	ERR_clear_error();
+}
+
+/*******************************************************/
+/* GetServerContext: Returns the server context for a  */
+/*   certificate and key, loading them the first time. */
+/*   Reusing one context per certificate is what lets  */
+/*   later connections resume sessions.                */
+/*******************************************************/
+static struct tlsServerContext *GetServerContext(
+		Environment *theEnv,
+		CLIPSLexeme *certFile,
+		CLIPSLexeme *keyFile,
+		const char *functionName)
+{
+	struct tlsServerContext *theServer;
+	SSL_CTX *ctx;
+
+	for (theServer = TlsData(theEnv)->ListOfServerContexts;
+	     theServer != NULL;
+	     theServer = theServer->next)
+	{
+		if ((theServer->certFile == certFile) && (theServer->keyFile == keyFile))
+		{ return theServer; }
+	}
+
+	if ((ctx = SSL_CTX_new(TLS_server_method())) == NULL)
+	{
+		WriteTlsError(theEnv,functionName,"could not create TLS context");
+		return NULL;
+	}
+
+	SSL_CTX_set_min_proto_version(ctx,TLS1_2_VERSION);
+	SSL_CTX_set_options(ctx,SSL_OP_ENABLE_KTLS | SSL_OP_IGNORE_UNEXPECTED_EOF);
+	SSL_CTX_set_mode(ctx,SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+	SSL_CTX_set_session_cache_mode(ctx,SSL_SESS_CACHE_SERVER);
+	SSL_CTX_sess_set_cache_size(ctx,TLS_SERVER_CACHE_SIZE);
+	SSL_CTX_set_session_id_context(ctx,(const unsigned char *) TLS_SESSION_ID_CONTEXT,
+	                               sizeof(TLS_SESSION_ID_CONTEXT) - 1);
+
+	if (SSL_CTX_use_certificate_chain_file(ctx,certFile->contents) != 1)
+	{
+		WriteTlsError(theEnv,functionName,"could not load certificate");
+		SSL_CTX_free(ctx);
+		return NULL;
+	}
+
+	if ((SSL_CTX_use_PrivateKey_file(ctx,keyFile->contents,SSL_FILETYPE_PEM) != 1) ||
+	    (SSL_CTX_check_private_key(ctx) != 1))
+	{
+		WriteTlsError(theEnv,functionName,"could not load private key");
+		SSL_CTX_free(ctx);
+		return NULL;
+	}
+
+	theServer = get_struct(theEnv,tlsServerContext);
+	theServer->certFile = certFile;
+	theServer->keyFile = keyFile;
+	IncrementLexemeCount(certFile);
+	IncrementLexemeCount(keyFile);
+	theServer->ctx = ctx;
+	theServer->next = TlsData(theEnv)->ListOfServerContexts;
+	TlsData(theEnv)->ListOfServerContexts = theServer;
+
+	return theServer;
+}
+
+/********************************************************/
+/* GetClientContext: Returns the client context for a   */
+/*   CA file, creating it the first time. NULL uses the */
+/*   system's trusted certificates and none skips       */
+/*   verification.                                      */
+/********************************************************/
+static struct tlsClientContext *GetClientContext(
+		Environment *theEnv,
+		CLIPSLexeme *caFile,
+		const char *functionName)
+{
+	struct tlsClientContext *theClient;
+	SSL_CTX *ctx;
+	int rv;
+
+	for (theClient = TlsData(theEnv)->ListOfClientContexts;
+	     theClient != NULL;
+	     theClient = theClient->next)
+	{
+		if (theClient->caFile == caFile)
+		{ return theClient; }
+	}
+
+	if ((ctx = SSL_CTX_new(TLS_client_method())) == NULL)
+	{
+		WriteTlsError(theEnv,functionName,"could not create TLS context");
+		return NULL;
+	}
+
+	SSL_CTX_set_min_proto_version(ctx,TLS1_2_VERSION);
+	SSL_CTX_set_options(ctx,SSL_OP_ENABLE_KTLS | SSL_OP_IGNORE_UNEXPECTED_EOF);
+	SSL_CTX_set_mode(ctx,SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+	SSL_CTX_set_session_cache_mode(ctx,SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx,NewClientSession);
+	SSL_CTX_set_app_data(ctx,theEnv);
+
+	if (caFile == NULL)
+	{
+		rv = SSL_CTX_set_default_verify_paths(ctx);
+		SSL_CTX_set_verify(ctx,SSL_VERIFY_PEER,NULL);
+	}
+	else if (strcmp(caFile->contents,TLS_NO_VERIFY) == 0)
+	{
+		rv = 1;
+		SSL_CTX_set_verify(ctx,SSL_VERIFY_NONE,NULL);
+	}
+	else
+	{
+		rv = SSL_CTX_load_verify_locations(ctx,caFile->contents,NULL);
+		SSL_CTX_set_verify(ctx,SSL_VERIFY_PEER,NULL);
+	}
+
+	if (rv != 1)
+	{
+		WriteTlsError(theEnv,functionName,"could not load trusted certificates");
+		SSL_CTX_free(ctx);
+		return NULL;
+	}
+
+	theClient = get_struct(theEnv,tlsClientContext);
+	theClient->caFile = caFile;
+	if (caFile != NULL) IncrementLexemeCount(caFile);
+	theClient->ctx = ctx;
+	theClient->sessions = NULL;
+	theClient->sessionCount = 0;
+	theClient->next = TlsData(theEnv)->ListOfClientContexts;
+	TlsData(theEnv)->ListOfClientContexts = theClient;
+
+	return theClient;
+}
+
+/*****************************************************/
+/* NewClientSession: OpenSSL callback for a session  */
+/*   a server has handed to a client. With TLS 1.3   */
+/*   the tickets arrive after the handshake, which   */
+/*   is why they are collected here rather than when */
+/*   tls-connect returns.                            */
+/*****************************************************/
+static int NewClientSession(
+		SSL *ssl,
+		SSL_SESSION *session)
+{
+	struct socketTls *theTls;
+	Environment *theEnv;
+
+	theTls = (struct socketTls *) SSL_get_app_data(ssl);
+	theEnv = (Environment *) SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+
+	if ((theTls == NULL) || (theTls->client == NULL) ||
+	    (! SSL_SESSION_is_resumable(session)))
+	{ return 0; }
+
+	StoreClientSession(theEnv,theTls->client,theTls->peer,session);
+
+	return 1;
+}
+
+/********************************************************/
+/* StoreClientSession: Keeps the newest session for a   */
+/*   peer at the front of the cache, dropping the       */
+/*   least recently stored peer when the cache is full. */
+/*   Takes over the caller's reference to the session.  */
+/********************************************************/
+static void StoreClientSession(
+		Environment *theEnv,
+		struct tlsClientContext *theClient,
+		const char *peerName,
+		SSL_SESSION *session)
+{
+	struct tlsSession *theSession, *lastSession = NULL;
+	CLIPSLexeme *peer = CreateString(theEnv,peerName);
+
+	for (theSession = theClient->sessions;
+	     theSession != NULL;
+	     lastSession = theSession, theSession = theSession->next)
+	{
+		if (theSession->peer == peer) break;
+	}
+
+	if (theSession != NULL)
+	{
+		SSL_SESSION_free(theSession->session);
+		if (lastSession != NULL)
+		{
+			lastSession->next = theSession->next;
+			theSession->next = theClient->sessions;
+			theClient->sessions = theSession;
+		}
+		theSession->session = session;
+		return;
+	}
+
+	theSession = get_struct(theEnv,tlsSession);
+	theSession->peer = peer;
+	IncrementLexemeCount(peer);
+	theSession->session = session;
+	theSession->next = theClient->sessions;
+	theClient->sessions = theSession;
+
+	if (++theClient->sessionCount <= TLS_CLIENT_CACHE_SIZE) return;
+
+	for (lastSession = theClient->sessions;
+	     lastSession->next->next != NULL;
+	     lastSession = lastSession->next)
+	{ /* Do Nothing */ }
+
+	theSession = lastSession->next;
+	lastSession->next = NULL;
+	SSL_SESSION_free(theSession->session);
+	ReleaseLexeme(theEnv,theSession->peer);
+	rtn_struct(theEnv,tlsSession,theSession);
+	theClient->sessionCount--;
+}
+
+/**************************************************/
+/* FindClientSession: Returns the cached session  */
+/*   for a peer, or NULL if there is none.        */
+/**************************************************/
+static struct tlsSession *FindClientSession(
+		struct tlsClientContext *theClient,
+		CLIPSLexeme *peer)
+{
+	struct tlsSession *theSession;
+
+	for (theSession = theClient->sessions; theSession != NULL; theSession = theSession->next)
+	{
+		if (theSession->peer == peer) return theSession;
+	}
+
+	return NULL;
+}
+
+/******************************************************/
+/* CreatePeerName: Creates the key client sessions    */
+/*   are cached under, the server name (or address)   */
+/*   and port of the connection's peer.               */
+/******************************************************/
+static CLIPSLexeme *CreatePeerName(
+		Environment *theEnv,
+		int sockfd,
+		const char *serverName)
+{
+	struct sockaddr_storage address;
+	socklen_t addressLength = sizeof(address);
+	char host[NI_MAXHOST], service[NI_MAXSERV];
+	char name[NI_MAXHOST + NI_MAXSERV + 2];
+
+	strcpy(host,"local");
+	service[0] = EOS;
+
+	if (getpeername(sockfd,(struct sockaddr *) &address,&addressLength) == 0)
+	{
+		getnameinfo((struct sockaddr *) &address,addressLength,host,sizeof(host),
+		            service,sizeof(service),NI_NUMERICHOST | NI_NUMERICSERV);
+	}
+
+	snprintf(name,sizeof(name),"%s:%s",(serverName != NULL) ? serverName : host,service);
+
+	return CreateString(theEnv,name);
+}
+
+/**************************************************/
+/* WaitForTls: Waits until the socket is ready    */
+/*   for what OpenSSL asked for. Returns false if */
+/*   the error was anything else.                 */
+/**************************************************/
+static bool WaitForTls(
+		SSL *ssl,
+		int rv)
+{
+	struct pollfd fds;
+
+	fds.fd = SSL_get_fd(ssl);
+
+	switch (SSL_get_error(ssl,rv))
+	{
+		case SSL_ERROR_WANT_READ:
+			fds.events = POLLIN;
+			break;
+
+		case SSL_ERROR_WANT_WRITE:
+			fds.events = POLLOUT;
+			break;
+
+		default:
+			return false;
+	}
+
+	while ((poll(&fds,1,-1) < 0) && (errno == EINTR))
+	{ /* Do Nothing */ }
+
+	return true;
+}
+
+/******************************************************/
+/* StartTls: Runs the handshake on a connection and   */
+/*   replaces its stream with one that reads and      */
+/*   writes through the TLS session. Takes ownership  */
+/*   of the SSL object. The peer name is copied       */
+/*   rather than kept as a lexeme because the         */
+/*   connection may outlive the symbol table.         */
+/******************************************************/
+static bool StartTls(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		SSL *ssl,
+		bool server,
+		struct tlsClientContext *theClient,
+		const char *peer,
+		const char *functionName)
+{
+	static cookie_io_functions_t tlsStreamFunctions =
+		{ ReadTlsStream, WriteTlsStream, NULL, CloseTlsStream };
+	struct socketTls *theTls;
+	FILE *tlsStream;
+	int rv;
+
+	GenFlush(theEnv,sptr->stream);
+
+	theTls = get_struct(theEnv,socketTls);
+	theTls->ssl = ssl;
+	theTls->rawStream = sptr->stream;
+	theTls->client = theClient;
+	theTls->peer = NULL;
+	if (peer != NULL)
+	{
+		theTls->peer = (char *) gm2(theEnv,strlen(peer) + 1);
+		strcpy(theTls->peer,peer);
+	}
+	theTls->kernelSend = false;
+	theTls->kernelRecv = false;
+
+	SSL_set_app_data(ssl,theTls);
+	SSL_set_fd(ssl,fileno(sptr->stream));
+
+	do
+	{ rv = server ? SSL_accept(ssl) : SSL_connect(ssl); }
+	while ((rv != 1) && WaitForTls(ssl,rv));
+
+	if ((rv != 1) ||
+	    ((tlsStream = fopencookie(theTls,"r+",tlsStreamFunctions)) == NULL))
+	{
+		WriteTlsError(theEnv,functionName,"handshake failed");
+		SSL_free(ssl);
+		if (theTls->peer != NULL) rm(theEnv,theTls->peer,strlen(theTls->peer) + 1);
+		rtn_struct(theEnv,socketTls,theTls);
+		return false;
+	}
+
+	theTls->kernelSend = BIO_get_ktls_send(SSL_get_wbio(ssl));
+	theTls->kernelRecv = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+
+	if (__flbf(sptr->stream))
+	{ setvbuf(tlsStream,NULL,_IOLBF,BUFSIZ); }
+
+	sptr->tls = theTls;
+	sptr->stream = tlsStream;
+
+	return true;
+}
+
+/******************************************************/
+/* ReadTlsStream: Read function of a TLS connection's */
+/*   stream. A non-blocking socket with nothing to    */
+/*   read reports EAGAIN like a plain socket does.    */
+/******************************************************/
+static ssize_t ReadTlsStream(
+		void *cookie,
+		char *buffer,
+		size_t size)
+{
+	struct socketTls *theTls = (struct socketTls *) cookie;
+	size_t nread;
+
+	if (SSL_read_ex(theTls->ssl,buffer,size,&nread))
+	{ return (ssize_t) nread; }
+
+	switch (SSL_get_error(theTls->ssl,0))
+	{
+		case SSL_ERROR_ZERO_RETURN:
+			return 0;
+
+		case SSL_ERROR_WANT_READ:
+		case SSL_ERROR_WANT_WRITE:
+			errno = EAGAIN;
+			return -1;
+
+		default:
+			ERR_clear_error();
+			if (errno == 0) errno = EIO;
+			return -1;
+	}
+}
+
+/******************************************************/
+/* WriteTlsStream: Write function of a TLS            */
+/*   connection's stream. Waits out a full socket     */
+/*   buffer so that everything handed to it is sent.  */
+/******************************************************/
+static ssize_t WriteTlsStream(
+		void *cookie,
+		const char *buffer,
+		size_t size)
+{
+	struct socketTls *theTls = (struct socketTls *) cookie;
+	size_t written = 0, nwritten;
+
+	while (written < size)
+	{
+		if (SSL_write_ex(theTls->ssl,buffer + written,size - written,&nwritten))
+		{
+			written += nwritten;
+			continue;
+		}
+
+		if (! WaitForTls(theTls->ssl,0))
+		{
+			ERR_clear_error();
+			if (errno == 0) errno = EIO;
+			return (written > 0) ? (ssize_t) written : -1;
+		}
+	}
+
+	return (ssize_t) written;
+}
+
+/******************************************************/
+/* CloseTlsStream: Close function of a TLS            */
+/*   connection's stream. The session and the socket  */
+/*   are shut down by EndTls.                         */
+/******************************************************/
+static int CloseTlsStream(
+		void *cookie)
+{
+	return 0;
+}
+
+#endif
+
+/*****************************************************/
+/* EndTls: Sends close_notify if the peer can still  */
+/*   receive it, frees the TLS session and gives the */
+/*   connection back its plain stream so that it can */
+/*   be closed.                                      */
+/*****************************************************/
+void EndTls(
+		Environment *theEnv,
+		struct socketRouter *sptr)
+{
+#ifndef NO_OPENSSL
+	struct socketTls *theTls = sptr->tls;
+	struct pollfd fds;
+
+	if (theTls == NULL) return;
+
+	GenFlush(theEnv,sptr->stream);
+
+	/*=============================================*/
+	/* Writing to a peer that has reset the        */
+	/* connection would raise SIGPIPE, so the      */
+	/* close_notify is only sent to a healthy one. */
+	/*=============================================*/
+	fds.fd = SSL_get_fd(theTls->ssl);
+	fds.events = POLLOUT;
+	if ((poll(&fds,1,0) == 1) && ((fds.revents & (POLLERR | POLLHUP)) == 0))
+	{ SSL_shutdown(theTls->ssl); }
+	ERR_clear_error();
+
+	GenClose(theEnv,sptr->stream);
+	sptr->stream = theTls->rawStream;
+	sptr->tls = NULL;
+
+	SSL_free(theTls->ssl);
+	if (theTls->peer != NULL) rm(theEnv,theTls->peer,strlen(theTls->peer) + 1);
+	rtn_struct(theEnv,socketTls,theTls);
+#endif
+}
+
+/*****************************************************/
+/* TlsCanSendFile: Returns true if the kernel does   */
+/*   the encryption for a connection, so that a file */
+/*   can be sent without reading it into memory.     */
+/*****************************************************/
+bool TlsCanSendFile(
+		struct socketRouter *sptr)
+{
+#ifndef NO_OPENSSL
+	return (sptr->tls != NULL) && sptr->tls->kernelSend;
+#else
+	return false;
+#endif
+}
+
+/*****************************************************/
+/* TlsSendFile: Sends a whole file on a connection   */
+/*   whose encryption the kernel does. Returns the   */
+/*   number of bytes sent, or -1 on failure.         */
+/*****************************************************/
+long long TlsSendFile(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		int fileDescriptor)
+{
+#ifndef NO_OPENSSL
+	struct stat fileStat;
+	off_t offset = 0;
+	ossl_ssize_t nsent;
+
+	if (fstat(fileDescriptor,&fileStat) != 0) return -1;
+
+	GenFlush(theEnv,sptr->stream);
+
+	while (offset < fileStat.st_size)
+	{
+		nsent = SSL_sendfile(sptr->tls->ssl,fileDescriptor,offset,
+		                     (size_t) (fileStat.st_size - offset),0);
+		if (nsent > 0)
+		{ offset += nsent; }
+		else if (! WaitForTls(sptr->tls->ssl,(int) nsent))
+		{
+			ERR_clear_error();
+			return -1;
+		}
+	}
+
+	return (long long) offset;
+#else
+	return -1;
+#endif
+}
+
+/***********************************************************/
+/* TlsWrapFunction: H/L access routine for tls-wrap. Runs  */
+/*   the server side of a handshake on an accepted         */
+/*   connection. Returns TRUE once the connection is       */
+/*   encrypted, otherwise FALSE.                           */
+/*   (tls-wrap ?socket ?certFile ?keyFile)                 */
+/***********************************************************/
+void TlsWrapFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+#ifndef NO_OPENSSL
+	UDFValue theCert, theKey;
+	struct tlsServerContext *theServer;
+	SSL *ssl;
+#endif
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"tls-wrap: could not find connection\n");
+		return;
+	}
+
+#ifdef NO_OPENSSL
+	WriteString(theEnv,STDERR,"tls-wrap: built without OpenSSL\n");
+#else
+	UDFNextArgument(context,LEXEME_BITS,&theCert);
+	UDFNextArgument(context,LEXEME_BITS,&theKey);
+
+	if (sptr->tls != NULL)
+	{
+		WriteString(theEnv,STDERR,"tls-wrap: connection already uses TLS\n");
+		return;
+	}
+
+	if (sptr->compression != NULL)
+	{
+		WriteString(theEnv,STDERR,"tls-wrap: compression must be set after tls-wrap\n");
+		return;
+	}
+
+	theServer = GetServerContext(theEnv,theCert.lexemeValue,theKey.lexemeValue,"tls-wrap");
+	if (theServer == NULL) return;
+
+	if ((ssl = SSL_new(theServer->ctx)) == NULL)
+	{
+		WriteTlsError(theEnv,"tls-wrap","could not create TLS session");
+		return;
+	}
+
+	if (StartTls(theEnv,sptr,ssl,true,NULL,NULL,"tls-wrap"))
+	{ returnValue->lexemeValue = TrueSymbol(theEnv); }
+#endif
+}
+
+/***********************************************************/
+/* TlsConnectFunction: H/L access routine for tls-connect. */
+/*   Runs the client side of a handshake on a connected    */
+/*   socket, resuming the last session with the same peer  */
+/*   when there is one. The server's certificate is        */
+/*   checked against ?caFile, or the system's trusted      */
+/*   certificates if it is omitted, and against            */
+/*   ?serverName if given. A ?caFile of none skips the     */
+/*   check. Returns TRUE once the connection is encrypted. */
+/*   (tls-connect ?socket <?serverName> <?caFile>)         */
+/***********************************************************/
+void TlsConnectFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+#ifndef NO_OPENSSL
+	const char *serverName = NULL;
+	CLIPSLexeme *caFile = NULL, *peer;
+	struct tlsClientContext *theClient;
+	struct tlsSession *theSession;
+	SSL *ssl;
+#endif
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"tls-connect: could not find connection\n");
+		return;
+	}
+
+#ifdef NO_OPENSSL
+	WriteString(theEnv,STDERR,"tls-connect: built without OpenSSL\n");
+#else
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,LEXEME_BITS,&theArg);
+		serverName = theArg.lexemeValue->contents;
+	}
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,LEXEME_BITS,&theArg);
+		caFile = theArg.lexemeValue;
+	}
+
+	if (sptr->tls != NULL)
+	{
+		WriteString(theEnv,STDERR,"tls-connect: connection already uses TLS\n");
+		return;
+	}
+
+	if (sptr->compression != NULL)
+	{
+		WriteString(theEnv,STDERR,"tls-connect: compression must be set after tls-connect\n");
+		return;
+	}
+
+	theClient = GetClientContext(theEnv,caFile,"tls-connect");
+	if (theClient == NULL) return;
+
+	if ((ssl = SSL_new(theClient->ctx)) == NULL)
+	{
+		WriteTlsError(theEnv,"tls-connect","could not create TLS session");
+		return;
+	}
+
+	if (serverName != NULL)
+	{
+		SSL_set_tlsext_host_name(ssl,serverName);
+		SSL_set1_host(ssl,serverName);
+	}
+
+	peer = CreatePeerName(theEnv,fileno(sptr->stream),serverName);
+	if ((theSession = FindClientSession(theClient,peer)) != NULL)
+	{ SSL_set_session(ssl,theSession->session); }
+
+	if (StartTls(theEnv,sptr,ssl,false,theClient,peer->contents,"tls-connect"))
+	{ returnValue->lexemeValue = TrueSymbol(theEnv); }
+#endif
+}
+
+/***********************************************************/
+/* TlsInfoFunction: H/L access routine for tls-info.       */
+/*   Returns the protocol version, the cipher, whether the */
+/*   session was resumed and whether the kernel encrypts   */
+/*   and decrypts the connection, or FALSE if the          */
+/*   connection does not use TLS.                          */
+/*   (tls-info ?socket)                                    */
+/***********************************************************/
+void TlsInfoFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+#ifndef NO_OPENSSL
+	MultifieldBuilder *theMB;
+	SSL *ssl;
+#endif
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"tls-info: could not find connection\n");
+		return;
+	}
+
+#ifndef NO_OPENSSL
+	if (sptr->tls == NULL) return;
+
+	ssl = sptr->tls->ssl;
+	theMB = CreateMultifieldBuilder(theEnv,5);
+	MBAppendSymbol(theMB,SSL_get_version(ssl));
+	MBAppendSymbol(theMB,SSL_get_cipher_name(ssl));
+	MBAppendCLIPSLexeme(theMB,CreateBoolean(theEnv,SSL_session_reused(ssl)));
+	MBAppendCLIPSLexeme(theMB,CreateBoolean(theEnv,sptr->tls->kernelSend));
+	MBAppendCLIPSLexeme(theMB,CreateBoolean(theEnv,sptr->tls->kernelRecv));
+	returnValue->multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+#endif
+}
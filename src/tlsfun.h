@@ -0,0 +1,95 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*                TLS FUNCTIONS HEADER                 */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: OpenSSL backed TLS on socket connections, with   */
+/*   session resumption and kernel TLS offload.              */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_tlsfun
+
+#pragma once
+
+#define _H_tlsfun
+
+#include <stdio.h>
+
+#ifndef NO_OPENSSL
+#include <openssl/ssl.h>
+#endif
+
+#define TLS_DATA USER_ENVIRONMENT_DATA + 4
+
+#define TLS_SERVER_CACHE_SIZE 4096
+#define TLS_CLIENT_CACHE_SIZE 64
+#define TLS_SESSION_ID_CONTEXT "clips"
+#define TLS_NO_VERIFY "none"
+
+struct socketRouter;
+
+#ifndef NO_OPENSSL
+struct socketTls
+  {
+   SSL *ssl;
+   FILE *rawStream;
+   struct tlsClientContext *client;
+   char *peer;
+   bool kernelSend;
+   bool kernelRecv;
+  };
+
+struct tlsServerContext
+  {
+   CLIPSLexeme *certFile;
+   CLIPSLexeme *keyFile;
+   SSL_CTX *ctx;
+   struct tlsServerContext *next;
+  };
+
+struct tlsSession
+  {
+   CLIPSLexeme *peer;
+   SSL_SESSION *session;
+   struct tlsSession *next;
+  };
+
+struct tlsClientContext
+  {
+   CLIPSLexeme *caFile;
+   SSL_CTX *ctx;
+   struct tlsSession *sessions;
+   unsigned sessionCount;
+   struct tlsClientContext *next;
+  };
+
+struct tlsData
+  {
+   struct tlsServerContext *ListOfServerContexts;
+   struct tlsClientContext *ListOfClientContexts;
+  };
+
+#define TlsData(theEnv) ((struct tlsData *) GetEnvironmentData(theEnv,TLS_DATA))
+#endif
+
+   void                           TlsFunctionDefinitions(Environment *);
+   void                           EndTls(Environment *,struct socketRouter *);
+   bool                           TlsCanSendFile(struct socketRouter *);
+   long long                      TlsSendFile(Environment *,struct socketRouter *,int);
+   void                           TlsWrapFunction(Environment *,UDFContext *,UDFValue *);
+   void                           TlsConnectFunction(Environment *,UDFContext *,UDFValue *);
+   void                           TlsInfoFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_tlsfun */
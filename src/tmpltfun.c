@@ -109,6 +109,15 @@
 /*            Slot names in the modify/update/duplicate      */
 /*            functions can now be dynamically specified.    */
 /*                                                           */
+/*      ?.??: The modify command retains the partial matches */
+/*            of patterns that do not test the changed       */
+/*            slots, detaching them when the fact is         */
+/*            retracted and reattaching them in assert order */
+/*            when it is reasserted.                         */
+/*                                                           */
+/*            Matches reaching an aggregate join are not     */
+/*            retained by modify.                            */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -123,8 +132,11 @@
 #include "constant.h"
 #include "cstrnchk.h"
 #include "default.h"
+#include "drive.h"
+#include "engine.h"
 #include "envrnmnt.h"
 #include "exprnpsr.h"
+#include "factbld.h"
 #include "factfun.h"
 #include "factmch.h"
 #include "factmngr.h"
@@ -132,6 +144,7 @@
 #include "memalloc.h"
 #include "modulutl.h"
 #include "multifld.h"
+#include "pattern.h"
 #include "pprint.h"
 #include "prcdrpsr.h"
 #include "prntutil.h"
@@ -158,6 +171,14 @@
    static void                    FreeTemplateValueArray(Environment *,CLIPSValue *,Deftemplate *);
    static struct expr            *ModAndDupParse(Environment *,struct expr *,const char *,const char *);
    static void                    ModifyUpdateDriver(Environment *,UDFContext *,UDFValue *,bool);
+   static bool                    ModifyCanRetainMatches(Environment *,Fact *,CLIPSBitMap *);
+   static bool                    MatchCanBeRetained(Environment *,struct patternMatch *,Deftemplate *,CLIPSBitMap *);
+   static bool                    NodeTestsChangedSlots(struct factPatternNode *,CLIPSBitMap *);
+   static bool                    EntryJoinAllowsRetainedMatch(Environment *,struct joinNode *,Deftemplate *);
+   static bool                    LowerJoinAllowsRetainedMatch(Environment *,struct joinLink *,Deftemplate *);
+   static bool                    JoinPatternMatchesTemplate(Environment *,struct joinNode *,Deftemplate *);
+   static bool                    JoinTestsCanBeReevaluated(Environment *,struct joinNode *);
+   static bool                    ExpressionCanBeReevaluated(Environment *,struct expr *);
 
 /****************************************************************/
 /* DeftemplateFunctions: Initializes the deftemplate functions. */
@@ -678,6 +699,7 @@ Fact *ReplaceFact(
    Fact *theFact;
    Fact *factListPosition, *templatePosition;
    size_t factHash;
+   struct patternMatch *retainedMatches = NULL, *theMatch;
    
    if (oldFact->whichDeftemplate->named)
      {
@@ -753,6 +775,11 @@ Fact *ReplaceFact(
    oldFact->garbage = false;
    if (applyReactivity)
      { FactData(theEnv)->CurrentChangeMap = NULL; }
+   else
+     {
+      retainedMatches = oldFact->list;
+      oldFact->list = NULL;
+     }
 
    /*======================================*/
    /* Copy the new values to the old fact. */
@@ -779,12 +806,29 @@ Fact *ReplaceFact(
         }
      }
 
-   /*======================*/
-   /* Assert the new fact. */
-   /*======================*/
+   /*=================================================*/
+   /* Assert the new fact. Matches that were retained */
+   /* by the modify are reattached when the fact      */
+   /* reaches their patterns in the pattern network.  */
+   /*=================================================*/
 
+   FactData(theEnv)->RetainedMatches = retainedMatches;
    theFact = AssertDriver(oldFact,oldFact->factIndex,factListPosition,templatePosition,changeMap,applyReactivity);
 
+   /*===================================================*/
+   /* A retained match whose pattern wasn't reached is  */
+   /* reattached and retracted so that it's discarded   */
+   /* the way the retraction would have discarded it.   */
+   /*===================================================*/
+
+   while (FactData(theEnv)->RetainedMatches != NULL)
+     {
+      theMatch = FactData(theEnv)->RetainedMatches;
+      FactData(theEnv)->RetainedMatches = theMatch->next;
+      NetworkReattachMatch(theEnv,theMatch->theMatch,theMatch->matchingPattern);
+      NetworkRetractMatch(theEnv,theMatch);
+     }
+
    /*===============================================*/
    /* Call registered modify notification functions */
    /* for the new version of the fact.              */
@@ -848,6 +892,394 @@ struct patternMatch *NetworkRetractReplaceFact(
    return first;
   }
 
+/*************************************************************/
+/* NetworkRetractModifiedFact: Retracts a fact being changed */
+/*   by the modify command from the pattern and join         */
+/*   networks. Matches for patterns which don't test any of  */
+/*   the changed slots are detached from the network along   */
+/*   with their partial matches when reattaching them yields */
+/*   the same network state and agenda as a full retract and */
+/*   reassert. Returns the list of detached matches.         */
+/*************************************************************/
+struct patternMatch *NetworkRetractModifiedFact(
+  Environment *theEnv,
+  Fact *theFact,
+  CLIPSBitMap *changeMap)
+  {
+   struct patternMatch *theMatch, *nextMatch;
+   struct patternMatch *retained = NULL, *lastRetained = NULL;
+
+   if (! ModifyCanRetainMatches(theEnv,theFact,changeMap))
+     {
+      NetworkRetract(theEnv,theFact->list);
+      return NULL;
+     }
+
+   /*====================================================*/
+   /* Mark the matches that can't be retained before any */
+   /* match is retracted, so a match detached before one */
+   /* of them is retracted is recognized as going away.  */
+   /*====================================================*/
+
+   for (theMatch = theFact->list;
+        theMatch != NULL;
+        theMatch = theMatch->next)
+     {
+      if (! MatchCanBeRetained(theEnv,theMatch,theFact->whichDeftemplate,changeMap))
+        { theMatch->theMatch->deleting = true; }
+     }
+
+   /*===================================================*/
+   /* Retract or detach the matches in the order of the */
+   /* fact's list of matches, which is the order used   */
+   /* by NetworkRetract.                                */
+   /*===================================================*/
+
+   for (theMatch = theFact->list;
+        theMatch != NULL;
+        theMatch = nextMatch)
+     {
+      nextMatch = theMatch->next;
+
+      if (theMatch->theMatch->deleting)
+        {
+         NetworkRetractMatch(theEnv,theMatch);
+         continue;
+        }
+
+      NetworkDetachMatch(theEnv,theMatch);
+
+      theMatch->next = NULL;
+      if (lastRetained == NULL) retained = theMatch;
+      else lastRetained->next = theMatch;
+      lastRetained = theMatch;
+     }
+
+   return retained;
+  }
+
+/***********************************************************/
+/* ModifyCanRetainMatches: Determines whether any of the   */
+/*   matches of a modified fact can be retained. Goals,    */
+/*   facts with certainty factors, and facts whose name    */
+/*   slot is changed always use a full retract. So does a  */
+/*   modify from the actions of a rule with a logical CE   */
+/*   since the fact's logical support is recomputed.       */
+/***********************************************************/
+static bool ModifyCanRetainMatches(
+  Environment *theEnv,
+  Fact *theFact,
+  CLIPSBitMap *changeMap)
+  {
+   Deftemplate *theDeftemplate = theFact->whichDeftemplate;
+
+   if ((changeMap == NULL) ||
+       theFact->goal ||
+       theDeftemplate->cfd ||
+       (EngineData(theEnv)->TheLogicalJoin != NULL))
+     { return false; }
+
+   if (theDeftemplate->named &&
+       TestBitMap(changeMap->contents,0))
+     { return false; }
+
+   return true;
+  }
+
+/*************************************************************/
+/* MatchCanBeRetained: Determines if a match of a modified   */
+/*   fact can be detached and later reattached. The match    */
+/*   can't bind multifield slots, its pattern can't test the */
+/*   changed slots, and the tests it would reevaluate if it  */
+/*   was reasserted must not have side effects or depend on  */
+/*   globals. The joins it reaches must also allow it.       */
+/*************************************************************/
+static bool MatchCanBeRetained(
+  Environment *theEnv,
+  struct patternMatch *theMatch,
+  Deftemplate *theDeftemplate,
+  CLIPSBitMap *changeMap)
+  {
+   struct factPatternNode *theNode;
+   struct joinNode *theJoin;
+
+   if (theMatch->theMatch->binds[0].gm.theMatch->markers != NULL)
+     { return false; }
+
+   theNode = (struct factPatternNode *) theMatch->matchingPattern;
+   if (NodeTestsChangedSlots(theNode,changeMap))
+     { return false; }
+
+   if ((! ExpressionCanBeReevaluated(theEnv,theNode->header.rightHash)) ||
+       (! ExpressionCanBeReevaluated(theEnv,theNode->header.rightRange)))
+     { return false; }
+
+   for (;
+        theNode != NULL;
+        theNode = theNode->lastLevel)
+     {
+      if (! ExpressionCanBeReevaluated(theEnv,theNode->networkTest))
+        { return false; }
+     }
+
+   for (theJoin = theMatch->matchingPattern->entryJoin;
+        theJoin != NULL;
+        theJoin = theJoin->rightMatchNode)
+     {
+      if (! EntryJoinAllowsRetainedMatch(theEnv,theJoin,theDeftemplate))
+        { return false; }
+     }
+
+   return true;
+  }
+
+/***********************************************************/
+/* NodeTestsChangedSlots: Determines if a changed slot is  */
+/*   among the slots tested by a pattern's pattern network */
+/*   or join network tests.                                */
+/***********************************************************/
+static bool NodeTestsChangedSlots(
+  struct factPatternNode *theNode,
+  CLIPSBitMap *changeMap)
+  {
+   unsigned short i, compares;
+   CLIPSBitMap *testedSlots;
+
+   testedSlots = theNode->testedSlots;
+   if (testedSlots == NULL)
+     { return true; }
+
+   compares = (testedSlots->size < changeMap->size) ? testedSlots->size : changeMap->size;
+
+   for (i = 0; i < compares; i++)
+     {
+      if (testedSlots->contents[i] & changeMap->contents[i])
+        { return true; }
+     }
+
+   return false;
+  }
+
+/**************************************************************/
+/* EntryJoinAllowsRetainedMatch: Determines if a join entered */
+/*   by a match from the right allows the match to be kept.   */
+/*   Logical, goal, exists, and aggregate joins depend on the */
+/*   match being retracted. The join can't have a join from   */
+/*   the right above it, and a positive join can't have a     */
+/*   pattern for the fact's deftemplate above it, since the   */
+/*   fact may match that pattern after the modify. A not CE   */
+/*   join only requires that such patterns above it aren't    */
+/*   not, exists, or aggregate CEs. The partial matches it    */
+/*   creates don't contain the match, so the joins below it   */
+/*   aren't checked.                                          */
+/**************************************************************/
+static bool EntryJoinAllowsRetainedMatch(
+  Environment *theEnv,
+  struct joinNode *theJoin,
+  Deftemplate *theDeftemplate)
+  {
+   struct joinNode *theAncestor;
+   struct joinLink *theLink;
+
+   if (theJoin->logicalJoin || theJoin->goalJoin ||
+       (theJoin->goalExpression != NULL) ||
+       theJoin->joinFromTheRight ||
+       theJoin->patternIsExists ||
+       (theJoin->aggregate != NO_AGGREGATE))
+     { return false; }
+
+   if (! JoinTestsCanBeReevaluated(theEnv,theJoin))
+     { return false; }
+
+   for (theAncestor = theJoin->lastLevel;
+        theAncestor != NULL;
+        theAncestor = theAncestor->lastLevel)
+     {
+      if (theAncestor->joinFromTheRight)
+        { return false; }
+
+      if (! JoinPatternMatchesTemplate(theEnv,theAncestor,theDeftemplate))
+        { continue; }
+
+      if ((! theJoin->patternIsNegated) ||
+          theAncestor->patternIsNegated ||
+          theAncestor->patternIsExists ||
+          (theAncestor->aggregate != NO_AGGREGATE))
+        { return false; }
+     }
+
+   if (theJoin->patternIsNegated)
+     { return true; }
+
+   for (theLink = theJoin->nextLinks;
+        theLink != NULL;
+        theLink = theLink->next)
+     {
+      if (! LowerJoinAllowsRetainedMatch(theEnv,theLink,theDeftemplate))
+        { return false; }
+     }
+
+   return true;
+  }
+
+/************************************************************/
+/* LowerJoinAllowsRetainedMatch: Determines if a join below */
+/*   the entry join of a match allows the match to be kept. */
+/*   The join must be entered from the left, must not join  */
+/*   a pattern for the fact's deftemplate, and its partial  */
+/*   matches must not depend on its right memory being      */
+/*   emptied when the match is retracted.                   */
+/************************************************************/
+static bool LowerJoinAllowsRetainedMatch(
+  Environment *theEnv,
+  struct joinLink *theLink,
+  Deftemplate *theDeftemplate)
+  {
+   struct joinNode *theJoin = theLink->join;
+
+   if (theLink->enterDirection != LHS)
+     { return false; }
+
+   if (theJoin->logicalJoin || theJoin->goalJoin ||
+       (theJoin->goalExpression != NULL) ||
+       theJoin->joinFromTheRight ||
+       theJoin->patternIsNegated ||
+       theJoin->patternIsExists ||
+       (theJoin->aggregate != NO_AGGREGATE))
+     { return false; }
+
+   if (JoinPatternMatchesTemplate(theEnv,theJoin,theDeftemplate))
+     { return false; }
+
+   if (! JoinTestsCanBeReevaluated(theEnv,theJoin))
+     { return false; }
+
+   for (theLink = theJoin->nextLinks;
+        theLink != NULL;
+        theLink = theLink->next)
+     {
+      if (! LowerJoinAllowsRetainedMatch(theEnv,theLink,theDeftemplate))
+        { return false; }
+     }
+
+   return true;
+  }
+
+/*************************************************************/
+/* JoinPatternMatchesTemplate: Determines if the pattern of  */
+/*   a join is a fact pattern for a deftemplate or one of    */
+/*   its parents, and so may be matched by the modified fact */
+/*   either before or after the modify.                      */
+/*************************************************************/
+static bool JoinPatternMatchesTemplate(
+  Environment *theEnv,
+  struct joinNode *theJoin,
+  Deftemplate *theDeftemplate)
+  {
+   struct patternParser *theParser;
+   struct factPatternNode *theNode, *topNode;
+
+   if (theJoin->rightSideEntryStructure == NULL)
+     { return false; }
+
+   theParser = GetPatternParser(theEnv,theJoin->rhsType);
+   if ((theParser == NULL) ||
+       (theParser->entityType != &FactData(theEnv)->FactInfo))
+     { return false; }
+
+   for (theNode = (struct factPatternNode *) theJoin->rightSideEntryStructure;
+        theNode->lastLevel != NULL;
+        theNode = theNode->lastLevel)
+     { /* Do Nothing */ }
+
+   for (;
+        theDeftemplate != NULL;
+        theDeftemplate = theDeftemplate->parent)
+     {
+      for (topNode = theDeftemplate->patternNetwork;
+           topNode != NULL;
+           topNode = topNode->rightNode)
+        {
+         if (topNode == theNode)
+           { return true; }
+        }
+     }
+
+   return false;
+  }
+
+/*********************************************************/
+/* JoinTestsCanBeReevaluated: Determines if the tests of */
+/*   a join would give the same results if they were     */
+/*   evaluated again for the same partial matches.       */
+/*********************************************************/
+static bool JoinTestsCanBeReevaluated(
+  Environment *theEnv,
+  struct joinNode *theJoin)
+  {
+   return (ExpressionCanBeReevaluated(theEnv,theJoin->networkTest) &&
+           ExpressionCanBeReevaluated(theEnv,theJoin->secondaryNetworkTest) &&
+           ExpressionCanBeReevaluated(theEnv,theJoin->leftHash) &&
+           ExpressionCanBeReevaluated(theEnv,theJoin->rightHash) &&
+           ExpressionCanBeReevaluated(theEnv,theJoin->leftRange));
+  }
+
+/**************************************************************/
+/* ExpressionCanBeReevaluated: Determines if an expression    */
+/*   only calls functions without side effects whose results  */
+/*   depend on their arguments alone. Globals, deffunctions,  */
+/*   generic functions, and message handlers aren't allowed.  */
+/**************************************************************/
+static bool ExpressionCanBeReevaluated(
+  Environment *theEnv,
+  struct expr *theExp)
+  {
+   static const char *pureFunctions[] =
+     { "eq", "neq", "=", "<>", ">", ">=", "<", "<=", "and", "or", "not",
+       "+", "-", "*", "/", "div", "mod", "abs", "min", "max", "integer", "float",
+       "numberp", "integerp", "floatp", "symbolp", "stringp", "lexemep",
+       "multifieldp", "evenp", "oddp", "length$", "nth$", "member$", "subsetp",
+       "str-length", "str-compare", "str-index", "sub-string", "sym-cat",
+       "str-cat", "upcase", "lowcase", "create$", "first$", "rest$", "subseq$",
+       "expand$", NULL };
+   const char *theName;
+   int i;
+
+   for (;
+        theExp != NULL;
+        theExp = theExp->nextArg)
+     {
+      switch (theExp->type)
+        {
+         case FCALL:
+           theName = ExpressionFunctionCallName(theExp)->contents;
+           for (i = 0; pureFunctions[i] != NULL; i++)
+             {
+              if (strcmp(theName,pureFunctions[i]) == 0)
+                { break; }
+             }
+
+           if (pureFunctions[i] == NULL)
+             { return false; }
+           break;
+
+         case GCALL:
+         case PCALL:
+         case GBL_VARIABLE:
+         case MF_GBL_VARIABLE:
+         case DEFGLOBAL_PTR:
+         case HANDLER_GET:
+         case HANDLER_PUT:
+           return false;
+        }
+
+      if (! ExpressionCanBeReevaluated(theEnv,theExp->argList))
+        { return false; }
+     }
+
+   return true;
+  }
+
 /*******************************************************************/
 /* DuplicateCommand: H/L access routine for the duplicate command. */
 /*******************************************************************/
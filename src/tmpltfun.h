@@ -121,6 +121,7 @@
    bool                           DeftemplateSlotFacetValue(Environment *,Deftemplate *,const char *,const char *,UDFValue *);
    Fact                          *ReplaceFact(Environment *,Fact *,CLIPSValue *,CLIPSBitMap *,bool);
    struct patternMatch           *NetworkRetractReplaceFact(Environment *,struct patternMatch *,CLIPSBitMap *,bool);
+   struct patternMatch           *NetworkRetractModifiedFact(Environment *,Fact *,CLIPSBitMap *);
 
 #endif /* _H_tmpltfun */
 
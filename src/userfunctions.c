@@ -61,7 +61,16 @@
 #include <time.h>
 
 #include "clips.h"
+#include "compressfun.h"
+#include "jsonfun.h"
+#include "msgpackfun.h"
+#include "ratefun.h"
+#include "respfun.h"
+#include "routefun.h"
+#include "sbfun.h"
+#include "wsfun.h"
 #include "socketrtr.h"
+#include "tlsfun.h"
 
 void UserFunctions(Environment *);
 
@@ -572,6 +581,7 @@ void UserFunctions(
   Environment *env)
   {
 	  AddUDF(env,"accept","bl",1,1,"lsy",AcceptFunction,"AcceptFunction",NULL);
+	  AddUDF(env,"arena-statistics","bm",0,1,"lsy",ArenaStatisticsFunction,"ArenaStatisticsFunction",NULL);
 	  AddUDF(env,"bind-socket","bsy",2,3,";l;sy;l",BindSocketFunction,"BindSocketFunction",NULL);
 	  AddUDF(env,"connect","bl",2,3,";l;sy;l",ConnectFunction,"ConnectFunction",NULL);
 	  AddUDF(env,"close-connection","b",1,1,";lsy",CloseConnectionFunction,"CloseConnectionFunction",NULL);
@@ -582,17 +592,34 @@ void UserFunctions(
 	  AddUDF(env,"flush-connection","l",1,1,"lsy",FlushConnectionFunction,"FlushConnectionFunction",NULL);
 	  AddUDF(env,"get-socket-logical-name","y",1,1,"l",GetSocketLogicalNameFunction,"GetSocketLogicalNameFunction",NULL);
 	  AddUDF(env,"get-timeout","l",1,1,"lsy",GetTimeoutFunction,"GetTimeoutFunction",NULL);
-	  AddUDF(env,"getsockopt","bl",3,3,";lsy;sy;sy",GetsockoptFunction,"GetsockoptFunction",NULL);
+	  AddUDF(env,"getsockopt","bls",3,3,";lsy;sy;sy",GetsockoptFunction,"GetsockoptFunction",NULL);
 	  AddUDF(env,"listen","b",1,2,";lsy;l",ListenFunction,"ListenFunction",NULL);
 	  AddUDF(env,"poll","b",1,11,"sy;lsy;l;sy;",PollFunction,"PollFunction",NULL);
+	  AddUDF(env,"inherited-sockets","m",0,0,NULL,InheritedSocketsFunction,"InheritedSocketsFunction",NULL);
+	  AddUDF(env,"exec-with-sockets","b",1,1,"msy",ExecWithSocketsFunction,"ExecWithSocketsFunction",NULL);
+	  AddUDF(env,"send-fd","b",2,3,";lsy;lsy;sy",SendFdFunction,"SendFdFunction",NULL);
+	  AddUDF(env,"recv-fd","bm",1,1,"lsy",RecvFdFunction,"RecvFdFunction",NULL);
 	  AddUDF(env,"set-fully-buffered","b",1,1,"lsy",SetFullyBufferedFunction,"SetFullyBufferedFunction",NULL);
 	  AddUDF(env,"set-not-buffered","b",1,1,"lsy",SetNotBufferedFunction,"SetNotBufferedFunction",NULL);
 	  AddUDF(env,"set-line-buffered","b",1,1,"lsy",SetLineBufferedFunction,"SetLineBufferedFunction",NULL);
 	  AddUDF(env,"set-timeout","l",2,2,";lsy;l",SetTimeoutFunction,"SetTimeoutFunction",NULL);
-	  AddUDF(env,"setsockopt","l",4,4,";lsy;sy;sy;l",SetsockoptFunction,"SetsockoptFunction",NULL);
+	  AddUDF(env,"setsockopt","b",4,4,";lsy;sy;sy;lsyd",SetsockoptFunction,"SetsockoptFunction",NULL);
+	  AddUDF(env,"splice-connections","b",2,3,";lsy;lsy;l",SpliceConnectionsFunction,"SpliceConnectionsFunction",NULL);
+	  AddUDF(env,"splice-status","bm",1,1,"lsy",SpliceStatusFunction,"SpliceStatusFunction",NULL);
+	  AddUDF(env,"splice-step","l",0,1,"l",SpliceStepFunction,"SpliceStepFunction",NULL);
 	  AddUDF(env,"shutdown-connection","l",1,1,"lsy",ShutdownConnectionFunction,"ShutdownConnectionFunction",NULL);
 	  AddUDF(env,"resolve-domain-name","bm",1,1,"sy",ResolveDomainNameFunction,"ResolveDomainNameFunction",NULL);
 
+	  JsonFunctionDefinitions(env);
+	  RespFunctionDefinitions(env);
+	  MsgpackFunctionDefinitions(env);
+	  WsFunctionDefinitions(env);
+	  CompressionFunctionDefinitions(env);
+	  RouteFunctionDefinitions(env);
+	  RateLimitFunctionDefinitions(env);
+	  TlsFunctionDefinitions(env);
+	  StringBuilderFunctionDefinitions(env);
+
 	  AddUDF(env,"errno","l",0,0,NULL,ErrnoFunction,"ErrnoFunction",NULL);
 	  AddUDF(env,"errno-sym","yv",0,0,NULL,ErrnoSymFunction,"ErrnoSymFunction",NULL);
 
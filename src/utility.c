@@ -77,6 +77,12 @@
 /*                                                           */
 /*      7.00: Support for data driven backward chaining.     */
 /*                                                           */
+/*      ?.??: Added SBAppendLength for appending runs of     */
+/*            characters that are not null terminated.       */
+/*                                                           */
+/*            SBAppend, SBAppendInteger, and SBAppendFloat   */
+/*            grow the buffer by doubling.                   */
+/*                                                           */
 /*************************************************************/
 
 #include "setup.h"
@@ -1506,8 +1512,7 @@ void SBAppend(
   StringBuilder *theSB,
   const char *appendString)
   {
-   theSB->contents = AppendToString(theSB->sbEnv,appendString,
-                                    theSB->contents,&theSB->length,&theSB->bufferMaximum);
+   SBAppendLength(theSB,appendString,strlen(appendString));
   }
 
 /********************/
@@ -1517,12 +1522,40 @@ void SBAppendInteger(
   StringBuilder *theSB,
   long long value)
   {
-   const char *appendString;
+   char buffer[50];
+   int length;
+
+   length = snprintf(buffer,sizeof(buffer),"%lld",value);
 
-   appendString = LongIntegerToString(theSB->sbEnv,value);
+   SBAppendLength(theSB,buffer,(size_t) length);
+  }
+
+/*****************************************************/
+/* SBAppendLength: Appends length characters, which  */
+/*   need not be null terminated. The buffer doubles */
+/*   when it grows so that building a large string   */
+/*   from many short runs stays linear.              */
+/*****************************************************/
+void SBAppendLength(
+  StringBuilder *theSB,
+  const char *appendString,
+  size_t length)
+  {
+   size_t newSize;
+
+   if ((theSB->length + length + 1) > theSB->bufferMaximum)
+     {
+      newSize = theSB->bufferMaximum * 2;
+      if (newSize < (theSB->length + length + 1))
+        { newSize = theSB->length + length + 1; }
+
+      theSB->contents = (char *) genrealloc(theSB->sbEnv,theSB->contents,theSB->bufferMaximum,newSize);
+      theSB->bufferMaximum = newSize;
+     }
 
-   theSB->contents = AppendToString(theSB->sbEnv,appendString,
-                                    theSB->contents,&theSB->length,&theSB->bufferMaximum);
+   memcpy(&theSB->contents[theSB->length],appendString,length);
+   theSB->length += length;
+   theSB->contents[theSB->length] = EOS;
   }
 
 /******************/
@@ -1536,8 +1569,7 @@ void SBAppendFloat(
 
    appendString = FloatToString(theSB->sbEnv,value);
 
-   theSB->contents = AppendToString(theSB->sbEnv,appendString,
-                                    theSB->contents,&theSB->length,&theSB->bufferMaximum);
+   SBAppendLength(theSB,appendString,strlen(appendString));
   }
 
 /**************/
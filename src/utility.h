@@ -251,6 +251,7 @@ struct utilityData
    void                           SBAppend(StringBuilder *,const char *);
    void                           SBAppendInteger(StringBuilder *,long long);
    void                           SBAppendFloat(StringBuilder *,double);
+   void                           SBAppendLength(StringBuilder *,const char *,size_t);
    void                           SBAddChar(StringBuilder *,int);
    void                           SBReset(StringBuilder *);
    char                          *SBCopy(StringBuilder *);
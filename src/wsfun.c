@@ -0,0 +1,1151 @@
+/*******************************************************/
+/*      "C" Language Integrated Production System      */
+/*                                                     */
+/*            CLIPS Version ?.??  05/07/24             */
+/*                                                     */
+/*             WEBSOCKET FUNCTIONS MODULE              */
+/*******************************************************/
+
+/***********************************************************************/
+/* Purpose: Speaks the WebSocket protocol (RFC 6455) on socket         */
+/*   connections. Upgrades an HTTP connection, parses and unmasks      */
+/*   client frames in the connection's pending buffer (reassembling    */
+/*   fragmented messages and answering pings), and writes frames       */
+/*   straight to the connection's output buffer.                       */
+/*                                                                     */
+/* Principal Programmer(s):                                            */
+/*      Ryan P. Johnston                                               */
+/*                                                                     */
+/* Revision History:                                                   */
+/*                                                                     */
+/*      ?.??: Added this file.                                         */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "clips.h"
+
+#include "socketrtr.h"
+#include "wsfun.h"
+
+/***************************************/
+/* LOCAL INTERNAL FUNCTION DEFINITIONS */
+/***************************************/
+
+	static void                    Sha1Init(struct sha1Context *);
+	static void                    Sha1Transform(struct sha1Context *,const unsigned char *);
+	static void                    Sha1Update(struct sha1Context *,const void *,size_t);
+	static void                    Sha1Final(struct sha1Context *,unsigned char *);
+	static void                    Base64Encode(const unsigned char *,size_t,char *);
+	static const char             *FindHeaderValue(const char *,const char *,const char *,size_t *);
+	static void                    UnmaskWebSocketPayload(unsigned char *,size_t,const unsigned char *);
+	static void                    WriteWebSocketFrame(FILE *,int,const void *,size_t);
+	static void                    FailWebSocket(Environment *,struct socketRouter *,int,const char *,const char *);
+	static bool                    AppendWebSocketMessage(Environment *,struct socketRouter *,const char *,size_t);
+	static enum wsParseResult      NextWebSocketMessage(Environment *,struct socketRouter *,size_t *,struct wsMessage *,const char *);
+	static void                    WebSocketMessageValue(Environment *,struct wsMessage *,CLIPSValue *);
+	static struct socketRouter    *GetWebSocketConnection(Environment *,UDFContext *,const char *);
+	static Deftemplate            *GetWsMessageDeftemplate(Environment *);
+
+#define SHA1_ROTATE(value,bits) ((((value) << (bits)) | ((value) >> (32 - (bits)))) & 0xFFFFFFFFUL)
+
+/*************************************/
+/* WsFunctionDefinitions: Registers  */
+/*   the WebSocket functions.        */
+/*************************************/
+void WsFunctionDefinitions(
+		Environment *theEnv)
+{
+	AddUDF(theEnv,"ws-upgrade","bsy",1,1,"lsy",WsUpgradeFunction,"WsUpgradeFunction",NULL);
+	AddUDF(theEnv,"ws-send","b",2,3,";lsy;synldm;y",WsSendFunction,"WsSendFunction",NULL);
+	AddUDF(theEnv,"ws-close","b",1,3,";lsy;l;sy",WsCloseFunction,"WsCloseFunction",NULL);
+	AddUDF(theEnv,"ws-recv","bsym",1,1,"lsy",WsRecvFunction,"WsRecvFunction",NULL);
+	AddUDF(theEnv,"ws-read","bl",1,1,"lsy",WsReadFunction,"WsReadFunction",NULL);
+}
+
+/*************************************/
+/* Sha1Init: Starts a SHA-1 digest.  */
+/*************************************/
+static void Sha1Init(
+		struct sha1Context *context)
+{
+	context->state[0] = 0x67452301UL;
+	context->state[1] = 0xEFCDAB89UL;
+	context->state[2] = 0x98BADCFEUL;
+	context->state[3] = 0x10325476UL;
+	context->state[4] = 0xC3D2E1F0UL;
+	context->count = 0;
+	context->bufferLength = 0;
+}
+
+/************************************************/
+/* Sha1Transform: Digests one 64 byte block.    */
+/************************************************/
+static void Sha1Transform(
+		struct sha1Context *context,
+		const unsigned char *block)
+{
+	unsigned long w[80];
+	unsigned long a, b, c, d, e, f, k, temp;
+	int i;
+
+	for (i = 0; i < 16; i++)
+	{
+		w[i] = ((unsigned long) block[i*4] << 24) |
+		       ((unsigned long) block[i*4+1] << 16) |
+		       ((unsigned long) block[i*4+2] << 8) |
+		       ((unsigned long) block[i*4+3]);
+	}
+
+	for (i = 16; i < 80; i++)
+	{ w[i] = SHA1_ROTATE(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16],1); }
+
+	a = context->state[0];
+	b = context->state[1];
+	c = context->state[2];
+	d = context->state[3];
+	e = context->state[4];
+
+	for (i = 0; i < 80; i++)
+	{
+		if (i < 20)
+		{
+			f = (b & c) | ((~b) & d);
+			k = 0x5A827999UL;
+		}
+		else if (i < 40)
+		{
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1UL;
+		}
+		else if (i < 60)
+		{
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8F1BBCDCUL;
+		}
+		else
+		{
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6UL;
+		}
+
+		temp = (SHA1_ROTATE(a,5) + (f & 0xFFFFFFFFUL) + e + k + w[i]) & 0xFFFFFFFFUL;
+		e = d;
+		d = c;
+		c = SHA1_ROTATE(b,30);
+		b = a;
+		a = temp;
+	}
+
+	context->state[0] = (context->state[0] + a) & 0xFFFFFFFFUL;
+	context->state[1] = (context->state[1] + b) & 0xFFFFFFFFUL;
+	context->state[2] = (context->state[2] + c) & 0xFFFFFFFFUL;
+	context->state[3] = (context->state[3] + d) & 0xFFFFFFFFUL;
+	context->state[4] = (context->state[4] + e) & 0xFFFFFFFFUL;
+}
+
+/********************************************/
+/* Sha1Update: Adds bytes to a digest.      */
+/********************************************/
+static void Sha1Update(
+		struct sha1Context *context,
+		const void *data,
+		size_t length)
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	size_t i;
+
+	context->count += length;
+
+	for (i = 0; i < length; i++)
+	{
+		context->buffer[context->bufferLength++] = bytes[i];
+		if (context->bufferLength == 64)
+		{
+			Sha1Transform(context,context->buffer);
+			context->bufferLength = 0;
+		}
+	}
+}
+
+/***********************************************/
+/* Sha1Final: Pads the message and writes the  */
+/*   20 byte digest.                           */
+/***********************************************/
+static void Sha1Final(
+		struct sha1Context *context,
+		unsigned char *digest)
+{
+	unsigned long long bits = context->count * 8;
+	unsigned char length[8];
+	unsigned char pad = 0x80;
+	int i;
+
+	for (i = 0; i < 8; i++)
+	{ length[i] = (unsigned char) (bits >> (56 - (8 * i))); }
+
+	Sha1Update(context,&pad,1);
+	pad = 0;
+	while (context->bufferLength != 56)
+	{ Sha1Update(context,&pad,1); }
+	Sha1Update(context,length,8);
+
+	for (i = 0; i < 20; i++)
+	{ digest[i] = (unsigned char) (context->state[i / 4] >> (24 - (8 * (i % 4)))); }
+}
+
+/*****************************************************/
+/* Base64Encode: Writes the base64 encoding of bytes */
+/*   to text, which must hold 4 * ((length + 2) / 3) */
+/*   + 1 characters.                                 */
+/*****************************************************/
+static void Base64Encode(
+		const unsigned char *bytes,
+		size_t length,
+		char *text)
+{
+	static const char alphabet[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	unsigned long group;
+	size_t i;
+
+	for (i = 0; i < length; i += 3)
+	{
+		group = (unsigned long) bytes[i] << 16;
+		if ((i + 1) < length) group |= (unsigned long) bytes[i+1] << 8;
+		if ((i + 2) < length) group |= bytes[i+2];
+
+		*text++ = alphabet[(group >> 18) & 0x3F];
+		*text++ = alphabet[(group >> 12) & 0x3F];
+		*text++ = ((i + 1) < length) ? alphabet[(group >> 6) & 0x3F] : '=';
+		*text++ = ((i + 2) < length) ? alphabet[group & 0x3F] : '=';
+	}
+
+	*text = '\0';
+}
+
+/*************************************************************/
+/* FindHeaderValue: Finds a header by name (ignoring case)   */
+/*   among the header lines between start and end. Returns   */
+/*   its value with surrounding spaces trimmed, or NULL.     */
+/*************************************************************/
+static const char *FindHeaderValue(
+		const char *start,
+		const char *end,
+		const char *name,
+		size_t *length)
+{
+	size_t nameLength = strlen(name);
+	const char *line, *lineEnd, *value;
+
+	for (line = start; line < end; line = lineEnd + 2)
+	{
+		lineEnd = (const char *) memmem(line,(size_t) (end - line),"\r\n",2);
+		if (lineEnd == NULL)
+		{ lineEnd = end; }
+
+		if (((size_t) (lineEnd - line) > nameLength) &&
+		    (line[nameLength] == ':') &&
+		    (strncasecmp(line,name,nameLength) == 0))
+		{
+			value = line + nameLength + 1;
+			while ((value < lineEnd) && ((*value == ' ') || (*value == '\t')))
+			{ value++; }
+			while ((lineEnd > value) && ((lineEnd[-1] == ' ') || (lineEnd[-1] == '\t')))
+			{ lineEnd--; }
+			*length = (size_t) (lineEnd - value);
+			return value;
+		}
+	}
+
+	return NULL;
+}
+
+/*************************************************************/
+/* WsUpgradeFunction: H/L access function for ws-upgrade.    */
+/*   Reads an HTTP upgrade request from the connection and   */
+/*   answers it with 101 Switching Protocols, after which    */
+/*   the connection speaks WebSocket. Returns the request    */
+/*   target (such as "/updates"), nil if a non-blocking      */
+/*   connection has not yet received the whole request, or   */
+/*   FALSE if it is not a valid upgrade request (which is    */
+/*   answered with 400 Bad Request) or the peer has closed.  */
+/*   (ws-upgrade ?socket)                                    */
+/*************************************************************/
+void WsUpgradeFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	struct sha1Context sha1;
+	unsigned char digest[20];
+	char accept[29];
+	const char *headerEnd, *lineEnd, *target, *targetEnd;
+	const char *upgrade, *key, *version;
+	size_t upgradeLength, keyLength, versionLength, headerLength;
+	char *targetText;
+	bool eof, valid;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,"ws-upgrade: could not find connection\n");
+		return;
+	}
+
+	if (sptr->websocket)
+	{
+		WriteString(theEnv,STDERR,"ws-upgrade: connection has already been upgraded\n");
+		return;
+	}
+
+	/*==============================================*/
+	/* Read until the blank line ending the header. */
+	/*==============================================*/
+	while (true)
+	{
+		headerEnd = (sptr->pendingLength == 0) ? NULL :
+		            (const char *) memmem(sptr->pending,sptr->pendingLength,"\r\n\r\n",4);
+		if (headerEnd != NULL)
+		{ break; }
+
+		if (sptr->pendingLength > WS_MAX_HEADER_LENGTH)
+		{
+			WriteString(theEnv,STDERR,"ws-upgrade: request header too long\n");
+			ConsumeSocketPending(theEnv,sptr,sptr->pendingLength);
+			return;
+		}
+
+		if (! ReadSocketAvailable(theEnv,sptr,&eof))
+		{
+			perror("perror");
+			return;
+		}
+
+		headerEnd = (sptr->pendingLength == 0) ? NULL :
+		            (const char *) memmem(sptr->pending,sptr->pendingLength,"\r\n\r\n",4);
+		if (headerEnd != NULL)
+		{ break; }
+
+		if (eof)
+		{ return; }
+
+		if (GenFcntl(theEnv,SocketRouterFileno(sptr),F_GETFL,0) & O_NONBLOCK)
+		{
+			returnValue->lexemeValue = CreateSymbol(theEnv,"nil");
+			return;
+		}
+	}
+
+	headerLength = (size_t) (headerEnd - sptr->pending) + 4;
+
+	/*=============================================*/
+	/* The request line is GET <target> HTTP/1.1.  */
+	/*=============================================*/
+	lineEnd = (const char *) memmem(sptr->pending,headerLength,"\r\n",2);
+	target = NULL;
+	targetEnd = NULL;
+	if (((size_t) (lineEnd - sptr->pending) > 4) && (memcmp(sptr->pending,"GET ",4) == 0))
+	{
+		target = sptr->pending + 4;
+		targetEnd = (const char *) memchr(target,' ',(size_t) (lineEnd - target));
+	}
+
+	upgrade = FindHeaderValue(lineEnd + 2,headerEnd + 2,"Upgrade",&upgradeLength);
+	key = FindHeaderValue(lineEnd + 2,headerEnd + 2,"Sec-WebSocket-Key",&keyLength);
+	version = FindHeaderValue(lineEnd + 2,headerEnd + 2,"Sec-WebSocket-Version",&versionLength);
+
+	valid = (targetEnd != NULL) &&
+	        (upgrade != NULL) && (upgradeLength == 9) && (strncasecmp(upgrade,"websocket",9) == 0) &&
+	        (key != NULL) && (keyLength > 0) &&
+	        (version != NULL) && (versionLength == 2) && (memcmp(version,"13",2) == 0);
+
+	if (! valid)
+	{
+		WriteString(theEnv,STDERR,"ws-upgrade: not a WebSocket upgrade request\n");
+		fputs("HTTP/1.1 400 Bad Request\r\n"
+		      "Sec-WebSocket-Version: 13\r\n"
+		      "Content-Length: 0\r\n"
+		      "Connection: close\r\n\r\n",sptr->stream);
+		fflush(sptr->stream);
+		ConsumeSocketPending(theEnv,sptr,headerLength);
+		return;
+	}
+
+	Sha1Init(&sha1);
+	Sha1Update(&sha1,key,keyLength);
+	Sha1Update(&sha1,WS_GUID,strlen(WS_GUID));
+	Sha1Final(&sha1,digest);
+	Base64Encode(digest,sizeof(digest),accept);
+
+	fprintf(sptr->stream,
+	        "HTTP/1.1 101 Switching Protocols\r\n"
+	        "Upgrade: websocket\r\n"
+	        "Connection: Upgrade\r\n"
+	        "Sec-WebSocket-Accept: %s\r\n\r\n",accept);
+	fflush(sptr->stream);
+
+	targetText = (char *) gm2(theEnv,(size_t) (targetEnd - target) + 1);
+	memcpy(targetText,target,(size_t) (targetEnd - target));
+	targetText[targetEnd - target] = '\0';
+	returnValue->lexemeValue = CreateString(theEnv,targetText);
+	rm(theEnv,targetText,(size_t) (targetEnd - target) + 1);
+
+	/*================================================*/
+	/* Frames the client sent right after the header */
+	/* stay in the pending buffer for ws-recv.        */
+	/*================================================*/
+	ConsumeSocketPending(theEnv,sptr,headerLength);
+	sptr->websocket = true;
+	sptr->websocketClosed = false;
+	sptr->websocketOpcode = 0;
+}
+
+/*************************************************************/
+/* UnmaskWebSocketPayload: XORs a client frame's payload     */
+/*   with its 4 byte masking key in place, 32 or 16 bytes at */
+/*   a time with AVX2 or SSE2. Each vector block starts at a */
+/*   multiple of 4 bytes, so the broadcast key lines up.     */
+/*************************************************************/
+static void UnmaskWebSocketPayload(
+		unsigned char *data,
+		size_t length,
+		const unsigned char *mask)
+{
+	size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+	int key;
+
+	memcpy(&key,mask,sizeof(key));
+#endif
+
+#if defined(__AVX2__)
+	{
+		__m256i wideKey = _mm256_set1_epi32(key);
+
+		for (; (i + 32) <= length; i += 32)
+		{
+			__m256i block = _mm256_loadu_si256((const __m256i *) (data + i));
+			_mm256_storeu_si256((__m256i *) (data + i),_mm256_xor_si256(block,wideKey));
+		}
+	}
+#endif
+
+#if defined(__SSE2__)
+	{
+		__m128i narrowKey = _mm_set1_epi32(key);
+
+		for (; (i + 16) <= length; i += 16)
+		{
+			__m128i block = _mm_loadu_si128((const __m128i *) (data + i));
+			_mm_storeu_si128((__m128i *) (data + i),_mm_xor_si128(block,narrowKey));
+		}
+	}
+#endif
+
+	for (; i < length; i++)
+	{ data[i] ^= mask[i & 3]; }
+}
+
+/*************************************************************/
+/* WriteWebSocketFrame: Writes one unfragmented, unmasked    */
+/*   frame, as a server sends them. Not flushed.             */
+/*************************************************************/
+static void WriteWebSocketFrame(
+		FILE *stream,
+		int opcode,
+		const void *data,
+		size_t length)
+{
+	unsigned char header[10];
+	size_t headerLength;
+	int i;
+
+	header[0] = (unsigned char) (0x80 | opcode);
+
+	if (length < 126)
+	{
+		header[1] = (unsigned char) length;
+		headerLength = 2;
+	}
+	else if (length <= 0xFFFF)
+	{
+		header[1] = 126;
+		header[2] = (unsigned char) (length >> 8);
+		header[3] = (unsigned char) length;
+		headerLength = 4;
+	}
+	else
+	{
+		header[1] = 127;
+		for (i = 0; i < 8; i++)
+		{ header[2 + i] = (unsigned char) ((unsigned long long) length >> (56 - (8 * i))); }
+		headerLength = 10;
+	}
+
+	fwrite(header,1,headerLength,stream);
+	if (length > 0)
+	{ fwrite(data,1,length,stream); }
+}
+
+/*************************************************************/
+/* FailWebSocket: Reports a protocol error, sends a close    */
+/*   frame with the given status code and marks the          */
+/*   connection closed.                                      */
+/*************************************************************/
+static void FailWebSocket(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		int code,
+		const char *functionName,
+		const char *message)
+{
+	unsigned char payload[2];
+
+	WriteString(theEnv,STDERR,functionName);
+	WriteString(theEnv,STDERR,": ");
+	WriteString(theEnv,STDERR,message);
+	WriteString(theEnv,STDERR,"\n");
+
+	payload[0] = (unsigned char) (code >> 8);
+	payload[1] = (unsigned char) code;
+	WriteWebSocketFrame(sptr->stream,WS_OPCODE_CLOSE,payload,2);
+	fflush(sptr->stream);
+
+	sptr->websocketClosed = true;
+}
+
+/*******************************************************/
+/* AppendWebSocketMessage: Adds a fragment's payload   */
+/*   to the message being reassembled.                 */
+/*******************************************************/
+static bool AppendWebSocketMessage(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		const char *data,
+		size_t length)
+{
+	size_t newSize;
+	char *newMessage;
+
+	if ((sptr->websocketMessageLength + length) > WS_MAX_MESSAGE_LENGTH)
+	{ return false; }
+
+	if ((sptr->websocketMessageLength + length) > sptr->websocketMessageSize)
+	{
+		newSize = (sptr->websocketMessageSize == 0) ? BUFSIZ : sptr->websocketMessageSize * 2;
+		while (newSize < (sptr->websocketMessageLength + length))
+		{ newSize *= 2; }
+
+		newMessage = (char *) gm2(theEnv,newSize);
+		if (sptr->websocketMessageLength > 0)
+		{ memcpy(newMessage,sptr->websocketMessage,sptr->websocketMessageLength); }
+		if (sptr->websocketMessage != NULL)
+		{ rm(theEnv,sptr->websocketMessage,sptr->websocketMessageSize); }
+		sptr->websocketMessage = newMessage;
+		sptr->websocketMessageSize = newSize;
+	}
+
+	memcpy(sptr->websocketMessage + sptr->websocketMessageLength,data,length);
+	sptr->websocketMessageLength += length;
+
+	return true;
+}
+
+/*************************************************************/
+/* NextWebSocketMessage: Parses frames in the pending buffer */
+/*   from offset until a whole data message is available,    */
+/*   answering pings and close frames along the way. An      */
+/*   unfragmented message is returned in place in the        */
+/*   pending buffer; fragments are reassembled in the        */
+/*   connection's message buffer. Either way the message is  */
+/*   only valid until the pending buffer is consumed or the  */
+/*   next message is parsed.                                 */
+/*************************************************************/
+static enum wsParseResult NextWebSocketMessage(
+		Environment *theEnv,
+		struct socketRouter *sptr,
+		size_t *offset,
+		struct wsMessage *theMessage,
+		const char *functionName)
+{
+	unsigned char *p;
+	size_t available, headerLength;
+	unsigned long long length;
+	int opcode, i;
+	bool fin;
+
+	while (true)
+	{
+		p = (unsigned char *) sptr->pending + *offset;
+		available = sptr->pendingLength - *offset;
+
+		if (available < 2)
+		{ return WS_PARSE_INCOMPLETE; }
+
+		fin = (p[0] & 0x80) != 0;
+		opcode = p[0] & 0x0F;
+		length = p[1] & 0x7F;
+		headerLength = 2;
+
+		if (p[0] & 0x70)
+		{
+			FailWebSocket(theEnv,sptr,WS_CLOSE_PROTOCOL_ERROR,functionName,"reserved bits set in frame");
+			return WS_PARSE_ERROR;
+		}
+
+		if (! (p[1] & 0x80))
+		{
+			FailWebSocket(theEnv,sptr,WS_CLOSE_PROTOCOL_ERROR,functionName,"client frame is not masked");
+			return WS_PARSE_ERROR;
+		}
+
+		if (length == 126)
+		{
+			if (available < 4)
+			{ return WS_PARSE_INCOMPLETE; }
+			length = ((unsigned long long) p[2] << 8) | p[3];
+			headerLength = 4;
+		}
+		else if (length == 127)
+		{
+			if (available < 10)
+			{ return WS_PARSE_INCOMPLETE; }
+			length = 0;
+			for (i = 0; i < 8; i++)
+			{ length = (length << 8) | p[2 + i]; }
+			headerLength = 10;
+		}
+
+		if (length > WS_MAX_MESSAGE_LENGTH)
+		{
+			FailWebSocket(theEnv,sptr,WS_CLOSE_TOO_BIG,functionName,"frame too large");
+			return WS_PARSE_ERROR;
+		}
+
+		headerLength += 4;
+		if (available < (headerLength + length))
+		{ return WS_PARSE_INCOMPLETE; }
+
+		UnmaskWebSocketPayload(p + headerLength,(size_t) length,p + headerLength - 4);
+		*offset += headerLength + (size_t) length;
+		p += headerLength;
+
+		/*==========================================*/
+		/* Control frames may arrive between the    */
+		/* fragments of a message and are handled   */
+		/* here rather than returned.               */
+		/*==========================================*/
+		if (opcode & 0x08)
+		{
+			if ((! fin) || (length > WS_MAX_CONTROL_LENGTH))
+			{
+				FailWebSocket(theEnv,sptr,WS_CLOSE_PROTOCOL_ERROR,functionName,"invalid control frame");
+				return WS_PARSE_ERROR;
+			}
+
+			switch (opcode)
+			{
+				case WS_OPCODE_CLOSE:
+					WriteWebSocketFrame(sptr->stream,WS_OPCODE_CLOSE,p,(length >= 2) ? 2 : 0);
+					fflush(sptr->stream);
+					sptr->websocketClosed = true;
+					return WS_PARSE_CLOSED;
+
+				case WS_OPCODE_PING:
+					WriteWebSocketFrame(sptr->stream,WS_OPCODE_PONG,p,(size_t) length);
+					fflush(sptr->stream);
+					break;
+
+				case WS_OPCODE_PONG:
+					break;
+
+				default:
+					FailWebSocket(theEnv,sptr,WS_CLOSE_PROTOCOL_ERROR,functionName,"unknown control frame");
+					return WS_PARSE_ERROR;
+			}
+			continue;
+		}
+
+		if (opcode == WS_OPCODE_CONTINUATION)
+		{
+			if (sptr->websocketOpcode == 0)
+			{
+				FailWebSocket(theEnv,sptr,WS_CLOSE_PROTOCOL_ERROR,functionName,"continuation frame without a message");
+				return WS_PARSE_ERROR;
+			}
+
+			if (! AppendWebSocketMessage(theEnv,sptr,(const char *) p,(size_t) length))
+			{
+				FailWebSocket(theEnv,sptr,WS_CLOSE_TOO_BIG,functionName,"message too large");
+				return WS_PARSE_ERROR;
+			}
+
+			if (fin)
+			{
+				theMessage->opcode = sptr->websocketOpcode;
+				theMessage->data = sptr->websocketMessage;
+				theMessage->length = sptr->websocketMessageLength;
+				sptr->websocketOpcode = 0;
+				return WS_PARSE_MESSAGE;
+			}
+			continue;
+		}
+
+		if ((opcode != WS_OPCODE_TEXT) && (opcode != WS_OPCODE_BINARY))
+		{
+			FailWebSocket(theEnv,sptr,WS_CLOSE_PROTOCOL_ERROR,functionName,"unknown frame opcode");
+			return WS_PARSE_ERROR;
+		}
+
+		if (sptr->websocketOpcode != 0)
+		{
+			FailWebSocket(theEnv,sptr,WS_CLOSE_PROTOCOL_ERROR,functionName,"new message before the last one finished");
+			return WS_PARSE_ERROR;
+		}
+
+		if (fin)
+		{
+			theMessage->opcode = opcode;
+			theMessage->data = (const char *) p;
+			theMessage->length = (size_t) length;
+			return WS_PARSE_MESSAGE;
+		}
+
+		sptr->websocketOpcode = opcode;
+		sptr->websocketMessageLength = 0;
+		AppendWebSocketMessage(theEnv,sptr,(const char *) p,(size_t) length);
+	}
+}
+
+/*************************************************************/
+/* WebSocketMessageValue: Converts a message to a string for */
+/*   text, or a multifield of byte values for binary. Text   */
+/*   containing a null byte cannot be a CLIPS string and is  */
+/*   converted like binary.                                  */
+/*************************************************************/
+static void WebSocketMessageValue(
+		Environment *theEnv,
+		struct wsMessage *theMessage,
+		CLIPSValue *theValue)
+{
+	MultifieldBuilder *theMB;
+	char *text;
+	size_t i;
+
+	if ((theMessage->opcode == WS_OPCODE_TEXT) &&
+	    (memchr(theMessage->data,'\0',theMessage->length) == NULL))
+	{
+		text = (char *) gm2(theEnv,theMessage->length + 1);
+		memcpy(text,theMessage->data,theMessage->length);
+		text[theMessage->length] = '\0';
+		theValue->lexemeValue = CreateString(theEnv,text);
+		rm(theEnv,text,theMessage->length + 1);
+		return;
+	}
+
+	theMB = CreateMultifieldBuilder(theEnv,theMessage->length);
+	for (i = 0; i < theMessage->length; i++)
+	{ MBAppendInteger(theMB,(unsigned char) theMessage->data[i]); }
+	theValue->multifieldValue = MBCreate(theMB);
+	MBDispose(theMB);
+}
+
+/*******************************************************/
+/* GetWebSocketConnection: Gets a connection argument  */
+/*   that has been upgraded with ws-upgrade.           */
+/*******************************************************/
+static struct socketRouter *GetWebSocketConnection(
+		Environment *theEnv,
+		UDFContext *context,
+		const char *functionName)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+
+	if ((sptr = GetSocketRouterFromArgument(theEnv,context,&theArg)) == NULL)
+	{
+		WriteString(theEnv,STDERR,functionName);
+		WriteString(theEnv,STDERR,": could not find connection\n");
+		return NULL;
+	}
+
+	if (! sptr->websocket)
+	{
+		WriteString(theEnv,STDERR,functionName);
+		WriteString(theEnv,STDERR,": connection has not been upgraded with ws-upgrade\n");
+		return NULL;
+	}
+
+	return sptr;
+}
+
+/*************************************************************/
+/* WsSendFunction: H/L access function for ws-send. Writes   */
+/*   a text or binary message to the connection's output     */
+/*   buffer. A multifield payload is a list of byte values   */
+/*   and is sent as binary unless text is asked for.         */
+/*   (ws-send ?socket ?payload <text|binary>)                */
+/*************************************************************/
+void WsSendFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg, typeArg;
+	struct socketRouter *sptr;
+	CLIPSValue *fields;
+	unsigned char *bytes;
+	const char *text;
+	char buffer[64];
+	int opcode;
+	size_t i, length;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetWebSocketConnection(theEnv,context,"ws-send")) == NULL)
+	{ return; }
+
+	UDFNextArgument(context,LEXEME_BITS|NUMBER_BITS|INSTANCE_NAME_BIT|MULTIFIELD_BIT,&theArg);
+
+	opcode = (theArg.header->type == MULTIFIELD_TYPE) ? WS_OPCODE_BINARY : WS_OPCODE_TEXT;
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,SYMBOL_BIT,&typeArg);
+		if (strcmp(typeArg.lexemeValue->contents,"text") == 0)
+		{ opcode = WS_OPCODE_TEXT; }
+		else if (strcmp(typeArg.lexemeValue->contents,"binary") == 0)
+		{ opcode = WS_OPCODE_BINARY; }
+		else
+		{
+			WriteString(theEnv,STDERR,"ws-send: message type must be text or binary\n");
+			return;
+		}
+	}
+
+	if (sptr->websocketClosed)
+	{ return; }
+
+	switch (theArg.header->type)
+	{
+		case MULTIFIELD_TYPE:
+			fields = &theArg.multifieldValue->contents[theArg.begin];
+			length = theArg.range;
+			bytes = (unsigned char *) gm2(theEnv,(length == 0) ? 1 : length);
+			for (i = 0; i < length; i++)
+			{
+				if ((fields[i].header->type != INTEGER_TYPE) ||
+				    (fields[i].integerValue->contents < 0) ||
+				    (fields[i].integerValue->contents > 255))
+				{
+					WriteString(theEnv,STDERR,"ws-send: multifield payload must be byte values from 0 to 255\n");
+					rm(theEnv,bytes,(length == 0) ? 1 : length);
+					return;
+				}
+				bytes[i] = (unsigned char) fields[i].integerValue->contents;
+			}
+			WriteWebSocketFrame(sptr->stream,opcode,bytes,length);
+			rm(theEnv,bytes,(length == 0) ? 1 : length);
+			break;
+
+		case INTEGER_TYPE:
+			length = (size_t) snprintf(buffer,sizeof(buffer),"%lld",theArg.integerValue->contents);
+			WriteWebSocketFrame(sptr->stream,opcode,buffer,length);
+			break;
+
+		case FLOAT_TYPE:
+			length = (size_t) snprintf(buffer,sizeof(buffer),"%.15g",theArg.floatValue->contents);
+			WriteWebSocketFrame(sptr->stream,opcode,buffer,length);
+			break;
+
+		default:
+			text = theArg.lexemeValue->contents;
+			WriteWebSocketFrame(sptr->stream,opcode,text,strlen(text));
+			break;
+	}
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*************************************************************/
+/* WsCloseFunction: H/L access function for ws-close. Sends  */
+/*   a close frame with a status code (1000 by default) and  */
+/*   an optional reason, and flushes the connection. The     */
+/*   socket itself is left for close-connection.             */
+/*   (ws-close ?socket <?code> <?reason>)                    */
+/*************************************************************/
+void WsCloseFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	UDFValue theArg;
+	struct socketRouter *sptr;
+	unsigned char payload[WS_MAX_CONTROL_LENGTH];
+	long long code = WS_CLOSE_NORMAL;
+	size_t length, reasonLength = 0;
+	const char *reason = "";
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetWebSocketConnection(theEnv,context,"ws-close")) == NULL)
+	{ return; }
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,INTEGER_BIT,&theArg);
+		code = theArg.integerValue->contents;
+		if ((code < 1000) || (code > 4999))
+		{
+			WriteString(theEnv,STDERR,"ws-close: status code must be from 1000 to 4999\n");
+			return;
+		}
+	}
+
+	if (UDFHasNextArgument(context))
+	{
+		UDFNextArgument(context,LEXEME_BITS,&theArg);
+		reason = theArg.lexemeValue->contents;
+		reasonLength = strlen(reason);
+		if (reasonLength > (WS_MAX_CONTROL_LENGTH - 2))
+		{ reasonLength = WS_MAX_CONTROL_LENGTH - 2; }
+	}
+
+	if (sptr->websocketClosed)
+	{ return; }
+
+	payload[0] = (unsigned char) (code >> 8);
+	payload[1] = (unsigned char) code;
+	memcpy(payload + 2,reason,reasonLength);
+	length = reasonLength + 2;
+
+	WriteWebSocketFrame(sptr->stream,WS_OPCODE_CLOSE,payload,length);
+	fflush(sptr->stream);
+	sptr->websocketClosed = true;
+
+	returnValue->lexemeValue = TrueSymbol(theEnv);
+}
+
+/*************************************************************/
+/* WsRecvFunction: H/L access function for ws-recv. Returns  */
+/*   the next message on the connection: a string for text, */
+/*   a multifield of byte values for binary. A blocking      */
+/*   connection waits for a whole message; a non-blocking    */
+/*   one returns FALSE if none is complete yet. Returns EOF  */
+/*   once the connection is closed.                          */
+/*   (ws-recv ?socket)                                       */
+/*************************************************************/
+void WsRecvFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *sptr;
+	struct wsMessage theMessage;
+	enum wsParseResult rv;
+	CLIPSValue theValue;
+	size_t offset = 0;
+	bool eof = false, blocking;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetWebSocketConnection(theEnv,context,"ws-recv")) == NULL)
+	{ return; }
+
+	if (sptr->websocketClosed)
+	{
+		returnValue->lexemeValue = CreateSymbol(theEnv,"EOF");
+		return;
+	}
+
+	blocking = ! (GenFcntl(theEnv,SocketRouterFileno(sptr),F_GETFL,0) & O_NONBLOCK);
+
+	/*===============================================*/
+	/* Frames already buffered are tried before any  */
+	/* more input is read.                           */
+	/*===============================================*/
+	while (true)
+	{
+		rv = NextWebSocketMessage(theEnv,sptr,&offset,&theMessage,"ws-recv");
+		if ((rv != WS_PARSE_INCOMPLETE) || eof)
+		{ break; }
+
+		ConsumeSocketPending(theEnv,sptr,offset);
+		offset = 0;
+
+		if (! ReadSocketAvailable(theEnv,sptr,&eof))
+		{
+			perror("perror");
+			return;
+		}
+
+		if (! blocking && ! eof)
+		{
+			rv = NextWebSocketMessage(theEnv,sptr,&offset,&theMessage,"ws-recv");
+			break;
+		}
+	}
+
+	switch (rv)
+	{
+		case WS_PARSE_MESSAGE:
+			WebSocketMessageValue(theEnv,&theMessage,&theValue);
+			returnValue->value = theValue.value;
+			ConsumeSocketPending(theEnv,sptr,offset);
+			return;
+
+		case WS_PARSE_INCOMPLETE:
+			ConsumeSocketPending(theEnv,sptr,offset);
+			if (eof)
+			{
+				sptr->websocketClosed = true;
+				returnValue->lexemeValue = CreateSymbol(theEnv,"EOF");
+			}
+			return;
+
+		default:
+			ConsumeSocketPending(theEnv,sptr,sptr->pendingLength);
+			returnValue->lexemeValue = CreateSymbol(theEnv,"EOF");
+			return;
+	}
+}
+
+/*******************************************************/
+/* GetWsMessageDeftemplate: Returns the deftemplate    */
+/*   messages are asserted as, defining it the first   */
+/*   time it is needed (and again after a clear).      */
+/*******************************************************/
+static Deftemplate *GetWsMessageDeftemplate(
+		Environment *theEnv)
+{
+	Deftemplate *theDeftemplate;
+
+	theDeftemplate = FindDeftemplate(theEnv,WS_MESSAGE_DEFTEMPLATE);
+	if (theDeftemplate != NULL)
+	{ return theDeftemplate; }
+
+	if (Build(theEnv,"(deftemplate " WS_MESSAGE_DEFTEMPLATE
+	                 " (slot connection) (slot id) (slot type) (multislot data))") != BE_NO_ERROR)
+	{ return NULL; }
+
+	return FindDeftemplate(theEnv,WS_MESSAGE_DEFTEMPLATE);
+}
+
+/*************************************************************/
+/* WsReadFunction: H/L access function for ws-read. Reads    */
+/*   what is available on the connection (waiting if it is   */
+/*   blocking and nothing is) and asserts a ws-message fact  */
+/*   for each complete message, numbered by id within the    */
+/*   connection. The data slot holds the text as a string,   */
+/*   or the bytes of a binary message. Returns the number of */
+/*   messages, or FALSE once the connection is closed.       */
+/*   (ws-read ?socket)                                       */
+/*************************************************************/
+void WsReadFunction(
+		Environment *theEnv,
+		UDFContext *context,
+		UDFValue *returnValue)
+{
+	struct socketRouter *sptr;
+	struct wsMessage theMessage;
+	enum wsParseResult rv;
+	Deftemplate *theDeftemplate;
+	FactBuilder *theFB;
+	MultifieldBuilder *theMB;
+	CLIPSValue theValue;
+	size_t offset = 0;
+	long long count = 0;
+	GCBlock gcb;
+	bool eof;
+
+	returnValue->lexemeValue = FalseSymbol(theEnv);
+
+	if ((sptr = GetWebSocketConnection(theEnv,context,"ws-read")) == NULL)
+	{ return; }
+
+	if (sptr->websocketClosed)
+	{ return; }
+
+	if (((theDeftemplate = GetWsMessageDeftemplate(theEnv)) == NULL) ||
+	    theDeftemplate->implied)
+	{
+		WriteString(theEnv,STDERR,"ws-read: ws-message must be a deftemplate with connection, type and data slots\n");
+		return;
+	}
+
+	if (! ReadSocketAvailable(theEnv,sptr,&eof))
+	{
+		perror("perror");
+		return;
+	}
+
+	theFB = CreateFactBuilder(theEnv,WS_MESSAGE_DEFTEMPLATE);
+	theMB = CreateMultifieldBuilder(theEnv,1);
+
+	while ((rv = NextWebSocketMessage(theEnv,sptr,&offset,&theMessage,"ws-read")) == WS_PARSE_MESSAGE)
+	{
+		GCBlockStart(theEnv,&gcb);
+
+		if (sptr->logicalName != NULL)
+		{ FBPutSlotSymbol(theFB,"connection",sptr->logicalName); }
+		else
+		{ FBPutSlotInteger(theFB,"connection",SocketRouterFileno(sptr)); }
+
+		sptr->websocketMessageCount++;
+		FBPutSlotInteger(theFB,"id",sptr->websocketMessageCount);
+
+		WebSocketMessageValue(theEnv,&theMessage,&theValue);
+		if (theValue.header->type == MULTIFIELD_TYPE)
+		{ FBPutSlotSymbol(theFB,"type","binary"); }
+		else
+		{
+			FBPutSlotSymbol(theFB,"type","text");
+			MBAppend(theMB,&theValue);
+			theValue.multifieldValue = MBCreate(theMB);
+		}
+		FBPutSlot(theFB,"data",&theValue);
+
+		if (FBAssert(theFB) != NULL)
+		{ count++; }
+		else
+		{ FBAbort(theFB); }
+
+		GCBlockEnd(theEnv,&gcb);
+	}
+
+	MBDispose(theMB);
+	FBDispose(theFB);
+
+	if ((rv == WS_PARSE_CLOSED) || (rv == WS_PARSE_ERROR))
+	{
+		ConsumeSocketPending(theEnv,sptr,sptr->pendingLength);
+		if (count > 0)
+		{ returnValue->integerValue = CreateInteger(theEnv,count); }
+		return;
+	}
+
+	ConsumeSocketPending(theEnv,sptr,offset);
+
+	if (eof)
+	{ sptr->websocketClosed = true; }
+
+	if ((count > 0) || ! eof)
+	{ returnValue->integerValue = CreateInteger(theEnv,count); }
+}
@@ -0,0 +1,77 @@
+   /*******************************************************/
+   /*      "C" Language Integrated Production System      */
+   /*                                                     */
+   /*            CLIPS Version ?.??  05/07/24             */
+   /*                                                     */
+   /*             WEBSOCKET FUNCTIONS HEADER              */
+   /*******************************************************/
+
+/*************************************************************/
+/* Purpose: WebSocket (RFC 6455) upgrade handshake, frame    */
+/*   parsing and frame writing on socket connections.        */
+/*                                                           */
+/* Principal Programmer(s):                                  */
+/*      Ryan P. Johnston                                     */
+/*                                                           */
+/* Revision History:                                         */
+/*                                                           */
+/*      ?.??: Added this file.                               */
+/*                                                           */
+/*************************************************************/
+
+#ifndef _H_wsfun
+
+#pragma once
+
+#define _H_wsfun
+
+#include <stddef.h>
+
+#define WS_MESSAGE_DEFTEMPLATE "ws-message"
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_MAX_HEADER_LENGTH 8192
+#define WS_MAX_MESSAGE_LENGTH (16UL * 1024UL * 1024UL)
+#define WS_MAX_CONTROL_LENGTH 125
+
+#define WS_OPCODE_CONTINUATION 0x0
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_BINARY 0x2
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PING 0x9
+#define WS_OPCODE_PONG 0xA
+
+#define WS_CLOSE_NORMAL 1000
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+#define WS_CLOSE_TOO_BIG 1009
+
+enum wsParseResult
+  {
+   WS_PARSE_MESSAGE,
+   WS_PARSE_INCOMPLETE,
+   WS_PARSE_CLOSED,
+   WS_PARSE_ERROR
+  };
+
+struct wsMessage
+  {
+   int opcode;
+   const char *data;
+   size_t length;
+  };
+
+struct sha1Context
+  {
+   unsigned long state[5];
+   unsigned long long count;
+   unsigned char buffer[64];
+   size_t bufferLength;
+  };
+
+   void                           WsFunctionDefinitions(Environment *);
+   void                           WsUpgradeFunction(Environment *,UDFContext *,UDFValue *);
+   void                           WsSendFunction(Environment *,UDFContext *,UDFValue *);
+   void                           WsCloseFunction(Environment *,UDFContext *,UDFValue *);
+   void                           WsRecvFunction(Environment *,UDFContext *,UDFValue *);
+   void                           WsReadFunction(Environment *,UDFContext *,UDFValue *);
+
+#endif /* _H_wsfun */